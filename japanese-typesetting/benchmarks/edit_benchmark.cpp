@@ -0,0 +1,120 @@
+/**
+ * @file edit_benchmark.cpp
+ * @brief 入力中のテキストで送り幅を引き直す処理のベンチマーク
+ *
+ * 1文字挿入するたびに送り幅の累積和を作り直す場合と、送り幅の索引を更新する場合で、
+ * 挿入位置を含む行の幅を引き直すまでの時間を比較する。
+ * あわせて、索引を使った行分割（LineBreaker::breakPositions）でテキスト全体を分割し直す場合と、
+ * 編集した段落だけを分割し直す場合の時間を比較する（テキストは改行文字で区切った段落の並び）。
+ * 使い方: edit_benchmark [テキストの文字数] [挿入回数]
+ */
+
+#include "japanese_typesetting/core/style/style.h"
+#include "japanese_typesetting/core/typesetting/glyph_advance_cache.h"
+#include "japanese_typesetting/core/typesetting/line_break.h"
+#include "japanese_typesetting/core/typesetting/width_index.h"
+#include "japanese_typesetting/core/typesetting/width_kernels.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace japanese_typesetting::core;
+
+namespace {
+
+// 挿入を繰り返し、1回あたりの時間（マイクロ秒）を返す
+double measure(int edits, const std::function<int64_t(size_t)>& body, int64_t& result) {
+    uint32_t seed = 1;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < edits; ++i) {
+        seed = seed * 1103515245u + 12345u;
+        result ^= body(seed >> 4);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::micro>(elapsed).count() / edits;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t characters = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1 << 18;
+    int edits = argc > 2 ? std::atoi(argv[2]) : 2000;
+
+    const std::u32string sample = U"吾輩は猫である。名前はまだ無い。どこで生れたかとんと見当がつかぬ。ABC 123、「かぎ括弧」";
+    const size_t samplesPerParagraph = 8;
+    std::u32string original;
+    original.reserve(characters);
+    for (size_t count = 1; original.size() < characters; ++count) {
+        original.append(sample, 0, std::min(sample.size(), characters - original.size()));
+        if (count % samplesPerParagraph == 0 && original.size() < characters) {
+            original.push_back(U'\n');
+        }
+    }
+
+    style::Style style;
+    auto table = typesetting::GlyphAdvanceCache::getInstance().preload(style, false);
+    const int64_t lineUnits = typesetting::toLayoutUnit(style.getFontSize() * 40);
+    const char32_t typed = U'字';
+
+    std::printf("characters: %zu, edits: %d\n", characters, edits);
+
+    // 累積和の配列: 挿入のたびに作り直し、挿入位置を含む行の終わりを二分探索で求める
+    int64_t result = 0;
+    std::u32string text = original;
+    std::vector<int64_t> prefix;
+    double rebuild = measure(edits, [&](size_t random) {
+        size_t position = random % (text.size() + 1);
+        text.insert(text.begin() + position, typed);
+        prefix.resize(text.size() + 1);
+        typesetting::prefixAdvances(*table, text.data(), text.size(), prefix.data());
+        int64_t lineEnd = prefix[position] + lineUnits;
+        return static_cast<int64_t>(std::upper_bound(prefix.begin(), prefix.end(), lineEnd) - prefix.begin());
+    }, result);
+    std::printf("%-20s %10.3f us/edit\n", "rebuild prefix", rebuild);
+
+    // 送り幅の索引: 挿入した文字だけを更新し、行の終わりを木の探索で求める
+    typesetting::AdvanceWidthIndex index;
+    index.assign(*table, original.data(), original.size());
+    double indexed = measure(edits, [&](size_t random) {
+        size_t position = random % (index.size() + 1);
+        index.insert(position, *table, &typed, 1);
+        return static_cast<int64_t>(index.findPosition(index.prefix(position) + lineUnits));
+    }, result);
+    std::printf("%-20s %10.3f us/edit  (x%.1f)\n", "width index", indexed, rebuild / indexed);
+
+    // 行分割: 挿入のたびにテキスト全体を分割し直す場合と、以前の分割位置を使って編集した段落だけを分割し直す場合
+    // （全体の分割は時間がかかるため、回数を減らして測る）
+    typesetting::TypesettingRules rules;
+    rules.setDefaultJisX4051Rules();
+    unicode::UnicodeHandler unicodeHandler;
+    typesetting::LineBreaker breaker(rules, unicodeHandler);
+    const double lineWidth = style.getFontSize() * 40;
+
+    text = original;
+    index.assign(*table, text.data(), text.size());
+    double rebreakAll = measure(std::max(1, edits / 100), [&](size_t random) {
+        size_t position = random % (text.size() + 1);
+        text.insert(text.begin() + position, typed);
+        index.insert(position, *table, &typed, 1);
+        return static_cast<int64_t>(breaker.breakPositions(text, index, lineWidth).size());
+    }, result);
+    std::printf("%-20s %10.3f us/edit\n", "rebreak text", rebreakAll);
+
+    text = original;
+    index.assign(*table, text.data(), text.size());
+    std::vector<size_t> breaks = breaker.breakPositions(text, index, lineWidth);
+    double rebreakEdited = measure(edits, [&](size_t random) {
+        size_t position = random % (text.size() + 1);
+        text.insert(text.begin() + position, typed);
+        index.insert(position, *table, &typed, 1);
+        breaks = breaker.breakPositions(text, index, lineWidth, breaks, position, 0, 1);
+        return static_cast<int64_t>(breaks.size());
+    }, result);
+    std::printf("%-20s %10.3f us/edit  (x%.1f)\n", "rebreak paragraph", rebreakEdited, rebreakAll / rebreakEdited);
+
+    return result == 42 ? 1 : 0; // 結果を使い、最適化で計算が消えないようにする
+}
@@ -0,0 +1,244 @@
+/**
+ * @file layout_benchmark.cpp
+ * @brief 書字方向・行揃えに特殊化した行組みカーネルのベンチマーク
+ *
+ * 縦書きフラグと行揃えを実行時に判定しながら処理を分けて行う従来の実装と、
+ * 呼び出しごとに1回だけ分岐して特殊化されたカーネルを使う実装を比較する。
+ * 使い方: layout_benchmark [文字数] [繰り返し回数]
+ */
+
+#include "japanese_typesetting/core/font/shaped_run_cache.h"
+#include "japanese_typesetting/core/style/style.h"
+#include "japanese_typesetting/core/typesetting/glyph_advance_cache.h"
+#include "japanese_typesetting/core/typesetting/layout_arena.h"
+#include "japanese_typesetting/core/typesetting/layout_kernels.h"
+#include "japanese_typesetting/core/typesetting/line_adjustment.h"
+#include "japanese_typesetting/core/typesetting/typesetting_rules.h"
+#include "japanese_typesetting/core/typesetting/width_kernels.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory_resource>
+#include <string>
+
+using namespace japanese_typesetting::core;
+using typesetting::LayoutUnit;
+using typesetting::LineRange;
+
+namespace {
+
+// 従来の実装：縦書きフラグと行揃えを実行時に判定し、処理ごとに行を走査する
+namespace runtime_flags {
+
+void breakLines(const std::pmr::u32string& text, const typesetting::GlyphAdvanceTable& advances, LayoutUnit maxUnits,
+                std::pmr::vector<LineRange>& lines) {
+    std::pmr::vector<LayoutUnit> widths(text.length(), lines.get_allocator());
+    typesetting::gatherAdvances(advances, text.data(), text.length(), widths.data());
+    LineRange current{0, 0, 0, false};
+    for (size_t i = 0; i < text.length(); ++i) {
+        if (text[i] == U'\n') {
+            current.hasLineBreak = true;
+            lines.push_back(current);
+            current = LineRange{i + 1, 0, 0, false};
+            continue;
+        }
+        if (current.width + widths[i] > maxUnits && current.length > 0) {
+            lines.push_back(current);
+            current = LineRange{i, 0, 0, false};
+        }
+        current.length++;
+        current.width += widths[i];
+    }
+    if (current.length > 0) {
+        lines.push_back(current);
+    }
+}
+
+void applyProhibitionRules(const std::pmr::u32string& text, std::pmr::vector<LineRange>& lines,
+                           const typesetting::GlyphAdvanceTable& advances, const typesetting::TypesettingRules& rules) {
+    for (size_t i = 0; i + 1 < lines.size(); ++i) {
+        LineRange& current = lines[i];
+        LineRange& next = lines[i + 1];
+        if (current.hasLineBreak || next.length == 0) {
+            continue;
+        }
+        if (current.length > 0) {
+            char32_t last = text[current.start + current.length - 1];
+            if (rules.isLineEndProhibited(last)) {
+                LayoutUnit width = advances.getAdvanceUnits(last);
+                current.length--;
+                current.width -= width;
+                next.start--;
+                next.length++;
+                next.width += width;
+            }
+        }
+        if (next.length > 0) {
+            char32_t first = text[next.start];
+            if (rules.isLineStartProhibited(first)) {
+                LayoutUnit width = advances.getAdvanceUnits(first);
+                next.start++;
+                next.length--;
+                next.width -= width;
+                current.length++;
+                current.width += width;
+            }
+        }
+    }
+}
+
+void applyShaping(const std::pmr::u32string& text, std::pmr::vector<LineRange>& lines,
+                  const typesetting::GlyphAdvanceTable& advances, bool vertical) {
+    const std::shared_ptr<const font::FontFace>& face = advances.getFont();
+    if (!face) {
+        return;
+    }
+    uint32_t features = font::defaultShapingFeatures(vertical);
+    for (auto& line : lines) {
+        if (line.length == 0) {
+            continue;
+        }
+        auto run = font::ShapedRunCache::getInstance().shape(
+            *face, text.data() + line.start, line.length, advances.getKey().fontSize, vertical, features);
+        if (run->missingGlyphs == 0) {
+            LayoutUnit total = 0;
+            for (double advance : run->advances) {
+                total += typesetting::toLayoutUnit(advance);
+            }
+            line.width = total;
+        }
+    }
+}
+
+void applyJustification(const std::pmr::u32string& text, std::pmr::vector<LineRange>& lines,
+                        const typesetting::GlyphAdvanceTable& advances, const typesetting::TypesettingRules& rules,
+                        style::TextAlignment alignment, LayoutUnit maxUnits, std::pmr::vector<LayoutUnit>& deltas) {
+    deltas.assign(text.length(), 0);
+    std::pmr::vector<LayoutUnit> widths(text.length(), lines.get_allocator());
+    typesetting::gatherAdvances(advances, text.data(), text.length(), widths.data());
+    typesetting::LineAdjuster adjuster(lines.get_allocator().resource());
+    for (size_t index = 0; index < lines.size(); ++index) {
+        LineRange& line = lines[index];
+        if (line.length == 0) {
+            continue;
+        }
+        size_t adjustable = line.length;
+        if (rules.isHangingCharacter(text[line.start + line.length - 1])) {
+            adjustable--;
+        }
+        bool stretch = alignment == style::TextAlignment::Justify && !line.hasLineBreak && index + 1 < lines.size();
+        if (line.width > maxUnits || (stretch && line.width < maxUnits)) {
+            line.width = adjuster.adjust(text.data() + line.start, widths.data() + line.start, adjustable, line.width,
+                                         maxUnits, stretch, rules, deltas.data() + line.start);
+        }
+    }
+}
+
+void applyHanging(const std::pmr::u32string& text, std::pmr::vector<LineRange>& lines,
+                  const typesetting::GlyphAdvanceTable& advances, const typesetting::TypesettingRules& rules) {
+    for (auto& line : lines) {
+        if (line.length == 0) {
+            continue;
+        }
+        char32_t last = text[line.start + line.length - 1];
+        if (rules.isHangingCharacter(last)) {
+            line.width -= advances.getAdvanceUnits(last) / 2;
+        }
+    }
+}
+
+void layout(bool vertical, style::TextAlignment alignment, const std::pmr::u32string& text,
+            const typesetting::GlyphAdvanceTable& advances, const typesetting::TypesettingRules& rules,
+            LayoutUnit maxUnits, std::pmr::vector<LineRange>& lines, std::pmr::vector<LayoutUnit>& deltas) {
+    breakLines(text, advances, maxUnits, lines);
+    applyProhibitionRules(text, lines, advances, rules);
+    applyShaping(text, lines, advances, vertical);
+    applyHanging(text, lines, advances, rules);
+    applyJustification(text, lines, advances, rules, alignment, maxUnits, deltas);
+}
+
+} // namespace runtime_flags
+
+// 関数を繰り返し実行し、1文字あたりの時間（ナノ秒）を返す（揺らぎを抑えるため5回の最小値）
+double measure(size_t characters, int iterations, const std::function<size_t()>& body, size_t& result) {
+    result = body(); // ウォームアップ
+    double best = 0.0;
+    for (int round = 0; round < 5; ++round) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            result ^= body();
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        double nanoseconds = std::chrono::duration<double, std::nano>(elapsed).count();
+        if (round == 0 || nanoseconds < best) {
+            best = nanoseconds;
+        }
+    }
+    return best / (static_cast<double>(characters) * iterations);
+}
+
+const char* alignmentName(style::TextAlignment alignment) {
+    switch (alignment) {
+    case style::TextAlignment::Right:
+        return "right";
+    case style::TextAlignment::Center:
+        return "center";
+    case style::TextAlignment::Justify:
+        return "justify";
+    default:
+        return "left";
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t characters = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1 << 18;
+    int iterations = argc > 2 ? std::atoi(argv[2]) : 50;
+
+    // 句読点・括弧を含む本文を作る（禁則とぶら下げが頻繁に起きる）
+    const std::u32string sample = U"吾輩は猫である。名前はまだ無い。「どこで生れたか」とんと見当がつかぬ、何でも薄暗い所で泣いていた。";
+    std::pmr::u32string text;
+    text.reserve(characters);
+    while (text.size() < characters) {
+        text.append(sample, 0, std::min(sample.size(), characters - text.size()));
+    }
+
+    style::Style style;
+    typesetting::TypesettingRules rules;
+    rules.setDefaultJisX4051Rules();
+    const LayoutUnit maxUnits = typesetting::toLayoutUnit(style.getFontSize() * 20.5);
+
+    std::printf("characters: %zu, iterations: %d\n", text.size(), iterations);
+
+    // エンジンと同じく、確保済みの領域を使い回すアリーナで中間データを確保する
+    typesetting::LayoutArena arena;
+    size_t result = 0;
+    for (bool vertical : {false, true}) {
+        auto table = typesetting::GlyphAdvanceCache::getInstance().preload(style, vertical);
+        for (style::TextAlignment alignment : {style::TextAlignment::Left, style::TextAlignment::Justify}) {
+            double runtime = measure(text.size(), iterations, [&]() {
+                arena.reset();
+                std::pmr::vector<LineRange> lines(&arena);
+                std::pmr::vector<LayoutUnit> deltas(&arena);
+                runtime_flags::layout(vertical, alignment, text, *table, rules, maxUnits, lines, deltas);
+                return lines.size() + static_cast<size_t>(lines.back().width);
+            }, result);
+
+            double specialized = measure(text.size(), iterations, [&]() {
+                arena.reset();
+                typesetting::LineLayout layout(&arena);
+                typesetting::layoutLineRanges(typesetting::toWritingMode(vertical), alignment, text, *table, rules,
+                                              maxUnits, layout, nullptr);
+                return layout.lines.size() + static_cast<size_t>(layout.lines.back().width);
+            }, result);
+
+            std::printf("%-10s %-8s runtime flags %7.3f ns/char, specialized %7.3f ns/char  (x%.2f)\n",
+                        vertical ? "vertical" : "horizontal", alignmentName(alignment),
+                        runtime, specialized, runtime / specialized);
+        }
+    }
+
+    return result == 42 ? 1 : 0; // 結果を使い、最適化で計算が消えないようにする
+}
@@ -0,0 +1,101 @@
+/**
+ * @file vertical_form_benchmark.cpp
+ * @brief 縦書き用字形への置き換えのベンチマーク
+ *
+ * 1文字ずつstd::mapを引いて新しい文字列を作る従来の方法と、
+ * 候補の文字をベクトル命令で探してその場で置き換える方法を比較する。
+ * 使い方: vertical_form_benchmark [文字数] [繰り返し回数]
+ */
+
+#include "japanese_typesetting/core/typesetting/vertical_layout.h"
+#include "japanese_typesetting/core/typesetting/width_kernels.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <string>
+
+using namespace japanese_typesetting::core;
+
+namespace {
+
+// 従来の変換表
+const std::map<char32_t, char32_t> kMapForms = {
+    {U'(', U'︵'}, {U')', U'︶'}, {U'[', U'﹇'}, {U']', U'﹈'}, {U'{', U'︷'}, {U'}', U'︸'}, {U'<', U'︿'},
+    {U'>', U'﹀'}, {U'«', U'︽'}, {U'»', U'︾'}, {U'—', U'︱'}, {U'－', U'｜'}, {U'…', U'︙'},
+};
+
+std::u32string convertWithMap(const std::u32string& text) {
+    std::u32string result;
+    result.reserve(text.length());
+    for (char32_t ch : text) {
+        auto it = kMapForms.find(ch);
+        result.push_back(it != kMapForms.end() ? it->second : ch);
+    }
+    return result;
+}
+
+// 関数を繰り返し実行し、1文字あたりの時間（ナノ秒）を返す
+double measure(size_t characters, int iterations, const std::function<size_t()>& body, size_t& result) {
+    result = body(); // ウォームアップ
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        result ^= body();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    double nanoseconds = std::chrono::duration<double, std::nano>(elapsed).count();
+    return nanoseconds / (static_cast<double>(characters) * iterations);
+}
+
+std::u32string makeText(const std::u32string& sample, size_t characters) {
+    std::u32string text;
+    text.reserve(characters);
+    while (text.size() < characters) {
+        text.append(sample, 0, std::min(sample.size(), characters - text.size()));
+    }
+    return text;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t characters = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1 << 18;
+    int iterations = argc > 2 ? std::atoi(argv[2]) : 100;
+
+    unicode::UnicodeHandler unicodeHandler;
+    typesetting::VerticalLayoutProcessor processor(unicodeHandler);
+    std::printf("characters: %zu, iterations: %d\n", characters, iterations);
+
+    // かな・漢字だけの本文と、括弧・三点リーダーを含む本文
+    const std::u32string samples[] = {
+        U"吾輩は猫である。名前はまだ無い。どこで生れたかとんと見当がつかぬ。",
+        U"吾輩は猫である(名前はまだ無い)。どこで生れたか…とんと見当がつかぬ。",
+    };
+    const char* names[] = {"kana/kanji", "with brackets"};
+
+    size_t result = 0;
+    for (size_t s = 0; s < 2; ++s) {
+        const std::u32string text = makeText(samples[s], characters);
+        std::u32string work = text;
+
+        double map = measure(text.size(), iterations, [&]() {
+            return convertWithMap(text).size();
+        }, result);
+
+        // 置き換え後の文字列は元に戻らないため、毎回元の文字列を書き戻してから測る
+        double copy = measure(text.size(), iterations, [&]() {
+            work = text;
+            return work.size();
+        }, result);
+        double inPlace = measure(text.size(), iterations, [&]() {
+            work = text;
+            return processor.convertToVerticalInPlace(work);
+        }, result);
+
+        std::printf("%-14s std::map %7.3f ns/char, in place %7.3f ns/char (copy %.3f excluded)  (x%.2f)\n",
+                    names[s], map, inPlace - copy, copy, map / std::max(inPlace - copy, 1e-3));
+    }
+
+    return result == 42 ? 1 : 0; // 結果を使い、最適化で計算が消えないようにする
+}
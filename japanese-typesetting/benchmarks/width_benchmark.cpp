@@ -0,0 +1,110 @@
+/**
+ * @file width_benchmark.cpp
+ * @brief 送り幅の合計・累積和を求めるカーネルのベンチマーク
+ *
+ * 1文字ずつテーブルを引くループと、命令セットごとのカーネルを比較する。
+ * 使い方: width_benchmark [文字数] [繰り返し回数]
+ */
+
+#include "japanese_typesetting/core/style/style.h"
+#include "japanese_typesetting/core/typesetting/glyph_advance_cache.h"
+#include "japanese_typesetting/core/typesetting/width_kernels.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace japanese_typesetting::core;
+
+namespace {
+
+// 関数を繰り返し実行し、1文字あたりの時間（ナノ秒）を返す
+double measure(size_t characters, int iterations, const std::function<int64_t()>& body, int64_t& result) {
+    result = body(); // ウォームアップ
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        result ^= body();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    double nanoseconds = std::chrono::duration<double, std::nano>(elapsed).count();
+    return nanoseconds / (static_cast<double>(characters) * iterations);
+}
+
+const char* levelName(typesetting::SimdLevel level) {
+    switch (level) {
+    case typesetting::SimdLevel::AVX2:
+        return "avx2";
+    case typesetting::SimdLevel::SSE2:
+        return "sse2";
+    default:
+        return "scalar";
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t characters = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1 << 20;
+    int iterations = argc > 2 ? std::atoi(argv[2]) : 20;
+
+    // かな・漢字・句読点・ASCIIを混ぜた本文を作る
+    const std::u32string sample = U"吾輩は猫である。名前はまだ無い。どこで生れたかとんと見当がつかぬ。ABC 123、「かぎ括弧」";
+    std::u32string text;
+    text.reserve(characters);
+    while (text.size() < characters) {
+        text.append(sample, 0, std::min(sample.size(), characters - text.size()));
+    }
+
+    style::Style style;
+    auto table = typesetting::GlyphAdvanceCache::getInstance().preload(style, true);
+    std::vector<int64_t> prefix(text.size() + 1);
+
+    std::printf("characters: %zu, iterations: %d, supported: %s\n",
+                text.size(), iterations, levelName(typesetting::getSupportedSimdLevel()));
+
+    int64_t result = 0;
+    double scalarSum = measure(text.size(), iterations, [&]() {
+        int64_t sum = 0;
+        for (char32_t ch : text) {
+            sum += table->getAdvanceUnits(ch);
+        }
+        return sum;
+    }, result);
+    std::printf("%-24s %8.3f ns/char\n", "sum (scalar loop)", scalarSum);
+
+    double scalarPrefix = measure(text.size(), iterations, [&]() {
+        int64_t running = 0;
+        prefix[0] = 0;
+        for (size_t i = 0; i < text.size(); ++i) {
+            running += table->getAdvanceUnits(text[i]);
+            prefix[i + 1] = running;
+        }
+        return prefix.back();
+    }, result);
+    std::printf("%-24s %8.3f ns/char\n", "prefix (scalar loop)", scalarPrefix);
+
+    for (typesetting::SimdLevel level : {typesetting::SimdLevel::Scalar, typesetting::SimdLevel::SSE2,
+                                         typesetting::SimdLevel::AVX2}) {
+        typesetting::setSimdLevel(level);
+        if (typesetting::getSimdLevel() != level) {
+            continue;
+        }
+
+        std::string name = std::string("sum (") + levelName(level) + ")";
+        double kernelSum = measure(text.size(), iterations, [&]() {
+            return typesetting::sumAdvances(*table, text.data(), text.size());
+        }, result);
+        std::printf("%-24s %8.3f ns/char  (x%.2f)\n", name.c_str(), kernelSum, scalarSum / kernelSum);
+
+        name = std::string("prefix (") + levelName(level) + ")";
+        double kernelPrefix = measure(text.size(), iterations, [&]() {
+            typesetting::prefixAdvances(*table, text.data(), text.size(), prefix.data());
+            return prefix.back();
+        }, result);
+        std::printf("%-24s %8.3f ns/char  (x%.2f)\n", name.c_str(), kernelPrefix, scalarPrefix / kernelPrefix);
+    }
+
+    return result == 42 ? 1 : 0; // 結果を使い、最適化で計算が消えないようにする
+}
@@ -35,6 +35,7 @@ struct CommandLineOptions {
     std::string fontFamily;           ///< フォントファミリー
     double fontSize;                  ///< フォントサイズ（pt）
     double lineHeight;                ///< 行の高さ（倍率）
+    std::string layoutCacheDir;       ///< 組版結果キャッシュのディレクトリ（空の場合は使わない）
     bool verbose;                     ///< 詳細出力フラグ
     bool help;                        ///< ヘルプ表示フラグ
     bool version;                     ///< バージョン表示フラグ
@@ -98,26 +99,26 @@ private:
     core::style::Style loadStyle(const std::string& filePath);
 
     /**
-     * @brief 文書を組版する
+     * @brief 文書を組版しながら結果を出力する
      * @param document 文書
      * @param style スタイル
      * @param options コマンドラインオプション
-     * @return 組版されたテキストブロックのリスト
+     * @return 成功した場合はtrue
+     *
+     * テキストブロックは1つずつ組版して書き出すため、文書全体の組版結果は保持しない。
      */
-    std::vector<core::typesetting::TextBlock> typesetDocument(
+    bool outputResult(
         const core::document::Document& document,
         const core::style::Style& style,
         const CommandLineOptions& options);
 
     /**
-     * @brief 組版結果を出力する
-     * @param blocks 組版されたテキストブロックのリスト
-     * @param options コマンドラインオプション
-     * @return 成功した場合はtrue
+     * @brief 数値の引数を解析する
+     * @param text 引数
+     * @param value 解析した値の格納先（解析できない場合は変更しない）
+     * @return 有限の数値として解析できた場合はtrue（できない場合はエラーを表示する）
      */
-    bool outputResult(
-        const std::vector<core::typesetting::TextBlock>& blocks,
-        const CommandLineOptions& options);
+    bool parseNumber(const std::string& text, double& value) const;
 
     /**
      * @brief エラーメッセージを表示する
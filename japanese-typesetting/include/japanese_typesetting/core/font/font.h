@@ -0,0 +1,207 @@
+/**
+ * @file font.h
+ * @brief フォントの読み込みとテキストのシェーピング
+ */
+
+#ifndef JAPANESE_TYPESETTING_CORE_FONT_FONT_H
+#define JAPANESE_TYPESETTING_CORE_FONT_FONT_H
+
+#include "japanese_typesetting/core/font/mapped_file.h"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// FreeType・HarfBuzzのヘッダを公開ヘッダに含めないための前方宣言
+struct FT_LibraryRec_;
+struct FT_FaceRec_;
+struct hb_blob_t;
+struct hb_face_t;
+struct hb_font_t;
+
+namespace japanese_typesetting {
+namespace core {
+namespace font {
+
+/**
+ * @enum ShapingFeature
+ * @brief シェーピング時に有効にするOpenType機能のビットフラグ
+ */
+enum ShapingFeature : uint32_t {
+    FeatureNone = 0,          ///< 機能なし
+    FeatureVert = 1u << 0,    ///< 縦書き字形（vert）
+    FeatureVrt2 = 1u << 1,    ///< 縦書き用回転字形（vrt2）
+    FeatureVkrn = 1u << 2,    ///< 縦書き用カーニング（vkrn）
+    FeatureKern = 1u << 3     ///< 横書き用カーニング（kern）
+};
+
+/**
+ * @brief 書字方向に応じた既定のシェーピング機能を取得
+ * @param vertical 縦書きの場合はtrue
+ * @return 機能のビットフラグ
+ */
+uint32_t defaultShapingFeatures(bool vertical);
+
+/**
+ * @struct FontLocation
+ * @brief フォントファイル内のフェイスの位置を表す構造体
+ */
+struct FontLocation {
+    std::string filePath;   ///< フォントファイルのパス（見つからない場合は空）
+    int faceIndex = 0;      ///< フォントコレクション内のフェイス番号
+};
+
+/**
+ * @struct ShapedRun
+ * @brief シェーピングされたテキストランを表す構造体
+ *
+ * 各配列はグリフごとの値を同じ順序で保持する。
+ * 送り幅とオフセットはポイント単位で、縦書きでは下方向を正とする。
+ */
+struct ShapedRun {
+    std::vector<uint32_t> glyphIds;   ///< グリフID
+    std::vector<uint32_t> clusters;   ///< 元のテキスト内の文字位置
+    std::vector<double> advances;     ///< 書字方向の送り幅
+    std::vector<double> xOffsets;     ///< X方向のオフセット
+    std::vector<double> yOffsets;     ///< Y方向のオフセット
+    double totalAdvance = 0.0;        ///< 送り幅の合計
+    size_t missingGlyphs = 0;         ///< フォントにグリフがなかった文字数
+};
+
+/**
+ * @class FontFace
+ * @brief フォントファイルから読み込んだ1つのフェイス
+ *
+ * FreeTypeでメトリクスを取得し、HarfBuzzが利用できる場合はシェーピングに用いる。
+ * FreeTypeのフェイスはスレッドセーフではないため、内部でロックして使用する。
+ * HarfBuzzのフォントは作成後に変更不可とするため、ロックせずに複数スレッドから共有する。
+ */
+class FontFace {
+public:
+    /**
+     * @brief フォントファイルを開く
+     * @param filePath フォントファイルのパス
+     * @param faceIndex フォントコレクション内のフェイス番号
+     * @return フォントフェイス、読み込めない場合はnullptr
+     */
+    static std::shared_ptr<FontFace> open(const std::string& filePath, int faceIndex = 0);
+
+    /**
+     * @brief メモリマップ済みのフォントファイルからフェイスを開く
+     * @param file フォントファイル（フェイスが参照を保持する）
+     * @param faceIndex フォントコレクション内のフェイス番号
+     * @return フォントフェイス、読み込めない場合はnullptr
+     */
+    static std::shared_ptr<FontFace> open(std::shared_ptr<const MappedFile> file, int faceIndex = 0);
+
+    /**
+     * @brief フォントファミリー名からフォントファイルを探す
+     * @param family フォントファミリー名、またはフォントファイルのパス
+     * @param bold 太字を探す場合はtrue
+     * @param italic 斜体を探す場合はtrue
+     * @return フォントの位置、見つからない場合はfilePathが空
+     *
+     * 環境変数JAPANESE_TYPESETTING_FONT_PATHと各OSの標準フォントディレクトリを検索する。
+     * 「Mincho」「Gothic」は代表的な明朝体・ゴシック体のファミリーに読み替える。
+     * フォントディレクトリの走査結果はプロセス内でキャッシュされる。
+     */
+    static FontLocation findFontFile(const std::string& family, bool bold = false, bool italic = false);
+
+    /**
+     * @brief デストラクタ
+     */
+    ~FontFace();
+
+    FontFace(const FontFace&) = delete;
+    FontFace& operator=(const FontFace&) = delete;
+
+    /**
+     * @brief フォントを識別する番号を取得（プロセス内で一意）
+     * @return 識別番号
+     */
+    uint32_t getId() const;
+
+    /**
+     * @brief フォントファイルのパスを取得
+     * @return パス
+     */
+    const std::string& getFilePath() const;
+
+    /**
+     * @brief フォントファイルを取得
+     * @return メモリマップしたフォントファイル
+     */
+    const std::shared_ptr<const MappedFile>& getFile() const;
+
+    /**
+     * @brief フォントファミリー名を取得
+     * @return ファミリー名
+     */
+    const std::string& getFamilyName() const;
+
+    /**
+     * @brief 1emあたりのフォント単位数を取得
+     * @return フォント単位数
+     */
+    int getUnitsPerEm() const;
+
+    /**
+     * @brief 文字に対応するグリフがあるかどうかを判定
+     * @param character 文字（UTF-32）
+     * @return グリフがある場合はtrue
+     */
+    bool hasGlyph(char32_t character) const;
+
+    /**
+     * @brief 文字の送り幅を取得
+     * @param character 文字（UTF-32）
+     * @param fontSize フォントサイズ（ポイント）
+     * @param vertical 縦書きの場合はtrue
+     * @return 送り幅（ポイント）、グリフがない場合は負値
+     */
+    double getAdvance(char32_t character, double fontSize, bool vertical) const;
+
+    /**
+     * @brief テキストをシェーピングする
+     * @param text テキスト（UTF-32）
+     * @param length 文字数
+     * @param fontSize フォントサイズ（ポイント）
+     * @param vertical 縦書きの場合はtrue
+     * @param features 有効にするOpenType機能（ShapingFeatureの組み合わせ）
+     * @return シェーピング結果
+     *
+     * HarfBuzzが利用できない場合は、文字ごとのグリフと送り幅を返す。
+     */
+    ShapedRun shape(const char32_t* text, size_t length, double fontSize, bool vertical, uint32_t features) const;
+
+    /**
+     * @brief HarfBuzzによるシェーピングが利用できるかどうか
+     * @return 利用できる場合はtrue
+     */
+    static bool isShapingAvailable();
+
+private:
+    /**
+     * @brief コンストラクタ
+     */
+    FontFace();
+
+    uint32_t m_id;                          ///< 識別番号
+    std::string m_filePath;                 ///< フォントファイルのパス
+    std::string m_familyName;               ///< ファミリー名
+    std::shared_ptr<const MappedFile> m_file; ///< フォントファイル
+    FT_LibraryRec_* m_library;              ///< FreeTypeライブラリ
+    FT_FaceRec_* m_face;                    ///< FreeTypeフェイス
+    hb_blob_t* m_hbBlob;                    ///< HarfBuzzブロブ
+    hb_face_t* m_hbFace;                    ///< HarfBuzzフェイス
+    hb_font_t* m_hbFont;                    ///< HarfBuzzフォント
+    int m_unitsPerEm;                       ///< 1emあたりのフォント単位数
+    mutable std::mutex m_mutex;             ///< FreeType呼び出し用のロック
+};
+
+} // namespace font
+} // namespace core
+} // namespace japanese_typesetting
+
+#endif // JAPANESE_TYPESETTING_CORE_FONT_FONT_H
@@ -0,0 +1,142 @@
+/**
+ * @file font_registry.h
+ * @brief プロセス全体で共有するフォントの登録簿
+ */
+
+#ifndef JAPANESE_TYPESETTING_CORE_FONT_FONT_REGISTRY_H
+#define JAPANESE_TYPESETTING_CORE_FONT_FONT_REGISTRY_H
+
+#include "japanese_typesetting/core/font/font.h"
+#include "japanese_typesetting/core/font/mapped_file.h"
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace japanese_typesetting {
+namespace core {
+namespace font {
+
+/**
+ * @struct FontRegistryStats
+ * @brief フォント登録簿の統計情報
+ */
+struct FontRegistryStats {
+    size_t fileCount = 0;      ///< 保持しているフォントファイル数
+    size_t faceCount = 0;      ///< 保持しているフェイス数
+    size_t memoryUsage = 0;    ///< 保持しているフォントファイルの合計サイズ（バイト）
+    size_t releasedMemoryUsage = 0; ///< 登録簿から外したが参照が残りマップされたままのファイルの合計サイズ（バイト）
+    size_t hits = 0;           ///< 登録済みのフェイス・ファイルが再利用された回数
+    size_t misses = 0;         ///< 新たに開いた回数
+    size_t evictions = 0;      ///< 上限を超えたため破棄した回数
+};
+
+/**
+ * @class FontRegistry
+ * @brief フォントファイルとフェイスをプロセス全体で共有する登録簿
+ *
+ * 各フォントファイルは1度だけメモリマップされ、組版エンジン・出力エンジン・
+ * スレッドの間で共有される。保持しているファイルの合計サイズが上限を超えた場合は、
+ * 最も長く参照されていないものから登録簿を外れる。登録簿を外れたフェイスやファイルも、
+ * 取得済みの参照が残っている間は有効なままとなる。その間に同じファイルを取得した場合は、
+ * 残っているマップを登録し直して返す（同じファイルを2度マップしない）。
+ */
+class FontRegistry {
+public:
+    /**
+     * @brief プロセス全体で共有されるインスタンスを取得する
+     * @return 登録簿のインスタンス
+     */
+    static FontRegistry& getInstance();
+
+    /**
+     * @brief コンストラクタ
+     * @param memoryLimit 保持するフォントファイルの合計サイズの上限（バイト）
+     */
+    explicit FontRegistry(size_t memoryLimit = 256 * 1024 * 1024);
+
+    /**
+     * @brief デストラクタ
+     */
+    ~FontRegistry();
+
+    FontRegistry(const FontRegistry&) = delete;
+    FontRegistry& operator=(const FontRegistry&) = delete;
+
+    /**
+     * @brief フェイスを取得（未登録なら開いて登録する）
+     * @param location フォントの位置
+     * @return フォントフェイス、開けない場合はnullptr
+     */
+    std::shared_ptr<const FontFace> getFace(const FontLocation& location);
+
+    /**
+     * @brief フォントファイルを取得（未登録ならメモリマップして登録する）
+     * @param filePath フォントファイルのパス
+     * @return マップしたファイル、開けない場合はnullptr
+     */
+    std::shared_ptr<const MappedFile> getFile(const std::string& filePath);
+
+    /**
+     * @brief 保持するフォントファイルの合計サイズの上限を設定
+     * @param memoryLimit 上限（バイト）
+     */
+    void setMemoryLimit(size_t memoryLimit);
+
+    /**
+     * @brief 保持するフォントファイルの合計サイズの上限を取得
+     * @return 上限（バイト）
+     */
+    size_t getMemoryLimit() const;
+
+    /**
+     * @brief 統計情報を取得
+     * @return 統計情報
+     */
+    FontRegistryStats getStats() const;
+
+    /**
+     * @brief 登録されているフェイスとファイルをすべて外す
+     */
+    void clear();
+
+private:
+    /**
+     * @struct FileEntry
+     * @brief 登録されたフォントファイル
+     */
+    struct FileEntry {
+        std::shared_ptr<const MappedFile> file;   ///< マップしたファイル
+        std::list<std::string>::iterator lruPosition; ///< 参照順リスト内の位置
+    };
+
+    /**
+     * @brief ファイルを取得する（ロック取得済みで呼び出す）
+     * @param filePath フォントファイルのパス
+     * @return マップしたファイル、開けない場合はnullptr
+     */
+    std::shared_ptr<const MappedFile> getFileLocked(const std::string& filePath);
+
+    /**
+     * @brief 上限を超えている間、最も古いファイルとそのフェイスを外す（ロック取得済みで呼び出す）
+     * @param keepPath 外さないファイルのパス（取得中のもの）
+     */
+    void evictLocked(const std::string& keepPath);
+
+    size_t m_memoryLimit;                                            ///< 合計サイズの上限
+    size_t m_memoryUsage;                                            ///< 合計サイズ
+    std::list<std::string> m_lru;                                    ///< 参照順のファイルパス（先頭が最新）
+    std::unordered_map<std::string, FileEntry> m_files;              ///< パスごとのファイル
+    std::unordered_map<std::string, std::shared_ptr<const FontFace>> m_faces; ///< 「パス#番号」ごとのフェイス
+    std::unordered_map<std::string, std::weak_ptr<const MappedFile>> m_releasedFiles; ///< 外したファイルの弱参照
+    std::unordered_map<std::string, std::weak_ptr<const FontFace>> m_releasedFaces;   ///< 外したフェイスの弱参照
+    FontRegistryStats m_stats;                                       ///< 統計情報
+    mutable std::mutex m_mutex;                                      ///< ロック
+};
+
+} // namespace font
+} // namespace core
+} // namespace japanese_typesetting
+
+#endif // JAPANESE_TYPESETTING_CORE_FONT_FONT_REGISTRY_H
@@ -0,0 +1,78 @@
+/**
+ * @file mapped_file.h
+ * @brief 読み取り専用でメモリマップしたファイル
+ */
+
+#ifndef JAPANESE_TYPESETTING_CORE_FONT_MAPPED_FILE_H
+#define JAPANESE_TYPESETTING_CORE_FONT_MAPPED_FILE_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace japanese_typesetting {
+namespace core {
+namespace font {
+
+/**
+ * @class MappedFile
+ * @brief 読み取り専用でメモリマップしたファイル
+ *
+ * ファイルの内容はページ単位でOSにより読み込まれ、同じファイルを
+ * 複数のフォントや出力エンジンから共有してもメモリ上の実体は1つとなる。
+ */
+class MappedFile {
+public:
+    /**
+     * @brief ファイルをメモリマップする
+     * @param filePath ファイルのパス
+     * @return マップしたファイル、開けない場合はnullptr
+     */
+    static std::shared_ptr<MappedFile> open(const std::string& filePath);
+
+    /**
+     * @brief デストラクタ（マップを解除する）
+     */
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * @brief ファイルの内容を取得
+     * @return 先頭へのポインタ
+     */
+    const unsigned char* data() const;
+
+    /**
+     * @brief ファイルのサイズを取得
+     * @return バイト数
+     */
+    size_t size() const;
+
+    /**
+     * @brief ファイルのパスを取得
+     * @return パス
+     */
+    const std::string& getFilePath() const;
+
+private:
+    /**
+     * @brief コンストラクタ
+     */
+    MappedFile();
+
+    std::string m_filePath;        ///< ファイルのパス
+    const unsigned char* m_data;   ///< マップした領域の先頭
+    size_t m_size;                 ///< ファイルのサイズ
+#ifdef _WIN32
+    void* m_fileHandle;            ///< ファイルハンドル
+    void* m_mappingHandle;         ///< ファイルマッピングハンドル
+#endif
+};
+
+} // namespace font
+} // namespace core
+} // namespace japanese_typesetting
+
+#endif // JAPANESE_TYPESETTING_CORE_FONT_MAPPED_FILE_H
@@ -0,0 +1,120 @@
+/**
+ * @file shaped_run_cache.h
+ * @brief シェーピング結果のキャッシュ
+ */
+
+#ifndef JAPANESE_TYPESETTING_CORE_FONT_SHAPED_RUN_CACHE_H
+#define JAPANESE_TYPESETTING_CORE_FONT_SHAPED_RUN_CACHE_H
+
+#include "japanese_typesetting/core/font/font.h"
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace japanese_typesetting {
+namespace core {
+namespace font {
+
+/**
+ * @struct ShapedRunCacheStats
+ * @brief シェーピング結果キャッシュの統計情報
+ */
+struct ShapedRunCacheStats {
+    size_t hits = 0;      ///< キャッシュヒット数
+    size_t misses = 0;    ///< キャッシュミス数
+    size_t entries = 0;   ///< 保持しているエントリ数
+};
+
+/**
+ * @class ShapedRunCache
+ * @brief (テキスト, フォント, サイズ, 機能)ごとのシェーピング結果を保持するキャッシュ
+ *
+ * 保持するエントリ数には上限があり、最も長く参照されていないものから破棄する。
+ * 複数スレッドから同時に使用してよい。
+ */
+class ShapedRunCache {
+public:
+    /**
+     * @brief プロセス全体で共有されるインスタンスを取得する
+     * @return キャッシュのインスタンス
+     */
+    static ShapedRunCache& getInstance();
+
+    /**
+     * @brief コンストラクタ
+     * @param capacity 保持するエントリ数の上限
+     */
+    explicit ShapedRunCache(size_t capacity = 4096);
+
+    /**
+     * @brief デストラクタ
+     */
+    ~ShapedRunCache();
+
+    ShapedRunCache(const ShapedRunCache&) = delete;
+    ShapedRunCache& operator=(const ShapedRunCache&) = delete;
+
+    /**
+     * @brief テキストをシェーピングする（キャッシュにあればそれを返す）
+     * @param font フォントフェイス
+     * @param text テキスト（UTF-32）
+     * @param length 文字数
+     * @param fontSize フォントサイズ（ポイント）
+     * @param vertical 縦書きの場合はtrue
+     * @param features 有効にするOpenType機能
+     * @return シェーピング結果
+     */
+    std::shared_ptr<const ShapedRun> shape(const FontFace& font, const char32_t* text, size_t length,
+                                           double fontSize, bool vertical, uint32_t features);
+
+    /**
+     * @brief 保持しているエントリをすべて破棄する
+     */
+    void clear();
+
+    /**
+     * @brief 統計情報を取得
+     * @return 統計情報
+     */
+    ShapedRunCacheStats getStats() const;
+
+private:
+    /**
+     * @struct Key
+     * @brief キャッシュのキー
+     */
+    struct Key {
+        std::u32string text;   ///< テキスト
+        uint32_t fontId;       ///< フォントの識別番号
+        double fontSize;       ///< フォントサイズ
+        bool vertical;         ///< 縦書きの場合はtrue
+        uint32_t features;     ///< OpenType機能
+
+        bool operator==(const Key& other) const;
+    };
+
+    /**
+     * @struct KeyHash
+     * @brief キーのハッシュ関数（FNV-1a）
+     */
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    using Entry = std::pair<Key, std::shared_ptr<const ShapedRun>>;
+
+    size_t m_capacity;                                                        ///< エントリ数の上限
+    std::list<Entry> m_entries;                                               ///< 参照順のエントリ（先頭が最新）
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> m_index;     ///< キーからエントリへの索引
+    size_t m_hits;                                                            ///< キャッシュヒット数
+    size_t m_misses;                                                          ///< キャッシュミス数
+    mutable std::mutex m_mutex;                                               ///< ロック
+};
+
+} // namespace font
+} // namespace core
+} // namespace japanese_typesetting
+
+#endif // JAPANESE_TYPESETTING_CORE_FONT_SHAPED_RUN_CACHE_H
@@ -35,6 +35,16 @@ enum class LineBreakMode {
     Loose       ///< 緩やかな禁則処理
 };
 
+/**
+ * @enum RubyAlignment
+ * @brief ルビの配置方法（JIS X 4051）
+ */
+enum class RubyAlignment {
+    Mono,       ///< モノルビ（ルビを親文字1字ごとに均等に割り当てる、割り切れない場合はグループルビ）
+    Group,      ///< グループルビ（親文字全体にルビを配置し、親文字の途中で改行しない）
+    Jukugo      ///< 熟語ルビ（各字のルビが親文字の幅に収まる場合はモノルビ、収まらない場合はグループルビ）
+};
+
 /**
  * @class Style
  * @brief 文書のスタイルを定義するクラス
@@ -111,6 +121,30 @@ public:
      */
     LineBreakMode getLineBreakMode() const;
 
+    /**
+     * @brief ルビの配置方法を設定
+     * @param alignment ルビの配置方法
+     */
+    void setRubyAlignment(RubyAlignment alignment);
+
+    /**
+     * @brief ルビの配置方法を取得
+     * @return ルビの配置方法
+     */
+    RubyAlignment getRubyAlignment() const;
+
+    /**
+     * @brief 字詰め（升目に文字を置く組み方）を設定
+     * @param gridLayout 全角の文字を1字分の升目に置き、行を字数で分割する場合はtrue
+     */
+    void setGridLayout(bool gridLayout);
+
+    /**
+     * @brief 字詰めかどうかを取得
+     * @return 字詰めの場合はtrue
+     */
+    bool isGridLayout() const;
+
     /**
      * @brief 文字間隔を設定
      * @param spacing 文字間隔（em単位）
@@ -221,6 +255,14 @@ public:
      */
     std::string getProperty(const std::string& key) const;
 
+    /**
+     * @brief スタイルファイルと同じ形式のキーで設定する
+     * @param key キー（FontSize、Bold、Property-名前など）
+     * @param value 値
+     * @return キーが認識された場合はtrue
+     */
+    bool setValue(const std::string& key, const std::string& value);
+
     /**
      * @brief スタイルをファイルから読み込む
      * @param filePath ファイルパス
@@ -235,12 +277,28 @@ public:
      */
     bool saveToFile(const std::string& filePath) const;
 
+    /**
+     * @brief すべての設定とカスタムプロパティが等しいかどうか
+     * @param other 比較するスタイル
+     * @return 等しい場合はtrue
+     */
+    bool operator==(const Style& other) const;
+
+    /**
+     * @brief 設定またはカスタムプロパティが異なるかどうか
+     * @param other 比較するスタイル
+     * @return 異なる場合はtrue
+     */
+    bool operator!=(const Style& other) const;
+
 private:
     std::string m_fontFamily;             ///< フォントファミリー
     double m_fontSize;                    ///< フォントサイズ（ポイント）
     double m_lineHeight;                  ///< 行の高さ（倍率）
     TextAlignment m_textAlignment;        ///< テキスト配置
     LineBreakMode m_lineBreakMode;        ///< 改行モード
+    RubyAlignment m_rubyAlignment;        ///< ルビの配置方法
+    bool m_gridLayout;                    ///< 字詰めフラグ
     double m_characterSpacing;            ///< 文字間隔（em単位）
     double m_wordSpacing;                 ///< 単語間隔（em単位）
     double m_paragraphSpacingBefore;      ///< 段落前の余白（em単位）
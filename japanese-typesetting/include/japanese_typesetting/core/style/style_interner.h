@@ -0,0 +1,220 @@
+/**
+ * @file style_interner.h
+ * @brief スタイルの共有と派生スタイルのキャッシュ
+ */
+
+#ifndef JAPANESE_TYPESETTING_CORE_STYLE_STYLE_INTERNER_H
+#define JAPANESE_TYPESETTING_CORE_STYLE_STYLE_INTERNER_H
+
+#include "japanese_typesetting/core/style/style.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace japanese_typesetting {
+namespace core {
+namespace style {
+
+/**
+ * @struct InternedStyle
+ * @brief 共有される不変のスタイル
+ */
+struct InternedStyle {
+    Style style;          ///< スタイル
+    uint64_t layoutHash;  ///< 組版に影響する項目のハッシュ値
+    uint32_t id;          ///< 一意な番号（インターナーをまたいでも重複しない）
+};
+
+/**
+ * @class StyleHandle
+ * @brief 共有されたスタイルを指す小さなハンドル
+ *
+ * 同じ内容のスタイルは同じハンドルとなるため、比較はポインタの比較で済む。
+ * 指すスタイルは変更できず、ハンドルが残っている間は破棄されない。
+ */
+class StyleHandle {
+public:
+    /**
+     * @brief コンストラクタ（何も指さないハンドル）
+     */
+    StyleHandle() = default;
+
+    /**
+     * @brief コンストラクタ
+     * @param entry 共有されたスタイル
+     */
+    explicit StyleHandle(std::shared_ptr<const InternedStyle> entry) : m_entry(std::move(entry)) {}
+
+    /**
+     * @brief スタイルを指しているかどうか
+     */
+    explicit operator bool() const { return m_entry != nullptr; }
+
+    /**
+     * @brief スタイルを取得
+     * @return スタイル
+     */
+    const Style& get() const { return m_entry->style; }
+
+    const Style& operator*() const { return m_entry->style; }
+    const Style* operator->() const { return &m_entry->style; }
+
+    /**
+     * @brief 組版に影響する項目のハッシュ値を取得
+     * @return ハッシュ値
+     */
+    uint64_t getLayoutHash() const { return m_entry->layoutHash; }
+
+    /**
+     * @brief 一意な番号を取得（インターナーをまたいでも重複しない）
+     * @return 番号
+     */
+    uint32_t getId() const { return m_entry->id; }
+
+    bool operator==(const StyleHandle& other) const { return m_entry == other.m_entry; }
+    bool operator!=(const StyleHandle& other) const { return m_entry != other.m_entry; }
+
+private:
+    std::shared_ptr<const InternedStyle> m_entry;  ///< 共有されたスタイル
+};
+
+/**
+ * @struct StyleDerivation
+ * @brief 元のスタイルから派生スタイルを作るための変更内容
+ */
+struct StyleDerivation {
+    std::optional<bool> bold;      ///< 太字の設定（未設定の場合は元のまま）
+    std::optional<bool> italic;    ///< 斜体の設定（未設定の場合は元のまま）
+    double fontSizeScale = 1.0;    ///< フォントサイズの倍率
+
+    bool operator==(const StyleDerivation& other) const;
+
+    /**
+     * @brief 変更内容をスタイルに適用する
+     * @param style 変更するスタイル
+     */
+    void apply(Style& style) const;
+};
+
+/**
+ * @class StyleInterner
+ * @brief スタイルを共有し、派生スタイルをキャッシュするクラス
+ *
+ * 内容の等しいスタイルを1つの不変なエントリにまとめ、組版に影響する項目の
+ * ハッシュ値を事前に計算しておく。「太字・1.2倍」のような派生スタイルも
+ * 元のスタイルと変更内容の組でキャッシュするため、2回目以降の派生は
+ * スタイルの複製ではなく検索のみで済む。他のインターナーが登録したスタイルからも派生できる。
+ *
+ * 登録したスタイルの数が上限に達すると、登録済みのスタイルと派生のキャッシュをすべて破棄してから
+ * 登録し直す（取得済みのハンドルは有効なままで、以降は同じ内容でも別のハンドルとなる）。
+ * プロセス全体のインスタンスが、入力ごとに異なるスタイルで際限なく大きくならないようにするため。
+ */
+class StyleInterner {
+public:
+    /**
+     * @brief プロセス全体で共有されるインスタンスを取得
+     * @return インスタンス
+     */
+    static StyleInterner& getInstance();
+
+    /**
+     * @brief コンストラクタ
+     * @param maxStyles 保持するスタイルの数の上限
+     */
+    explicit StyleInterner(size_t maxStyles = 4096);
+
+    /**
+     * @brief デストラクタ
+     */
+    ~StyleInterner();
+
+    StyleInterner(const StyleInterner&) = delete;
+    StyleInterner& operator=(const StyleInterner&) = delete;
+
+    /**
+     * @brief スタイルを登録してハンドルを取得
+     * @param style スタイル
+     * @return 同じ内容のスタイルに共通のハンドル
+     */
+    StyleHandle intern(const Style& style);
+
+    /**
+     * @brief 派生スタイルのハンドルを取得
+     * @param base 元のスタイル
+     * @param derivation 変更内容
+     * @return 派生スタイルのハンドル
+     */
+    StyleHandle derive(const StyleHandle& base, const StyleDerivation& derivation);
+
+    /**
+     * @brief 登録されているスタイルの数を取得
+     * @return スタイルの数
+     */
+    size_t size() const;
+
+    /**
+     * @brief 登録されているスタイルと派生のキャッシュを破棄する
+     *
+     * 取得済みのハンドルは引き続き有効だが、同じ内容のスタイルを再度登録すると
+     * 別のハンドルとなる。
+     */
+    void clear();
+
+    /**
+     * @brief 組版に影響する項目のハッシュ値を計算する
+     * @param style スタイル
+     * @return ハッシュ値
+     */
+    static uint64_t hashLayoutFields(const Style& style);
+
+    /**
+     * @brief 組版に影響する項目が等しいかどうか
+     * @param a 比較するスタイル
+     * @param b 比較するスタイル
+     * @return hashLayoutFieldsの対象となる項目がすべて等しい場合はtrue
+     */
+    static bool equalLayoutFields(const Style& a, const Style& b);
+
+private:
+    /**
+     * @struct DerivationKey
+     * @brief 派生スタイルのキャッシュのキー
+     */
+    struct DerivationKey {
+        uint32_t baseId;               ///< 元のスタイルの番号
+        StyleDerivation derivation;    ///< 変更内容
+
+        bool operator==(const DerivationKey& other) const;
+    };
+
+    /**
+     * @struct DerivationKeyHash
+     * @brief DerivationKeyのハッシュ関数
+     */
+    struct DerivationKeyHash {
+        size_t operator()(const DerivationKey& key) const;
+    };
+
+    /**
+     * @brief ロックを保持した状態でスタイルを登録する
+     * @param style スタイル
+     * @return ハンドル
+     */
+    StyleHandle internLocked(const Style& style);
+
+    mutable std::mutex m_mutex;   ///< ロック
+    std::unordered_map<uint64_t, std::vector<std::shared_ptr<const InternedStyle>>> m_styles; ///< ハッシュ値ごとの登録済みスタイル
+    std::unordered_map<DerivationKey, StyleHandle, DerivationKeyHash> m_derived;             ///< 派生スタイルのキャッシュ
+    size_t m_maxStyles;           ///< 保持するスタイルの数の上限
+    size_t m_count;               ///< 登録されているスタイルの数
+};
+
+} // namespace style
+} // namespace core
+} // namespace japanese_typesetting
+
+#endif // JAPANESE_TYPESETTING_CORE_STYLE_STYLE_INTERNER_H
@@ -0,0 +1,233 @@
+/**
+ * @file stylesheet.h
+ * @brief 名前付きスタイルの継承を解決するスタイルシート
+ */
+
+#ifndef JAPANESE_TYPESETTING_CORE_STYLE_STYLESHEET_H
+#define JAPANESE_TYPESETTING_CORE_STYLE_STYLESHEET_H
+
+#include "japanese_typesetting/core/style/style.h"
+#include "japanese_typesetting/core/style/style_interner.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace japanese_typesetting {
+namespace core {
+namespace style {
+
+/**
+ * @brief 解決済みスタイル表の番号
+ */
+using StyleId = uint16_t;
+
+/**
+ * @brief 無効なスタイル番号
+ */
+const StyleId kInvalidStyleId = 0xFFFF;
+
+/**
+ * @enum BuiltinStyle
+ * @brief 常に定義されているスタイルの番号
+ *
+ * コンパイル済みスタイルシートでは、これらのスタイルが先頭から順に並ぶ。
+ */
+enum BuiltinStyle : StyleId {
+    kBodyStyle = 0,      ///< 本文（body）
+    kHeadingStyle = 1,   ///< 見出し（heading）
+    kRubyStyle = 2,      ///< ルビ（ruby）
+    kEmphasisStyle = 3   ///< 強調（emphasis）
+};
+
+/**
+ * @enum StyleKind
+ * @brief スタイルの種類
+ */
+enum class StyleKind {
+    Paragraph,   ///< 段落スタイル
+    Character    ///< 文字スタイル
+};
+
+/**
+ * @struct StyleDefinition
+ * @brief スタイルシート内の名前付きスタイルの定義
+ */
+struct StyleDefinition {
+    std::string name;                                          ///< スタイル名
+    std::string parent;                                        ///< 継承元のスタイル名（空の場合は基本スタイル）
+    StyleKind kind = StyleKind::Paragraph;                     ///< スタイルの種類
+    std::vector<std::pair<std::string, std::string>> values;   ///< 継承元から変更する設定（記述順）
+};
+
+class CompiledStyleSheet;
+
+/**
+ * @class StyleSheet
+ * @brief 名前付きの段落スタイル・文字スタイルを継承付きで定義するスタイルシート
+ *
+ * 設定はStyleファイルと同じキーで記述する。加えてFontSizeScaleで
+ * 継承元のフォントサイズに対する倍率を指定できる。
+ * 組版に使う前にcompile()で解決済みスタイル表に変換する。
+ *
+ * ファイル形式の例：
+ * @code
+ * [body]
+ * FontSize: 10.5
+ *
+ * [heading : body]
+ * Bold: true
+ * FontSizeScale: 1.2
+ *
+ * [ruby : body]
+ * Kind: Character
+ * FontSizeScale: 0.5
+ * @endcode
+ */
+class StyleSheet {
+public:
+    /**
+     * @brief コンストラクタ
+     */
+    StyleSheet();
+
+    /**
+     * @brief デストラクタ
+     */
+    ~StyleSheet();
+
+    /**
+     * @brief スタイルを定義する（定義済みの場合は継承元と種類を変更する）
+     * @param name スタイル名
+     * @param parent 継承元のスタイル名（空の場合は基本スタイル）
+     * @param kind スタイルの種類
+     */
+    void define(const std::string& name, const std::string& parent = "", StyleKind kind = StyleKind::Paragraph);
+
+    /**
+     * @brief スタイルの設定を追加する（未定義の場合は基本スタイルを継承して定義する）
+     * @param name スタイル名
+     * @param key キー
+     * @param value 値
+     */
+    void setValue(const std::string& name, const std::string& key, const std::string& value);
+
+    /**
+     * @brief スタイルの定義を取得
+     * @param name スタイル名
+     * @return 定義（存在しない場合はnullptr）
+     */
+    const StyleDefinition* findDefinition(const std::string& name) const;
+
+    /**
+     * @brief 定義されているスタイルの数を取得
+     * @return スタイルの数
+     */
+    size_t getDefinitionCount() const;
+
+    /**
+     * @brief スタイルシートをファイルから読み込む
+     * @param filePath ファイルパス
+     * @return 成功した場合はtrue
+     */
+    bool loadFromFile(const std::string& filePath);
+
+    /**
+     * @brief 継承を解決して解決済みスタイル表を作成する
+     * @param base 継承元を持たないスタイルの基になるスタイル
+     * @param interner スタイルを共有するインターナー
+     * @return 解決済みスタイル表（継承元が存在しないか循環している場合はnullptr）
+     */
+    std::shared_ptr<const CompiledStyleSheet> compile(const Style& base,
+                                                      StyleInterner& interner = StyleInterner::getInstance()) const;
+
+private:
+    /**
+     * @brief スタイルの定義を取得または作成する
+     * @param name スタイル名
+     * @return 定義
+     */
+    StyleDefinition& getOrCreate(const std::string& name);
+
+    std::vector<StyleDefinition> m_definitions;           ///< 定義（定義順）
+    std::unordered_map<std::string, size_t> m_index;      ///< 名前から定義の位置への索引
+};
+
+/**
+ * @class CompiledStyleSheet
+ * @brief 継承を解決済みのスタイル表
+ *
+ * 各スタイルは小さな整数の番号で参照し、継承の解決や文字列の解析は
+ * コンパイル時に済ませてある。組版中に名前で検索する必要はない。
+ * 作成後は変更されないため、複数のスレッドから同時に参照できる。
+ */
+class CompiledStyleSheet {
+public:
+    /**
+     * @struct Entry
+     * @brief 解決済みのスタイル
+     */
+    struct Entry {
+        std::string name;     ///< スタイル名
+        StyleKind kind;       ///< スタイルの種類
+        StyleId parent;       ///< 継承元の番号（基本スタイルの場合はkInvalidStyleId）
+        StyleHandle style;    ///< 解決済みのスタイル
+    };
+
+    /**
+     * @brief コンストラクタ
+     * @param entries 解決済みのスタイル（番号順）
+     */
+    explicit CompiledStyleSheet(std::vector<Entry> entries);
+
+    /**
+     * @brief デストラクタ
+     */
+    ~CompiledStyleSheet();
+
+    /**
+     * @brief スタイルの数を取得
+     * @return スタイルの数
+     */
+    size_t size() const { return m_entries.size(); }
+
+    /**
+     * @brief 解決済みのスタイルを取得
+     * @param id スタイル番号
+     * @return スタイル
+     */
+    const Style& getStyle(StyleId id) const { return m_entries[id].style.get(); }
+
+    /**
+     * @brief 解決済みのスタイルのハンドルを取得
+     * @param id スタイル番号
+     * @return ハンドル
+     */
+    const StyleHandle& getHandle(StyleId id) const { return m_entries[id].style; }
+
+    /**
+     * @brief 解決済みのスタイルの情報を取得
+     * @param id スタイル番号
+     * @return 解決済みのスタイル
+     */
+    const Entry& getEntry(StyleId id) const { return m_entries[id]; }
+
+    /**
+     * @brief スタイル名から番号を検索する（準備段階で用いる）
+     * @param name スタイル名
+     * @return 番号（存在しない場合はkInvalidStyleId）
+     */
+    StyleId findId(const std::string& name) const;
+
+private:
+    std::vector<Entry> m_entries;                       ///< 解決済みのスタイル（番号順）
+    std::unordered_map<std::string, StyleId> m_ids;     ///< 名前から番号への索引
+};
+
+} // namespace style
+} // namespace core
+} // namespace japanese_typesetting
+
+#endif // JAPANESE_TYPESETTING_CORE_STYLE_STYLESHEET_H
@@ -0,0 +1,88 @@
+/**
+ * @file annotation.h
+ * @brief 圏点・傍線の注記と、ルビを含む行ごとの注記の配置
+ */
+
+#ifndef JAPANESE_TYPESETTING_CORE_TYPESETTING_ANNOTATION_H
+#define JAPANESE_TYPESETTING_CORE_TYPESETTING_ANNOTATION_H
+
+#include "japanese_typesetting/core/typesetting/glyph_advance_cache.h"
+#include "japanese_typesetting/core/typesetting/itemizer.h"
+#include "japanese_typesetting/core/typesetting/ruby.h"
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+namespace japanese_typesetting {
+namespace core {
+namespace typesetting {
+
+/**
+ * @brief 圏点の大きさの親文字に対する倍率
+ */
+constexpr double kEmphasisMarkScale = 0.5;
+
+/**
+ * @brief 傍線が占める幅（線と親文字との間隔）の親文字に対する倍率
+ */
+constexpr double kSidelineScale = 0.25;
+
+/**
+ * @struct AnnotationPlacement
+ * @brief 行内の圏点・傍線の配置
+ *
+ * 圏点は1文字（縦中横は1組）ごと、傍線は同じ種類が続く範囲ごとに1つとなる。
+ * 行方向の位置は行頭からの距離で、送り幅の増減を反映している。
+ * 圏点は行の上側（縦書きでは右側）、傍線は下側（縦書きでは左側）に置く。
+ */
+struct AnnotationPlacement {
+    uint32_t start = 0;                           ///< 行内の開始位置
+    uint32_t length = 0;                          ///< 文字数
+    EmphasisMark emphasis = EmphasisMark::None;   ///< 圏点
+    Sideline sideline = Sideline::None;           ///< 傍線
+    double inlineStart = 0.0;                     ///< 行頭からの開始位置（ポイント）
+    double inlineEnd = 0.0;                       ///< 行頭からの終了位置（ポイント）
+    double blockOffset = 0.0;                     ///< 親文字の外側からの距離（ルビがある文字ではルビの外側に置く）
+};
+
+/**
+ * @struct AnnotationExtents
+ * @brief 行の外側に出る注記の幅
+ */
+struct AnnotationExtents {
+    double over = 0.0;    ///< 上側（縦書きでは右側）に出る幅（ルビ・圏点）
+    double under = 0.0;   ///< 下側（縦書きでは左側）に出る幅（傍線）
+};
+
+/**
+ * @brief 圏点・傍線の注記をランの属性にする
+ * @param runs 段落全体のラン（注記の境界で分割される）
+ * @param spans 注記（開始位置の昇順、重なってもよい）
+ *
+ * 同じ種類の注記が重なる場合は、後から始まるものに従う。
+ */
+void annotateRuns(std::pmr::vector<TextRun>& runs, const std::pmr::vector<AnnotationSpan>& spans);
+
+/**
+ * @brief 1行のルビ・圏点・傍線の配置をまとめて求める
+ * @param text 行のテキスト（UTF-32）
+ * @param advanceDeltas 文字ごとの送り幅の増減（空の場合は増減なし）
+ * @param runs 行内のラン（行の先頭からの位置）
+ * @param rubies 行内のルビ注釈（行の先頭からの位置）
+ * @param advances 文字送り幅テーブル
+ * @param placements 圏点・傍線の配置の格納先（追加される）
+ * @return 行の外側に出る注記の幅
+ *
+ * 行の高さの調整は呼び出し側がこの結果から1度だけ行い、出力側で再計算する必要はない。
+ * 空白と約物には圏点を付けない。
+ */
+AnnotationExtents placeLineAnnotations(const std::u32string& text, const std::vector<double>& advanceDeltas,
+                                       const std::vector<TextRun>& runs, const std::vector<RubySpan>& rubies,
+                                       const GlyphAdvanceTable& advances, std::vector<AnnotationPlacement>& placements);
+
+} // namespace typesetting
+} // namespace core
+} // namespace japanese_typesetting
+
+#endif // JAPANESE_TYPESETTING_CORE_TYPESETTING_ANNOTATION_H
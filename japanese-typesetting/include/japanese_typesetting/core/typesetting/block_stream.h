@@ -0,0 +1,158 @@
+/**
+ * @file block_stream.h
+ * @brief 文書を1ブロックずつ組版するストリーム
+ */
+
+#ifndef JAPANESE_TYPESETTING_CORE_TYPESETTING_BLOCK_STREAM_H
+#define JAPANESE_TYPESETTING_CORE_TYPESETTING_BLOCK_STREAM_H
+
+#include "japanese_typesetting/core/document/document.h"
+#include "japanese_typesetting/core/style/style.h"
+#include "japanese_typesetting/core/style/style_interner.h"
+#include "japanese_typesetting/core/style/stylesheet.h"
+#include "japanese_typesetting/core/typesetting/typesetting_engine.h"
+#include <cstddef>
+#include <iterator>
+
+namespace japanese_typesetting {
+namespace core {
+namespace typesetting {
+
+/**
+ * @class DocumentBlockStream
+ * @brief 文書のテキストブロックを要求されるたびに1つずつ組版するストリーム
+ *
+ * セクションのタイトルと内容をtypesetDocumentと同じ順序で組版するが、
+ * 結果をまとめて保持しないため、文書の大きさによらず使用するメモリは一定となる。
+ * 文書・スタイル・エンジンはストリームの使用中に変更・破棄してはならない。
+ * 中断トークンを渡した場合はブロックごと・行ごとに確認し、中断されると
+ * 組版途中のブロックを捨てて終わりに達したものとして扱う。
+ *
+ * @code
+ * DocumentBlockStream stream(engine, document, style, width);
+ * for (const TextBlock& block : stream) {
+ *     write(block);
+ * }
+ * @endcode
+ */
+class DocumentBlockStream {
+public:
+    /**
+     * @class Iterator
+     * @brief ストリームを範囲forで読むための入力イテレータ
+     *
+     * 保持するのは現在のブロックのみで、進めると前のブロックは破棄される。
+     */
+    class Iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = TextBlock;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const TextBlock*;
+        using reference = const TextBlock&;
+
+        /**
+         * @brief コンストラクタ
+         * @param stream 読み込むストリーム（終端の場合はnullptr）
+         */
+        explicit Iterator(DocumentBlockStream* stream = nullptr);
+
+        reference operator*() const { return m_block; }
+        pointer operator->() const { return &m_block; }
+        Iterator& operator++();
+        bool operator==(const Iterator& other) const { return m_stream == other.m_stream; }
+        bool operator!=(const Iterator& other) const { return m_stream != other.m_stream; }
+
+    private:
+        DocumentBlockStream* m_stream;   ///< 読み込むストリーム（終端の場合はnullptr）
+        TextBlock m_block;               ///< 現在のブロック
+    };
+
+    /**
+     * @brief コンストラクタ
+     * @param engine 組版エンジン
+     * @param document 組版する文書
+     * @param style スタイル
+     * @param width 最大幅
+     * @param cancellation 中断要求を確認するトークン（nullptrの場合は中断しない）
+     */
+    DocumentBlockStream(const TypesettingEngine& engine, const document::Document& document,
+                        const style::Style& style, double width,
+                        const CancellationToken* cancellation = nullptr);
+
+    /**
+     * @brief コンストラクタ（スタイルシートの本文・見出しスタイルを使う）
+     * @param engine 組版エンジン
+     * @param document 組版する文書
+     * @param styleSheet 解決済みスタイル表
+     * @param width 最大幅
+     * @param cancellation 中断要求を確認するトークン（nullptrの場合は中断しない）
+     */
+    DocumentBlockStream(const TypesettingEngine& engine, const document::Document& document,
+                        const style::CompiledStyleSheet& styleSheet, double width,
+                        const CancellationToken* cancellation = nullptr);
+
+    /**
+     * @brief デストラクタ
+     */
+    ~DocumentBlockStream();
+
+    DocumentBlockStream(const DocumentBlockStream&) = delete;
+    DocumentBlockStream& operator=(const DocumentBlockStream&) = delete;
+
+    /**
+     * @brief 次のテキストブロックを組版する
+     * @param block 組版結果の格納先
+     * @return ブロックがあった場合はtrue、文書の終わりに達したか中断された場合はfalse
+     */
+    bool next(TextBlock& block);
+
+    /**
+     * @brief ストリームの状態を取得
+     * @return 中断された場合はその理由、それ以外はCompleted
+     */
+    TypesetStatus getStatus() const;
+
+    /**
+     * @brief これまでに組版したブロックの数を取得
+     * @return ブロック数
+     */
+    size_t getBlockCount() const;
+
+    /**
+     * @brief 先頭のイテレータを取得（ストリームを読み進める）
+     * @return イテレータ
+     */
+    Iterator begin();
+
+    /**
+     * @brief 終端のイテレータを取得
+     * @return イテレータ
+     */
+    Iterator end();
+
+private:
+    /**
+     * @brief 組版したブロックを返すかどうかを判定する
+     * @param block 組版したブロック
+     * @return 最後まで組版されていればtrue
+     */
+    bool accept(const TextBlock& block);
+
+    const TypesettingEngine& m_engine;      ///< 組版エンジン
+    const document::Document& m_document;   ///< 組版する文書
+    style::StyleHandle m_style;             ///< 本文のスタイル
+    style::StyleHandle m_titleStyle;        ///< タイトルのスタイル
+    double m_width;                         ///< 最大幅
+    const CancellationToken* m_cancellation; ///< 中断要求を確認するトークン
+    TypesetStatus m_status;                 ///< ストリームの状態
+    size_t m_sectionIndex;                  ///< 次に組版するセクションの番号
+    bool m_titleDone;                       ///< 現在のセクションのタイトルを組版済みかどうか
+    size_t m_blockCount;                    ///< これまでに組版したブロックの数
+};
+
+} // namespace typesetting
+} // namespace core
+} // namespace japanese_typesetting
+
+#endif // JAPANESE_TYPESETTING_CORE_TYPESETTING_BLOCK_STREAM_H
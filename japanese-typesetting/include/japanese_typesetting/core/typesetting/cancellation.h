@@ -0,0 +1,96 @@
+/**
+ * @file cancellation.h
+ * @brief 組版処理の中断要求と期限
+ */
+
+#ifndef JAPANESE_TYPESETTING_CORE_TYPESETTING_CANCELLATION_H
+#define JAPANESE_TYPESETTING_CORE_TYPESETTING_CANCELLATION_H
+
+#include <atomic>
+#include <chrono>
+
+namespace japanese_typesetting {
+namespace core {
+namespace typesetting {
+
+/**
+ * @enum TypesetStatus
+ * @brief 組版処理の結果の状態
+ */
+enum class TypesetStatus {
+    Completed,          ///< 最後まで組版した
+    Cancelled,          ///< 中断要求により途中で打ち切った
+    DeadlineExceeded    ///< 期限を過ぎたため途中で打ち切った
+};
+
+/**
+ * @class CancellationToken
+ * @brief 組版処理に中断を要求するためのトークン
+ *
+ * 組版エンジンは段落（テキストブロック）ごと・行組みの段階ごと・行ごとにトークンを確認し、
+ * 中断が要求されているか期限を過ぎていれば処理を打ち切る。
+ * cancel()は組版中の別スレッドから呼び出してよい。
+ */
+class CancellationToken {
+public:
+    using Clock = std::chrono::steady_clock; ///< 期限に用いる時計
+
+    /**
+     * @brief コンストラクタ（期限なし）
+     */
+    CancellationToken();
+
+    /**
+     * @brief デストラクタ
+     */
+    ~CancellationToken();
+
+    CancellationToken(const CancellationToken&) = delete;
+    CancellationToken& operator=(const CancellationToken&) = delete;
+
+    /**
+     * @brief 中断を要求する
+     */
+    void cancel();
+
+    /**
+     * @brief 中断要求と期限を取り消す（トークンを再利用する場合）
+     */
+    void reset();
+
+    /**
+     * @brief 期限を設定する
+     * @param deadline 期限
+     */
+    void setDeadline(Clock::time_point deadline);
+
+    /**
+     * @brief 現在時刻からの制限時間で期限を設定する
+     * @param timeout 制限時間
+     */
+    void setTimeout(Clock::duration timeout);
+
+    /**
+     * @brief 中断が要求されているかどうか
+     * @return 要求されている場合はtrue
+     */
+    bool isCancellationRequested() const;
+
+    /**
+     * @brief 処理を続けてよいかを確認する
+     * @return 続けてよい場合はCompleted、それ以外は打ち切る理由
+     */
+    TypesetStatus check() const;
+
+private:
+    static const Clock::rep kNoDeadline;    ///< 期限なしを表す値
+
+    std::atomic<bool> m_cancelled;          ///< 中断要求フラグ
+    std::atomic<Clock::rep> m_deadline;     ///< 期限（時計の刻み数）
+};
+
+} // namespace typesetting
+} // namespace core
+} // namespace japanese_typesetting
+
+#endif // JAPANESE_TYPESETTING_CORE_TYPESETTING_CANCELLATION_H
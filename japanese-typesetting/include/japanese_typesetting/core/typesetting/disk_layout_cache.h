@@ -0,0 +1,116 @@
+/**
+ * @file disk_layout_cache.h
+ * @brief ディスク上に永続化する組版結果のキャッシュ
+ */
+
+#ifndef JAPANESE_TYPESETTING_CORE_TYPESETTING_DISK_LAYOUT_CACHE_H
+#define JAPANESE_TYPESETTING_CORE_TYPESETTING_DISK_LAYOUT_CACHE_H
+
+#include "japanese_typesetting/core/typesetting/layout_cache.h"
+#include "japanese_typesetting/core/typesetting/typesetting_engine.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace japanese_typesetting {
+namespace core {
+namespace typesetting {
+
+/**
+ * @struct DiskLayoutCacheStats
+ * @brief ディスクキャッシュの統計情報
+ */
+struct DiskLayoutCacheStats {
+    size_t hits = 0;      ///< 読み込めた数
+    size_t misses = 0;    ///< 見つからなかった（または読み込めなかった）数
+    size_t writes = 0;    ///< 書き込んだ数
+};
+
+/**
+ * @class DiskLayoutCache
+ * @brief 組版結果をディレクトリ内のファイルとして保存するキャッシュ
+ *
+ * 各エントリはLayoutCacheKeyとエンジンのバージョンから求めたファイル名で保存される。
+ * ファイルにはテキスト・スタイル・ルールと、スタイルから解決したフォントファイルの
+ * パス・大きさ・更新日時を保存し、読み込み時にすべて一致した場合のみ再利用する。
+ * 書き込みは一時ファイルに書いてから名前を変更するため、同じディレクトリを
+ * 複数のプロセスから同時に使用してもよい。
+ */
+class DiskLayoutCache {
+public:
+    /**
+     * @brief 組版アルゴリズムのバージョン
+     *
+     * 行分割・禁則処理など、組版結果が変わる変更を行った場合は値を増やすこと。
+     * 値が異なるエントリは参照されない。
+     */
+    static constexpr uint32_t kEngineVersion = 9;
+
+    /**
+     * @brief コンストラクタ
+     * @param directory キャッシュディレクトリ（存在しない場合は作成する）
+     */
+    explicit DiskLayoutCache(const std::string& directory);
+
+    /**
+     * @brief デストラクタ
+     */
+    ~DiskLayoutCache();
+
+    DiskLayoutCache(const DiskLayoutCache&) = delete;
+    DiskLayoutCache& operator=(const DiskLayoutCache&) = delete;
+
+    /**
+     * @brief 組版結果を読み込む
+     * @param key キー
+     * @param block 読み込んだ組版結果の格納先
+     * @return 読み込めた場合はtrue
+     */
+    bool load(const LayoutCacheKey& key, TextBlock& block);
+
+    /**
+     * @brief 組版結果を保存する
+     * @param key キー
+     * @param block 組版結果
+     * @return 保存できた場合はtrue
+     */
+    bool store(const LayoutCacheKey& key, const TextBlock& block);
+
+    /**
+     * @brief キャッシュディレクトリを取得
+     * @return ディレクトリのパス
+     */
+    const std::string& getDirectory() const;
+
+    /**
+     * @brief キャッシュディレクトリが使用可能かどうか
+     * @return 使用可能な場合はtrue
+     */
+    bool isAvailable() const;
+
+    /**
+     * @brief 統計情報を取得
+     * @return 統計情報
+     */
+    DiskLayoutCacheStats getStats() const;
+
+private:
+    /**
+     * @brief キーに対応するファイルのパスを求める
+     * @param encodedKey ファイルに保存する形に符号化したキー
+     * @return ファイルのパス
+     */
+    std::string getEntryPath(const std::string& encodedKey) const;
+
+    std::string m_directory;            ///< キャッシュディレクトリ
+    bool m_available;                   ///< ディレクトリが使用可能かどうか
+    std::atomic<size_t> m_hits;         ///< 読み込めた数
+    std::atomic<size_t> m_misses;       ///< 見つからなかった数
+    std::atomic<size_t> m_writes;       ///< 書き込んだ数
+};
+
+} // namespace typesetting
+} // namespace core
+} // namespace japanese_typesetting
+
+#endif // JAPANESE_TYPESETTING_CORE_TYPESETTING_DISK_LAYOUT_CACHE_H
@@ -0,0 +1,342 @@
+/**
+ * @file glyph_advance_cache.h
+ * @brief 文字送り幅のキャッシュ
+ */
+
+#ifndef JAPANESE_TYPESETTING_CORE_TYPESETTING_GLYPH_ADVANCE_CACHE_H
+#define JAPANESE_TYPESETTING_CORE_TYPESETTING_GLYPH_ADVANCE_CACHE_H
+
+#include "japanese_typesetting/core/font/font.h"
+#include "japanese_typesetting/core/style/style.h"
+#include "japanese_typesetting/core/typesetting/layout_unit.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+namespace japanese_typesetting {
+namespace core {
+namespace typesetting {
+
+/**
+ * @struct GlyphAdvanceKey
+ * @brief 送り幅テーブルを識別するキー（フォントフェイス・サイズ・書字方向）
+ */
+struct GlyphAdvanceKey {
+    std::string fontFamily;   ///< フォントファミリー
+    bool bold;                ///< 太字フラグ
+    bool italic;              ///< 斜体フラグ
+    double fontSize;          ///< フォントサイズ（ポイント）
+    bool vertical;            ///< 縦書きの場合はtrue
+
+    bool operator==(const GlyphAdvanceKey& other) const;
+
+    /**
+     * @brief スタイルと書字方向からキーを作成
+     * @param style スタイル
+     * @param vertical 縦書きの場合はtrue
+     * @return キー
+     */
+    static GlyphAdvanceKey fromStyle(const style::Style& style, bool vertical);
+};
+
+/**
+ * @struct GlyphAdvanceKeyHash
+ * @brief GlyphAdvanceKeyのハッシュ関数
+ */
+struct GlyphAdvanceKeyHash {
+    size_t operator()(const GlyphAdvanceKey& key) const;
+};
+
+/**
+ * @class GlyphAdvanceTable
+ * @brief 1つのフォントフェイス・サイズ・書字方向に対する文字送り幅のテーブル
+ *
+ * かな・漢字・全角記号・ASCIIを含むBMPの頻出範囲は密な配列で保持し、
+ * それ以外の文字はハッシュマップで保持する。未計算の値は初回参照時に計算される。
+ * 送り幅はLayoutUnitに丸めて保持するため、ポイント単位の値もその丸めを経たものとなる。
+ * 複数スレッドから同時に参照してよい。
+ *
+ * フォントはフォントの登録簿が所有し、テーブルは弱参照とその位置だけを持つ。
+ * 登録簿がフォントを外した後に参照すると、登録簿から取得し直す
+ * （テーブルが残っていてもフォントファイルのマップは保持しない）。
+ */
+class GlyphAdvanceTable {
+public:
+    /**
+     * @brief 文字の送り幅を計算する関数の型（fontはgetFont()の結果で、nullptrの場合がある）
+     */
+    using Measurer = std::function<double(const font::FontFace* font, char32_t character)>;
+
+    /**
+     * @brief コンストラクタ
+     * @param key テーブルのキー
+     * @param measurer 送り幅を計算する関数
+     * @param font 送り幅の計算に用いるフォント（推定値を用いる場合はnullptr、弱参照として保持する）
+     * @param location フォントの位置（フォントが破棄された後に登録簿から取得し直すために使う）
+     */
+    GlyphAdvanceTable(const GlyphAdvanceKey& key, Measurer measurer,
+                      const std::shared_ptr<const font::FontFace>& font = nullptr,
+                      const font::FontLocation& location = font::FontLocation());
+
+    /**
+     * @brief デストラクタ
+     */
+    ~GlyphAdvanceTable();
+
+    GlyphAdvanceTable(const GlyphAdvanceTable&) = delete;
+    GlyphAdvanceTable& operator=(const GlyphAdvanceTable&) = delete;
+
+    /**
+     * @brief 文字の送り幅を取得する
+     * @param character 文字（UTF-32）
+     * @return 送り幅（LayoutUnit）
+     */
+    LayoutUnit getAdvanceUnits(char32_t character) const {
+        int index = denseIndex(character);
+        if (index >= 0) {
+            LayoutUnit cached = m_dense[index].load(std::memory_order_relaxed);
+            if (cached >= 0) {
+                return cached;
+            }
+        }
+        return lookupSlow(character, index);
+    }
+
+    /**
+     * @brief 文字の送り幅を取得する
+     * @param character 文字（UTF-32）
+     * @return 送り幅（ポイント）
+     */
+    double getAdvance(char32_t character) const {
+        return fromLayoutUnit(getAdvanceUnits(character));
+    }
+
+    /**
+     * @brief 密な配列の範囲（かな・漢字など）を事前に計算する
+     */
+    void preload() const;
+
+    /**
+     * @brief 事前計算済みかどうかを取得
+     * @return 事前計算済みの場合はtrue
+     */
+    bool isPreloaded() const;
+
+    /**
+     * @brief テーブルのキーを取得
+     * @return キー
+     */
+    const GlyphAdvanceKey& getKey() const;
+
+    /**
+     * @brief 送り幅の計算に用いるフォントを取得
+     * @return フォント、推定値を用いる場合や取得し直せない場合はnullptr
+     *
+     * 登録簿が外したフォントは登録簿から取得し直す。組版の間は戻り値を保持して使うこと。
+     */
+    std::shared_ptr<const font::FontFace> getFont() const;
+
+    /**
+     * @brief 送り幅の計算に用いるフォントの位置を取得
+     * @return フォントの位置（推定値を用いる場合はfilePathが空）
+     */
+    const font::FontLocation& getFontLocation() const;
+
+    /**
+     * @brief ハッシュマップに保持している文字数を取得
+     * @return 文字数
+     */
+    size_t getSparseEntryCount() const;
+
+    /**
+     * @brief 密な配列に含まれる文字かどうかを判定
+     * @param character 文字（UTF-32）
+     * @return 密な配列に含まれる場合はtrue
+     */
+    static bool isDenseCharacter(char32_t character);
+
+    /**
+     * @brief 事前計算済みの密な配列を取得する（ベクトル化したカーネル用）
+     * @return denseIndex()で引ける送り幅の配列、事前計算前はnullptr
+     *
+     * 事前計算後の値は変化しないため、ロックなしで読み出してよい。
+     */
+    const LayoutUnit* getDenseAdvances() const;
+
+    /**
+     * @brief 密な配列のインデックスを求める
+     * @param character 文字（UTF-32）
+     * @return インデックス、範囲外の場合は-1
+     *
+     * 範囲を変更する場合はwidth_kernels.cppのベクトル版も合わせて変更すること。
+     */
+    static int denseIndex(char32_t character) {
+        if (character < 0x100) {
+            return static_cast<int>(character);
+        }
+        if (character >= 0x3000 && character < 0xA000) {
+            return static_cast<int>(0x100 + (character - 0x3000));
+        }
+        if (character >= 0xFF00 && character < 0xFFF0) {
+            return static_cast<int>(0x7100 + (character - 0xFF00));
+        }
+        return -1;
+    }
+
+private:
+    /**
+     * @brief キャッシュされていない送り幅を計算して格納する
+     * @param character 文字（UTF-32）
+     * @param index 密な配列のインデックス（範囲外の場合は-1）
+     * @return 送り幅（LayoutUnit）
+     */
+    LayoutUnit lookupSlow(char32_t character, int index) const;
+
+    /**
+     * @brief 送り幅を計算してLayoutUnitに丸める
+     * @param character 文字（UTF-32）
+     * @param font フォント（nullptrの場合は推定値）
+     * @return 送り幅（LayoutUnit）
+     */
+    LayoutUnit measure(char32_t character, const font::FontFace* font) const;
+
+    static const size_t kDenseSize = 0x7100 + 0xF0; ///< 密な配列の要素数
+
+    GlyphAdvanceKey m_key;                               ///< テーブルのキー
+    Measurer m_measurer;                                 ///< 送り幅を計算する関数
+    font::FontLocation m_fontLocation;                   ///< フォントの位置（推定値を用いる場合は空）
+    mutable std::weak_ptr<const font::FontFace> m_font;  ///< フォントの弱参照（所有するのは登録簿）
+    mutable std::mutex m_fontMutex;                      ///< m_font用のロック
+    std::unique_ptr<std::atomic<LayoutUnit>[]> m_dense;  ///< 頻出範囲の送り幅（負値は未計算）
+    mutable std::unordered_map<char32_t, LayoutUnit> m_sparse; ///< それ以外の文字の送り幅
+    mutable std::shared_mutex m_sparseMutex;             ///< m_sparse用のロック
+    mutable std::atomic<bool> m_preloaded;               ///< 事前計算済みフラグ
+};
+
+/**
+ * @class GlyphAdvanceCache
+ * @brief 文字送り幅テーブルを共有するキャッシュ
+ *
+ * (フォントフェイス, サイズ, 書字方向)ごとにGlyphAdvanceTableを保持し、
+ * 複数の組版エンジン・スレッドから共有される。保持するテーブルの数が上限を超えた場合は、
+ * 最も長く取得されていないものから外す（取得済みのテーブルは参照が残っている間は有効なままとなる）。
+ * フォントファミリーに対応するフォントファイルが見つかればその送り幅を用い、
+ * 見つからない場合やグリフがない文字は推定値を用いる。
+ */
+class GlyphAdvanceCache {
+public:
+    /**
+     * @brief プロセス全体で共有されるインスタンスを取得する
+     * @return キャッシュのインスタンス
+     */
+    static GlyphAdvanceCache& getInstance();
+
+    /**
+     * @brief コンストラクタ
+     * @param maxTables 保持するテーブルの数の上限
+     */
+    explicit GlyphAdvanceCache(size_t maxTables = 64);
+
+    /**
+     * @brief デストラクタ
+     */
+    ~GlyphAdvanceCache();
+
+    GlyphAdvanceCache(const GlyphAdvanceCache&) = delete;
+    GlyphAdvanceCache& operator=(const GlyphAdvanceCache&) = delete;
+
+    /**
+     * @brief スタイルと書字方向に対応するテーブルを取得（なければ作成）
+     * @param style スタイル
+     * @param vertical 縦書きの場合はtrue
+     * @return 事前計算済みの送り幅テーブル
+     *
+     * 作成したテーブルは最初の取得時に密な配列の範囲を事前計算するため、
+     * 取得したテーブルでは常にベクトル化したカーネルの経路が使われる。
+     */
+    std::shared_ptr<const GlyphAdvanceTable> getTable(const style::Style& style, bool vertical);
+
+    /**
+     * @brief キーに対応するテーブルを取得（なければ作成）
+     * @param key テーブルのキー
+     * @return 事前計算済みの送り幅テーブル
+     *
+     * 既存のテーブルのキーからサイズだけを変えたテーブルを、スタイルを作らずに引くために使う。
+     */
+    std::shared_ptr<const GlyphAdvanceTable> getTable(const GlyphAdvanceKey& key);
+
+    /**
+     * @brief スタイルと書字方向に対応するテーブルを事前計算して取得
+     * @param style スタイル
+     * @param vertical 縦書きの場合はtrue
+     * @return 送り幅テーブル
+     *
+     * getTable()と同じ結果となる（事前計算を明示したい呼び出し側のために残している）。
+     */
+    std::shared_ptr<const GlyphAdvanceTable> preload(const style::Style& style, bool vertical);
+
+    /**
+     * @brief 保持しているテーブルをすべて破棄する
+     *
+     * 取得済みのテーブルは参照が残っている間は有効なままとなる。
+     */
+    void clear();
+
+    /**
+     * @brief 保持しているテーブルの数を取得
+     * @return テーブルの数
+     */
+    size_t getTableCount() const;
+
+    /**
+     * @brief フォントメトリクスが得られない場合の送り幅を計算する
+     * @param character 文字（UTF-32）
+     * @param fontSize フォントサイズ（ポイント）
+     * @return 送り幅（ポイント）
+     *
+     * Unicodeの東アジアの文字幅に基づき、全角は1em、半角は0.5emとする。
+     */
+    static double estimateAdvance(char32_t character, double fontSize);
+
+private:
+    /**
+     * @brief テーブルを作成する
+     * @param key テーブルのキー
+     * @return 送り幅テーブル
+     *
+     * フォントの検索とマップを伴うため、m_mutexを保持せずに呼ぶ。
+     */
+    std::shared_ptr<GlyphAdvanceTable> createTable(const GlyphAdvanceKey& key);
+
+    /**
+     * @brief フォントを登録簿から取得する
+     * @param location フォントの位置
+     * @return フォント、見つからない場合はnullptr
+     */
+    std::shared_ptr<const font::FontFace> openFont(const font::FontLocation& location);
+
+    /**
+     * @struct Entry
+     * @brief 保持しているテーブル
+     */
+    struct Entry {
+        std::shared_ptr<GlyphAdvanceTable> table;   ///< テーブル
+        mutable std::atomic<uint64_t> lastUse{0};   ///< 最後に取得した時刻（m_clockの値）
+    };
+
+    size_t m_maxTables;                                               ///< テーブルの数の上限
+    std::atomic<uint64_t> m_clock;                                    ///< 取得のたびに進める時刻
+    std::unordered_map<GlyphAdvanceKey, Entry, GlyphAdvanceKeyHash> m_tables; ///< テーブルのマップ
+    mutable std::shared_mutex m_mutex;                                ///< m_tables用のロック
+};
+
+} // namespace typesetting
+} // namespace core
+} // namespace japanese_typesetting
+
+#endif // JAPANESE_TYPESETTING_CORE_TYPESETTING_GLYPH_ADVANCE_CACHE_H
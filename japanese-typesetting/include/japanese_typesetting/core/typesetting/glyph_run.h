@@ -0,0 +1,91 @@
+/**
+ * @file glyph_run.h
+ * @brief 位置付けされたグリフ列（出力側がそのまま描画できる組版結果）
+ */
+
+#ifndef JAPANESE_TYPESETTING_CORE_TYPESETTING_GLYPH_RUN_H
+#define JAPANESE_TYPESETTING_CORE_TYPESETTING_GLYPH_RUN_H
+
+#include "japanese_typesetting/core/font/font.h"
+#include "japanese_typesetting/core/font/font_registry.h"
+#include "japanese_typesetting/core/typesetting/glyph_advance_cache.h"
+#include "japanese_typesetting/core/typesetting/itemizer.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace japanese_typesetting {
+namespace core {
+namespace typesetting {
+
+/**
+ * @struct GlyphRun
+ * @brief 同じフォント・同じ向きで描画する位置付け済みのグリフ列（行内のテキストランに1つずつ対応する）
+ *
+ * 各配列はグリフごとの値を同じ順序で保持する（配列の構造体）。
+ * 送り幅には行の伸縮による増減が含まれるため、出力側はペンの位置に
+ * オフセットを加えた位置にグリフを置き、送り幅だけペンを進めればよい。
+ * 縦書きでは送り幅はyAdvancesに下方向を正として入り、xAdvancesは0となる。
+ * 縦中横のランでは送り幅は最後のグリフのyAdvancesにだけ1字分が入り、
+ * グリフは字の中心線を0とするxOffsetsで横に並べられる。
+ *
+ * フォントはフェイスへの参照ではなく位置で持ち、描画時にgetFont()で登録簿から取得する。
+ * そのため、キャッシュに残った組版結果がフォントを登録簿の上限を超えて保持することはない。
+ * フォントが見つからず推定幅で組版した場合、fontLocationのfilePathは空、グリフIDは0となる。
+ * この場合はclustersが指す行のテキストの文字を描画する。
+ */
+struct GlyphRun {
+    font::FontLocation fontLocation;             ///< グリフIDが属するフォントの位置（推定幅の場合はfilePathが空）
+    double fontSize = 0.0;                       ///< フォントサイズ（ポイント）
+    std::vector<uint32_t> glyphIds;              ///< グリフID
+    std::vector<uint32_t> clusters;              ///< 行のテキスト内の文字位置
+    std::vector<double> xAdvances;               ///< X方向の送り幅
+    std::vector<double> yAdvances;               ///< Y方向の送り幅
+    std::vector<double> xOffsets;                ///< X方向のオフセット
+    std::vector<double> yOffsets;                ///< Y方向のオフセット
+    std::vector<uint8_t> rotated;                ///< 縦書きで90度回転して描画する場合は1
+
+    /**
+     * @brief グリフ数を取得
+     * @return グリフ数
+     */
+    size_t size() const { return glyphIds.size(); }
+
+    /**
+     * @brief グリフIDが属するフォントを登録簿から取得する
+     * @return フォント、推定幅の場合や開けない場合はnullptr
+     *
+     * 描画の間は戻り値を保持して使うこと。
+     */
+    std::shared_ptr<const font::FontFace> getFont() const {
+        if (fontLocation.filePath.empty()) {
+            return nullptr;
+        }
+        return font::FontRegistry::getInstance().getFace(fontLocation);
+    }
+};
+
+/**
+ * @brief 組版済みの行からテキストランごとのグリフ列を作成する
+ * @param text 行のテキスト（UTF-32）
+ * @param advanceDeltas 文字ごとの送り幅の増減（空の場合は増減なし）
+ * @param runs 行のテキストラン（行の先頭からの位置）
+ * @param advances 行の組版に使った文字送り幅テーブル
+ * @param vertical 縦書きの場合はtrue
+ * @return ランごとのグリフ列
+ *
+ * 行の幅の計算にシェーピング結果を使った場合は、シェーピング結果のキャッシュから
+ * 同じ結果を取り出して使うため、再度シェーピングすることはない。
+ * 送り幅はLayoutUnitに丸めた値で、行の幅の計算と一致する。
+ * 縦書きで横倒しのランは全グリフのrotatedが1となる。
+ */
+std::vector<GlyphRun> buildGlyphRuns(const std::u32string& text, const std::vector<double>& advanceDeltas,
+                                     const std::vector<TextRun>& runs, const GlyphAdvanceTable& advances,
+                                     bool vertical);
+
+} // namespace typesetting
+} // namespace core
+} // namespace japanese_typesetting
+
+#endif // JAPANESE_TYPESETTING_CORE_TYPESETTING_GLYPH_RUN_H
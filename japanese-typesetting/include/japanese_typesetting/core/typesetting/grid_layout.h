@@ -0,0 +1,46 @@
+/**
+ * @file grid_layout.h
+ * @brief 字詰め（文字を升目に置く組み方）の行組みカーネル
+ */
+
+#ifndef JAPANESE_TYPESETTING_CORE_TYPESETTING_GRID_LAYOUT_H
+#define JAPANESE_TYPESETTING_CORE_TYPESETTING_GRID_LAYOUT_H
+
+#include "japanese_typesetting/core/typesetting/layout_kernels.h"
+
+namespace japanese_typesetting {
+namespace core {
+namespace typesetting {
+
+/**
+ * @brief 字詰めで行組みを行う
+ * @param mode 書字方向
+ * @param text 組版するテキスト（UTF-32）
+ * @param advances 書字方向に対応する文字送り幅テーブル
+ * @param rules 組版ルール
+ * @param maxUnits 行の最大幅（1字分の整数倍に切り捨てた字数を1行の字数とする）
+ * @param layout 結果の格納先（rubiesとrubyは参照しない）
+ * @param cancellation 行ごとに確認する中断トークン（nullptrの場合は中断しない）
+ * @return 最後まで組版した場合はCompleted、中断された場合はその理由
+ *
+ * 全角で正立するランの文字は1字分の升目に置き、行分割は字数の整数演算と禁則だけで行う
+ * （送り幅の合計は取らない）。かな・漢字・全角の記号が続く範囲は1文字ずつ分類せずに1つのランとし、
+ * それ以外の範囲だけをitemizeTextで分類する。
+ *
+ * 例外として、半角や横倒しのランはプロポーショナルに組み、行内で占める幅を升目の整数倍に切り上げる
+ * （余りはその範囲の末尾の文字の後ろに空ける）。縦中横は1字分の升目に置く。
+ * フォントの送り幅が1字分と異なる全角の文字は、その差をadvanceDeltasで埋めて升目にそろえる。
+ *
+ * 行頭禁則の文字は、ぶら下げ対象であれば升目の外にぶら下げ、それ以外は前の行の末尾の1字を
+ * 次の行に追い出す。行末禁則の文字は次の行に送る。行の伸縮は行わないため、追い出した行は
+ * 字数が足りないまま残り、行揃えの指定は結果に影響しない。
+ */
+TypesetStatus layoutGridLines(WritingMode mode, const std::pmr::u32string& text, const GlyphAdvanceTable& advances,
+                              const TypesettingRules& rules, LayoutUnit maxUnits, LineLayout& layout,
+                              const CancellationToken* cancellation);
+
+} // namespace typesetting
+} // namespace core
+} // namespace japanese_typesetting
+
+#endif // JAPANESE_TYPESETTING_CORE_TYPESETTING_GRID_LAYOUT_H
@@ -0,0 +1,173 @@
+/**
+ * @file itemizer.h
+ * @brief 段落を文字種・向き・字幅・フォントが一様なランに分割する処理
+ */
+
+#ifndef JAPANESE_TYPESETTING_CORE_TYPESETTING_ITEMIZER_H
+#define JAPANESE_TYPESETTING_CORE_TYPESETTING_ITEMIZER_H
+
+#include "japanese_typesetting/core/font/font.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+namespace japanese_typesetting {
+namespace core {
+namespace typesetting {
+
+/**
+ * @enum Script
+ * @brief ランの用字（シェーピングの単位）
+ *
+ * 漢字・ひらがな・カタカナは同じランとしてシェーピングするため、まとめてJapaneseとする。
+ */
+enum class Script : uint8_t {
+    Common,     ///< 用字を持たない文字（記号・数字・空白など、隣接するランの用字に従う）
+    Japanese,   ///< 漢字・ひらがな・カタカナ
+    Latin,      ///< ラテン文字
+    Other       ///< その他の用字
+};
+
+/**
+ * @enum GlyphOrientation
+ * @brief 縦書きでのグリフの向き（横書きでは常にUpright）
+ */
+enum class GlyphOrientation : uint8_t {
+    Upright,      ///< 正立（縦書き用字形がある場合はそれを使う）
+    Sideways,     ///< 90度回転（横倒し）
+    TateChuYoko   ///< 縦中横（複数の文字を1字分の枠に横組みする）
+};
+
+/**
+ * @enum WidthClass
+ * @brief 東アジアの文字幅による分類
+ */
+enum class WidthClass : uint8_t {
+    Full,   ///< 全角（East Asian WidthがW・F・A）
+    Half    ///< 半角（East Asian WidthがH・Na・N）
+};
+
+/**
+ * @enum EmphasisMark
+ * @brief 圏点（傍点）の種類
+ */
+enum class EmphasisMark : uint8_t {
+    None,           ///< なし
+    FilledSesame,   ///< 黒ゴマ（﹅）
+    OpenSesame,     ///< 白ゴマ（﹆）
+    FilledCircle,   ///< 黒丸（●）
+    OpenCircle      ///< 白丸（○）
+};
+
+/**
+ * @enum Sideline
+ * @brief 傍線の種類
+ */
+enum class Sideline : uint8_t {
+    None,     ///< なし
+    Solid,    ///< 傍線
+    Double    ///< 二重傍線
+};
+
+/**
+ * @struct CharacterProperties
+ * @brief 1文字の分類結果
+ */
+struct CharacterProperties {
+    Script script;                 ///< 用字
+    GlyphOrientation orientation;  ///< 縦書きでの向き
+    WidthClass widthClass;         ///< 文字幅
+};
+
+/**
+ * @struct TextRun
+ * @brief 用字・向き・字幅・フォントが一様なテキストの範囲
+ *
+ * fallbackがfalseのランはスタイルのフォントにすべての文字のグリフがあり、
+ * そのフォントでシェーピング・計測する。trueのランは推定幅で計測する。
+ * 圏点と傍線は入力の注記から付ける属性で、ランはその境界でも分かれる。
+ */
+struct TextRun {
+    uint32_t start = 0;                                      ///< 開始位置
+    uint32_t length = 0;                                     ///< 文字数
+    Script script = Script::Common;                          ///< 用字
+    GlyphOrientation orientation = GlyphOrientation::Upright; ///< 縦書きでの向き
+    WidthClass widthClass = WidthClass::Full;                ///< 文字幅
+    bool fallback = false;                                   ///< スタイルのフォントで描画できない場合はtrue
+    EmphasisMark emphasis = EmphasisMark::None;              ///< 圏点
+    Sideline sideline = Sideline::None;                      ///< 傍線
+
+    /**
+     * @brief 終了位置（範囲の直後）を取得
+     * @return 終了位置
+     */
+    uint32_t end() const { return start + length; }
+
+    /**
+     * @brief 用字以外の属性が等しいかどうか
+     * @param other 比較するラン
+     * @return 等しい場合はtrue
+     */
+    bool hasSameLayout(const TextRun& other) const {
+        return orientation == other.orientation && widthClass == other.widthClass && fallback == other.fallback;
+    }
+};
+
+/**
+ * @brief 縦中横にする半角英数字の最大文字数
+ */
+constexpr size_t kMaxTateChuYokoCharacters = 2;
+
+/**
+ * @brief 文字を分類する
+ * @param character 文字（UTF-32）
+ * @param vertical 縦書きの場合はtrue
+ * @return 分類結果（縦中横は前後の文字によるため判定しない）
+ *
+ * かな・漢字・ASCII・全角形は表で判定し、それ以外はICUの用字・East Asian Width・
+ * Vertical Orientation（UAX #50）の各プロパティで判定する。
+ */
+CharacterProperties classifyCharacter(char32_t character, bool vertical);
+
+/**
+ * @brief テキストを1回の走査でランに分割する
+ * @param text テキスト（UTF-32）
+ * @param length 文字数
+ * @param vertical 縦書きの場合はtrue
+ * @param font スタイルのフォント（nullptrの場合はすべてのランが推定幅）
+ * @param runs ランの格納先（追加される）
+ *
+ * 用字を持たない文字は直前のランの用字に従う（先頭の場合は後続の用字に合わせる）。
+ * 縦書きでは次の並びを縦中横とする（組版時は1字分の幅として扱う）。
+ * - 前後を半角の記号・英数字以外に挟まれたkMaxTateChuYokoCharacters文字以下の半角英数字
+ * - 「!?」「!!」などの感嘆符・疑問符2文字の組み合わせ（全角を含む）
+ */
+void itemizeText(const char32_t* text, size_t length, bool vertical, const font::FontFace* font,
+                 std::pmr::vector<TextRun>& runs);
+
+/**
+ * @brief 範囲と重なるランを先頭から順に列挙する
+ * @param runs ランのリスト（開始位置の昇順）
+ * @param cursor 走査の開始位置（範囲を昇順に渡す間は呼び出しをまたいで保持すると線形時間で済む）
+ * @param start 範囲の開始位置
+ * @param end 範囲の終了位置
+ * @param function ランと、範囲内の開始・終了位置を受け取る関数
+ */
+template <typename Runs, typename Function>
+void forEachRunSegment(const Runs& runs, size_t& cursor, size_t start, size_t end, Function&& function) {
+    while (cursor < runs.size() && runs[cursor].end() <= start) {
+        ++cursor;
+    }
+    for (size_t i = cursor; i < runs.size() && runs[i].start < end; ++i) {
+        size_t segmentStart = runs[i].start > start ? runs[i].start : start;
+        size_t segmentEnd = runs[i].end() < end ? runs[i].end() : end;
+        function(runs[i], segmentStart, segmentEnd);
+    }
+}
+
+} // namespace typesetting
+} // namespace core
+} // namespace japanese_typesetting
+
+#endif // JAPANESE_TYPESETTING_CORE_TYPESETTING_ITEMIZER_H
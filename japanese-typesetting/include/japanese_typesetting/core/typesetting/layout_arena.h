@@ -0,0 +1,99 @@
+/**
+ * @file layout_arena.h
+ * @brief 組版処理の中間データ用アリーナアロケータ
+ */
+
+#ifndef JAPANESE_TYPESETTING_CORE_TYPESETTING_LAYOUT_ARENA_H
+#define JAPANESE_TYPESETTING_CORE_TYPESETTING_LAYOUT_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+
+namespace japanese_typesetting {
+namespace core {
+namespace typesetting {
+
+/**
+ * @struct AllocationStats
+ * @brief メモリ確保の統計情報を表す構造体
+ */
+struct AllocationStats {
+    size_t bytesAllocated = 0;   ///< 確保したバイト数
+    size_t allocationCount = 0;  ///< 確保回数
+};
+
+/**
+ * @class LayoutArena
+ * @brief 組版処理の中間データをバンプ割り当てで確保するメモリリソース
+ *
+ * 1回の組版呼び出しで生成される短命なデータ（UTF-32変換結果や行の範囲など）を
+ * 単調増加バッファから確保する。reset()で全領域を一括解放し、
+ * 前回の使用量に合わせて保持バッファを拡張するため、定常状態ではヒープ確保が発生しない。
+ */
+class LayoutArena : public std::pmr::memory_resource {
+public:
+    /**
+     * @brief コンストラクタ
+     * @param upstream バッファを使い切った場合の上流メモリリソース
+     * @param initialSize 保持バッファの初期サイズ（バイト）
+     */
+    explicit LayoutArena(std::pmr::memory_resource* upstream = std::pmr::get_default_resource(),
+                         size_t initialSize = 16 * 1024);
+
+    /**
+     * @brief デストラクタ
+     */
+    ~LayoutArena() override;
+
+    LayoutArena(const LayoutArena&) = delete;
+    LayoutArena& operator=(const LayoutArena&) = delete;
+
+    /**
+     * @brief 確保済みの領域をすべて解放し、統計情報をリセットする
+     */
+    void reset();
+
+    /**
+     * @brief 上流メモリリソースを設定（アリーナはリセットされる）
+     * @param upstream 上流メモリリソース（nullptrの場合はデフォルト）
+     */
+    void setUpstream(std::pmr::memory_resource* upstream);
+
+    /**
+     * @brief 上流メモリリソースを取得
+     * @return 上流メモリリソース
+     */
+    std::pmr::memory_resource* getUpstream() const;
+
+    /**
+     * @brief 前回のリセット以降の確保統計を取得
+     * @return 確保統計
+     */
+    AllocationStats getStats() const;
+
+    /**
+     * @brief 保持バッファのサイズを取得
+     * @return 保持バッファのサイズ（バイト）
+     */
+    size_t getRetainedSize() const;
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+private:
+    std::pmr::memory_resource* m_upstream;                      ///< 上流メモリリソース
+    std::unique_ptr<std::byte[]> m_buffer;                      ///< 保持バッファ
+    size_t m_bufferSize;                                        ///< 保持バッファのサイズ
+    std::optional<std::pmr::monotonic_buffer_resource> m_resource; ///< 単調増加リソース
+    AllocationStats m_stats;                                    ///< 確保統計
+};
+
+} // namespace typesetting
+} // namespace core
+} // namespace japanese_typesetting
+
+#endif // JAPANESE_TYPESETTING_CORE_TYPESETTING_LAYOUT_ARENA_H
@@ -0,0 +1,186 @@
+/**
+ * @file layout_cache.h
+ * @brief 組版結果のキャッシュ
+ */
+
+#ifndef JAPANESE_TYPESETTING_CORE_TYPESETTING_LAYOUT_CACHE_H
+#define JAPANESE_TYPESETTING_CORE_TYPESETTING_LAYOUT_CACHE_H
+
+#include "japanese_typesetting/core/style/style.h"
+#include "japanese_typesetting/core/style/style_interner.h"
+#include "japanese_typesetting/core/typesetting/typesetting_engine.h"
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace japanese_typesetting {
+namespace core {
+namespace typesetting {
+
+/**
+ * @struct LayoutCacheKey
+ * @brief 組版結果を識別するキー
+ *
+ * ハッシュ値は索引にのみ用い、一致の判定ではテキスト・スタイル・ルールを値で比較する。
+ * そのため、ハッシュ値が衝突しても別の入力の組版結果を返すことはない。
+ */
+struct LayoutCacheKey {
+    uint64_t textHash = 0;        ///< テキストのハッシュ値
+    std::string text;             ///< テキスト（UTF-8）
+    uint64_t styleHash = 0;       ///< 組版に影響するスタイル項目のハッシュ値
+    style::Style style;           ///< スタイル（組版に影響する項目のみ比較する）
+    uint64_t rulesHash = 0;       ///< 組版ルールのハッシュ値
+    std::shared_ptr<const TypesettingRules> rules; ///< 組版ルール
+    double width = 0.0;           ///< 最大幅
+    bool vertical = false;        ///< 縦書きの場合はtrue
+    bool glyphRuns = false;       ///< グリフ列を出力する場合はtrue（結果の形が変わるため区別する）
+
+    bool operator==(const LayoutCacheKey& other) const;
+
+    /**
+     * @brief 組版の入力からキーを作成
+     * @param text テキスト（UTF-8）
+     * @param style スタイル
+     * @param rules 組版ルール（キーと共有する）
+     * @param width 最大幅
+     * @param vertical 縦書きの場合はtrue
+     * @return キー
+     */
+    static LayoutCacheKey create(const std::string& text, const style::Style& style,
+                                 std::shared_ptr<const TypesettingRules> rules, double width, bool vertical);
+
+    /**
+     * @brief 組版の入力からキーを作成（スタイルのハッシュ値は計算済みのものを使う）
+     * @param text テキスト（UTF-8）
+     * @param style 共有されたスタイル
+     * @param rules 組版ルール（キーと共有する）
+     * @param width 最大幅
+     * @param vertical 縦書きの場合はtrue
+     * @return キー
+     */
+    static LayoutCacheKey create(const std::string& text, const style::StyleHandle& style,
+                                 std::shared_ptr<const TypesettingRules> rules, double width, bool vertical);
+};
+
+/**
+ * @struct LayoutCacheKeyHash
+ * @brief LayoutCacheKeyのハッシュ関数
+ */
+struct LayoutCacheKeyHash {
+    size_t operator()(const LayoutCacheKey& key) const;
+};
+
+/**
+ * @struct LayoutCacheStats
+ * @brief 組版結果キャッシュの統計情報
+ */
+struct LayoutCacheStats {
+    size_t hits = 0;        ///< キャッシュヒット数
+    size_t misses = 0;      ///< キャッシュミス数
+    size_t evictions = 0;   ///< 上限を超えたため破棄した数
+    size_t entries = 0;     ///< 保持しているエントリ数
+};
+
+/**
+ * @class LayoutCache
+ * @brief (テキスト, スタイル, ルール, 幅, 書字方向)ごとの組版結果を保持するキャッシュ
+ *
+ * 保持するエントリ数には上限があり、最も長く参照されていないものから破棄する。
+ * 複数の組版エンジン・スレッドから同時に使用してよい。
+ */
+class LayoutCache {
+public:
+    /**
+     * @brief プロセス全体で共有されるインスタンスを取得する
+     * @return キャッシュのインスタンス
+     */
+    static LayoutCache& getInstance();
+
+    /**
+     * @brief コンストラクタ
+     * @param capacity 保持するエントリ数の上限
+     */
+    explicit LayoutCache(size_t capacity = 1024);
+
+    /**
+     * @brief デストラクタ
+     */
+    ~LayoutCache();
+
+    LayoutCache(const LayoutCache&) = delete;
+    LayoutCache& operator=(const LayoutCache&) = delete;
+
+    /**
+     * @brief 組版結果を検索する
+     * @param key キー
+     * @return 組版結果、見つからない場合はnullptr
+     */
+    std::shared_ptr<const TextBlock> find(const LayoutCacheKey& key);
+
+    /**
+     * @brief 組版結果を格納する
+     * @param key キー
+     * @param block 組版結果
+     */
+    void store(const LayoutCacheKey& key, const TextBlock& block);
+
+    /**
+     * @brief 保持するエントリ数の上限を設定
+     * @param capacity 上限（0の場合はキャッシュしない）
+     */
+    void setCapacity(size_t capacity);
+
+    /**
+     * @brief 保持するエントリ数の上限を取得
+     * @return 上限
+     */
+    size_t getCapacity() const;
+
+    /**
+     * @brief 保持しているエントリをすべて破棄する
+     */
+    void clear();
+
+    /**
+     * @brief 統計情報を取得
+     * @return 統計情報
+     */
+    LayoutCacheStats getStats() const;
+
+    /**
+     * @brief 組版に影響するスタイル項目のハッシュ値を求める
+     * @param style スタイル
+     * @return ハッシュ値
+     */
+    static uint64_t hashStyle(const style::Style& style);
+
+    /**
+     * @brief テキストのハッシュ値を求める（FNV-1a）
+     * @param text テキスト
+     * @return ハッシュ値
+     */
+    static uint64_t hashText(const std::string& text);
+
+private:
+    /**
+     * @brief 上限を超えている間、最も古いエントリを破棄する（ロック取得済みで呼び出す）
+     */
+    void evictLocked();
+
+    using Entry = std::pair<LayoutCacheKey, std::shared_ptr<const TextBlock>>;
+
+    size_t m_capacity;                                                                  ///< エントリ数の上限
+    std::list<Entry> m_entries;                                                         ///< 参照順のエントリ（先頭が最新）
+    std::unordered_map<LayoutCacheKey, std::list<Entry>::iterator, LayoutCacheKeyHash> m_index; ///< キーからエントリへの索引
+    LayoutCacheStats m_stats;                                                           ///< 統計情報
+    mutable std::mutex m_mutex;                                                         ///< ロック
+};
+
+} // namespace typesetting
+} // namespace core
+} // namespace japanese_typesetting
+
+#endif // JAPANESE_TYPESETTING_CORE_TYPESETTING_LAYOUT_CACHE_H
@@ -0,0 +1,137 @@
+/**
+ * @file layout_kernels.h
+ * @brief 書字方向と両端揃えかどうかで特殊化された行組みカーネル
+ */
+
+#ifndef JAPANESE_TYPESETTING_CORE_TYPESETTING_LAYOUT_KERNELS_H
+#define JAPANESE_TYPESETTING_CORE_TYPESETTING_LAYOUT_KERNELS_H
+
+#include "japanese_typesetting/core/style/style.h"
+#include "japanese_typesetting/core/typesetting/annotation.h"
+#include "japanese_typesetting/core/typesetting/cancellation.h"
+#include "japanese_typesetting/core/typesetting/glyph_advance_cache.h"
+#include "japanese_typesetting/core/typesetting/itemizer.h"
+#include "japanese_typesetting/core/typesetting/layout_unit.h"
+#include "japanese_typesetting/core/typesetting/ruby.h"
+#include "japanese_typesetting/core/typesetting/typesetting_rules.h"
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+namespace japanese_typesetting {
+namespace core {
+namespace typesetting {
+
+/**
+ * @enum WritingMode
+ * @brief 書字方向
+ */
+enum class WritingMode {
+    Horizontal,   ///< 横書き
+    Vertical      ///< 縦書き
+};
+
+/**
+ * @brief 縦書きフラグから書字方向を取得
+ * @param vertical 縦書きの場合はtrue
+ * @return 書字方向
+ */
+inline WritingMode toWritingMode(bool vertical) {
+    return vertical ? WritingMode::Vertical : WritingMode::Horizontal;
+}
+
+/**
+ * @struct LineRange
+ * @brief 組版中の行をテキスト内の範囲として表す構造体
+ *
+ * 行ごとに文字列を確保せず、UTF-32バッファ内の位置で行を表現する。
+ * 明示的な改行を含まない限り、隣接する行の範囲は連続している。
+ */
+struct LineRange {
+    size_t start;         ///< テキスト内の開始位置
+    size_t length;        ///< 文字数
+    LayoutUnit width;     ///< 行の幅
+    bool hasLineBreak;    ///< 明示的な改行があるかどうか
+};
+
+/**
+ * @struct LineLayout
+ * @brief 行組みカーネルの結果（中間データと同じアリーナに確保する）
+ *
+ * ルビを組む場合は、呼び出し前にrubiesとrubyを設定しておく。
+ * カーネルはrubiesのモノルビを親文字1字ごとに分け、各注釈のルビの枠を書き込む。
+ * 圏点・傍線はannotationsに設定しておくと、runsの属性として付けられる。
+ */
+struct LineLayout {
+    std::pmr::vector<LineRange> lines;           ///< 行のリスト
+    std::pmr::vector<LayoutUnit> advanceDeltas;  ///< ルビのアキと行の伸縮による文字ごとの送り幅の増減（テキストと同じ長さ、増減がない場合は空でもよい）
+    std::pmr::vector<TextRun> runs;              ///< 段落全体のラン
+    std::pmr::vector<RubySpan> rubies;           ///< 段落全体のルビ注釈（親文字の位置の昇順）
+    RubyAnnotations ruby;                        ///< ルビ文字列と送り幅（rubiesが空の場合は参照しない）
+    std::pmr::vector<AnnotationSpan> annotations; ///< 段落全体の圏点・傍線の注記（開始位置の昇順）
+
+    /**
+     * @brief コンストラクタ
+     * @param resource 結果と中間データを確保するメモリリソース
+     */
+    explicit LineLayout(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : lines(resource)
+        , advanceDeltas(resource)
+        , runs(resource)
+        , rubies(resource)
+        , annotations(resource) {
+    }
+};
+
+/**
+ * @brief テキストをランに分割して行に分割し、禁則・シェーピング・行揃え・ぶら下げを適用する
+ * @tparam Mode 書字方向
+ * @tparam Justify 両端揃えの場合はtrue
+ * @param text 組版するテキスト（UTF-32）
+ * @param advances 書字方向に対応する文字送り幅テーブル
+ * @param rules 組版ルール
+ * @param maxUnits 行の最大幅
+ * @param layout 結果の格納先（アロケータは中間データの確保にも使う）
+ * @param cancellation 各段階の間と行・ランごとに確認する中断トークン（nullptrの場合は中断しない）
+ * @return 最後まで組版した場合はCompleted、中断された場合はその理由
+ *
+ * ランへの分割は段落ごとに1回だけ行い、シェーピングは行とランが重なる区間ごとに行う
+ * （スタイルのフォントにグリフがないランは推定幅のままとする）。
+ * ルビは行分割の前に配置を決め（placeRubies）、グループルビの親文字の途中では改行しない。
+ * 行頭・行末に来た親文字はルビが行外に出ないよう、前後のアキと掛かりを行内に移す。
+ * 行はJIS X 4051の優先順位で伸縮する（LineAdjuster）。最大幅を超える行は常に詰め、
+ * 両端揃えでは段落末と明示的な改行の前を除く行を最大幅まで広げる。
+ * 書字方向と両端揃えかどうかはコンパイル時に決まるため、行・文字ごとの分岐が取り除かれる。
+ * 左・右・中央揃えは行内の配置が変わらないため同じカーネルを使い、
+ * 書字方向と両端揃えかどうかの4つの組み合わせがlayout_kernels.cppで実体化される。
+ */
+template <WritingMode Mode, bool Justify>
+TypesetStatus layoutLineRanges(const std::pmr::u32string& text, const GlyphAdvanceTable& advances,
+                               const TypesettingRules& rules, LayoutUnit maxUnits,
+                               LineLayout& layout, const CancellationToken* cancellation);
+
+/**
+ * @brief 書字方向と行揃えに対応する特殊化を選んで行組みを行う
+ * @param mode 書字方向
+ * @param alignment 行揃え
+ * @param text 組版するテキスト（UTF-32）
+ * @param advances 書字方向に対応する文字送り幅テーブル
+ * @param rules 組版ルール
+ * @param maxUnits 行の最大幅
+ * @param layout 結果の格納先
+ * @param cancellation 各段階の間と行・ランごとに確認する中断トークン（nullptrの場合は中断しない）
+ * @return 最後まで組版した場合はCompleted、中断された場合はその理由
+ *
+ * 分岐は呼び出しごとに1回だけ行う。
+ */
+TypesetStatus layoutLineRanges(WritingMode mode, style::TextAlignment alignment,
+                               const std::pmr::u32string& text, const GlyphAdvanceTable& advances,
+                               const TypesettingRules& rules, LayoutUnit maxUnits,
+                               LineLayout& layout, const CancellationToken* cancellation);
+
+} // namespace typesetting
+} // namespace core
+} // namespace japanese_typesetting
+
+#endif // JAPANESE_TYPESETTING_CORE_TYPESETTING_LAYOUT_KERNELS_H
@@ -0,0 +1,66 @@
+/**
+ * @file layout_unit.h
+ * @brief 組版に用いる固定小数点の長さの単位
+ */
+
+#ifndef JAPANESE_TYPESETTING_CORE_TYPESETTING_LAYOUT_UNIT_H
+#define JAPANESE_TYPESETTING_CORE_TYPESETTING_LAYOUT_UNIT_H
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace japanese_typesetting {
+namespace core {
+namespace typesetting {
+
+/**
+ * @brief 組版内部で用いる長さ（1/64ポイント単位の整数）
+ *
+ * 送り幅・行幅の合計や改行位置の判定はこの単位で行う。整数の加算は
+ * 順序によらず厳密なので、計算の順序やスレッド数が違っても結果は一致する。
+ * 1/64ポイントはどの値もdoubleで正確に表せる。
+ */
+using LayoutUnit = int32_t;
+
+/**
+ * @brief 1ポイントあたりのLayoutUnitの数
+ */
+constexpr LayoutUnit kLayoutUnitsPerPoint = 64;
+
+/**
+ * @brief ポイントをLayoutUnitに変換する（最も近い値に丸める）
+ * @param points 長さ（ポイント）
+ * @return 長さ（LayoutUnit）
+ *
+ * LayoutUnitで表せない長さ（約±3300万ポイント超）と無限大は表せる最大・最小の値に、
+ * 非数は0にする。整数への変換で値が折り返して負の行幅などにならないようにするため。
+ */
+inline LayoutUnit toLayoutUnit(double points) {
+    const double units = points * kLayoutUnitsPerPoint;
+    if (std::isnan(units)) {
+        return 0;
+    }
+    if (units >= static_cast<double>(std::numeric_limits<LayoutUnit>::max())) {
+        return std::numeric_limits<LayoutUnit>::max();
+    }
+    if (units <= static_cast<double>(std::numeric_limits<LayoutUnit>::min())) {
+        return std::numeric_limits<LayoutUnit>::min();
+    }
+    return static_cast<LayoutUnit>(std::llround(units));
+}
+
+/**
+ * @brief LayoutUnitをポイントに変換する
+ * @param units 長さ（LayoutUnit）
+ * @return 長さ（ポイント）
+ */
+constexpr double fromLayoutUnit(int64_t units) {
+    return static_cast<double>(units) / kLayoutUnitsPerPoint;
+}
+
+} // namespace typesetting
+} // namespace core
+} // namespace japanese_typesetting
+
+#endif // JAPANESE_TYPESETTING_CORE_TYPESETTING_LAYOUT_UNIT_H
@@ -0,0 +1,107 @@
+/**
+ * @file line_adjustment.h
+ * @brief JIS X 4051に基づく行の伸縮（行長の調整）
+ */
+
+#ifndef JAPANESE_TYPESETTING_CORE_TYPESETTING_LINE_ADJUSTMENT_H
+#define JAPANESE_TYPESETTING_CORE_TYPESETTING_LINE_ADJUSTMENT_H
+
+#include "japanese_typesetting/core/typesetting/layout_unit.h"
+#include "japanese_typesetting/core/typesetting/typesetting_rules.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+namespace japanese_typesetting {
+namespace core {
+namespace typesetting {
+
+/**
+ * @enum PunctuationClass
+ * @brief 字幅の半分の空き（アキ）を持つ約物の分類（JIS X 4051の文字クラスに対応）
+ */
+enum class PunctuationClass : uint8_t {
+    None,         ///< 約物ではない
+    Opening,      ///< 始め括弧類（前側にアキ）
+    Closing,      ///< 終わり括弧類（後側にアキ）
+    Comma,        ///< 読点類（後側にアキ）
+    FullStop,     ///< 句点類（後側にアキ、詰めない）
+    MiddleDot     ///< 中点類（前後に4分のアキ）
+};
+
+/**
+ * @brief 文字の約物分類を取得
+ * @param character 文字（UTF-32）
+ * @return 約物分類
+ */
+PunctuationClass classifyPunctuation(char32_t character);
+
+/**
+ * @class LineAdjuster
+ * @brief 行を目標の長さに伸縮し、文字ごとの送り幅の増減を求めるクラス
+ *
+ * JIS X 4051の優先順位に従って調整箇所に量を割り当てる。
+ * - 詰める場合：約物のアキ（括弧・読点・中点）、欧文間のスペースの順
+ * - 広げる場合：欧文間のスペース、文字間の順
+ * 同じ優先順位の調整箇所には、上限に達するまで均等に割り当てる。
+ *
+ * 結果は「文字iの後ろの空きの増減」として文字位置ごとの配列に書き込む。
+ * 調整箇所の一時データは構造体の配列ではなく配列の構造体として保持し、
+ * 行ごとに使い回す。
+ */
+class LineAdjuster {
+public:
+    /**
+     * @brief コンストラクタ
+     * @param resource 一時データを確保するメモリリソース
+     */
+    explicit LineAdjuster(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    /**
+     * @brief デストラクタ
+     */
+    ~LineAdjuster();
+
+    /**
+     * @brief 行を伸縮する
+     * @param text 行のテキスト（UTF-32）
+     * @param widths 文字ごとの送り幅
+     * @param length 調整対象の文字数（ぶら下げる文字は含めない）
+     * @param width 現在の行の幅
+     * @param target 目標の行の幅
+     * @param stretch 行が短い場合に広げるかどうか（falseの場合は詰めるのみ）
+     * @param rules 組版ルール（分離禁止文字の間は広げない）
+     * @param deltas 送り幅の増減の格納先（length要素、加算される）
+     * @return 調整後の行の幅（調整箇所が足りない場合は目標に届かない）
+     */
+    LayoutUnit adjust(const char32_t* text, const LayoutUnit* widths, size_t length, LayoutUnit width,
+                      LayoutUnit target, bool stretch, const TypesettingRules& rules, LayoutUnit* deltas);
+
+private:
+    /**
+     * @brief 調整箇所を追加する
+     * @param position 増減を書き込む文字位置
+     * @param limit 調整できる量の上限
+     */
+    void addOpportunity(size_t position, LayoutUnit limit);
+
+    /**
+     * @brief 追加済みの調整箇所に均等に割り当て、調整箇所を空にする
+     * @param amount 割り当てる量
+     * @param direction 広げる場合は1、詰める場合は-1
+     * @param deltas 送り幅の増減の格納先
+     * @return 割り当てた量
+     */
+    LayoutUnit distribute(LayoutUnit amount, int direction, LayoutUnit* deltas);
+
+    std::pmr::vector<uint32_t> m_positions;    ///< 調整箇所の文字位置
+    std::pmr::vector<LayoutUnit> m_limits;     ///< 調整箇所ごとの上限
+    std::pmr::vector<LayoutUnit> m_assigned;   ///< 調整箇所ごとの割り当て済みの量
+};
+
+} // namespace typesetting
+} // namespace core
+} // namespace japanese_typesetting
+
+#endif // JAPANESE_TYPESETTING_CORE_TYPESETTING_LINE_ADJUSTMENT_H
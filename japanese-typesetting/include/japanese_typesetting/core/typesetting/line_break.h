@@ -7,7 +7,9 @@
 #define JAPANESE_TYPESETTING_CORE_TYPESETTING_LINE_BREAK_H
 
 #include "japanese_typesetting/core/style/style.h"
+#include "japanese_typesetting/core/typesetting/glyph_advance_cache.h"
 #include "japanese_typesetting/core/typesetting/typesetting_rules.h"
+#include "japanese_typesetting/core/typesetting/width_index.h"
 #include "japanese_typesetting/core/unicode/unicode.h"
 #include <string>
 #include <vector>
@@ -54,6 +56,36 @@ public:
      */
     std::vector<std::u32string> breakLines(const std::u32string& text, const style::Style& style, double maxWidth, bool vertical);
 
+    /**
+     * @brief 編集に追従させている送り幅の索引を使って行分割を行う
+     * @param text 分割するテキスト（UTF-32）
+     * @param widths textと同じ内容に保たれた送り幅の索引
+     * @param maxWidth 最大幅
+     * @return 分割位置のリスト（各行の終了位置、最後の行を除く）
+     *
+     * breakLinesと同じ規則（段落全体の最適化）で分割し、breakLinesの各行の終了位置と一致する。
+     * 分割可能な位置までの幅は索引から引くため、段落の送り幅の累積和は作らない。
+     */
+    std::vector<size_t> breakPositions(const std::u32string& text, const AdvanceWidthIndex& widths, double maxWidth);
+
+    /**
+     * @brief 編集の前の分割位置を使い、編集した行の付近だけを分割し直す
+     * @param text 編集後のテキスト（UTF-32）
+     * @param widths 編集後のtextと同じ内容に保たれた送り幅の索引
+     * @param maxWidth 最大幅（previousBreaksを求めたときと同じ値）
+     * @param previousBreaks 編集前のテキストに対するbreakPositionsの結果
+     * @param editPosition 編集した位置
+     * @param removedLength 削除した文字数
+     * @param insertedLength 挿入した文字数
+     * @return 編集後のテキストに対するbreakPositionsと同じ分割位置のリスト
+     *
+     * 改行文字の後では必ず分かれ、最適化は改行文字で区切った段落ごとに独立しているため、
+     * 編集した範囲を含む段落だけを分割し直し、前後の段落は以前の分割位置（後ろはずらしたもの）を使う。
+     */
+    std::vector<size_t> breakPositions(const std::u32string& text, const AdvanceWidthIndex& widths, double maxWidth,
+                                       const std::vector<size_t>& previousBreaks, size_t editPosition,
+                                       size_t removedLength, size_t insertedLength);
+
 private:
     /**
      * @brief 分割可能な位置を検出する
@@ -62,16 +94,48 @@ private:
      */
     std::vector<BreakPoint> findBreakPoints(const std::u32string& text);
 
+    /**
+     * @brief 1つの位置で分割できるかを判定する
+     * @param text テキスト（UTF-32）
+     * @param position 判定する位置（1以上text.length()以下）
+     * @param breakPoint 分割できる場合の分割点の格納先
+     * @return 分割できる場合はtrue
+     */
+    bool findBreakAt(const std::u32string& text, size_t position, BreakPoint& breakPoint) const;
+
+    /**
+     * @brief テキストの範囲を最適な位置で分割する
+     * @param text テキスト（UTF-32）
+     * @param widths textと同じ内容に保たれた送り幅の索引
+     * @param start 範囲の先頭（テキストの先頭か改行文字の直後）
+     * @param end 範囲の末尾（テキストの末尾か改行文字の直後）
+     * @param maxWidth 最大幅
+     * @return 範囲内の分割位置のリスト（startとendを除く）
+     */
+    std::vector<size_t> breakRange(const std::u32string& text, const AdvanceWidthIndex& widths,
+                                   size_t start, size_t end, double maxWidth) const;
+
     /**
      * @brief 最適な分割位置を計算する
      * @param text テキスト（UTF-32）
      * @param breakPoints 分割可能な位置のリスト
-     * @param style スタイル
+     * @param advances 文字送り幅テーブル
+     * @param maxWidth 最大幅
+     * @return 最適な分割位置のリスト
+     */
+    std::vector<size_t> calculateOptimalBreaks(const std::u32string& text, const std::vector<BreakPoint>& breakPoints, const GlyphAdvanceTable& advances, double maxWidth) const;
+
+    /**
+     * @brief 分割可能な位置までの累積幅から最適な分割位置を計算する
+     * @param breakPoints 分割可能な位置のリスト
+     * @param breakPrefix 各分割可能な位置までの送り幅の合計（LayoutUnit）
      * @param maxWidth 最大幅
-     * @param vertical 縦書きの場合はtrue
      * @return 最適な分割位置のリスト
+     *
+     * 強制分割点の後では必ず分割し、最大幅を超える行は直前の分割点からでも収まらない場合に限り
+     * 大きなペナルティを付けて許す。
      */
-    std::vector<size_t> calculateOptimalBreaks(const std::u32string& text, const std::vector<BreakPoint>& breakPoints, const style::Style& style, double maxWidth, bool vertical);
+    std::vector<size_t> calculateOptimalBreaks(const std::vector<BreakPoint>& breakPoints, const std::vector<int64_t>& breakPrefix, double maxWidth) const;
 
     /**
      * @brief 文字の幅を計算する
@@ -0,0 +1,138 @@
+/**
+ * @file page_composer.h
+ * @brief 組版済みの行をページに割り付けるページ構成器
+ */
+
+#ifndef JAPANESE_TYPESETTING_CORE_TYPESETTING_PAGE_COMPOSER_H
+#define JAPANESE_TYPESETTING_CORE_TYPESETTING_PAGE_COMPOSER_H
+
+#include "japanese_typesetting/core/typesetting/typesetting_engine.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace japanese_typesetting {
+namespace core {
+namespace typesetting {
+
+/**
+ * @struct PageFrame
+ * @brief ページの版面を表す構造体
+ *
+ * 行送り方向は縦書きでは右から左、横書きでは上から下となる。
+ */
+struct PageFrame {
+    double lineLength = 0.0;    ///< 行長（縦書きでは列の高さ、横書きでは行の幅）
+    double blockExtent = 0.0;   ///< 行送り方向の版面の大きさ（縦書きでは幅、横書きでは高さ）、0の場合は制限なし
+    size_t maxLines = 0;        ///< 1ページの最大行数、0の場合は制限なし
+    double blockSpacing = 0.0;  ///< テキストブロック間の余白（行送り方向）
+};
+
+/**
+ * @struct PlacedLine
+ * @brief ページ上に配置された行を表す構造体
+ */
+struct PlacedLine {
+    TextLine line;          ///< 行
+    double offset;          ///< 版面の先頭から行の先頭までの行送り方向の距離
+    size_t blockIndex;      ///< 行が属するテキストブロックの番号
+};
+
+/**
+ * @struct Page
+ * @brief 1ページ分の配置結果を表す構造体
+ */
+struct Page {
+    size_t index = 0;                 ///< ページ番号（0から）
+    std::vector<PlacedLine> lines;    ///< 配置された行
+    double extent = 0.0;              ///< 使用した行送り方向の大きさ
+};
+
+/**
+ * @class PageComposer
+ * @brief 組版済みの行を版面に詰め、ページが埋まるたびにコールバックで渡すクラス
+ *
+ * 保持するのは構成中の1ページ分の行のみで、文書全体の結果は保持しない。
+ */
+class PageComposer {
+public:
+    /**
+     * @brief ページが完成したときに呼ばれる関数の型
+     *
+     * falseを返した場合は以降のページ構成を中止する。
+     */
+    using PageCallback = std::function<bool(Page& page)>;
+
+    /**
+     * @brief コンストラクタ
+     * @param frame 版面
+     * @param callback ページが完成したときに呼ばれる関数
+     */
+    PageComposer(const PageFrame& frame, PageCallback callback);
+
+    /**
+     * @brief デストラクタ
+     */
+    ~PageComposer();
+
+    /**
+     * @brief テキストブロックの行をページに追加する
+     * @param block テキストブロック
+     * @return 構成を続ける場合はtrue、コールバックが中止を求めた場合はfalse
+     */
+    bool addBlock(const TextBlock& block);
+
+    /**
+     * @brief 構成中のページを完成させる（最後に1度呼び出す）
+     * @return 構成を続ける場合はtrue、コールバックが中止を求めた場合はfalse
+     */
+    bool finish();
+
+    /**
+     * @brief 完成したページの数を取得
+     * @return ページ数
+     */
+    size_t getPageCount() const;
+
+    /**
+     * @brief コールバックにより中止されたかどうか
+     * @return 中止された場合はtrue
+     */
+    bool isStopped() const;
+
+    /**
+     * @brief 版面を取得
+     * @return 版面
+     */
+    const PageFrame& getFrame() const;
+
+private:
+    /**
+     * @brief 1行をページに追加する
+     * @param line 行
+     * @return 構成を続ける場合はtrue
+     */
+    bool addLine(const TextLine& line);
+
+    /**
+     * @brief 構成中のページをコールバックに渡し、次のページを始める
+     * @return 構成を続ける場合はtrue
+     */
+    bool emitPage();
+
+    PageFrame m_frame;          ///< 版面
+    PageCallback m_callback;    ///< ページが完成したときに呼ばれる関数
+    Page m_page;                ///< 構成中のページ
+    size_t m_blockIndex;        ///< 次に追加するテキストブロックの番号
+    LayoutUnit m_pendingSpacing; ///< 次の行の前に入れるブロック間の余白
+    int64_t m_extent;           ///< 構成中のページで使用した大きさ（LayoutUnit）
+    size_t m_pageCount;         ///< 完成したページの数
+    bool m_stopped;             ///< 中止されたかどうか
+};
+
+} // namespace typesetting
+} // namespace core
+} // namespace japanese_typesetting
+
+#endif // JAPANESE_TYPESETTING_CORE_TYPESETTING_PAGE_COMPOSER_H
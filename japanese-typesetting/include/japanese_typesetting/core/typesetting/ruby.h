@@ -7,7 +7,16 @@
 #define JAPANESE_TYPESETTING_CORE_TYPESETTING_RUBY_H
 
 #include "japanese_typesetting/core/style/style.h"
+#include "japanese_typesetting/core/typesetting/glyph_advance_cache.h"
+#include "japanese_typesetting/core/typesetting/itemizer.h"
+#include "japanese_typesetting/core/typesetting/layout_unit.h"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory_resource>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace japanese_typesetting {
@@ -25,6 +34,269 @@ struct RubyText {
     size_t endPos;            ///< 元のテキスト内での終了位置
 };
 
+/**
+ * @brief ルビのフォントサイズの親文字に対する倍率（スタイルシートのrubyスタイルと同じ）
+ */
+constexpr double kRubyFontSizeScale = 0.5;
+
+/**
+ * @struct RubySpan
+ * @brief ルビ注釈（親文字とルビの範囲の組）
+ *
+ * 親文字の範囲はマークアップを除いたテキスト内の位置、ルビの範囲は
+ * すべてのルビを連結したルビ文字列内の位置を表す。
+ *
+ * rubyOffsetとrubyWidthは組版時に決まるルビの枠で、親文字の先頭の文字の位置を基準とする。
+ * ルビの文字は枠の中に置き、余る場合は両端をその間の半分とする比率（1:2:1）で空ける。
+ */
+struct RubySpan {
+    uint32_t baseStart = 0;    ///< 親文字の開始位置
+    uint32_t baseLength = 0;   ///< 親文字の文字数
+    uint32_t rubyStart = 0;    ///< ルビの開始位置
+    uint32_t rubyLength = 0;   ///< ルビの文字数
+    LayoutUnit rubyOffset = 0; ///< ルビの枠の開始位置の親文字の先頭からのずれ（負の値は前にはみ出す）
+    LayoutUnit rubyWidth = 0;  ///< ルビの枠の幅
+
+    /**
+     * @brief 親文字の終了位置（範囲の直後）を取得
+     * @return 終了位置
+     */
+    uint32_t baseEnd() const { return baseStart + baseLength; }
+
+    /**
+     * @brief ルビの終了位置（範囲の直後）を取得
+     * @return 終了位置
+     */
+    uint32_t rubyEnd() const { return rubyStart + rubyLength; }
+};
+
+/**
+ * @struct AnnotationSpan
+ * @brief 圏点・傍線の注記（マークアップを除いたテキスト内の範囲）
+ */
+struct AnnotationSpan {
+    uint32_t start = 0;                          ///< 開始位置
+    uint32_t length = 0;                         ///< 文字数
+    EmphasisMark emphasis = EmphasisMark::None;  ///< 圏点
+    Sideline sideline = Sideline::None;          ///< 傍線
+
+    /**
+     * @brief 終了位置（範囲の直後）を取得
+     * @return 終了位置
+     */
+    uint32_t end() const { return start + length; }
+};
+
+/**
+ * @struct RubySourceRange
+ * @brief ルビ注釈のマークアップの入力内での範囲
+ */
+struct RubySourceRange {
+    size_t start;   ///< 開始位置（「｜」または親文字の先頭）
+    size_t end;     ///< 終了位置（「》」の直後）
+};
+
+/**
+ * @brief ルビと圏点・傍線のマークアップを1回の走査で取り除き、注釈を別表に記録する
+ * @param text 入力テキスト（UTF-32）
+ * @param length 文字数
+ * @param clean マークアップを除いたテキストの格納先
+ * @param rubyText すべてのルビを連結したルビ文字列の格納先
+ * @param spans ルビ注釈の格納先（親文字の位置の昇順）
+ * @param sources 各注釈のマークアップの入力内での範囲の格納先（nullptrの場合は記録しない）
+ * @param annotations 圏点・傍線の注記の格納先（開始位置の昇順、nullptrの場合は記録しない）
+ * @return マークアップの記号を含む場合はtrue（falseの場合、格納先は変更しない）
+ *
+ * 「｜親文字《ルビ》」と「親文字《ルビ》」の形式を扱う。「｜」がない場合の親文字は
+ * 「《」の直前にある同じ字種（漢字・カタカナ・ひらがな・英数字）の並びとする。
+ * 閉じられない「《」や、注釈にならない「｜」はそのまま本文に残す。
+ * 圏点は「《《文字》》」、および青空文庫形式の「文字［＃「文字」に傍点］」（白ゴマ傍点・
+ * 丸傍点・白丸傍点・傍線・二重傍線も同様）で指定する。認識できない注記は本文に残す。
+ * 各文字は高々2度しか読まず、親文字とルビの文字列を複製しないため、時間は入力の長さに比例する。
+ * trueを返す場合、格納先は呼び出し前の内容を消去してから書き込む。
+ */
+bool scanRubyMarkup(const char32_t* text, size_t length, std::pmr::u32string& clean, std::pmr::u32string& rubyText,
+                    std::pmr::vector<RubySpan>& spans, std::pmr::vector<RubySourceRange>* sources = nullptr,
+                    std::pmr::vector<AnnotationSpan>* annotations = nullptr);
+
+/**
+ * @struct RubyLayout
+ * @brief 親文字とルビの組に対して前後の文字によらず決まる配置
+ */
+struct RubyLayout {
+    style::RubyAlignment alignment = style::RubyAlignment::Group; ///< 決定した配置（Monoは親文字1字ごとに配置する）
+    LayoutUnit baseWidth = 0;     ///< 親文字の幅
+    LayoutUnit rubyWidth = 0;     ///< ルビの幅
+    LayoutUnit maxOverhang = 0;   ///< 前後それぞれの文字にルビを掛けてよい量の上限（ルビ1字分）
+
+    /**
+     * @brief ルビが親文字からはみ出す量を取得
+     * @return はみ出す量（はみ出さない場合は0）
+     */
+    LayoutUnit getExcess() const { return rubyWidth > baseWidth ? rubyWidth - baseWidth : 0; }
+};
+
+/**
+ * @brief 親文字とルビの配置を計算する
+ * @param base 親文字（UTF-32）
+ * @param baseLength 親文字の文字数
+ * @param ruby ルビ（UTF-32）
+ * @param rubyLength ルビの文字数
+ * @param baseAdvances 親文字の文字送り幅テーブル
+ * @param rubyAdvances ルビの文字送り幅テーブル
+ * @param alignment スタイルで指定された配置方法
+ * @return 配置
+ *
+ * モノルビと熟語ルビは、ルビの文字数が親文字の文字数で割り切れる場合に親文字1字ごとに
+ * 配置する（熟語ルビはさらに各字のルビが親文字の幅に収まる場合に限る）。
+ * それ以外はグループルビとする。
+ */
+RubyLayout computeRubyLayout(const char32_t* base, size_t baseLength, const char32_t* ruby, size_t rubyLength,
+                             const GlyphAdvanceTable& baseAdvances, const GlyphAdvanceTable& rubyAdvances,
+                             style::RubyAlignment alignment);
+
+/**
+ * @struct RubyLayoutCacheStats
+ * @brief ルビの配置のキャッシュの統計情報
+ */
+struct RubyLayoutCacheStats {
+    size_t hits = 0;      ///< キャッシュヒット数
+    size_t misses = 0;    ///< キャッシュミス数
+    size_t entries = 0;   ///< 保持しているエントリ数
+};
+
+/**
+ * @class RubyLayoutCache
+ * @brief (親文字, ルビ, スタイル)ごとのルビの配置を保持するキャッシュ
+ *
+ * 小説では同じ語に同じルビが何百回も付くため、幅の合計と配置方法の決定を1度だけ行う。
+ * 前後の文字による掛かりやアキは組版時に決める。
+ * 保持するエントリ数には上限があり、最も長く参照されていないものから破棄する。
+ * 複数スレッドから同時に使用してよい。
+ */
+class RubyLayoutCache {
+public:
+    /**
+     * @brief プロセス全体で共有されるインスタンスを取得する
+     * @return キャッシュのインスタンス
+     */
+    static RubyLayoutCache& getInstance();
+
+    /**
+     * @brief コンストラクタ
+     * @param capacity 保持するエントリ数の上限
+     */
+    explicit RubyLayoutCache(size_t capacity = 4096);
+
+    /**
+     * @brief デストラクタ
+     */
+    ~RubyLayoutCache();
+
+    RubyLayoutCache(const RubyLayoutCache&) = delete;
+    RubyLayoutCache& operator=(const RubyLayoutCache&) = delete;
+
+    /**
+     * @brief 親文字とルビの配置を取得する（キャッシュになければ計算する）
+     * @param base 親文字（UTF-32）
+     * @param baseLength 親文字の文字数
+     * @param ruby ルビ（UTF-32）
+     * @param rubyLength ルビの文字数
+     * @param baseAdvances 親文字の文字送り幅テーブル
+     * @param rubyAdvances ルビの文字送り幅テーブル
+     * @param alignment スタイルで指定された配置方法
+     * @return 配置
+     */
+    RubyLayout getLayout(const char32_t* base, size_t baseLength, const char32_t* ruby, size_t rubyLength,
+                         const GlyphAdvanceTable& baseAdvances, const GlyphAdvanceTable& rubyAdvances,
+                         style::RubyAlignment alignment);
+
+    /**
+     * @brief 保持しているエントリをすべて破棄する
+     */
+    void clear();
+
+    /**
+     * @brief 統計情報を取得
+     * @return 統計情報
+     */
+    RubyLayoutCacheStats getStats() const;
+
+private:
+    /**
+     * @struct Key
+     * @brief キャッシュのキー
+     */
+    struct Key {
+        std::u32string text;          ///< 親文字とルビ（親文字の文字数で区切る）
+        uint32_t baseLength;          ///< 親文字の文字数
+        GlyphAdvanceKey baseFont;     ///< 親文字のフォント
+        double rubyFontSize;          ///< ルビのフォントサイズ
+        style::RubyAlignment alignment; ///< 配置方法
+
+        bool operator==(const Key& other) const;
+    };
+
+    /**
+     * @struct KeyHash
+     * @brief キーのハッシュ関数（FNV-1a）
+     */
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    using Entry = std::pair<Key, RubyLayout>;
+
+    size_t m_capacity;                                                        ///< エントリ数の上限
+    std::list<Entry> m_entries;                                               ///< 参照順のエントリ（先頭が最新）
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> m_index;     ///< キーからエントリへの索引
+    size_t m_hits;                                                            ///< キャッシュヒット数
+    size_t m_misses;                                                          ///< キャッシュミス数
+    mutable std::mutex m_mutex;                                               ///< ロック
+};
+
+/**
+ * @struct RubyAnnotations
+ * @brief 行組みでルビを扱うための入力
+ */
+struct RubyAnnotations {
+    const char32_t* text = nullptr;                 ///< すべてのルビを連結したルビ文字列
+    const GlyphAdvanceTable* advances = nullptr;    ///< ルビの文字送り幅テーブル
+    style::RubyAlignment alignment = style::RubyAlignment::Jukugo; ///< 配置方法
+};
+
+/**
+ * @struct RubyPlacement
+ * @brief 組版中のルビの前後の文字との関係
+ */
+struct RubyPlacement {
+    LayoutUnit leading = 0;          ///< 親文字の前に入れたアキ（直前の文字の後ろに加えてある）
+    LayoutUnit overhangBefore = 0;   ///< 直前の文字に掛けたルビの量
+    LayoutUnit overhangAfter = 0;    ///< 直後の文字に掛けたルビの量
+    LayoutUnit width = 0;            ///< ルビの枠の幅
+};
+
+/**
+ * @brief 段落のルビの配置を決め、親文字の前後と間に必要なアキを文字の幅に加える
+ * @param text 本文（UTF-32）
+ * @param length 文字数
+ * @param advances 本文の文字送り幅テーブル
+ * @param annotations ルビ文字列と配置方法
+ * @param spans ルビ注釈（親文字の位置の昇順、モノルビは親文字1字ごとの注釈に分ける）
+ * @param placements 注釈ごとの前後の文字との関係の格納先
+ * @param widths 文字の幅（アキを加える）
+ * @param spacing 文字の後ろに入れたアキの格納先（テキストと同じ長さで0に初期化しておく）
+ * @param noBreakBefore 分割できない親文字の2文字目以降に1を書き込む配列（テキストと同じ長さ）
+ *
+ * ルビが親文字より長い場合、前後の文字がかなであれば、はみ出す量の半分までを
+ * ルビ1字分を上限としてその文字に掛ける。残りは親文字の前後と間に1:2:1で空ける。
+ * 親文字の前のアキは直前の文字の後ろに入れる（改行の直後では親文字の後ろに入れる）。
+ */
+void placeRubies(const char32_t* text, size_t length, const GlyphAdvanceTable& advances,
+                 const RubyAnnotations& annotations, std::pmr::vector<RubySpan>& spans,
+                 std::pmr::vector<RubyPlacement>& placements, LayoutUnit* widths, LayoutUnit* spacing,
+                 uint8_t* noBreakBefore);
+
 /**
  * @class RubyProcessor
  * @brief ルビ処理を実装するクラス
@@ -45,43 +317,21 @@ public:
      * @brief テキスト内のルビ注釈を解析する
      * @param text 解析するテキスト（UTF-32）
      * @return 検出されたルビテキストのリスト
+     *
+     * scanRubyMarkupの結果をRubyTextに展開する。組版ではscanRubyMarkupを直接使う。
      */
     std::vector<RubyText> parseRuby(const std::u32string& text);
 
     /**
      * @brief ルビ付きテキストを描画するための情報を計算する
      * @param rubyText ルビテキスト
-     * @param baseStyle ベーステキストのスタイル
+     * @param baseStyle ベーステキストのスタイル（ルビの配置方法もこのスタイルに従う）
      * @param rubyStyle ルビテキストのスタイル
      * @param vertical 縦書きの場合はtrue
-     * @return ルビの配置情報（将来的に拡張）
-     */
-    void calculateRubyLayout(RubyText& rubyText, const style::Style& baseStyle, const style::Style& rubyStyle, bool vertical);
-
-private:
-    /**
-     * @brief ルビ注釈の開始タグを検出する
-     * @param text テキスト
-     * @param startPos 検索開始位置
-     * @return タグの位置、見つからない場合は-1
-     */
-    size_t findRubyStartTag(const std::u32string& text, size_t startPos);
-
-    /**
-     * @brief ルビ注釈の終了タグを検出する
-     * @param text テキスト
-     * @param startPos 検索開始位置
-     * @return タグの位置、見つからない場合は-1
-     */
-    size_t findRubyEndTag(const std::u32string& text, size_t startPos);
-
-    /**
-     * @brief ルビテキストの開始タグを検出する
-     * @param text テキスト
-     * @param startPos 検索開始位置
-     * @return タグの位置、見つからない場合は-1
+     * @return 前後の文字によらない配置（RubyLayoutCacheを介して求める）
      */
-    size_t findRubyTextTag(const std::u32string& text, size_t startPos);
+    RubyLayout calculateRubyLayout(const RubyText& rubyText, const style::Style& baseStyle,
+                                   const style::Style& rubyStyle, bool vertical);
 };
 
 } // namespace typesetting
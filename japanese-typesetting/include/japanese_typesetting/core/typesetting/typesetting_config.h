@@ -0,0 +1,47 @@
+/**
+ * @file typesetting_config.h
+ * @brief 組版エンジンの不変な設定
+ */
+
+#ifndef JAPANESE_TYPESETTING_CORE_TYPESETTING_CONFIG_H
+#define JAPANESE_TYPESETTING_CORE_TYPESETTING_CONFIG_H
+
+#include "japanese_typesetting/core/typesetting/typesetting_rules.h"
+#include "japanese_typesetting/core/unicode/unicode.h"
+#include <memory_resource>
+
+namespace japanese_typesetting {
+namespace core {
+namespace typesetting {
+
+class DiskLayoutCache;
+class LayoutCache;
+
+/**
+ * @struct TypesettingConfig
+ * @brief 組版エンジンが組版中に参照する設定をまとめた構造体
+ *
+ * エンジンは設定を共有ポインタで保持し、組版の呼び出しごとにその時点の設定を
+ * 取得して最後まで使い続ける。設定の変更は新しい設定への置き換えとして行うため、
+ * 組版中の呼び出しが設定の変更の影響を受けることはない。
+ * フォントと送り幅はプロセス全体で共有されるFontRegistryとGlyphAdvanceCacheから取得する。
+ */
+struct TypesettingConfig {
+    /**
+     * @brief コンストラクタ（JIS X 4051の既定ルールと共有の組版結果キャッシュを使う）
+     */
+    TypesettingConfig();
+
+    TypesettingRules rules;                       ///< 組版ルール
+    unicode::UnicodeHandler unicodeHandler;       ///< Unicodeハンドラ
+    std::pmr::memory_resource* memoryResource;    ///< 中間データ用アリーナの上流メモリリソース（nullptrの場合はデフォルト）
+    LayoutCache* layoutCache;                     ///< 組版結果のキャッシュ（nullptrの場合は使わない）
+    DiskLayoutCache* diskLayoutCache;             ///< ディスク上の組版結果キャッシュ（nullptrの場合は使わない）
+    bool glyphRuns;                               ///< 行ごとに位置付け済みのグリフ列を出力するかどうか
+};
+
+} // namespace typesetting
+} // namespace core
+} // namespace japanese_typesetting
+
+#endif // JAPANESE_TYPESETTING_CORE_TYPESETTING_CONFIG_H
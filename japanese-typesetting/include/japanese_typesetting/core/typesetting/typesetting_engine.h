@@ -8,19 +8,57 @@
 
 #include "japanese_typesetting/core/document/document.h"
 #include "japanese_typesetting/core/style/style.h"
+#include "japanese_typesetting/core/style/style_interner.h"
+#include "japanese_typesetting/core/style/stylesheet.h"
+#include "japanese_typesetting/core/typesetting/annotation.h"
+#include "japanese_typesetting/core/typesetting/cancellation.h"
+#include "japanese_typesetting/core/typesetting/glyph_advance_cache.h"
+#include "japanese_typesetting/core/typesetting/glyph_run.h"
+#include "japanese_typesetting/core/typesetting/layout_arena.h"
+#include "japanese_typesetting/core/typesetting/layout_kernels.h"
+#include "japanese_typesetting/core/typesetting/layout_unit.h"
+#include "japanese_typesetting/core/typesetting/ruby.h"
+#include "japanese_typesetting/core/typesetting/typesetting_config.h"
 #include "japanese_typesetting/core/typesetting/typesetting_rules.h"
 #include "japanese_typesetting/core/unicode/unicode.h"
+#include <functional>
 #include <string>
 #include <vector>
 #include <memory>
+#include <memory_resource>
+#include <mutex>
 
 namespace japanese_typesetting {
 namespace core {
 namespace typesetting {
 
+class DocumentBlockStream;
+struct Page;
+struct PageFrame;
+
 /**
  * @struct TextLine
  * @brief 組版された1行のテキストを表す構造体
+ *
+ * 幅と高さは内部でLayoutUnitとして計算した値をポイントに変換したもので、
+ * 計算の順序によらず同じ入力からは常に同じ値となる。
+ *
+ * 行の伸縮を行った場合やルビのアキがある場合、advanceDeltasはtextと同じ長さの配列となり、
+ * i番目の文字の後ろの空きの増減（負の値は詰め）を表す。
+ * 出力側はi番目の文字を「それより前の文字の送り幅と増減の合計」の位置に置けばよい。
+ *
+ * runsは行を文字種・向き・字幅・フォントが一様な区間に分けたもので、位置は行の先頭から数える。
+ *
+ * 入力のルビのマークアップ（「｜親文字《ルビ》」）は組版前に取り除かれ、textには親文字だけが残る。
+ * rubiesの親文字の範囲はtextの位置、ルビの範囲はrubyTextの位置を表す。
+ * モノルビは親文字1字ごとの注釈に分けてあり、ルビの枠（rubyOffset・rubyWidth）は組版時に決まる。
+ * 親文字の前後と間に入れたアキはadvanceDeltasに含まれる。
+ *
+ * 圏点・傍線はrunsの属性として持ち、annotationsにはその配置を組版時に求めたものが入る。
+ * ルビ・圏点・傍線が行間に収まらない場合、heightとbaselineはその分だけ大きくなっている。
+ *
+ * グリフ列の出力を有効にした場合、glyphRunsにはランごとに増減を反映した位置付け済みのグリフが入り、
+ * 出力側で再度シェーピングや計測を行う必要がなくなる。
  */
 struct TextLine {
     std::u32string text;      ///< 行のテキスト（UTF-32）
@@ -28,6 +66,14 @@ struct TextLine {
     double height;            ///< 行の高さ
     double baseline;          ///< ベースラインの位置
     bool hasLineBreak;        ///< 明示的な改行があるかどうか
+    std::vector<double> advanceDeltas; ///< 文字ごとの送り幅の増減（伸縮もルビのアキもない行では空）
+    std::vector<TextRun> runs;         ///< 行内のテキストラン
+    std::vector<RubySpan> rubies;      ///< 親文字が行内で始まるルビ注釈
+    std::u32string rubyText;           ///< 行のルビを連結した文字列
+    std::vector<AnnotationPlacement> annotations; ///< 圏点・傍線の配置
+    double annotationOver = 0.0;       ///< 上側（縦書きでは右側）に出るルビ・圏点の幅
+    double annotationUnder = 0.0;      ///< 下側（縦書きでは左側）に出る傍線の幅
+    std::vector<GlyphRun> glyphRuns;   ///< ランごとの位置付け済みのグリフ列（出力を有効にした場合のみ）
 };
 
 /**
@@ -38,11 +84,17 @@ struct TextBlock {
     std::vector<TextLine> lines;  ///< 行のリスト
     double width;                 ///< ブロックの幅
     double height;                ///< ブロックの高さ
+    TypesetStatus status = TypesetStatus::Completed; ///< 組版を最後まで行ったかどうか
 };
 
 /**
  * @class TypesettingEngine
  * @brief 日本語組版エンジンのクラス
+ *
+ * 組版中に参照する設定は不変なTypesettingConfigとして保持し、中間データは
+ * 呼び出しごとに作業領域のプールから借りる。そのため組版メソッドはconstで、
+ * 1つのエンジンを複数のスレッドから同時に使用できる。
+ * 設定の変更は設定全体の置き換えとなり、実行中の組版には影響しない。
  */
 class TypesettingEngine {
 public:
@@ -51,11 +103,29 @@ public:
      */
     TypesettingEngine();
 
+    /**
+     * @brief コンストラクタ
+     * @param config 設定
+     */
+    explicit TypesettingEngine(const TypesettingConfig& config);
+
     /**
      * @brief デストラクタ
      */
     ~TypesettingEngine();
 
+    /**
+     * @brief 設定を置き換える
+     * @param config 設定
+     */
+    void setConfig(const TypesettingConfig& config);
+
+    /**
+     * @brief 現在の設定を取得
+     * @return 設定（置き換えられた後も保持している間は有効）
+     */
+    std::shared_ptr<const TypesettingConfig> getConfig() const;
+
     /**
      * @brief 組版ルールを設定
      * @param rules 組版ルール
@@ -64,9 +134,9 @@ public:
 
     /**
      * @brief 組版ルールを取得
-     * @return 組版ルール
+     * @return 組版ルールの複製（別のスレッドで設定が置き換えられても有効）
      */
-    const TypesettingRules& getTypesettingRules() const;
+    TypesettingRules getTypesettingRules() const;
 
     /**
      * @brief Unicodeハンドラを設定
@@ -76,9 +146,70 @@ public:
 
     /**
      * @brief Unicodeハンドラを取得
-     * @return Unicodeハンドラ
+     * @return Unicodeハンドラの複製（別のスレッドで設定が置き換えられても有効）
+     */
+    unicode::UnicodeHandler getUnicodeHandler() const;
+
+    /**
+     * @brief 中間データ用アリーナの上流メモリリソースを設定
+     * @param resource メモリリソース（nullptrの場合はデフォルト）
+     *
+     * 組版中の中間データは作業領域のアリーナから確保され、
+     * 呼び出しごとにリセットされる。アリーナの保持バッファを超えた分のみ
+     * このメモリリソースから確保される。
+     */
+    void setMemoryResource(std::pmr::memory_resource* resource);
+
+    /**
+     * @brief 中間データ用アリーナの上流メモリリソースを取得
+     * @return メモリリソース
      */
-    const unicode::UnicodeHandler& getUnicodeHandler() const;
+    std::pmr::memory_resource* getMemoryResource() const;
+
+    /**
+     * @brief 組版結果のキャッシュを設定
+     * @param cache キャッシュ（nullptrの場合はキャッシュを使わない）
+     *
+     * 既定ではプロセス全体で共有されるLayoutCache::getInstance()を使う。
+     * キャッシュにヒットした場合は組版処理を行わず、typesetが返す確保統計は0となる。
+     */
+    void setLayoutCache(LayoutCache* cache);
+
+    /**
+     * @brief 組版結果のキャッシュを取得
+     * @return キャッシュ（使わない場合はnullptr）
+     */
+    LayoutCache* getLayoutCache() const;
+
+    /**
+     * @brief 位置付け済みのグリフ列の出力を有効/無効にする
+     * @param enabled 出力する場合はtrue
+     *
+     * 有効にすると各行のTextLine::glyphRunsが設定される。
+     * グリフ列はディスク上のキャッシュの形式に含まれないため、ディスク上のキャッシュは使わない。
+     */
+    void setGlyphRunOutput(bool enabled);
+
+    /**
+     * @brief 位置付け済みのグリフ列を出力するかどうか
+     * @return 出力する場合はtrue
+     */
+    bool isGlyphRunOutputEnabled() const;
+
+    /**
+     * @brief ディスク上の組版結果キャッシュを設定
+     * @param cache キャッシュ（nullptrの場合は使わない）
+     *
+     * メモリ上のキャッシュにない組版結果はディスクから読み込み、
+     * 新たに組版した結果はディスクにも保存する。
+     */
+    void setDiskLayoutCache(DiskLayoutCache* cache);
+
+    /**
+     * @brief ディスク上の組版結果キャッシュを取得
+     * @return キャッシュ（使わない場合はnullptr）
+     */
+    DiskLayoutCache* getDiskLayoutCache() const;
 
     /**
      * @brief テキストを組版する
@@ -86,84 +217,136 @@ public:
      * @param style スタイル
      * @param width 最大幅
      * @param vertical 縦書きの場合はtrue
+     * @param cancellation 中断要求を確認するトークン（nullptrの場合は中断しない）
+     * @param allocationStats この呼び出しで中間データに確保したメモリの統計の格納先（nullptrの場合は返さない）
+     * @return 組版されたテキストブロック
+     *
+     * 行を分割するたびにトークンを確認し、中断された場合は行を持たず
+     * statusに理由を設定したブロックを返す。中断された結果はキャッシュしない。
+     */
+    TextBlock typeset(const std::string& text, const style::Style& style, double width, bool vertical = true,
+                      const CancellationToken* cancellation = nullptr, AllocationStats* allocationStats = nullptr) const;
+
+    /**
+     * @brief 共有されたスタイルでテキストを組版する
+     * @param text 組版するテキスト（UTF-8）
+     * @param style 共有されたスタイル
+     * @param width 最大幅
+     * @param vertical 縦書きの場合はtrue
+     * @param cancellation 中断要求を確認するトークン（nullptrの場合は中断しない）
+     * @param allocationStats この呼び出しで中間データに確保したメモリの統計の格納先（nullptrの場合は返さない）
      * @return 組版されたテキストブロック
+     *
+     * キャッシュのキーにはスタイルの計算済みハッシュ値を用いる。
      */
-    TextBlock typeset(const std::string& text, const style::Style& style, double width, bool vertical = true);
+    TextBlock typeset(const std::string& text, const style::StyleHandle& style, double width, bool vertical = true,
+                      const CancellationToken* cancellation = nullptr, AllocationStats* allocationStats = nullptr) const;
 
     /**
      * @brief 文書を組版する
      * @param document 組版する文書
      * @param style スタイル
      * @param width 最大幅
+     * @param cancellation 中断要求を確認するトークン（nullptrの場合は中断しない）
+     * @param status 最後まで組版した場合はCompleted、中断された場合はその理由の格納先（nullptrの場合は返さない）
      * @return 組版されたテキストブロックのリスト
+     *
+     * 中断された場合はそれまでに組版し終えたブロックのみを返す。
      */
-    std::vector<TextBlock> typesetDocument(const document::Document& document, const style::Style& style, double width);
+    std::vector<TextBlock> typesetDocument(const document::Document& document, const style::Style& style, double width,
+                                           const CancellationToken* cancellation = nullptr,
+                                           TypesetStatus* status = nullptr) const;
 
-private:
     /**
-     * @brief 行分割を行う
-     * @param text 分割するテキスト（UTF-32）
-     * @param style スタイル
-     * @param maxWidth 最大幅
-     * @param vertical 縦書きの場合はtrue
-     * @return 分割された行のリスト
+     * @brief スタイルシートの本文・見出しスタイルで文書を組版する
+     * @param document 組版する文書
+     * @param styleSheet 解決済みスタイル表
+     * @param width 最大幅
+     * @param cancellation 中断要求を確認するトークン（nullptrの場合は中断しない）
+     * @param status 最後まで組版した場合はCompleted、中断された場合はその理由の格納先（nullptrの場合は返さない）
+     * @return 組版されたテキストブロックのリスト
      */
-    std::vector<TextLine> breakLines(const std::u32string& text, const style::Style& style, double maxWidth, bool vertical);
+    std::vector<TextBlock> typesetDocument(const document::Document& document, const style::CompiledStyleSheet& styleSheet,
+                                           double width, const CancellationToken* cancellation = nullptr,
+                                           TypesetStatus* status = nullptr) const;
 
     /**
-     * @brief 禁則処理を適用する
-     * @param lines 行のリスト
+     * @brief 文書を組版してページに割り付ける
+     * @param document 組版する文書
      * @param style スタイル
-     * @param vertical 縦書きの場合はtrue
+     * @param frame 版面（行長を組版の最大幅として用いる）
+     * @param callback ページが完成するたびに呼ばれる関数（falseを返すと中止）
+     * @param cancellation 中断要求を確認するトークン（nullptrの場合は中断しない）
+     * @param status 最後まで組版した場合はCompleted、中断された場合はその理由の格納先（nullptrの場合は返さない）
+     * @return 完成したページの数
+     *
+     * セクションごとに組版しながらページを構成するため、先頭のページは
+     * 文書全体の組版を待たずにコールバックに渡される。
+     * 中断された場合は組版途中のページをコールバックに渡さない。
      */
-    void applyProhibitionRules(std::vector<TextLine>& lines, const style::Style& style, bool vertical);
+    size_t composeDocument(const document::Document& document, const style::Style& style,
+                           const PageFrame& frame, const std::function<bool(Page& page)>& callback,
+                           const CancellationToken* cancellation = nullptr, TypesetStatus* status = nullptr) const;
+
+private:
+    struct Scratch;
 
     /**
-     * @brief 文字詰め処理を適用する
-     * @param lines 行のリスト
-     * @param style スタイル
-     * @param maxWidth 最大幅
-     * @param vertical 縦書きの場合はtrue
+     * @class ScratchLease
+     * @brief プールから借りた作業領域を返却まで保持するクラス
      */
-    void applyJustification(std::vector<TextLine>& lines, const style::Style& style, double maxWidth, bool vertical);
+    class ScratchLease {
+    public:
+        ScratchLease(const TypesettingEngine& engine, const TypesettingConfig& config);
+        ~ScratchLease();
+        ScratchLease(const ScratchLease&) = delete;
+        ScratchLease& operator=(const ScratchLease&) = delete;
+        Scratch* operator->() const { return m_scratch.get(); }
+
+    private:
+        const TypesettingEngine& m_engine;   ///< 返却先のエンジン
+        std::unique_ptr<Scratch> m_scratch;  ///< 借りている作業領域
+    };
 
     /**
-     * @brief ぶら下げ処理を適用する
-     * @param lines 行のリスト
+     * @brief テキストを組版する
+     * @param text 組版するテキスト（UTF-8）
      * @param style スタイル
+     * @param handle 共有されたスタイル（ある場合はハッシュ値の計算を省く）
+     * @param width 最大幅
      * @param vertical 縦書きの場合はtrue
+     * @param cancellation 中断要求を確認するトークン
+     * @param allocationStats 確保統計の格納先（nullptrの場合は返さない）
+     * @return 組版されたテキストブロック
      */
-    void applyHanging(std::vector<TextLine>& lines, const style::Style& style, bool vertical);
+    TextBlock typesetText(const std::string& text, const style::Style& style, const style::StyleHandle* handle,
+                          double width, bool vertical, const CancellationToken* cancellation,
+                          AllocationStats* allocationStats) const;
 
     /**
-     * @brief 文字の幅を計算する
-     * @param character 文字（UTF-32）
-     * @param style スタイル
-     * @param vertical 縦書きの場合はtrue
-     * @return 文字の幅
+     * @brief 文書のセクションを順に組版する
+     * @param stream 文書を組版するストリーム
+     * @param sink ブロックが組版されるたびに呼ばれる関数（falseを返すと中止）
+     * @return 最後まで組版した場合はCompleted、中断された場合はその理由
      */
-    double calculateCharacterWidth(char32_t character, const style::Style& style, bool vertical);
+    static TypesetStatus typesetSections(DocumentBlockStream& stream,
+                                         const std::function<bool(TextBlock&& block)>& sink);
 
     /**
-     * @brief 文字の高さを計算する
-     * @param character 文字（UTF-32）
-     * @param style スタイル
-     * @param vertical 縦書きの場合はtrue
-     * @return 文字の高さ
+     * @brief 現在の設定を取得する
+     * @return 設定
      */
-    double calculateCharacterHeight(char32_t character, const style::Style& style, bool vertical);
+    std::shared_ptr<const TypesettingConfig> loadConfig() const;
 
     /**
-     * @brief テキストの幅を計算する
-     * @param text テキスト（UTF-32）
-     * @param style スタイル
-     * @param vertical 縦書きの場合はtrue
-     * @return テキストの幅
+     * @brief 現在の設定の一部を変更して置き換える
+     * @param update 設定を変更する関数
      */
-    double calculateTextWidth(const std::u32string& text, const style::Style& style, bool vertical);
+    void updateConfig(const std::function<void(TypesettingConfig& config)>& update);
 
-    TypesettingRules m_rules;                 ///< 組版ルール
-    unicode::UnicodeHandler m_unicodeHandler; ///< Unicodeハンドラ
+    std::shared_ptr<const TypesettingConfig> m_config;   ///< 設定（アトミックに読み書きする）
+    mutable std::mutex m_mutex;                           ///< 以下のメンバ用のロック
+    mutable std::vector<std::unique_ptr<Scratch>> m_scratchPool; ///< 使われていない作業領域
 };
 
 } // namespace typesetting
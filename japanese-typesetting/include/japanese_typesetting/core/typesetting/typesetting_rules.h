@@ -6,6 +6,8 @@
 #ifndef JAPANESE_TYPESETTING_CORE_TYPESETTING_RULES_H
 #define JAPANESE_TYPESETTING_CORE_TYPESETTING_RULES_H
 
+#include <array>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <set>
@@ -125,7 +127,48 @@ public:
      */
     bool saveToFile(const std::string& filePath) const;
 
+    /**
+     * @brief ルールの内容から求めたハッシュ値を取得
+     * @return ハッシュ値（同じ内容のルールは同じ値になる）
+     *
+     * 組版結果のキャッシュでルールを識別するために用いる。
+     */
+    uint64_t getFingerprint() const;
+
+    /**
+     * @brief すべての文字のセットが等しいかどうか
+     * @param other 比較するルール
+     * @return 等しい場合はtrue
+     */
+    bool operator==(const TypesettingRules& other) const;
+
+    /**
+     * @brief いずれかの文字のセットが異なるかどうか
+     * @param other 比較するルール
+     * @return 異なる場合はtrue
+     */
+    bool operator!=(const TypesettingRules& other) const;
+
 private:
+    /**
+     * @brief いずれかのセットに含まれる可能性があるかどうか
+     * @param character 文字
+     * @return 含まれる可能性がある場合はtrue（falseの場合はどのセットにも含まれない）
+     *
+     * 行ごとに引く禁則の判定で、ほとんどのかな・漢字についてセットの探索を省く。
+     */
+    bool mayHaveRule(char32_t character) const {
+        uint32_t bit = static_cast<uint32_t>(character) & 1023;
+        return (m_ruleFilter[bit >> 6] >> (bit & 63)) & 1;
+    }
+
+    /**
+     * @brief セットに追加した文字をフィルタに加える
+     * @param character 文字
+     */
+    void addToRuleFilter(char32_t character);
+
+    std::array<uint64_t, 16> m_ruleFilter{};        ///< セットの文字の下位10ビットのビットマップ
     std::set<char32_t> m_lineStartProhibitedChars;  ///< 行頭禁則文字のセット
     std::set<char32_t> m_lineEndProhibitedChars;    ///< 行末禁則文字のセット
     std::set<char32_t> m_inseparableChars;          ///< 分離禁止文字のセット
@@ -7,6 +7,7 @@
 #define JAPANESE_TYPESETTING_CORE_TYPESETTING_VERTICAL_LAYOUT_H
 
 #include "japanese_typesetting/core/unicode/unicode.h"
+#include <cstddef>
 #include <string>
 
 namespace japanese_typesetting {
@@ -58,6 +59,39 @@ public:
      */
     std::u32string convertToHorizontal(const std::u32string& text) const;
 
+    /**
+     * @brief テキストをその場で縦書き用に変換する
+     * @param text 変換するテキスト（UTF-32）
+     * @param length 文字数
+     * @return 置き換えた文字数
+     *
+     * 変換表に含まれうる文字をベクトル命令でまとめて探し、見つかった文字だけを表で引く。
+     * かな・漢字だけのテキストでは走査のみで戻る。
+     */
+    size_t convertToVerticalInPlace(char32_t* text, size_t length) const;
+
+    /**
+     * @brief テキストをその場で横書き用に変換する
+     * @param text 変換するテキスト（UTF-32）
+     * @param length 文字数
+     * @return 置き換えた文字数
+     */
+    size_t convertToHorizontalInPlace(char32_t* text, size_t length) const;
+
+    /**
+     * @brief テキストをその場で縦書き用に変換する
+     * @param text 変換するテキスト（UTF-32、置き換えがない場合は変更しない）
+     * @return 置き換えた文字数
+     */
+    size_t convertToVerticalInPlace(std::u32string& text) const;
+
+    /**
+     * @brief テキストをその場で横書き用に変換する
+     * @param text 変換するテキスト（UTF-32、置き換えがない場合は変更しない）
+     * @return 置き換えた文字数
+     */
+    size_t convertToHorizontalInPlace(std::u32string& text) const;
+
     /**
      * @brief 文字の回転角度を取得する
      * @param character 文字（UTF-32）
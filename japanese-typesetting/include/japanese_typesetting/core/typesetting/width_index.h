@@ -0,0 +1,180 @@
+/**
+ * @file width_index.h
+ * @brief 編集に追従する段落の送り幅の索引
+ */
+
+#ifndef JAPANESE_TYPESETTING_CORE_TYPESETTING_WIDTH_INDEX_H
+#define JAPANESE_TYPESETTING_CORE_TYPESETTING_WIDTH_INDEX_H
+
+#include "japanese_typesetting/core/typesetting/glyph_advance_cache.h"
+#include "japanese_typesetting/core/typesetting/layout_unit.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace japanese_typesetting {
+namespace core {
+namespace typesetting {
+
+/**
+ * @class AdvanceWidthIndex
+ * @brief 1段落の文字の送り幅を、挿入・削除をまたいで区間の幅を引ける形で保持するクラス
+ *
+ * 送り幅の累積和の配列は1文字の挿入でも以降がすべてずれるため、編集のたびに作り直しになる。
+ * この索引は文字を並び順のキーとする平衡木（ツリープ）の各節点に部分木の文字数と送り幅の合計を持たせ、
+ * 挿入・削除・累積和・幅からの位置の検索をいずれも期待O(log n)（挿入・削除は文字数に比例する分を加える）で行う。
+ * 節点は配列に確保し、削除した節点は再利用する。
+ */
+class AdvanceWidthIndex {
+public:
+    /**
+     * @brief コンストラクタ
+     */
+    AdvanceWidthIndex();
+
+    /**
+     * @brief デストラクタ
+     */
+    ~AdvanceWidthIndex();
+
+    /**
+     * @brief 段落全体の送り幅で索引を作り直す（O(n)）
+     * @param advances 送り幅テーブル
+     * @param text 段落のテキスト（UTF-32）
+     * @param length 文字数
+     */
+    void assign(const GlyphAdvanceTable& advances, const char32_t* text, size_t length);
+
+    /**
+     * @brief 文字を挿入する
+     * @param position 挿入位置（0以上size()以下）
+     * @param advances 送り幅テーブル
+     * @param text 挿入するテキスト（UTF-32）
+     * @param length 挿入する文字数
+     */
+    void insert(size_t position, const GlyphAdvanceTable& advances, const char32_t* text, size_t length);
+
+    /**
+     * @brief 文字を削除する
+     * @param position 削除する範囲の開始位置
+     * @param length 削除する文字数（末尾を越える分は無視する）
+     */
+    void erase(size_t position, size_t length);
+
+    /**
+     * @brief すべての文字を削除する
+     */
+    void clear();
+
+    /**
+     * @brief 文字数を取得
+     * @return 文字数
+     */
+    size_t size() const;
+
+    /**
+     * @brief 1文字の送り幅を取得
+     * @param position 位置（size()未満）
+     * @return 送り幅（LayoutUnit）
+     */
+    LayoutUnit advanceAt(size_t position) const;
+
+    /**
+     * @brief 先頭からposition文字の送り幅の合計を取得
+     * @param position 文字数（size()を越える場合はsize()とする）
+     * @return 送り幅の合計（LayoutUnit）
+     */
+    int64_t prefix(size_t position) const;
+
+    /**
+     * @brief 区間[start, end)の送り幅の合計を取得
+     * @param start 開始位置
+     * @param end 終了位置
+     * @return 送り幅の合計（LayoutUnit）
+     */
+    int64_t width(size_t start, size_t end) const;
+
+    /**
+     * @brief 送り幅の合計がwidthを越えない最大の文字数を求める
+     * @param width 幅（LayoutUnit）
+     * @return prefix(n) <= widthとなる最大のn（送り幅は負でないものとする）
+     *
+     * 行頭からの累積幅で行末の候補を探すときに使う。
+     */
+    size_t findPosition(int64_t width) const;
+
+private:
+    /**
+     * @struct Node
+     * @brief 1文字を表す節点
+     */
+    struct Node {
+        uint32_t left;       ///< 左の子（kNullは子なし）
+        uint32_t right;      ///< 右の子（kNullは子なし）
+        uint32_t priority;   ///< ヒープ順の優先度（親は子以上）
+        uint32_t count;      ///< 部分木の文字数
+        LayoutUnit advance;  ///< この文字の送り幅
+        int64_t sum;         ///< 部分木の送り幅の合計
+    };
+
+    static constexpr uint32_t kNull = 0xFFFFFFFFu; ///< 子がないことを表す添字
+
+    /**
+     * @brief 節点を1つ確保する
+     * @param advance 送り幅
+     * @return 節点の添字
+     */
+    uint32_t allocate(LayoutUnit advance);
+
+    /**
+     * @brief 送り幅の並びから部分木を作る（O(n)）
+     * @param widths 送り幅の配列
+     * @param length 要素数
+     * @return 部分木の根（length == 0の場合はkNull）
+     */
+    uint32_t build(const LayoutUnit* widths, size_t length);
+
+    /**
+     * @brief 子の集計から節点の文字数と合計を求め直す
+     * @param node 節点
+     */
+    void update(uint32_t node);
+
+    /**
+     * @brief 部分木を先頭のposition文字とそれ以降に分ける
+     * @param node 部分木の根
+     * @param position 分ける位置
+     * @param left 先頭側の根の格納先
+     * @param right 末尾側の根の格納先
+     */
+    void split(uint32_t node, size_t position, uint32_t& left, uint32_t& right);
+
+    /**
+     * @brief 2つの部分木をこの順に連結する
+     * @param left 先頭側の根
+     * @param right 末尾側の根
+     * @return 連結した部分木の根
+     */
+    uint32_t merge(uint32_t left, uint32_t right);
+
+    /**
+     * @brief 部分木の節点をすべて再利用できるようにする
+     * @param node 部分木の根
+     */
+    void release(uint32_t node);
+
+    uint32_t count(uint32_t node) const { return node == kNull ? 0 : m_nodes[node].count; }   ///< 部分木の文字数
+    int64_t sum(uint32_t node) const { return node == kNull ? 0 : m_nodes[node].sum; }        ///< 部分木の送り幅の合計
+
+    std::vector<Node> m_nodes;       ///< 節点の配列
+    std::vector<uint32_t> m_free;    ///< 再利用できる節点の添字
+    std::vector<uint32_t> m_stack;   ///< 作業用のスタック（構築・解放で使う）
+    uint32_t m_root;                 ///< 根の添字
+    uint32_t m_seed;                 ///< 優先度の乱数の状態
+};
+
+} // namespace typesetting
+} // namespace core
+} // namespace japanese_typesetting
+
+#endif // JAPANESE_TYPESETTING_CORE_TYPESETTING_WIDTH_INDEX_H
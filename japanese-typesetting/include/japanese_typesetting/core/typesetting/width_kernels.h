@@ -0,0 +1,84 @@
+/**
+ * @file width_kernels.h
+ * @brief 送り幅の合計・累積和を求めるベクトル化されたカーネル
+ */
+
+#ifndef JAPANESE_TYPESETTING_CORE_TYPESETTING_WIDTH_KERNELS_H
+#define JAPANESE_TYPESETTING_CORE_TYPESETTING_WIDTH_KERNELS_H
+
+#include "japanese_typesetting/core/typesetting/glyph_advance_cache.h"
+#include "japanese_typesetting/core/typesetting/layout_unit.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace japanese_typesetting {
+namespace core {
+namespace typesetting {
+
+/**
+ * @enum SimdLevel
+ * @brief 送り幅カーネルが使う命令セット
+ */
+enum class SimdLevel {
+    Scalar,   ///< ベクトル命令を使わない
+    SSE2,     ///< SSE2（添字の計算と加算のみベクトル化）
+    AVX2      ///< AVX2（送り幅テーブルからの収集もベクトル化）
+};
+
+/**
+ * @brief 実行中のCPUで使える最上位の命令セットを取得
+ * @return 命令セット
+ *
+ * x86のGCC・Clangでは__builtin_cpu_supports、MSVCでは__cpuidで判定する。
+ * それ以外のコンパイラ・アーキテクチャでは常にScalarとなる。
+ */
+SimdLevel getSupportedSimdLevel();
+
+/**
+ * @brief カーネルが使う命令セットを取得
+ * @return 命令セット
+ */
+SimdLevel getSimdLevel();
+
+/**
+ * @brief カーネルが使う命令セットを設定する（比較・試験用）
+ * @param level 命令セット（CPUが対応していない場合は対応する最上位のものに下げる）
+ */
+void setSimdLevel(SimdLevel level);
+
+/**
+ * @brief 文字の送り幅を配列に展開する
+ * @param advances 送り幅テーブル
+ * @param text テキスト（UTF-32）
+ * @param length 文字数
+ * @param widths 送り幅の格納先（length要素）
+ *
+ * テーブルが事前計算済みの場合、密な範囲の文字はテーブルの添字に分類して
+ * ベクトル命令でまとめて読み出す。それ以外の文字は1文字ずつ引く。
+ * 結果は命令セットによらず1文字ずつ引いた場合と一致する。
+ */
+void gatherAdvances(const GlyphAdvanceTable& advances, const char32_t* text, size_t length, LayoutUnit* widths);
+
+/**
+ * @brief 文字の送り幅の合計を求める
+ * @param advances 送り幅テーブル
+ * @param text テキスト（UTF-32）
+ * @param length 文字数
+ * @return 送り幅の合計（LayoutUnit）
+ */
+int64_t sumAdvances(const GlyphAdvanceTable& advances, const char32_t* text, size_t length);
+
+/**
+ * @brief 文字の送り幅の累積和を求める
+ * @param advances 送り幅テーブル
+ * @param text テキスト（UTF-32）
+ * @param length 文字数
+ * @param prefix 累積和の格納先（length + 1要素、prefix[0]は0）
+ */
+void prefixAdvances(const GlyphAdvanceTable& advances, const char32_t* text, size_t length, int64_t* prefix);
+
+} // namespace typesetting
+} // namespace core
+} // namespace japanese_typesetting
+
+#endif // JAPANESE_TYPESETTING_CORE_TYPESETTING_WIDTH_KERNELS_H
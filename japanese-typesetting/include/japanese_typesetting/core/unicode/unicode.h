@@ -6,6 +6,7 @@
 #ifndef JAPANESE_TYPESETTING_CORE_UNICODE_UNICODE_H
 #define JAPANESE_TYPESETTING_CORE_UNICODE_UNICODE_H
 
+#include <memory_resource>
 #include <string>
 #include <vector>
 
@@ -36,6 +37,16 @@ public:
      */
     std::u32string utf8ToUtf32(const std::string& utf8String) const;
 
+    /**
+     * @brief UTF-8文字列をUTF-32に変換し、指定したバッファに格納
+     * @param utf8String UTF-8文字列
+     * @param result 変換結果の格納先（内容は置き換えられる）
+     *
+     * 一時的なICU文字列を経由せずに変換するため、
+     * resultのアロケータ以外からのメモリ確保は発生しない。
+     */
+    void utf8ToUtf32(const std::string& utf8String, std::pmr::u32string& result) const;
+
     /**
      * @brief UTF-32文字列をUTF-8に変換
      * @param utf32String UTF-32文字列
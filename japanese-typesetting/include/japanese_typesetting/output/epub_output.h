@@ -142,12 +142,10 @@ private:
     /**
      * @brief 組版結果をHTMLに変換する
      * @param blocks 組版されたテキストブロックのリスト
-     * @param options 出力オプション
      * @return HTML内容
      */
     std::string blocksToHtml(
-        const std::vector<core::typesetting::TextBlock>& blocks,
-        const EpubOutputOptions& options);
+        const std::vector<core::typesetting::TextBlock>& blocks);
 
     core::typesetting::TypesettingEngine m_typesettingEngine; ///< 組版エンジン
 };
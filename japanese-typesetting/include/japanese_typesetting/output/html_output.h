@@ -118,12 +118,10 @@ private:
     /**
      * @brief 組版結果をHTMLに変換する
      * @param blocks 組版されたテキストブロックのリスト
-     * @param options 出力オプション
      * @return HTML内容
      */
     std::string blocksToHtml(
-        const std::vector<core::typesetting::TextBlock>& blocks,
-        const HtmlOutputOptions& options);
+        const std::vector<core::typesetting::TextBlock>& blocks);
 
     /**
      * @brief フォントをBase64エンコードする
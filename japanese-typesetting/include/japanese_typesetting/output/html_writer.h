@@ -0,0 +1,53 @@
+/**
+ * @file html_writer.h
+ * @brief HTMLを経由する出力エンジンで共有する組版結果の書き出し
+ */
+
+#ifndef JAPANESE_TYPESETTING_OUTPUT_HTML_WRITER_H
+#define JAPANESE_TYPESETTING_OUTPUT_HTML_WRITER_H
+
+#include "japanese_typesetting/core/typesetting/typesetting_engine.h"
+#include "japanese_typesetting/core/unicode/unicode.h"
+#include <ostream>
+#include <string>
+
+namespace japanese_typesetting {
+namespace output {
+
+/**
+ * @brief 1行のテキストをエスケープしてHTMLに書き出す
+ * @param html 書き出し先
+ * @param line 組版された行
+ * @param unicodeHandler 文字コード変換に使う処理
+ *
+ * 縦中横のランはtcyクラス、圏点はemphasisクラス、傍線はsidelineクラスのspan要素で囲み、
+ * ルビはruby要素で囲む。圏点・傍線の描画位置と行の伸縮による送り幅の増減は
+ * 組版結果（TextLine::annotations、TextLine::advanceDeltas）を使わず、
+ * writeAnnotationCssのスタイルに従ってブラウザに任せる。
+ */
+void writeLineHtml(std::ostream& html,
+                   const core::typesetting::TextLine& line,
+                   const core::unicode::UnicodeHandler& unicodeHandler);
+
+/**
+ * @brief 1つのテキストブロックをdiv要素として書き出す（各行はp要素とする）
+ * @param html 書き出し先
+ * @param block テキストブロック
+ * @param unicodeHandler 文字コード変換に使う処理
+ * @param indent 各要素の前に付ける字下げ
+ */
+void writeBlockHtml(std::ostream& html,
+                    const core::typesetting::TextBlock& block,
+                    const core::unicode::UnicodeHandler& unicodeHandler,
+                    const std::string& indent = "");
+
+/**
+ * @brief writeLineHtmlが使う縦中横・圏点・傍線のクラスのCSSを書き出す
+ * @param css 書き出し先
+ */
+void writeAnnotationCss(std::ostream& css);
+
+} // namespace output
+} // namespace japanese_typesetting
+
+#endif // JAPANESE_TYPESETTING_OUTPUT_HTML_WRITER_H
@@ -109,12 +109,10 @@ private:
     /**
      * @brief 組版結果をHTMLに変換する
      * @param blocks 組版されたテキストブロックのリスト
-     * @param options 出力オプション
      * @return HTML内容
      */
     std::string blocksToHtml(
-        const std::vector<core::typesetting::TextBlock>& blocks,
-        const PdfOutputOptions& options);
+        const std::vector<core::typesetting::TextBlock>& blocks);
 
     /**
      * @brief 一時ファイルを作成する
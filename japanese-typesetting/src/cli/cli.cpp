@@ -4,10 +4,14 @@
  */
 
 #include "japanese_typesetting/cli/cli.h"
+#include "japanese_typesetting/core/typesetting/block_stream.h"
+#include "japanese_typesetting/core/typesetting/disk_layout_cache.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <cmath>
+#include <cstdlib>
 #include <cstring>
 
 namespace japanese_typesetting {
@@ -84,37 +88,37 @@ CommandLineOptions CommandLineInterface::parseCommandLine(int argc, char* argv[]
             options.vertical = true;
         } else if (arg == "--page-width") {
             if (i + 1 < argc) {
-                options.pageWidth = std::stod(argv[++i]);
+                parseNumber(argv[++i], options.pageWidth);
             } else {
                 showError("ページ幅が指定されていません");
             }
         } else if (arg == "--page-height") {
             if (i + 1 < argc) {
-                options.pageHeight = std::stod(argv[++i]);
+                parseNumber(argv[++i], options.pageHeight);
             } else {
                 showError("ページ高さが指定されていません");
             }
         } else if (arg == "--margin-top") {
             if (i + 1 < argc) {
-                options.marginTop = std::stod(argv[++i]);
+                parseNumber(argv[++i], options.marginTop);
             } else {
                 showError("上マージンが指定されていません");
             }
         } else if (arg == "--margin-bottom") {
             if (i + 1 < argc) {
-                options.marginBottom = std::stod(argv[++i]);
+                parseNumber(argv[++i], options.marginBottom);
             } else {
                 showError("下マージンが指定されていません");
             }
         } else if (arg == "--margin-left") {
             if (i + 1 < argc) {
-                options.marginLeft = std::stod(argv[++i]);
+                parseNumber(argv[++i], options.marginLeft);
             } else {
                 showError("左マージンが指定されていません");
             }
         } else if (arg == "--margin-right") {
             if (i + 1 < argc) {
-                options.marginRight = std::stod(argv[++i]);
+                parseNumber(argv[++i], options.marginRight);
             } else {
                 showError("右マージンが指定されていません");
             }
@@ -126,16 +130,22 @@ CommandLineOptions CommandLineInterface::parseCommandLine(int argc, char* argv[]
             }
         } else if (arg == "--font-size") {
             if (i + 1 < argc) {
-                options.fontSize = std::stod(argv[++i]);
+                parseNumber(argv[++i], options.fontSize);
             } else {
                 showError("フォントサイズが指定されていません");
             }
         } else if (arg == "--line-height") {
             if (i + 1 < argc) {
-                options.lineHeight = std::stod(argv[++i]);
+                parseNumber(argv[++i], options.lineHeight);
             } else {
                 showError("行の高さが指定されていません");
             }
+        } else if (arg == "--layout-cache") {
+            if (i + 1 < argc) {
+                options.layoutCacheDir = argv[++i];
+            } else {
+                showError("組版キャッシュのディレクトリが指定されていません");
+            }
         } else if (arg.substr(0, 2) == "--") {
             // カスタムオプション
             std::string key = arg.substr(2);
@@ -180,6 +190,7 @@ void CommandLineInterface::showHelp() const {
     std::cout << "  --font-family FAMILY       フォントファミリーを指定（デフォルト: Mincho）" << std::endl;
     std::cout << "  --font-size SIZE           フォントサイズをptで指定（デフォルト: 10.5）" << std::endl;
     std::cout << "  --line-height HEIGHT       行の高さを倍率で指定（デフォルト: 1.5）" << std::endl;
+    std::cout << "  --layout-cache DIR         組版結果をDIRにキャッシュし、変更のない節の組版を省略" << std::endl;
     std::cout << std::endl;
     std::cout << "例:" << std::endl;
     std::cout << "  japanese-typesetting input.txt output.pdf" << std::endl;
@@ -251,17 +262,11 @@ int CommandLineInterface::run(CommandLineOptions options) {
             style.setLineHeight(options.lineHeight);
         }
         
-        // 文書の組版
-        if (options.verbose) {
-            showInfo("文書を組版しています...");
-        }
-        std::vector<core::typesetting::TextBlock> blocks = typesetDocument(document, style, options);
-        
-        // 結果の出力
+        // 文書の組版と結果の出力
         if (options.verbose) {
-            showInfo("結果を出力しています: " + options.outputFile);
+            showInfo("文書を組版して出力しています: " + options.outputFile);
         }
-        if (!outputResult(blocks, options)) {
+        if (!outputResult(document, style, options)) {
             showError("結果の出力に失敗しました");
             return 1;
         }
@@ -299,23 +304,11 @@ core::style::Style CommandLineInterface::loadStyle(const std::string& filePath)
     return style;
 }
 
-std::vector<core::typesetting::TextBlock> CommandLineInterface::typesetDocument(
+bool CommandLineInterface::outputResult(
     const core::document::Document& document,
     const core::style::Style& style,
     const CommandLineOptions& options) {
     
-    // 組版エンジンの作成
-    core::typesetting::TypesettingEngine engine;
-    
-    // 組版処理
-    double contentWidth = options.pageWidth - options.marginLeft - options.marginRight;
-    return engine.typesetDocument(document, style, contentWidth);
-}
-
-bool CommandLineInterface::outputResult(
-    const std::vector<core::typesetting::TextBlock>& blocks,
-    const CommandLineOptions& options) {
-    
     // 出力フォーマットに応じた処理
     // 実際の実装では、各出力エンジンを呼び出す
     
@@ -325,21 +318,54 @@ bool CommandLineInterface::outputResult(
         return false;
     }
     
+    // 組版エンジンの作成
+    core::typesetting::TypesettingEngine engine;
+    
+    // 出力し終えたブロックを再び使うことはないため、メモリ上のキャッシュは使わない
+    engine.setLayoutCache(nullptr);
+    
+    // 組版結果のディスクキャッシュ（変更のない節は前回の結果を再利用する）
+    std::unique_ptr<core::typesetting::DiskLayoutCache> diskCache;
+    if (!options.layoutCacheDir.empty()) {
+        diskCache = std::make_unique<core::typesetting::DiskLayoutCache>(options.layoutCacheDir);
+        engine.setDiskLayoutCache(diskCache.get());
+    }
+    
     outFile << "Japanese Typesetting Output" << std::endl;
     outFile << "===========================" << std::endl;
     outFile << std::endl;
     
-    for (const auto& block : blocks) {
+    // ブロックを1つずつ組版して書き出す
+    double contentWidth = options.pageWidth - options.marginLeft - options.marginRight;
+    core::typesetting::DocumentBlockStream stream(engine, document, style, contentWidth);
+    core::unicode::UnicodeHandler unicodeHandler;
+    for (const auto& block : stream) {
         for (const auto& line : block.lines) {
             // UTF-32からUTF-8に変換して出力
-            core::unicode::UnicodeHandler unicodeHandler;
-            std::string utf8Text = unicodeHandler.utf32ToUtf8(line.text);
-            outFile << utf8Text << std::endl;
+            outFile << unicodeHandler.utf32ToUtf8(line.text) << '\n';
         }
-        outFile << std::endl;
+        outFile << '\n';
+    }
+    
+    if (diskCache && options.verbose) {
+        core::typesetting::DiskLayoutCacheStats stats = diskCache->getStats();
+        showInfo("組版キャッシュ: " + std::to_string(stats.hits) + "件再利用, " +
+                 std::to_string(stats.writes) + "件保存");
     }
     
     outFile.close();
+    return static_cast<bool>(outFile);
+}
+
+bool CommandLineInterface::parseNumber(const std::string& text, double& value) const {
+    // 数値以外の文字を含むものや、非数・無限大（"nan"・"inf"）は受け付けない
+    char* end = nullptr;
+    double parsed = std::strtod(text.c_str(), &end);
+    if (text.empty() || end != text.c_str() + text.size() || !std::isfinite(parsed)) {
+        showError("無効な数値です: " + text);
+        return false;
+    }
+    value = parsed;
     return true;
 }
 
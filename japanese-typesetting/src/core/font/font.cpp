@@ -0,0 +1,447 @@
+/**
+ * @file font.cpp
+ * @brief フォントの読み込みとテキストのシェーピングの実装
+ */
+
+#include "japanese_typesetting/core/font/font.h"
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_ADVANCES_H
+#ifdef JAPANESE_TYPESETTING_HAVE_HARFBUZZ
+#include <hb.h>
+#endif
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+
+namespace japanese_typesetting {
+namespace core {
+namespace font {
+
+namespace {
+
+/**
+ * @struct FontIndexEntry
+ * @brief フォントディレクトリの走査結果の1項目
+ */
+struct FontIndexEntry {
+    std::string family;   ///< ファミリー名（小文字）
+    bool bold;            ///< 太字フラグ
+    bool italic;          ///< 斜体フラグ
+    FontLocation location; ///< フォントの位置
+};
+
+std::string toLower(const std::string& text) {
+    std::string result = text;
+    std::transform(result.begin(), result.end(), result.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+    return result;
+}
+
+std::vector<std::string> getFontDirectories() {
+    std::vector<std::string> directories;
+
+    // 環境変数で指定されたディレクトリを優先する
+    if (const char* env = std::getenv("JAPANESE_TYPESETTING_FONT_PATH")) {
+#ifdef _WIN32
+        const char separator = ';';
+#else
+        const char separator = ':';
+#endif
+        std::string paths = env;
+        size_t start = 0;
+        while (start <= paths.size()) {
+            size_t end = paths.find(separator, start);
+            if (end == std::string::npos) {
+                end = paths.size();
+            }
+            if (end > start) {
+                directories.push_back(paths.substr(start, end - start));
+            }
+            start = end + 1;
+        }
+    }
+
+#ifdef _WIN32
+    if (const char* windir = std::getenv("WINDIR")) {
+        directories.push_back(std::string(windir) + "\\Fonts");
+    }
+    if (const char* localAppData = std::getenv("LOCALAPPDATA")) {
+        directories.push_back(std::string(localAppData) + "\\Microsoft\\Windows\\Fonts");
+    }
+#elif defined(__APPLE__)
+    directories.push_back("/System/Library/Fonts");
+    directories.push_back("/Library/Fonts");
+    if (const char* home = std::getenv("HOME")) {
+        directories.push_back(std::string(home) + "/Library/Fonts");
+    }
+#else
+    directories.push_back("/usr/share/fonts");
+    directories.push_back("/usr/local/share/fonts");
+    if (const char* home = std::getenv("HOME")) {
+        directories.push_back(std::string(home) + "/.fonts");
+        directories.push_back(std::string(home) + "/.local/share/fonts");
+    }
+#endif
+
+    return directories;
+}
+
+bool isFontFile(const std::filesystem::path& path) {
+    std::string extension = toLower(path.extension().string());
+    return extension == ".ttf" || extension == ".otf" || extension == ".ttc" || extension == ".otc";
+}
+
+std::vector<FontIndexEntry> buildFontIndex() {
+    std::vector<FontIndexEntry> index;
+
+    FT_Library library = nullptr;
+    if (FT_Init_FreeType(&library) != 0) {
+        return index;
+    }
+
+    for (const auto& directory : getFontDirectories()) {
+        std::error_code ec;
+        if (!std::filesystem::is_directory(directory, ec)) {
+            continue;
+        }
+
+        auto options = std::filesystem::directory_options::skip_permission_denied;
+        for (auto it = std::filesystem::recursive_directory_iterator(directory, options, ec);
+             it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+            if (ec) {
+                break;
+            }
+            if (!it->is_regular_file(ec) || !isFontFile(it->path())) {
+                continue;
+            }
+
+            std::string path = it->path().string();
+            FT_Long faceCount = 1;
+            for (FT_Long faceIndex = 0; faceIndex < faceCount; ++faceIndex) {
+                FT_Face face = nullptr;
+                if (FT_New_Face(library, path.c_str(), faceIndex, &face) != 0) {
+                    break;
+                }
+                faceCount = face->num_faces;
+
+                if (face->family_name) {
+                    FontIndexEntry entry;
+                    entry.family = toLower(face->family_name);
+                    entry.bold = (face->style_flags & FT_STYLE_FLAG_BOLD) != 0;
+                    entry.italic = (face->style_flags & FT_STYLE_FLAG_ITALIC) != 0;
+                    entry.location.filePath = path;
+                    entry.location.faceIndex = static_cast<int>(faceIndex);
+                    index.push_back(entry);
+                }
+                FT_Done_Face(face);
+            }
+        }
+    }
+
+    FT_Done_FreeType(library);
+    return index;
+}
+
+const std::vector<FontIndexEntry>& getFontIndex() {
+    // フォントディレクトリの走査は初回のみ行う
+    static const std::vector<FontIndexEntry> index = buildFontIndex();
+    return index;
+}
+
+const FontIndexEntry* findInIndex(const std::string& family, bool bold, bool italic) {
+    const std::vector<FontIndexEntry>& index = getFontIndex();
+    std::string key = toLower(family);
+
+    const FontIndexEntry* fallback = nullptr;
+    for (const auto& entry : index) {
+        if (entry.family != key) {
+            continue;
+        }
+        if (entry.bold == bold && entry.italic == italic) {
+            return &entry;
+        }
+        // 書体が一致しない場合は標準の書体を優先する
+        if (!fallback || (!entry.bold && !entry.italic)) {
+            fallback = &entry;
+        }
+    }
+    return fallback;
+}
+
+std::atomic<uint32_t> nextFontId(1);
+
+} // namespace
+
+uint32_t defaultShapingFeatures(bool vertical) {
+    if (vertical) {
+        return FeatureVert | FeatureVrt2 | FeatureVkrn;
+    }
+    return FeatureKern;
+}
+
+FontFace::FontFace()
+    : m_id(nextFontId.fetch_add(1))
+    , m_library(nullptr)
+    , m_face(nullptr)
+    , m_hbBlob(nullptr)
+    , m_hbFace(nullptr)
+    , m_hbFont(nullptr)
+    , m_unitsPerEm(1000) {
+}
+
+FontFace::~FontFace() {
+#ifdef JAPANESE_TYPESETTING_HAVE_HARFBUZZ
+    if (m_hbFont) {
+        hb_font_destroy(m_hbFont);
+    }
+    if (m_hbFace) {
+        hb_face_destroy(m_hbFace);
+    }
+    if (m_hbBlob) {
+        hb_blob_destroy(m_hbBlob);
+    }
+#endif
+    if (m_face) {
+        FT_Done_Face(m_face);
+    }
+    if (m_library) {
+        FT_Done_FreeType(m_library);
+    }
+}
+
+std::shared_ptr<FontFace> FontFace::open(const std::string& filePath, int faceIndex) {
+    std::shared_ptr<MappedFile> file = MappedFile::open(filePath);
+    if (!file) {
+        return nullptr;
+    }
+    return open(std::shared_ptr<const MappedFile>(std::move(file)), faceIndex);
+}
+
+std::shared_ptr<FontFace> FontFace::open(std::shared_ptr<const MappedFile> file, int faceIndex) {
+    if (!file) {
+        return nullptr;
+    }
+
+    std::shared_ptr<FontFace> font(new FontFace());
+    font->m_filePath = file->getFilePath();
+    font->m_file = std::move(file);
+
+    if (FT_Init_FreeType(&font->m_library) != 0) {
+        return nullptr;
+    }
+    if (FT_New_Memory_Face(font->m_library, font->m_file->data(), static_cast<FT_Long>(font->m_file->size()),
+                           faceIndex, &font->m_face) != 0) {
+        return nullptr;
+    }
+
+    font->m_familyName = font->m_face->family_name ? font->m_face->family_name : "";
+    if (font->m_face->units_per_EM > 0) {
+        font->m_unitsPerEm = font->m_face->units_per_EM;
+    }
+
+#ifdef JAPANESE_TYPESETTING_HAVE_HARFBUZZ
+    // HarfBuzzもFreeTypeと同じメモリ上のフォントデータを参照する
+    font->m_hbBlob = hb_blob_create(reinterpret_cast<const char*>(font->m_file->data()),
+                                    static_cast<unsigned int>(font->m_file->size()),
+                                    HB_MEMORY_MODE_READONLY, nullptr, nullptr);
+    font->m_hbFace = hb_face_create(font->m_hbBlob, static_cast<unsigned int>(faceIndex));
+    font->m_hbFont = hb_font_create(font->m_hbFace);
+    // フォント単位で結果を受け取り、呼び出し側でポイントに換算する
+    hb_font_set_scale(font->m_hbFont, font->m_unitsPerEm, font->m_unitsPerEm);
+    hb_font_make_immutable(font->m_hbFont);
+#endif
+
+    return font;
+}
+
+FontLocation FontFace::findFontFile(const std::string& family, bool bold, bool italic) {
+    FontLocation location;
+
+    // パスが直接指定された場合
+    std::error_code ec;
+    if (std::filesystem::is_regular_file(family, ec)) {
+        location.filePath = family;
+        return location;
+    }
+
+    // 総称的なファミリー名は代表的な日本語フォントに読み替える
+    static const std::map<std::string, std::vector<std::string>> aliases = {
+        {"mincho", {"Noto Serif CJK JP", "Source Han Serif JP", "IPAexMincho", "IPAMincho",
+                    "Hiragino Mincho ProN", "Yu Mincho", "MS Mincho"}},
+        {"gothic", {"Noto Sans CJK JP", "Source Han Sans JP", "IPAexGothic", "IPAGothic",
+                    "Hiragino Sans", "Yu Gothic", "MS Gothic"}},
+    };
+
+    std::vector<std::string> candidates;
+    auto alias = aliases.find(toLower(family));
+    if (alias != aliases.end()) {
+        candidates = alias->second;
+    } else {
+        candidates.push_back(family);
+    }
+
+    for (const auto& candidate : candidates) {
+        const FontIndexEntry* entry = findInIndex(candidate, bold, italic);
+        if (entry) {
+            return entry->location;
+        }
+    }
+
+    return location;
+}
+
+uint32_t FontFace::getId() const {
+    return m_id;
+}
+
+const std::string& FontFace::getFilePath() const {
+    return m_filePath;
+}
+
+const std::shared_ptr<const MappedFile>& FontFace::getFile() const {
+    return m_file;
+}
+
+const std::string& FontFace::getFamilyName() const {
+    return m_familyName;
+}
+
+int FontFace::getUnitsPerEm() const {
+    return m_unitsPerEm;
+}
+
+bool FontFace::hasGlyph(char32_t character) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return FT_Get_Char_Index(m_face, character) != 0;
+}
+
+double FontFace::getAdvance(char32_t character, double fontSize, bool vertical) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    FT_UInt glyphIndex = FT_Get_Char_Index(m_face, character);
+    if (glyphIndex == 0) {
+        return -1.0;
+    }
+
+    FT_Int32 flags = FT_LOAD_NO_SCALE;
+    if (vertical) {
+        flags |= FT_LOAD_VERTICAL_LAYOUT;
+    }
+
+    FT_Fixed advance = 0;
+    if (FT_Get_Advance(m_face, glyphIndex, flags, &advance) != 0) {
+        return -1.0;
+    }
+
+    return static_cast<double>(advance) * fontSize / m_unitsPerEm;
+}
+
+ShapedRun FontFace::shape(const char32_t* text, size_t length, double fontSize, bool vertical, uint32_t features) const {
+    ShapedRun run;
+    double scale = fontSize / m_unitsPerEm;
+
+#ifdef JAPANESE_TYPESETTING_HAVE_HARFBUZZ
+    hb_buffer_t* buffer = hb_buffer_create();
+    hb_buffer_add_utf32(buffer, reinterpret_cast<const uint32_t*>(text),
+                        static_cast<int>(length), 0, static_cast<int>(length));
+    hb_buffer_set_direction(buffer, vertical ? HB_DIRECTION_TTB : HB_DIRECTION_LTR);
+    hb_buffer_set_language(buffer, hb_language_from_string("ja", -1));
+    hb_buffer_guess_segment_properties(buffer);
+
+    std::vector<hb_feature_t> hbFeatures;
+    auto addFeature = [&hbFeatures](const char* tag) {
+        hb_feature_t feature;
+        if (hb_feature_from_string(tag, -1, &feature)) {
+            hbFeatures.push_back(feature);
+        }
+    };
+    if (features & FeatureVert) {
+        addFeature("vert");
+    }
+    if (features & FeatureVrt2) {
+        addFeature("vrt2");
+    }
+    if (features & FeatureVkrn) {
+        addFeature("vkrn");
+    }
+    if (features & FeatureKern) {
+        addFeature("kern");
+    }
+
+    // 変更不可のHarfBuzzフォントはスレッド間で共有できる
+    hb_shape(m_hbFont, buffer, hbFeatures.data(), static_cast<unsigned int>(hbFeatures.size()));
+
+    unsigned int glyphCount = 0;
+    hb_glyph_info_t* infos = hb_buffer_get_glyph_infos(buffer, &glyphCount);
+    hb_glyph_position_t* positions = hb_buffer_get_glyph_positions(buffer, &glyphCount);
+
+    run.glyphIds.reserve(glyphCount);
+    run.clusters.reserve(glyphCount);
+    run.advances.reserve(glyphCount);
+    run.xOffsets.reserve(glyphCount);
+    run.yOffsets.reserve(glyphCount);
+    for (unsigned int i = 0; i < glyphCount; ++i) {
+        // 縦書きではy_advanceが上向き正（負値）で返るため、下向き正に揃える
+        double advance = vertical ? -positions[i].y_advance * scale : positions[i].x_advance * scale;
+        run.glyphIds.push_back(infos[i].codepoint);
+        run.clusters.push_back(infos[i].cluster);
+        run.advances.push_back(advance);
+        run.xOffsets.push_back(positions[i].x_offset * scale);
+        run.yOffsets.push_back(vertical ? -positions[i].y_offset * scale : positions[i].y_offset * scale);
+        run.totalAdvance += advance;
+        if (infos[i].codepoint == 0) {
+            run.missingGlyphs++;
+        }
+    }
+
+    hb_buffer_destroy(buffer);
+#else
+    // HarfBuzzがない場合は文字ごとにグリフと送り幅を求める（機能は適用されない）
+    (void)features;
+
+    FT_Int32 flags = FT_LOAD_NO_SCALE;
+    if (vertical) {
+        flags |= FT_LOAD_VERTICAL_LAYOUT;
+    }
+
+    run.glyphIds.reserve(length);
+    run.clusters.reserve(length);
+    run.advances.reserve(length);
+    run.xOffsets.assign(length, 0.0);
+    run.yOffsets.assign(length, 0.0);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (size_t i = 0; i < length; ++i) {
+        FT_UInt glyphIndex = FT_Get_Char_Index(m_face, text[i]);
+        FT_Fixed advance = 0;
+        if (glyphIndex == 0) {
+            run.missingGlyphs++;
+        }
+        FT_Get_Advance(m_face, glyphIndex, flags, &advance);
+
+        run.glyphIds.push_back(glyphIndex);
+        run.clusters.push_back(static_cast<uint32_t>(i));
+        run.advances.push_back(advance * scale);
+        run.totalAdvance += advance * scale;
+    }
+#endif
+
+    return run;
+}
+
+bool FontFace::isShapingAvailable() {
+#ifdef JAPANESE_TYPESETTING_HAVE_HARFBUZZ
+    return true;
+#else
+    return false;
+#endif
+}
+
+} // namespace font
+} // namespace core
+} // namespace japanese_typesetting
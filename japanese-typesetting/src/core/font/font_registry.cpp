@@ -0,0 +1,188 @@
+/**
+ * @file font_registry.cpp
+ * @brief プロセス全体で共有するフォントの登録簿の実装
+ */
+
+#include "japanese_typesetting/core/font/font_registry.h"
+#include <iterator>
+
+namespace japanese_typesetting {
+namespace core {
+namespace font {
+
+namespace {
+
+std::string faceKey(const std::string& filePath, int faceIndex) {
+    return filePath + "#" + std::to_string(faceIndex);
+}
+
+} // namespace
+
+FontRegistry& FontRegistry::getInstance() {
+    static FontRegistry instance;
+    return instance;
+}
+
+FontRegistry::FontRegistry(size_t memoryLimit)
+    : m_memoryLimit(memoryLimit)
+    , m_memoryUsage(0) {
+}
+
+FontRegistry::~FontRegistry() {
+    // 特に何もしない
+}
+
+std::shared_ptr<const FontFace> FontRegistry::getFace(const FontLocation& location) {
+    if (location.filePath.empty()) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::string key = faceKey(location.filePath, location.faceIndex);
+    auto it = m_faces.find(key);
+    if (it != m_faces.end()) {
+        // ファイルの参照順も更新する
+        getFileLocked(location.filePath);
+        return it->second;
+    }
+
+    std::shared_ptr<const MappedFile> file = getFileLocked(location.filePath);
+    if (!file) {
+        return nullptr;
+    }
+
+    // 外した後も使われているフェイスは、作り直さずに登録し直す
+    auto released = m_releasedFaces.find(key);
+    if (released != m_releasedFaces.end()) {
+        std::shared_ptr<const FontFace> face = released->second.lock();
+        m_releasedFaces.erase(released);
+        if (face && face->getFile() == file) {
+            m_faces.emplace(key, face);
+            return face;
+        }
+    }
+
+    // フェイスの作成はファイルを共有するだけなので、ロックを保持したままでも軽い
+    std::shared_ptr<const FontFace> face = FontFace::open(file, location.faceIndex);
+    if (face) {
+        m_faces.emplace(key, face);
+    }
+    return face;
+}
+
+std::shared_ptr<const MappedFile> FontRegistry::getFile(const std::string& filePath) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return getFileLocked(filePath);
+}
+
+void FontRegistry::setMemoryLimit(size_t memoryLimit) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_memoryLimit = memoryLimit;
+    evictLocked(std::string());
+}
+
+size_t FontRegistry::getMemoryLimit() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_memoryLimit;
+}
+
+FontRegistryStats FontRegistry::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    FontRegistryStats stats = m_stats;
+    stats.fileCount = m_files.size();
+    stats.faceCount = m_faces.size();
+    stats.memoryUsage = m_memoryUsage;
+    for (const auto& released : m_releasedFiles) {
+        if (std::shared_ptr<const MappedFile> file = released.second.lock()) {
+            stats.releasedMemoryUsage += file->size();
+        }
+    }
+    return stats;
+}
+
+void FontRegistry::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_faces.clear();
+    m_files.clear();
+    m_releasedFiles.clear();
+    m_releasedFaces.clear();
+    m_lru.clear();
+    m_memoryUsage = 0;
+}
+
+std::shared_ptr<const MappedFile> FontRegistry::getFileLocked(const std::string& filePath) {
+    auto it = m_files.find(filePath);
+    if (it != m_files.end()) {
+        m_lru.splice(m_lru.begin(), m_lru, it->second.lruPosition);
+        m_stats.hits++;
+        return it->second.file;
+    }
+
+    // 外した後も使われているファイルは、マップし直さずに登録し直す
+    std::shared_ptr<const MappedFile> file;
+    auto released = m_releasedFiles.find(filePath);
+    if (released != m_releasedFiles.end()) {
+        file = released->second.lock();
+        m_releasedFiles.erase(released);
+    }
+    if (file) {
+        m_stats.hits++;
+    } else {
+        file = MappedFile::open(filePath);
+        if (!file) {
+            return nullptr;
+        }
+        m_stats.misses++;
+    }
+
+    m_lru.push_front(filePath);
+    FileEntry entry;
+    entry.file = file;
+    entry.lruPosition = m_lru.begin();
+    m_files.emplace(filePath, entry);
+    m_memoryUsage += file->size();
+
+    evictLocked(filePath);
+    return file;
+}
+
+void FontRegistry::evictLocked(const std::string& keepPath) {
+    while (m_memoryUsage > m_memoryLimit && !m_lru.empty()) {
+        std::string path = m_lru.back();
+        if (path == keepPath) {
+            // 取得中のファイル1つだけで上限を超える場合は保持する
+            break;
+        }
+
+        // 取得済みの参照が残っている場合に登録し直せるよう、弱参照を残して外す
+        auto it = m_files.find(path);
+        m_memoryUsage -= it->second.file->size();
+        m_releasedFiles[path] = it->second.file;
+        m_files.erase(it);
+        m_lru.pop_back();
+        m_stats.evictions++;
+
+        // このファイルを参照するフェイスも外す
+        std::string prefix = path + "#";
+        for (auto face = m_faces.begin(); face != m_faces.end();) {
+            if (face->first.compare(0, prefix.size(), prefix) == 0) {
+                m_releasedFaces[face->first] = face->second;
+                face = m_faces.erase(face);
+            } else {
+                ++face;
+            }
+        }
+    }
+
+    // 破棄済みの弱参照を捨てる
+    for (auto file = m_releasedFiles.begin(); file != m_releasedFiles.end();) {
+        file = file->second.expired() ? m_releasedFiles.erase(file) : std::next(file);
+    }
+    for (auto face = m_releasedFaces.begin(); face != m_releasedFaces.end();) {
+        face = face->second.expired() ? m_releasedFaces.erase(face) : std::next(face);
+    }
+}
+
+} // namespace font
+} // namespace core
+} // namespace japanese_typesetting
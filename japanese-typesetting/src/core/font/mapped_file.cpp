@@ -0,0 +1,115 @@
+/**
+ * @file mapped_file.cpp
+ * @brief 読み取り専用でメモリマップしたファイルの実装
+ */
+
+#include "japanese_typesetting/core/font/mapped_file.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace japanese_typesetting {
+namespace core {
+namespace font {
+
+MappedFile::MappedFile()
+    : m_data(nullptr)
+    , m_size(0)
+#ifdef _WIN32
+    , m_fileHandle(nullptr)
+    , m_mappingHandle(nullptr)
+#endif
+{
+}
+
+MappedFile::~MappedFile() {
+#ifdef _WIN32
+    if (m_data) {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mappingHandle) {
+        CloseHandle(m_mappingHandle);
+    }
+    if (m_fileHandle && m_fileHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(m_fileHandle);
+    }
+#else
+    if (m_data) {
+        munmap(const_cast<unsigned char*>(m_data), m_size);
+    }
+#endif
+}
+
+std::shared_ptr<MappedFile> MappedFile::open(const std::string& filePath) {
+    std::shared_ptr<MappedFile> file(new MappedFile());
+    file->m_filePath = filePath;
+
+#ifdef _WIN32
+    file->m_fileHandle = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                     OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file->m_fileHandle == INVALID_HANDLE_VALUE) {
+        return nullptr;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file->m_fileHandle, &fileSize) || fileSize.QuadPart == 0) {
+        return nullptr;
+    }
+    file->m_size = static_cast<size_t>(fileSize.QuadPart);
+
+    file->m_mappingHandle = CreateFileMappingA(file->m_fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!file->m_mappingHandle) {
+        return nullptr;
+    }
+
+    file->m_data = static_cast<const unsigned char*>(MapViewOfFile(file->m_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if (!file->m_data) {
+        return nullptr;
+    }
+#else
+    int fd = ::open(filePath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size == 0) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    void* address = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    // マップ後はファイル記述子を閉じてもよい
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        return nullptr;
+    }
+
+    file->m_data = static_cast<const unsigned char*>(address);
+    file->m_size = static_cast<size_t>(info.st_size);
+#endif
+
+    return file;
+}
+
+const unsigned char* MappedFile::data() const {
+    return m_data;
+}
+
+size_t MappedFile::size() const {
+    return m_size;
+}
+
+const std::string& MappedFile::getFilePath() const {
+    return m_filePath;
+}
+
+} // namespace font
+} // namespace core
+} // namespace japanese_typesetting
@@ -0,0 +1,111 @@
+/**
+ * @file shaped_run_cache.cpp
+ * @brief シェーピング結果のキャッシュの実装
+ */
+
+#include "japanese_typesetting/core/font/shaped_run_cache.h"
+
+namespace japanese_typesetting {
+namespace core {
+namespace font {
+
+bool ShapedRunCache::Key::operator==(const Key& other) const {
+    return fontId == other.fontId &&
+           fontSize == other.fontSize &&
+           vertical == other.vertical &&
+           features == other.features &&
+           text == other.text;
+}
+
+size_t ShapedRunCache::KeyHash::operator()(const Key& key) const {
+    uint64_t hash = 14695981039346656037ULL;
+    auto mix = [&hash](const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+    };
+
+    mix(key.text.data(), key.text.size() * sizeof(char32_t));
+    mix(&key.fontId, sizeof(key.fontId));
+    mix(&key.fontSize, sizeof(key.fontSize));
+    uint32_t flags = key.features | (key.vertical ? 0x80000000u : 0u);
+    mix(&flags, sizeof(flags));
+    return static_cast<size_t>(hash);
+}
+
+ShapedRunCache& ShapedRunCache::getInstance() {
+    static ShapedRunCache instance;
+    return instance;
+}
+
+ShapedRunCache::ShapedRunCache(size_t capacity)
+    : m_capacity(capacity > 0 ? capacity : 1)
+    , m_hits(0)
+    , m_misses(0) {
+}
+
+ShapedRunCache::~ShapedRunCache() {
+    // 特に何もしない
+}
+
+std::shared_ptr<const ShapedRun> ShapedRunCache::shape(const FontFace& font, const char32_t* text, size_t length,
+                                                       double fontSize, bool vertical, uint32_t features) {
+    Key key;
+    key.text.assign(text, length);
+    key.fontId = font.getId();
+    key.fontSize = fontSize;
+    key.vertical = vertical;
+    key.features = features;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_index.find(key);
+        if (it != m_index.end()) {
+            m_entries.splice(m_entries.begin(), m_entries, it->second);
+            m_hits++;
+            return it->second->second;
+        }
+        m_misses++;
+    }
+
+    // シェーピングはロックの外で行う（同じキーを複数スレッドが計算しても結果は同じ）
+    std::shared_ptr<const ShapedRun> run =
+        std::make_shared<ShapedRun>(font.shape(text, length, fontSize, vertical, features));
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_index.find(key);
+    if (it != m_index.end()) {
+        return it->second->second;
+    }
+
+    m_entries.emplace_front(key, run);
+    m_index.emplace(std::move(key), m_entries.begin());
+
+    while (m_entries.size() > m_capacity) {
+        m_index.erase(m_entries.back().first);
+        m_entries.pop_back();
+    }
+
+    return run;
+}
+
+void ShapedRunCache::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_index.clear();
+    m_entries.clear();
+}
+
+ShapedRunCacheStats ShapedRunCache::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ShapedRunCacheStats stats;
+    stats.hits = m_hits;
+    stats.misses = m_misses;
+    stats.entries = m_entries.size();
+    return stats;
+}
+
+} // namespace font
+} // namespace core
+} // namespace japanese_typesetting
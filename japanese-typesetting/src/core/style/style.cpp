@@ -18,6 +18,8 @@ Style::Style()
     , m_lineHeight(1.5)
     , m_textAlignment(TextAlignment::Justify)
     , m_lineBreakMode(LineBreakMode::Normal)
+    , m_rubyAlignment(RubyAlignment::Jukugo)
+    , m_gridLayout(false)
     , m_characterSpacing(0.0)
     , m_wordSpacing(0.0)
     , m_paragraphSpacingBefore(0.0)
@@ -72,6 +74,22 @@ LineBreakMode Style::getLineBreakMode() const {
     return m_lineBreakMode;
 }
 
+void Style::setRubyAlignment(RubyAlignment alignment) {
+    m_rubyAlignment = alignment;
+}
+
+RubyAlignment Style::getRubyAlignment() const {
+    return m_rubyAlignment;
+}
+
+void Style::setGridLayout(bool gridLayout) {
+    m_gridLayout = gridLayout;
+}
+
+bool Style::isGridLayout() const {
+    return m_gridLayout;
+}
+
 void Style::setCharacterSpacing(double spacing) {
     m_characterSpacing = spacing;
 }
@@ -162,6 +180,8 @@ bool Style::loadFromFile(const std::string& filePath) {
     // LineHeight: 1.5
     // TextAlignment: Justify
     // LineBreakMode: Normal
+    // RubyAlignment: Jukugo
+    // GridLayout: false
     // CharacterSpacing: 0.0
     // WordSpacing: 0.0
     // ParagraphSpacingBefore: 0.0
@@ -184,49 +204,7 @@ bool Style::loadFromFile(const std::string& filePath) {
             value.erase(0, value.find_first_not_of(" \t"));
             value.erase(value.find_last_not_of(" \t") + 1);
 
-            if (key == "FontFamily") {
-                setFontFamily(value);
-            } else if (key == "FontSize") {
-                setFontSize(std::stod(value));
-            } else if (key == "LineHeight") {
-                setLineHeight(std::stod(value));
-            } else if (key == "TextAlignment") {
-                if (value == "Left") {
-                    setTextAlignment(TextAlignment::Left);
-                } else if (value == "Right") {
-                    setTextAlignment(TextAlignment::Right);
-                } else if (value == "Center") {
-                    setTextAlignment(TextAlignment::Center);
-                } else if (value == "Justify") {
-                    setTextAlignment(TextAlignment::Justify);
-                }
-            } else if (key == "LineBreakMode") {
-                if (value == "Normal") {
-                    setLineBreakMode(LineBreakMode::Normal);
-                } else if (value == "Strict") {
-                    setLineBreakMode(LineBreakMode::Strict);
-                } else if (value == "Loose") {
-                    setLineBreakMode(LineBreakMode::Loose);
-                }
-            } else if (key == "CharacterSpacing") {
-                setCharacterSpacing(std::stod(value));
-            } else if (key == "WordSpacing") {
-                setWordSpacing(std::stod(value));
-            } else if (key == "ParagraphSpacingBefore") {
-                setParagraphSpacingBefore(std::stod(value));
-            } else if (key == "ParagraphSpacingAfter") {
-                setParagraphSpacingAfter(std::stod(value));
-            } else if (key == "FirstLineIndent") {
-                setFirstLineIndent(std::stod(value));
-            } else if (key == "Bold") {
-                setBold(value == "true");
-            } else if (key == "Italic") {
-                setItalic(value == "true");
-            } else if (key == "Underline") {
-                setUnderline(value == "true");
-            } else if (key.substr(0, 9) == "Property-") {
-                setProperty(key.substr(9), value);
-            }
+            setValue(key, value);
         }
     }
 
@@ -234,6 +212,65 @@ bool Style::loadFromFile(const std::string& filePath) {
     return true;
 }
 
+bool Style::setValue(const std::string& key, const std::string& value) {
+    if (key == "FontFamily") {
+        setFontFamily(value);
+    } else if (key == "FontSize") {
+        setFontSize(std::stod(value));
+    } else if (key == "LineHeight") {
+        setLineHeight(std::stod(value));
+    } else if (key == "TextAlignment") {
+        if (value == "Left") {
+            setTextAlignment(TextAlignment::Left);
+        } else if (value == "Right") {
+            setTextAlignment(TextAlignment::Right);
+        } else if (value == "Center") {
+            setTextAlignment(TextAlignment::Center);
+        } else if (value == "Justify") {
+            setTextAlignment(TextAlignment::Justify);
+        }
+    } else if (key == "LineBreakMode") {
+        if (value == "Normal") {
+            setLineBreakMode(LineBreakMode::Normal);
+        } else if (value == "Strict") {
+            setLineBreakMode(LineBreakMode::Strict);
+        } else if (value == "Loose") {
+            setLineBreakMode(LineBreakMode::Loose);
+        }
+    } else if (key == "RubyAlignment") {
+        if (value == "Mono") {
+            setRubyAlignment(RubyAlignment::Mono);
+        } else if (value == "Group") {
+            setRubyAlignment(RubyAlignment::Group);
+        } else if (value == "Jukugo") {
+            setRubyAlignment(RubyAlignment::Jukugo);
+        }
+    } else if (key == "GridLayout") {
+        setGridLayout(value == "true");
+    } else if (key == "CharacterSpacing") {
+        setCharacterSpacing(std::stod(value));
+    } else if (key == "WordSpacing") {
+        setWordSpacing(std::stod(value));
+    } else if (key == "ParagraphSpacingBefore") {
+        setParagraphSpacingBefore(std::stod(value));
+    } else if (key == "ParagraphSpacingAfter") {
+        setParagraphSpacingAfter(std::stod(value));
+    } else if (key == "FirstLineIndent") {
+        setFirstLineIndent(std::stod(value));
+    } else if (key == "Bold") {
+        setBold(value == "true");
+    } else if (key == "Italic") {
+        setItalic(value == "true");
+    } else if (key == "Underline") {
+        setUnderline(value == "true");
+    } else if (key.substr(0, 9) == "Property-") {
+        setProperty(key.substr(9), value);
+    } else {
+        return false;
+    }
+    return true;
+}
+
 bool Style::saveToFile(const std::string& filePath) const {
     // 簡易的なファイル保存実装
     std::ofstream file(filePath);
@@ -275,6 +312,21 @@ bool Style::saveToFile(const std::string& filePath) const {
             break;
     }
     
+    // RubyAlignment
+    switch (m_rubyAlignment) {
+        case RubyAlignment::Mono:
+            file << "RubyAlignment: Mono\n";
+            break;
+        case RubyAlignment::Group:
+            file << "RubyAlignment: Group\n";
+            break;
+        case RubyAlignment::Jukugo:
+            file << "RubyAlignment: Jukugo\n";
+            break;
+    }
+    
+    file << "GridLayout: " << (m_gridLayout ? "true" : "false") << "\n";
+    
     file << "CharacterSpacing: " << m_characterSpacing << "\n";
     file << "WordSpacing: " << m_wordSpacing << "\n";
     file << "ParagraphSpacingBefore: " << m_paragraphSpacingBefore << "\n";
@@ -293,6 +345,29 @@ bool Style::saveToFile(const std::string& filePath) const {
     return true;
 }
 
+bool Style::operator==(const Style& other) const {
+    return m_fontFamily == other.m_fontFamily &&
+           m_fontSize == other.m_fontSize &&
+           m_lineHeight == other.m_lineHeight &&
+           m_textAlignment == other.m_textAlignment &&
+           m_lineBreakMode == other.m_lineBreakMode &&
+           m_rubyAlignment == other.m_rubyAlignment &&
+           m_gridLayout == other.m_gridLayout &&
+           m_characterSpacing == other.m_characterSpacing &&
+           m_wordSpacing == other.m_wordSpacing &&
+           m_paragraphSpacingBefore == other.m_paragraphSpacingBefore &&
+           m_paragraphSpacingAfter == other.m_paragraphSpacingAfter &&
+           m_firstLineIndent == other.m_firstLineIndent &&
+           m_bold == other.m_bold &&
+           m_italic == other.m_italic &&
+           m_underline == other.m_underline &&
+           m_properties == other.m_properties;
+}
+
+bool Style::operator!=(const Style& other) const {
+    return !(*this == other);
+}
+
 } // namespace style
 } // namespace core
 } // namespace japanese_typesetting
@@ -0,0 +1,194 @@
+/**
+ * @file style_interner.cpp
+ * @brief スタイルの共有と派生スタイルのキャッシュの実装
+ */
+
+#include "japanese_typesetting/core/style/style_interner.h"
+#include <atomic>
+
+namespace japanese_typesetting {
+namespace core {
+namespace style {
+
+namespace {
+
+const uint64_t kFnvOffsetBasis = 14695981039346656037ULL;
+const uint64_t kFnvPrime = 1099511628211ULL;
+
+void mixBytes(uint64_t& hash, const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= kFnvPrime;
+    }
+}
+
+template <typename T>
+void mixValue(uint64_t& hash, const T& value) {
+    mixBytes(hash, &value, sizeof(value));
+}
+
+// 派生のキャッシュは元のスタイルの番号で引くため、番号はインターナーをまたいで一意にする
+std::atomic<uint32_t> g_nextStyleId{0};
+
+// 未設定・false・trueを区別して混ぜる
+void mixOptional(uint64_t& hash, const std::optional<bool>& value) {
+    unsigned char encoded = value ? (*value ? 2 : 1) : 0;
+    mixValue(hash, encoded);
+}
+
+} // namespace
+
+// StyleDerivation の実装
+
+bool StyleDerivation::operator==(const StyleDerivation& other) const {
+    return bold == other.bold &&
+           italic == other.italic &&
+           fontSizeScale == other.fontSizeScale;
+}
+
+void StyleDerivation::apply(Style& style) const {
+    if (bold) {
+        style.setBold(*bold);
+    }
+    if (italic) {
+        style.setItalic(*italic);
+    }
+    if (fontSizeScale != 1.0) {
+        style.setFontSize(style.getFontSize() * fontSizeScale);
+    }
+}
+
+// StyleInterner::DerivationKey の実装
+
+bool StyleInterner::DerivationKey::operator==(const DerivationKey& other) const {
+    return baseId == other.baseId && derivation == other.derivation;
+}
+
+size_t StyleInterner::DerivationKeyHash::operator()(const DerivationKey& key) const {
+    uint64_t hash = kFnvOffsetBasis;
+    mixValue(hash, key.baseId);
+    mixOptional(hash, key.derivation.bold);
+    mixOptional(hash, key.derivation.italic);
+    mixValue(hash, key.derivation.fontSizeScale);
+    return static_cast<size_t>(hash);
+}
+
+// StyleInterner の実装
+
+StyleInterner& StyleInterner::getInstance() {
+    static StyleInterner instance;
+    return instance;
+}
+
+StyleInterner::StyleInterner(size_t maxStyles)
+    : m_maxStyles(maxStyles > 0 ? maxStyles : 1)
+    , m_count(0) {
+}
+
+StyleInterner::~StyleInterner() {
+    // 特に何もしない
+}
+
+StyleHandle StyleInterner::intern(const Style& style) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return internLocked(style);
+}
+
+StyleHandle StyleInterner::derive(const StyleHandle& base, const StyleDerivation& derivation) {
+    if (!base) {
+        return StyleHandle();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    DerivationKey key{base.getId(), derivation};
+    auto it = m_derived.find(key);
+    if (it != m_derived.end()) {
+        return it->second;
+    }
+
+    // 初回のみ元のスタイルを複製して変更する
+    Style derived = base.get();
+    derivation.apply(derived);
+    StyleHandle handle = internLocked(derived);
+    m_derived.emplace(key, handle);
+    return handle;
+}
+
+size_t StyleInterner::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_count;
+}
+
+void StyleInterner::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_styles.clear();
+    m_derived.clear();
+    m_count = 0;
+    // 番号は再利用しない（古いハンドルとの取り違えを防ぐ）
+}
+
+uint64_t StyleInterner::hashLayoutFields(const Style& style) {
+    // 行分割・行送り・文字幅に影響する項目のみを対象とする
+    uint64_t hash = kFnvOffsetBasis;
+    std::string fontFamily = style.getFontFamily();
+    mixValue(hash, fontFamily.size());
+    mixBytes(hash, fontFamily.data(), fontFamily.size());
+    mixValue(hash, style.getFontSize());
+    mixValue(hash, style.getLineHeight());
+    mixValue(hash, style.getTextAlignment());
+    mixValue(hash, style.getLineBreakMode());
+    mixValue(hash, style.getRubyAlignment());
+    mixValue(hash, style.isGridLayout());
+    mixValue(hash, style.getCharacterSpacing());
+    mixValue(hash, style.getWordSpacing());
+    mixValue(hash, style.getFirstLineIndent());
+    mixValue(hash, style.isBold());
+    mixValue(hash, style.isItalic());
+    return hash;
+}
+
+bool StyleInterner::equalLayoutFields(const Style& a, const Style& b) {
+    // hashLayoutFieldsと同じ項目を比較する
+    return a.getFontFamily() == b.getFontFamily() &&
+           a.getFontSize() == b.getFontSize() &&
+           a.getLineHeight() == b.getLineHeight() &&
+           a.getTextAlignment() == b.getTextAlignment() &&
+           a.getLineBreakMode() == b.getLineBreakMode() &&
+           a.getRubyAlignment() == b.getRubyAlignment() &&
+           a.isGridLayout() == b.isGridLayout() &&
+           a.getCharacterSpacing() == b.getCharacterSpacing() &&
+           a.getWordSpacing() == b.getWordSpacing() &&
+           a.getFirstLineIndent() == b.getFirstLineIndent() &&
+           a.isBold() == b.isBold() &&
+           a.isItalic() == b.isItalic();
+}
+
+StyleHandle StyleInterner::internLocked(const Style& style) {
+    uint64_t layoutHash = hashLayoutFields(style);
+    std::vector<std::shared_ptr<const InternedStyle>>& bucket = m_styles[layoutHash];
+    for (const auto& entry : bucket) {
+        if (entry->style == style) {
+            return StyleHandle(entry);
+        }
+    }
+
+    auto entry = std::make_shared<InternedStyle>();
+    entry->style = style;
+    entry->layoutHash = layoutHash;
+    entry->id = g_nextStyleId.fetch_add(1, std::memory_order_relaxed);
+
+    // 上限に達した場合はすべて破棄してから登録する（取得済みのハンドルは有効なまま）
+    if (m_count >= m_maxStyles) {
+        m_styles.clear();
+        m_derived.clear();
+        m_count = 0;
+    }
+    m_styles[layoutHash].push_back(entry);
+    m_count++;
+    return StyleHandle(std::move(entry));
+}
+
+} // namespace style
+} // namespace core
+} // namespace japanese_typesetting
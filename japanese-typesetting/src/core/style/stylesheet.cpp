@@ -0,0 +1,216 @@
+/**
+ * @file stylesheet.cpp
+ * @brief 名前付きスタイルの継承を解決するスタイルシートの実装
+ */
+
+#include "japanese_typesetting/core/style/stylesheet.h"
+#include <fstream>
+#include <functional>
+#include <iostream>
+
+namespace japanese_typesetting {
+namespace core {
+namespace style {
+
+namespace {
+
+// 先頭と末尾の空白を削除
+std::string trim(const std::string& text) {
+    size_t first = text.find_first_not_of(" \t\r");
+    if (first == std::string::npos) {
+        return "";
+    }
+    size_t last = text.find_last_not_of(" \t\r");
+    return text.substr(first, last - first + 1);
+}
+
+} // namespace
+
+// StyleSheet の実装
+
+StyleSheet::StyleSheet() {
+    // 常に存在するスタイルを番号順に定義しておく
+    define("body");
+    define("heading", "body");
+    setValue("heading", "Bold", "true");
+    setValue("heading", "FontSizeScale", "1.2");
+    define("ruby", "body", StyleKind::Character);
+    setValue("ruby", "FontSizeScale", "0.5");
+    define("emphasis", "body", StyleKind::Character);
+}
+
+StyleSheet::~StyleSheet() {
+    // 特に何もしない
+}
+
+void StyleSheet::define(const std::string& name, const std::string& parent, StyleKind kind) {
+    StyleDefinition& definition = getOrCreate(name);
+    definition.parent = parent;
+    definition.kind = kind;
+}
+
+void StyleSheet::setValue(const std::string& name, const std::string& key, const std::string& value) {
+    getOrCreate(name).values.emplace_back(key, value);
+}
+
+const StyleDefinition* StyleSheet::findDefinition(const std::string& name) const {
+    auto it = m_index.find(name);
+    return it != m_index.end() ? &m_definitions[it->second] : nullptr;
+}
+
+size_t StyleSheet::getDefinitionCount() const {
+    return m_definitions.size();
+}
+
+bool StyleSheet::loadFromFile(const std::string& filePath) {
+    std::ifstream file(filePath);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open stylesheet file: " << filePath << std::endl;
+        return false;
+    }
+
+    std::string current;
+    std::string line;
+    while (std::getline(file, line)) {
+        line = trim(line);
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        // [名前] または [名前 : 継承元] でスタイルを始める
+        if (line.front() == '[' && line.back() == ']') {
+            std::string header = line.substr(1, line.size() - 2);
+            std::string parent;
+            size_t colonPos = header.find(':');
+            if (colonPos != std::string::npos) {
+                parent = trim(header.substr(colonPos + 1));
+                header = header.substr(0, colonPos);
+            }
+            current = trim(header);
+            const StyleDefinition* existing = findDefinition(current);
+            define(current, parent, existing ? existing->kind : StyleKind::Paragraph);
+            continue;
+        }
+
+        size_t colonPos = line.find(':');
+        if (colonPos == std::string::npos || current.empty()) {
+            continue;
+        }
+        std::string key = trim(line.substr(0, colonPos));
+        std::string value = trim(line.substr(colonPos + 1));
+        if (key == "Kind") {
+            getOrCreate(current).kind = value == "Character" ? StyleKind::Character : StyleKind::Paragraph;
+        } else {
+            setValue(current, key, value);
+        }
+    }
+
+    return true;
+}
+
+std::shared_ptr<const CompiledStyleSheet> StyleSheet::compile(const Style& base, StyleInterner& interner) const {
+    if (m_definitions.size() >= kInvalidStyleId) {
+        std::cerr << "Too many styles in stylesheet: " << m_definitions.size() << std::endl;
+        return nullptr;
+    }
+
+    // 継承元から順に解決する（0: 未解決、1: 解決中、2: 解決済み）
+    std::vector<int> state(m_definitions.size(), 0);
+    std::vector<Style> resolved(m_definitions.size());
+    std::vector<StyleId> parents(m_definitions.size(), kInvalidStyleId);
+
+    std::function<bool(size_t)> resolve = [&](size_t index) -> bool {
+        if (state[index] == 2) {
+            return true;
+        }
+        const StyleDefinition& definition = m_definitions[index];
+        if (state[index] == 1) {
+            std::cerr << "Circular style inheritance: " << definition.name << std::endl;
+            return false;
+        }
+        state[index] = 1;
+
+        Style style = base;
+        if (!definition.parent.empty()) {
+            auto it = m_index.find(definition.parent);
+            if (it == m_index.end()) {
+                std::cerr << "Unknown parent style: " << definition.parent
+                          << " (in " << definition.name << ")" << std::endl;
+                return false;
+            }
+            if (!resolve(it->second)) {
+                return false;
+            }
+            style = resolved[it->second];
+            parents[index] = static_cast<StyleId>(it->second);
+        }
+
+        // 倍率は継承元のフォントサイズに対して適用する
+        double parentFontSize = style.getFontSize();
+        for (const auto& value : definition.values) {
+            if (value.first == "FontSizeScale") {
+                style.setFontSize(parentFontSize * std::stod(value.second));
+            } else if (!style.setValue(value.first, value.second)) {
+                std::cerr << "Unknown style key: " << value.first
+                          << " (in " << definition.name << ")" << std::endl;
+            }
+        }
+
+        resolved[index] = std::move(style);
+        state[index] = 2;
+        return true;
+    };
+
+    std::vector<CompiledStyleSheet::Entry> entries;
+    entries.reserve(m_definitions.size());
+    for (size_t i = 0; i < m_definitions.size(); ++i) {
+        if (!resolve(i)) {
+            return nullptr;
+        }
+    }
+    for (size_t i = 0; i < m_definitions.size(); ++i) {
+        CompiledStyleSheet::Entry entry;
+        entry.name = m_definitions[i].name;
+        entry.kind = m_definitions[i].kind;
+        entry.parent = parents[i];
+        entry.style = interner.intern(resolved[i]);
+        entries.push_back(std::move(entry));
+    }
+
+    return std::make_shared<const CompiledStyleSheet>(std::move(entries));
+}
+
+StyleDefinition& StyleSheet::getOrCreate(const std::string& name) {
+    auto it = m_index.find(name);
+    if (it != m_index.end()) {
+        return m_definitions[it->second];
+    }
+
+    StyleDefinition definition;
+    definition.name = name;
+    m_index.emplace(name, m_definitions.size());
+    m_definitions.push_back(std::move(definition));
+    return m_definitions.back();
+}
+
+// CompiledStyleSheet の実装
+
+CompiledStyleSheet::CompiledStyleSheet(std::vector<Entry> entries)
+    : m_entries(std::move(entries)) {
+    for (size_t i = 0; i < m_entries.size(); ++i) {
+        m_ids.emplace(m_entries[i].name, static_cast<StyleId>(i));
+    }
+}
+
+CompiledStyleSheet::~CompiledStyleSheet() {
+    // 特に何もしない
+}
+
+StyleId CompiledStyleSheet::findId(const std::string& name) const {
+    auto it = m_ids.find(name);
+    return it != m_ids.end() ? it->second : kInvalidStyleId;
+}
+
+} // namespace style
+} // namespace core
+} // namespace japanese_typesetting
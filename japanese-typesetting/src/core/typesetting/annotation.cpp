@@ -0,0 +1,166 @@
+/**
+ * @file annotation.cpp
+ * @brief 圏点・傍線の注記と、ルビを含む行ごとの注記の配置の実装
+ */
+
+#include "japanese_typesetting/core/typesetting/annotation.h"
+#include <algorithm>
+#include <unicode/uchar.h>
+
+namespace japanese_typesetting {
+namespace core {
+namespace typesetting {
+
+namespace {
+
+// 圏点を付けない文字（空白と約物）
+bool skipsEmphasis(char32_t character) {
+    return u_isUWhiteSpace(character) || u_ispunct(character);
+}
+
+bool hasSameAnnotations(const TextRun& a, const TextRun& b) {
+    return a.emphasis == b.emphasis && a.sideline == b.sideline;
+}
+
+} // namespace
+
+void annotateRuns(std::pmr::vector<TextRun>& runs, const std::pmr::vector<AnnotationSpan>& spans) {
+    if (spans.empty()) {
+        return;
+    }
+    std::pmr::memory_resource* resource = runs.get_allocator().resource();
+    
+    // 注記の境界を昇順に並べる
+    std::pmr::vector<uint32_t> cuts(resource);
+    cuts.reserve(spans.size() * 2);
+    for (const auto& span : spans) {
+        cuts.push_back(span.start);
+        cuts.push_back(span.end());
+    }
+    std::sort(cuts.begin(), cuts.end());
+    cuts.erase(std::unique(cuts.begin(), cuts.end()), cuts.end());
+    
+    // ランを境界で切り、区間ごとに有効な注記の属性を付ける
+    std::pmr::vector<TextRun> result(resource);
+    result.reserve(runs.size() + cuts.size());
+    std::pmr::vector<const AnnotationSpan*> active(resource);
+    size_t next = 0;
+    size_t cut = 0;
+    for (const auto& run : runs) {
+        uint32_t position = run.start;
+        bool first = true;
+        while (position < run.end()) {
+            while (cut < cuts.size() && cuts[cut] <= position) {
+                ++cut;
+            }
+            uint32_t pieceEnd = cut < cuts.size() ? std::min(cuts[cut], run.end()) : run.end();
+            
+            while (next < spans.size() && spans[next].start <= position) {
+                active.push_back(&spans[next++]);
+            }
+            active.erase(std::remove_if(active.begin(), active.end(),
+                                        [position](const AnnotationSpan* span) { return span->end() <= position; }),
+                         active.end());
+            
+            TextRun piece = run;
+            piece.start = position;
+            piece.length = pieceEnd - position;
+            for (const AnnotationSpan* span : active) {
+                if (span->emphasis != EmphasisMark::None) {
+                    piece.emphasis = span->emphasis;
+                }
+                if (span->sideline != Sideline::None) {
+                    piece.sideline = span->sideline;
+                }
+            }
+            
+            // 属性の変わらない境界では同じランのまま続ける
+            if (!first && hasSameAnnotations(result.back(), piece)) {
+                result.back().length += piece.length;
+            } else {
+                result.push_back(piece);
+            }
+            first = false;
+            position = pieceEnd;
+        }
+    }
+    runs.swap(result);
+}
+
+AnnotationExtents placeLineAnnotations(const std::u32string& text, const std::vector<double>& advanceDeltas,
+                                       const std::vector<TextRun>& runs, const std::vector<RubySpan>& rubies,
+                                       const GlyphAdvanceTable& advances, std::vector<AnnotationPlacement>& placements) {
+    AnnotationExtents extents;
+    const bool annotated = std::any_of(runs.begin(), runs.end(), [](const TextRun& run) {
+        return run.emphasis != EmphasisMark::None || run.sideline != Sideline::None;
+    });
+    const double fontSize = advances.getKey().fontSize;
+    const double rubySize = fontSize * kRubyFontSizeScale;
+    if (!rubies.empty()) {
+        extents.over = rubySize;
+    }
+    if (!annotated) {
+        return extents;
+    }
+    
+    const double markSize = fontSize * kEmphasisMarkScale;
+    const double em = fromLayoutUnit(toLayoutUnit(fontSize));
+    size_t rubyCursor = 0;
+    size_t lastSideline = placements.size();
+    double pen = 0.0;
+    for (const auto& run : runs) {
+        const bool combined = run.orientation == GlyphOrientation::TateChuYoko;
+        const double runStart = pen;
+        for (uint32_t i = run.start; i < run.end() && i < text.size(); ++i) {
+            // 縦中横は先頭の文字が1字分を占め、残りの文字は幅を持たない
+            double advance = combined ? (i == run.start ? em : 0.0) : advances.getAdvance(text[i]);
+            double charStart = pen;
+            pen += advance + (i < advanceDeltas.size() ? advanceDeltas[i] : 0.0);
+            
+            if (run.emphasis == EmphasisMark::None || (combined && i != run.start) || skipsEmphasis(text[i])) {
+                continue;
+            }
+            
+            // ルビのある文字はルビの外側に置く
+            while (rubyCursor < rubies.size() && rubies[rubyCursor].baseEnd() <= i) {
+                ++rubyCursor;
+            }
+            bool hasRuby = rubyCursor < rubies.size() && rubies[rubyCursor].baseStart <= i;
+            
+            AnnotationPlacement mark;
+            mark.start = i;
+            mark.length = combined ? run.length : 1;
+            mark.emphasis = run.emphasis;
+            mark.inlineStart = charStart;
+            mark.inlineEnd = charStart + advance;
+            mark.blockOffset = hasRuby ? rubySize : 0.0;
+            placements.push_back(mark);
+            extents.over = std::max(extents.over, mark.blockOffset + markSize);
+        }
+        
+        // 傍線は同じ種類が続く範囲を1本にまとめる（末尾の文字の後ろの増減は含めない）
+        if (run.sideline != Sideline::None && run.length > 0) {
+            double runEnd = pen - (run.end() - 1 < advanceDeltas.size() ? advanceDeltas[run.end() - 1] : 0.0);
+            AnnotationPlacement* last = lastSideline < placements.size() ? &placements[lastSideline] : nullptr;
+            if (last && last->sideline == run.sideline && last->start + last->length == run.start) {
+                last->length += run.length;
+                last->inlineEnd = runEnd;
+            } else {
+                lastSideline = placements.size();
+                AnnotationPlacement line;
+                line.start = run.start;
+                line.length = run.length;
+                line.sideline = run.sideline;
+                line.inlineStart = runStart;
+                line.inlineEnd = runEnd;
+                placements.push_back(line);
+            }
+            extents.under = fontSize * kSidelineScale;
+        }
+    }
+    return extents;
+}
+
+} // namespace typesetting
+} // namespace core
+} // namespace japanese_typesetting
@@ -0,0 +1,142 @@
+/**
+ * @file block_stream.cpp
+ * @brief 文書を1ブロックずつ組版するストリームの実装
+ */
+
+#include "japanese_typesetting/core/typesetting/block_stream.h"
+
+namespace japanese_typesetting {
+namespace core {
+namespace typesetting {
+
+// DocumentBlockStream::Iterator の実装
+
+DocumentBlockStream::Iterator::Iterator(DocumentBlockStream* stream)
+    : m_stream(stream) {
+    // 最初のブロックを読み込む
+    ++(*this);
+}
+
+DocumentBlockStream::Iterator& DocumentBlockStream::Iterator::operator++() {
+    if (m_stream && !m_stream->next(m_block)) {
+        m_stream = nullptr;
+        m_block = TextBlock();
+    }
+    return *this;
+}
+
+// DocumentBlockStream の実装
+
+DocumentBlockStream::DocumentBlockStream(const TypesettingEngine& engine, const document::Document& document,
+                                         const style::Style& style, double width,
+                                         const CancellationToken* cancellation)
+    : m_engine(engine)
+    , m_document(document)
+    , m_style(style::StyleInterner::getInstance().intern(style))
+    , m_width(width)
+    , m_cancellation(cancellation)
+    , m_status(TypesetStatus::Completed)
+    , m_sectionIndex(0)
+    , m_titleDone(false)
+    , m_blockCount(0) {
+    // タイトルは本文より太く大きくする（同じ本文スタイルからの派生は検索のみで済む）
+    style::StyleDerivation title;
+    title.bold = true;
+    title.fontSizeScale = 1.2;
+    m_titleStyle = style::StyleInterner::getInstance().derive(m_style, title);
+
+    // 本文スタイルの送り幅を事前計算しておく
+    GlyphAdvanceCache::getInstance().preload(*m_style, m_document.isVertical());
+}
+
+DocumentBlockStream::DocumentBlockStream(const TypesettingEngine& engine, const document::Document& document,
+                                         const style::CompiledStyleSheet& styleSheet, double width,
+                                         const CancellationToken* cancellation)
+    : m_engine(engine)
+    , m_document(document)
+    , m_style(styleSheet.getHandle(style::kBodyStyle))
+    , m_titleStyle(styleSheet.getHandle(style::kHeadingStyle))
+    , m_width(width)
+    , m_cancellation(cancellation)
+    , m_status(TypesetStatus::Completed)
+    , m_sectionIndex(0)
+    , m_titleDone(false)
+    , m_blockCount(0) {
+    // 本文スタイルの送り幅を事前計算しておく
+    GlyphAdvanceCache::getInstance().preload(*m_style, m_document.isVertical());
+}
+
+DocumentBlockStream::~DocumentBlockStream() {
+    // 特に何もしない
+}
+
+bool DocumentBlockStream::next(TextBlock& block) {
+    if (m_status != TypesetStatus::Completed) {
+        return false;
+    }
+
+    while (m_sectionIndex < m_document.getSectionCount()) {
+        // ブロックごとに中断要求を確認する
+        if (m_cancellation) {
+            m_status = m_cancellation->check();
+            if (m_status != TypesetStatus::Completed) {
+                return false;
+            }
+        }
+
+        document::Section* section = m_document.getSection(m_sectionIndex);
+        if (!section) {
+            m_sectionIndex++;
+            continue;
+        }
+
+        // セクションのタイトルを組版
+        if (!m_titleDone) {
+            m_titleDone = true;
+            std::string title = section->getTitle();
+            if (!title.empty()) {
+                block = m_engine.typeset(title, m_titleStyle, m_width, m_document.isVertical(), m_cancellation);
+                return accept(block);
+            }
+        }
+
+        // セクションの内容を組版して次のセクションへ進む
+        // 子セクションを再帰的に組版（将来的な拡張）
+        block = m_engine.typeset(section->getContent(), m_style, m_width, m_document.isVertical(), m_cancellation);
+        m_sectionIndex++;
+        m_titleDone = false;
+        return accept(block);
+    }
+
+    return false;
+}
+
+TypesetStatus DocumentBlockStream::getStatus() const {
+    return m_status;
+}
+
+bool DocumentBlockStream::accept(const TextBlock& block) {
+    // 組版途中で中断されたブロックは返さない
+    if (block.status != TypesetStatus::Completed) {
+        m_status = block.status;
+        return false;
+    }
+    m_blockCount++;
+    return true;
+}
+
+size_t DocumentBlockStream::getBlockCount() const {
+    return m_blockCount;
+}
+
+DocumentBlockStream::Iterator DocumentBlockStream::begin() {
+    return Iterator(this);
+}
+
+DocumentBlockStream::Iterator DocumentBlockStream::end() {
+    return Iterator();
+}
+
+} // namespace typesetting
+} // namespace core
+} // namespace japanese_typesetting
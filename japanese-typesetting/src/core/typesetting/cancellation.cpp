@@ -0,0 +1,62 @@
+/**
+ * @file cancellation.cpp
+ * @brief 組版処理の中断要求と期限の実装
+ */
+
+#include "japanese_typesetting/core/typesetting/cancellation.h"
+#include <limits>
+
+namespace japanese_typesetting {
+namespace core {
+namespace typesetting {
+
+const CancellationToken::Clock::rep CancellationToken::kNoDeadline =
+    std::numeric_limits<CancellationToken::Clock::rep>::max();
+
+CancellationToken::CancellationToken()
+    : m_cancelled(false)
+    , m_deadline(kNoDeadline) {
+}
+
+CancellationToken::~CancellationToken() {
+    // 特に何もしない
+}
+
+void CancellationToken::cancel() {
+    m_cancelled.store(true, std::memory_order_relaxed);
+}
+
+void CancellationToken::reset() {
+    m_cancelled.store(false, std::memory_order_relaxed);
+    m_deadline.store(kNoDeadline, std::memory_order_relaxed);
+}
+
+void CancellationToken::setDeadline(Clock::time_point deadline) {
+    m_deadline.store(deadline.time_since_epoch().count(), std::memory_order_relaxed);
+}
+
+void CancellationToken::setTimeout(Clock::duration timeout) {
+    setDeadline(Clock::now() + timeout);
+}
+
+bool CancellationToken::isCancellationRequested() const {
+    return m_cancelled.load(std::memory_order_relaxed);
+}
+
+TypesetStatus CancellationToken::check() const {
+    if (m_cancelled.load(std::memory_order_relaxed)) {
+        return TypesetStatus::Cancelled;
+    }
+
+    // 期限がない場合は時刻を取得しない
+    Clock::rep deadline = m_deadline.load(std::memory_order_relaxed);
+    if (deadline != kNoDeadline && Clock::now().time_since_epoch().count() >= deadline) {
+        return TypesetStatus::DeadlineExceeded;
+    }
+
+    return TypesetStatus::Completed;
+}
+
+} // namespace typesetting
+} // namespace core
+} // namespace japanese_typesetting
@@ -0,0 +1,392 @@
+/**
+ * @file disk_layout_cache.cpp
+ * @brief ディスク上に永続化する組版結果のキャッシュの実装
+ */
+
+#include "japanese_typesetting/core/typesetting/disk_layout_cache.h"
+#include "japanese_typesetting/core/font/font.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <set>
+#include <sstream>
+
+namespace japanese_typesetting {
+namespace core {
+namespace typesetting {
+
+namespace {
+
+const char kMagic[4] = {'J', 'T', 'L', 'C'};
+
+// 読み込み時に不正なファイルで巨大な確保をしないための上限
+const uint64_t kMaxLineCount = 1u << 24;
+const uint64_t kMaxLineLength = 1u << 24;
+const uint64_t kMaxKeyLength = 1u << 30;
+
+template <typename T>
+void writeValue(std::ostream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+bool readValue(std::istream& in, T& value) {
+    in.read(reinterpret_cast<char*>(&value), sizeof(value));
+    return static_cast<bool>(in);
+}
+
+void writeString(std::ostream& out, const std::string& text) {
+    writeValue(out, static_cast<uint64_t>(text.size()));
+    out.write(text.data(), static_cast<std::streamsize>(text.size()));
+}
+
+void writeCharacters(std::ostream& out, const std::set<char32_t>& characters) {
+    writeValue(out, static_cast<uint64_t>(characters.size()));
+    for (char32_t character : characters) {
+        writeValue(out, character);
+    }
+}
+
+/**
+ * @brief 組版に使われるフォントファイルを識別する値を書き出す
+ *
+ * フォントの検索パスやファイルが変わると別のフォントで組版されるため、
+ * 解決したファイルのパスに加えて大きさと更新日時を含める。
+ */
+void writeFontIdentity(std::ostream& out, const style::Style& style) {
+    font::FontLocation location = font::FontFace::findFontFile(style.getFontFamily(), style.isBold(), style.isItalic());
+    uint64_t fileSize = 0;
+    int64_t modified = 0;
+    if (!location.filePath.empty()) {
+        std::error_code ec;
+        std::uintmax_t size = std::filesystem::file_size(location.filePath, ec);
+        if (!ec) {
+            fileSize = static_cast<uint64_t>(size);
+        }
+        std::filesystem::file_time_type time = std::filesystem::last_write_time(location.filePath, ec);
+        if (!ec) {
+            modified = static_cast<int64_t>(time.time_since_epoch().count());
+        }
+    }
+    writeString(out, location.filePath);
+    writeValue(out, static_cast<int32_t>(location.faceIndex));
+    writeValue(out, fileSize);
+    writeValue(out, modified);
+}
+
+/**
+ * @brief 組版の入力をファイルに保存する形に符号化する
+ * @param key キー
+ * @return 符号化したキー
+ *
+ * ハッシュ値ではなくテキスト・スタイル・ルール・フォントの内容そのものを含めるため、
+ * 読み込み時にバイト列として比較すれば入力が同じかどうかを判定できる。
+ */
+std::string encodeKey(const LayoutCacheKey& key) {
+    std::ostringstream out;
+    writeString(out, key.text);
+
+    // StyleInterner::hashLayoutFieldsと同じ項目
+    const style::Style& style = key.style;
+    writeString(out, style.getFontFamily());
+    writeValue(out, style.getFontSize());
+    writeValue(out, style.getLineHeight());
+    writeValue(out, style.getTextAlignment());
+    writeValue(out, style.getLineBreakMode());
+    writeValue(out, style.getRubyAlignment());
+    writeValue(out, static_cast<uint8_t>(style.isGridLayout()));
+    writeValue(out, style.getCharacterSpacing());
+    writeValue(out, style.getWordSpacing());
+    writeValue(out, style.getFirstLineIndent());
+    writeValue(out, static_cast<uint8_t>(style.isBold()));
+    writeValue(out, static_cast<uint8_t>(style.isItalic()));
+
+    TypesettingRules noRules;
+    const TypesettingRules& rules = key.rules ? *key.rules : noRules;
+    writeCharacters(out, rules.getLineStartProhibitedCharacters());
+    writeCharacters(out, rules.getLineEndProhibitedCharacters());
+    writeCharacters(out, rules.getInseparableCharacters());
+    writeCharacters(out, rules.getHangingCharacters());
+
+    writeValue(out, key.width);
+    writeValue(out, static_cast<uint8_t>(key.vertical));
+    writeFontIdentity(out, style);
+    return out.str();
+}
+
+bool readKeyMatches(std::istream& in, const std::string& encodedKey) {
+    uint64_t length = 0;
+    if (!readValue(in, length) || length != encodedKey.size() || length > kMaxKeyLength) {
+        return false;
+    }
+    std::string stored(static_cast<size_t>(length), '\0');
+    in.read(&stored[0], static_cast<std::streamsize>(length));
+    return in && stored == encodedKey;
+}
+
+} // namespace
+
+DiskLayoutCache::DiskLayoutCache(const std::string& directory)
+    : m_directory(directory)
+    , m_available(false)
+    , m_hits(0)
+    , m_misses(0)
+    , m_writes(0) {
+    std::error_code ec;
+    std::filesystem::create_directories(m_directory, ec);
+    m_available = std::filesystem::is_directory(m_directory, ec);
+    if (!m_available) {
+        std::cerr << "組版キャッシュのディレクトリを使用できません: " << m_directory << std::endl;
+    }
+}
+
+DiskLayoutCache::~DiskLayoutCache() {
+    // 特に何もしない
+}
+
+bool DiskLayoutCache::load(const LayoutCacheKey& key, TextBlock& block) {
+    if (!m_available) {
+        return false;
+    }
+
+    std::string encodedKey = encodeKey(key);
+    std::ifstream file(getEntryPath(encodedKey), std::ios::binary);
+    if (!file.is_open()) {
+        m_misses++;
+        return false;
+    }
+
+    // 名前の衝突や別バージョン・別フォントのファイルを除外するため、ヘッダとキーを照合する
+    char magic[4];
+    uint32_t version = 0;
+    file.read(magic, sizeof(magic));
+    if (!file || !std::equal(magic, magic + 4, kMagic) ||
+        !readValue(file, version) || version != kEngineVersion ||
+        !readKeyMatches(file, encodedKey)) {
+        m_misses++;
+        return false;
+    }
+
+    TextBlock result;
+    uint64_t lineCount = 0;
+    if (!readValue(file, result.width) || !readValue(file, result.height) ||
+        !readValue(file, lineCount) || lineCount > kMaxLineCount) {
+        m_misses++;
+        return false;
+    }
+
+    result.lines.resize(static_cast<size_t>(lineCount));
+    for (auto& line : result.lines) {
+        uint8_t hasLineBreak = 0;
+        uint64_t length = 0;
+        if (!readValue(file, line.width) || !readValue(file, line.height) ||
+            !readValue(file, line.baseline) || !readValue(file, hasLineBreak) ||
+            !readValue(file, length) || length > kMaxLineLength) {
+            m_misses++;
+            return false;
+        }
+        line.hasLineBreak = hasLineBreak != 0;
+        line.text.resize(static_cast<size_t>(length));
+        file.read(reinterpret_cast<char*>(&line.text[0]), static_cast<std::streamsize>(length * sizeof(char32_t)));
+
+        // 送り幅の増減は空か、テキストと同じ長さ
+        uint64_t deltaCount = 0;
+        if (!file || !readValue(file, deltaCount) || (deltaCount != 0 && deltaCount != length)) {
+            m_misses++;
+            return false;
+        }
+        line.advanceDeltas.resize(static_cast<size_t>(deltaCount));
+        file.read(reinterpret_cast<char*>(line.advanceDeltas.data()),
+                  static_cast<std::streamsize>(deltaCount * sizeof(double)));
+
+        // ランは1文字に1つ以下で、行の範囲に収まる
+        uint64_t runCount = 0;
+        if (!file || !readValue(file, runCount) || runCount > length) {
+            m_misses++;
+            return false;
+        }
+        line.runs.resize(static_cast<size_t>(runCount));
+        for (auto& run : line.runs) {
+            uint8_t fallback = 0;
+            if (!readValue(file, run.start) || !readValue(file, run.length) || !readValue(file, run.script) ||
+                !readValue(file, run.orientation) || !readValue(file, run.widthClass) ||
+                !readValue(file, fallback) || !readValue(file, run.emphasis) || !readValue(file, run.sideline) ||
+                run.end() > length) {
+                m_misses++;
+                return false;
+            }
+            run.fallback = fallback != 0;
+        }
+
+        // ルビ注釈は親文字が行内に、ルビがルビ文字列内に収まる
+        uint64_t rubyCount = 0;
+        uint64_t rubyLength = 0;
+        if (!readValue(file, rubyCount) || rubyCount > length || !readValue(file, rubyLength) ||
+            rubyLength > kMaxLineLength) {
+            m_misses++;
+            return false;
+        }
+        line.rubyText.resize(static_cast<size_t>(rubyLength));
+        file.read(reinterpret_cast<char*>(&line.rubyText[0]), static_cast<std::streamsize>(rubyLength * sizeof(char32_t)));
+        line.rubies.resize(static_cast<size_t>(rubyCount));
+        for (auto& ruby : line.rubies) {
+            if (!readValue(file, ruby.baseStart) || !readValue(file, ruby.baseLength) ||
+                !readValue(file, ruby.rubyStart) || !readValue(file, ruby.rubyLength) ||
+                !readValue(file, ruby.rubyOffset) || !readValue(file, ruby.rubyWidth) ||
+                ruby.baseEnd() > length || ruby.rubyEnd() > rubyLength) {
+                m_misses++;
+                return false;
+            }
+        }
+
+        // 圏点・傍線の配置は行内に収まる
+        uint64_t annotationCount = 0;
+        if (!readValue(file, line.annotationOver) || !readValue(file, line.annotationUnder) ||
+            !readValue(file, annotationCount) || annotationCount > length) {
+            m_misses++;
+            return false;
+        }
+        line.annotations.resize(static_cast<size_t>(annotationCount));
+        for (auto& annotation : line.annotations) {
+            if (!readValue(file, annotation.start) || !readValue(file, annotation.length) ||
+                !readValue(file, annotation.emphasis) || !readValue(file, annotation.sideline) ||
+                !readValue(file, annotation.inlineStart) || !readValue(file, annotation.inlineEnd) ||
+                !readValue(file, annotation.blockOffset) || annotation.start + annotation.length > length) {
+                m_misses++;
+                return false;
+            }
+        }
+    }
+
+    block = std::move(result);
+    m_hits++;
+    return true;
+}
+
+bool DiskLayoutCache::store(const LayoutCacheKey& key, const TextBlock& block) {
+    if (!m_available) {
+        return false;
+    }
+
+    std::string encodedKey = encodeKey(key);
+    std::string path = getEntryPath(encodedKey);
+
+    // 他のプロセスと衝突しない一時ファイル名を作る
+    static std::atomic<uint64_t> counter(0);
+    std::random_device random;
+    std::ostringstream tempName;
+    tempName << path << ".tmp." << std::hex << random() << "." << counter.fetch_add(1);
+    std::string tempPath = tempName.str();
+
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+
+        file.write(kMagic, sizeof(kMagic));
+        writeValue(file, kEngineVersion);
+        writeString(file, encodedKey);
+        writeValue(file, block.width);
+        writeValue(file, block.height);
+        writeValue(file, static_cast<uint64_t>(block.lines.size()));
+        for (const auto& line : block.lines) {
+            writeValue(file, line.width);
+            writeValue(file, line.height);
+            writeValue(file, line.baseline);
+            writeValue(file, static_cast<uint8_t>(line.hasLineBreak));
+            writeValue(file, static_cast<uint64_t>(line.text.size()));
+            file.write(reinterpret_cast<const char*>(line.text.data()),
+                       static_cast<std::streamsize>(line.text.size() * sizeof(char32_t)));
+            writeValue(file, static_cast<uint64_t>(line.advanceDeltas.size()));
+            file.write(reinterpret_cast<const char*>(line.advanceDeltas.data()),
+                       static_cast<std::streamsize>(line.advanceDeltas.size() * sizeof(double)));
+            writeValue(file, static_cast<uint64_t>(line.runs.size()));
+            for (const auto& run : line.runs) {
+                writeValue(file, run.start);
+                writeValue(file, run.length);
+                writeValue(file, run.script);
+                writeValue(file, run.orientation);
+                writeValue(file, run.widthClass);
+                writeValue(file, static_cast<uint8_t>(run.fallback));
+                writeValue(file, run.emphasis);
+                writeValue(file, run.sideline);
+            }
+            writeValue(file, static_cast<uint64_t>(line.rubies.size()));
+            writeValue(file, static_cast<uint64_t>(line.rubyText.size()));
+            file.write(reinterpret_cast<const char*>(line.rubyText.data()),
+                       static_cast<std::streamsize>(line.rubyText.size() * sizeof(char32_t)));
+            for (const auto& ruby : line.rubies) {
+                writeValue(file, ruby.baseStart);
+                writeValue(file, ruby.baseLength);
+                writeValue(file, ruby.rubyStart);
+                writeValue(file, ruby.rubyLength);
+                writeValue(file, ruby.rubyOffset);
+                writeValue(file, ruby.rubyWidth);
+            }
+            writeValue(file, line.annotationOver);
+            writeValue(file, line.annotationUnder);
+            writeValue(file, static_cast<uint64_t>(line.annotations.size()));
+            for (const auto& annotation : line.annotations) {
+                writeValue(file, annotation.start);
+                writeValue(file, annotation.length);
+                writeValue(file, annotation.emphasis);
+                writeValue(file, annotation.sideline);
+                writeValue(file, annotation.inlineStart);
+                writeValue(file, annotation.inlineEnd);
+                writeValue(file, annotation.blockOffset);
+            }
+        }
+
+        file.flush();
+        if (!file) {
+            file.close();
+            std::remove(tempPath.c_str());
+            return false;
+        }
+    }
+
+    // 名前の変更は不可分なので、読み込み側が書きかけのファイルを見ることはない
+    std::error_code ec;
+    std::filesystem::rename(tempPath, path, ec);
+    if (ec) {
+        // 既存のファイルを置き換えられない環境では、先に書かれた同じ内容を使う
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+
+    m_writes++;
+    return true;
+}
+
+const std::string& DiskLayoutCache::getDirectory() const {
+    return m_directory;
+}
+
+bool DiskLayoutCache::isAvailable() const {
+    return m_available;
+}
+
+DiskLayoutCacheStats DiskLayoutCache::getStats() const {
+    DiskLayoutCacheStats stats;
+    stats.hits = m_hits.load();
+    stats.misses = m_misses.load();
+    stats.writes = m_writes.load();
+    return stats;
+}
+
+std::string DiskLayoutCache::getEntryPath(const std::string& encodedKey) const {
+    uint64_t hash = LayoutCache::hashText(encodedKey);
+    hash ^= static_cast<uint64_t>(kEngineVersion) << 56;
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.layout", static_cast<unsigned long long>(hash));
+    return (std::filesystem::path(m_directory) / name).string();
+}
+
+} // namespace typesetting
+} // namespace core
+} // namespace japanese_typesetting
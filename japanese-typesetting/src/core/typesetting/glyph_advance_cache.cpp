@@ -0,0 +1,294 @@
+/**
+ * @file glyph_advance_cache.cpp
+ * @brief 文字送り幅のキャッシュの実装
+ */
+
+#include "japanese_typesetting/core/typesetting/glyph_advance_cache.h"
+#include "japanese_typesetting/core/font/font_registry.h"
+#include "japanese_typesetting/core/unicode/unicode.h"
+#include <algorithm>
+#include <iostream>
+#include <tuple>
+#include <utility>
+
+namespace japanese_typesetting {
+namespace core {
+namespace typesetting {
+
+// GlyphAdvanceKey の実装
+
+bool GlyphAdvanceKey::operator==(const GlyphAdvanceKey& other) const {
+    return fontFamily == other.fontFamily &&
+           bold == other.bold &&
+           italic == other.italic &&
+           fontSize == other.fontSize &&
+           vertical == other.vertical;
+}
+
+GlyphAdvanceKey GlyphAdvanceKey::fromStyle(const style::Style& style, bool vertical) {
+    GlyphAdvanceKey key;
+    key.fontFamily = style.getFontFamily();
+    key.bold = style.isBold();
+    key.italic = style.isItalic();
+    key.fontSize = style.getFontSize();
+    key.vertical = vertical;
+    return key;
+}
+
+size_t GlyphAdvanceKeyHash::operator()(const GlyphAdvanceKey& key) const {
+    size_t hash = std::hash<std::string>()(key.fontFamily);
+    hash ^= std::hash<double>()(key.fontSize) + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+    hash ^= (static_cast<size_t>(key.bold) << 0) |
+            (static_cast<size_t>(key.italic) << 1) |
+            (static_cast<size_t>(key.vertical) << 2);
+    return hash;
+}
+
+// GlyphAdvanceTable の実装
+
+GlyphAdvanceTable::GlyphAdvanceTable(const GlyphAdvanceKey& key, Measurer measurer,
+                                     const std::shared_ptr<const font::FontFace>& font,
+                                     const font::FontLocation& location)
+    : m_key(key)
+    , m_measurer(std::move(measurer))
+    , m_fontLocation(location)
+    , m_font(font)
+    , m_dense(new std::atomic<LayoutUnit>[kDenseSize])
+    , m_preloaded(false) {
+    // 負値を未計算の印とする
+    for (size_t i = 0; i < kDenseSize; ++i) {
+        m_dense[i].store(-1, std::memory_order_relaxed);
+    }
+}
+
+GlyphAdvanceTable::~GlyphAdvanceTable() {
+    // 特に何もしない
+}
+
+void GlyphAdvanceTable::preload() const {
+    if (m_preloaded.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    // フォントは1度だけ取得し、計算の間は保持しておく
+    std::shared_ptr<const font::FontFace> font = getFont();
+    auto fill = [this, &font](char32_t first, char32_t last) {
+        for (char32_t ch = first; ch < last; ++ch) {
+            int index = denseIndex(ch);
+            if (m_dense[index].load(std::memory_order_relaxed) < 0) {
+                m_dense[index].store(measure(ch, font.get()), std::memory_order_relaxed);
+            }
+        }
+    };
+    fill(0, 0x100);
+    fill(0x3000, 0xA000);
+    fill(0xFF00, 0xFFF0);
+
+    m_preloaded.store(true, std::memory_order_release);
+}
+
+bool GlyphAdvanceTable::isPreloaded() const {
+    return m_preloaded.load(std::memory_order_acquire);
+}
+
+const GlyphAdvanceKey& GlyphAdvanceTable::getKey() const {
+    return m_key;
+}
+
+std::shared_ptr<const font::FontFace> GlyphAdvanceTable::getFont() const {
+    if (m_fontLocation.filePath.empty()) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(m_fontMutex);
+    std::shared_ptr<const font::FontFace> font = m_font.lock();
+    if (!font) {
+        // 登録簿が外して破棄されたフォントは取得し直す
+        font = font::FontRegistry::getInstance().getFace(m_fontLocation);
+        m_font = font;
+    }
+    return font;
+}
+
+const font::FontLocation& GlyphAdvanceTable::getFontLocation() const {
+    return m_fontLocation;
+}
+
+size_t GlyphAdvanceTable::getSparseEntryCount() const {
+    std::shared_lock<std::shared_mutex> lock(m_sparseMutex);
+    return m_sparse.size();
+}
+
+bool GlyphAdvanceTable::isDenseCharacter(char32_t character) {
+    return denseIndex(character) >= 0;
+}
+
+const LayoutUnit* GlyphAdvanceTable::getDenseAdvances() const {
+    // ロックフリーのアトミック整数は整数と同じ表現なので、事前計算後はそのまま読み出せる
+    static_assert(sizeof(std::atomic<LayoutUnit>) == sizeof(LayoutUnit),
+                  "atomic LayoutUnit must have the same layout as LayoutUnit");
+    static_assert(std::atomic<LayoutUnit>::is_always_lock_free,
+                  "atomic LayoutUnit must be lock free");
+    if (!isPreloaded()) {
+        return nullptr;
+    }
+    return reinterpret_cast<const LayoutUnit*>(m_dense.get());
+}
+
+LayoutUnit GlyphAdvanceTable::lookupSlow(char32_t character, int index) const {
+    if (index >= 0) {
+        // 同じ値を複数スレッドが計算しても結果は同じなので、ロックは不要
+        LayoutUnit advance = measure(character, getFont().get());
+        m_dense[index].store(advance, std::memory_order_relaxed);
+        return advance;
+    }
+
+    {
+        std::shared_lock<std::shared_mutex> lock(m_sparseMutex);
+        auto it = m_sparse.find(character);
+        if (it != m_sparse.end()) {
+            return it->second;
+        }
+    }
+
+    LayoutUnit advance = measure(character, getFont().get());
+    std::unique_lock<std::shared_mutex> lock(m_sparseMutex);
+    m_sparse.emplace(character, advance);
+    return advance;
+}
+
+LayoutUnit GlyphAdvanceTable::measure(char32_t character, const font::FontFace* font) const {
+    return std::max<LayoutUnit>(0, toLayoutUnit(m_measurer(font, character)));
+}
+
+// GlyphAdvanceCache の実装
+
+GlyphAdvanceCache& GlyphAdvanceCache::getInstance() {
+    static GlyphAdvanceCache instance;
+    return instance;
+}
+
+GlyphAdvanceCache::GlyphAdvanceCache(size_t maxTables)
+    : m_maxTables(maxTables > 0 ? maxTables : 1)
+    , m_clock(0) {
+}
+
+GlyphAdvanceCache::~GlyphAdvanceCache() {
+    // 特に何もしない
+}
+
+std::shared_ptr<const GlyphAdvanceTable> GlyphAdvanceCache::getTable(const style::Style& style, bool vertical) {
+    return getTable(GlyphAdvanceKey::fromStyle(style, vertical));
+}
+
+std::shared_ptr<const GlyphAdvanceTable> GlyphAdvanceCache::getTable(const GlyphAdvanceKey& key) {
+    const uint64_t now = m_clock.fetch_add(1, std::memory_order_relaxed) + 1;
+    std::shared_ptr<const GlyphAdvanceTable> table;
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        auto it = m_tables.find(key);
+        if (it != m_tables.end()) {
+            it->second.lastUse.store(now, std::memory_order_relaxed);
+            table = it->second.table;
+        }
+    }
+
+    if (!table) {
+        // フォントの検索・マップは時間がかかるため、テーブルはロックの外で作る
+        // （同時に作られた場合は先に登録されたものを使い、作ったものは捨てる）
+        std::shared_ptr<GlyphAdvanceTable> created = createTable(key);
+
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        auto it = m_tables.find(key);
+        if (it != m_tables.end()) {
+            it->second.lastUse.store(now, std::memory_order_relaxed);
+            table = it->second.table;
+        } else {
+            // 上限に達している場合は最も長く取得されていないテーブルを外す
+            if (m_tables.size() >= m_maxTables) {
+                auto oldest = std::min_element(m_tables.begin(), m_tables.end(), [](const auto& a, const auto& b) {
+                    return a.second.lastUse.load(std::memory_order_relaxed) <
+                           b.second.lastUse.load(std::memory_order_relaxed);
+                });
+                m_tables.erase(oldest);
+            }
+            Entry& entry = m_tables.emplace(std::piecewise_construct, std::forward_as_tuple(key),
+                                            std::forward_as_tuple()).first->second;
+            entry.table = std::move(created);
+            entry.lastUse.store(now, std::memory_order_relaxed);
+            table = entry.table;
+        }
+    }
+
+    // 事前計算はロックの外で行う（済んでいれば何もしない、同時に計算しても結果は同じ）
+    table->preload();
+    return table;
+}
+
+std::shared_ptr<const GlyphAdvanceTable> GlyphAdvanceCache::preload(const style::Style& style, bool vertical) {
+    return getTable(style, vertical);
+}
+
+void GlyphAdvanceCache::clear() {
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    m_tables.clear();
+}
+
+size_t GlyphAdvanceCache::getTableCount() const {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    return m_tables.size();
+}
+
+double GlyphAdvanceCache::estimateAdvance(char32_t character, double fontSize) {
+    static const unicode::UnicodeHandler unicodeHandler;
+
+    // 全角文字と半角文字で幅を調整
+    if (unicodeHandler.isFullWidthCharacter(character)) {
+        return fontSize;
+    } else if (unicodeHandler.isHalfWidthCharacter(character)) {
+        return fontSize * 0.5;
+    }
+
+    // デフォルトは全角として扱う
+    return fontSize;
+}
+
+std::shared_ptr<GlyphAdvanceTable> GlyphAdvanceCache::createTable(const GlyphAdvanceKey& key) {
+    double fontSize = key.fontSize;
+    font::FontLocation location = font::FontFace::findFontFile(key.fontFamily, key.bold, key.italic);
+    std::shared_ptr<const font::FontFace> face = openFont(location);
+    if (!face) {
+        // フォントが見つからない場合は文字幅の推定値を用いる
+        return std::make_shared<GlyphAdvanceTable>(key, [fontSize](const font::FontFace*, char32_t character) {
+            return estimateAdvance(character, fontSize);
+        });
+    }
+
+    // フォントはテーブルが取得し直したものを受け取る（テーブルはフォントを所有しない）
+    bool vertical = key.vertical;
+    return std::make_shared<GlyphAdvanceTable>(key, [fontSize, vertical](const font::FontFace* font, char32_t character) {
+        double advance = font ? font->getAdvance(character, fontSize, vertical) : -1.0;
+        if (advance < 0.0) {
+            // グリフがない文字やフォントを取得し直せない場合は推定値を用いる
+            return estimateAdvance(character, fontSize);
+        }
+        return advance;
+    }, face, location);
+}
+
+std::shared_ptr<const font::FontFace> GlyphAdvanceCache::openFont(const font::FontLocation& location) {
+    if (location.filePath.empty()) {
+        return nullptr;
+    }
+
+    // フォントファイルは登録簿を通じて他のエンジン・出力と共有する
+    std::shared_ptr<const font::FontFace> face = font::FontRegistry::getInstance().getFace(location);
+    if (!face) {
+        std::cerr << "フォントを開けません: " << location.filePath << std::endl;
+    }
+    return face;
+}
+
+} // namespace typesetting
+} // namespace core
+} // namespace japanese_typesetting
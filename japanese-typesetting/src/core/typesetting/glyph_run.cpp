@@ -0,0 +1,113 @@
+/**
+ * @file glyph_run.cpp
+ * @brief 位置付けされたグリフ列の実装
+ */
+
+#include "japanese_typesetting/core/typesetting/glyph_run.h"
+#include "japanese_typesetting/core/font/shaped_run_cache.h"
+#include "japanese_typesetting/core/typesetting/layout_unit.h"
+
+namespace japanese_typesetting {
+namespace core {
+namespace typesetting {
+
+namespace {
+
+// 1つのランのグリフ列を作成する（clustersは行の先頭からの位置）
+GlyphRun buildRun(const std::u32string& text, const std::vector<double>& advanceDeltas, const TextRun& textRun,
+                  const GlyphAdvanceTable& advances, bool vertical) {
+    GlyphRun run;
+    run.fontSize = advances.getKey().fontSize;
+    const char32_t* characters = text.data() + textRun.start;
+    const bool upright = vertical && textRun.orientation == GlyphOrientation::Upright;
+
+    // 組版時と同じ条件でシェーピング結果を使う（グリフがない文字を含む場合は推定幅）
+    std::shared_ptr<const font::ShapedRun> shaped;
+    const std::shared_ptr<const font::FontFace>& face = advances.getFont();
+    if (face && !textRun.fallback) {
+        shaped = font::ShapedRunCache::getInstance().shape(
+            *face, characters, textRun.length, run.fontSize, upright, font::defaultShapingFeatures(upright));
+        if (shaped->missingGlyphs != 0) {
+            shaped.reset();
+        }
+    }
+
+    size_t count = shaped ? shaped->glyphIds.size() : textRun.length;
+    run.glyphIds.reserve(count);
+    run.clusters.reserve(count);
+    run.xAdvances.reserve(count);
+    run.yAdvances.reserve(count);
+
+    if (shaped) {
+        run.fontLocation = advances.getFontLocation();
+        run.glyphIds = shaped->glyphIds;
+        for (uint32_t cluster : shaped->clusters) {
+            run.clusters.push_back(textRun.start + cluster);
+        }
+        run.xOffsets = shaped->xOffsets;
+        run.yOffsets = shaped->yOffsets;
+    } else {
+        for (uint32_t i = 0; i < textRun.length; ++i) {
+            run.glyphIds.push_back(0);
+            run.clusters.push_back(textRun.start + i);
+        }
+        run.xOffsets.assign(count, 0.0);
+        run.yOffsets.assign(count, 0.0);
+    }
+
+    // 縦中横はグリフを1字分の枠の中央に横に並べ、送り幅ではなくオフセットで位置を表す
+    const bool combined = vertical && textRun.orientation == GlyphOrientation::TateChuYoko;
+    double pen = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t cluster = run.clusters[i];
+        LayoutUnit advance = shaped ? toLayoutUnit(shaped->advances[i]) : advances.getAdvanceUnits(text[cluster]);
+        if (combined) {
+            run.xOffsets[i] += pen;
+            pen += fromLayoutUnit(advance);
+            run.xAdvances.push_back(0.0);
+            run.yAdvances.push_back(0.0);
+            continue;
+        }
+
+        // 文字の後ろの増減は、その文字の最後のグリフの送り幅に加える
+        bool lastOfCluster = i + 1 == count || run.clusters[i + 1] != cluster;
+        double width = fromLayoutUnit(advance);
+        if (lastOfCluster && cluster < advanceDeltas.size()) {
+            width += advanceDeltas[cluster];
+        }
+
+        run.xAdvances.push_back(vertical ? 0.0 : width);
+        run.yAdvances.push_back(vertical ? width : 0.0);
+    }
+    run.rotated.assign(count, vertical && textRun.orientation == GlyphOrientation::Sideways ? 1 : 0);
+
+    if (combined && count > 0) {
+        // 枠の中央に寄せ、最後のグリフで1字分（と縦中横の後ろの増減）だけ進める
+        for (double& offset : run.xOffsets) {
+            offset -= pen / 2.0;
+        }
+        double delta = textRun.end() <= advanceDeltas.size() ? advanceDeltas[textRun.end() - 1] : 0.0;
+        run.yAdvances[count - 1] = fromLayoutUnit(toLayoutUnit(run.fontSize)) + delta;
+    }
+
+    return run;
+}
+
+} // namespace
+
+std::vector<GlyphRun> buildGlyphRuns(const std::u32string& text, const std::vector<double>& advanceDeltas,
+                                     const std::vector<TextRun>& runs, const GlyphAdvanceTable& advances,
+                                     bool vertical) {
+    std::vector<GlyphRun> glyphRuns;
+    glyphRuns.reserve(runs.size());
+    for (const auto& run : runs) {
+        if (run.length > 0 && run.end() <= text.length()) {
+            glyphRuns.push_back(buildRun(text, advanceDeltas, run, advances, vertical));
+        }
+    }
+    return glyphRuns;
+}
+
+} // namespace typesetting
+} // namespace core
+} // namespace japanese_typesetting
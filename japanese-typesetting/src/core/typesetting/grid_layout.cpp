@@ -0,0 +1,282 @@
+/**
+ * @file grid_layout.cpp
+ * @brief 字詰め（文字を升目に置く組み方）の行組みカーネルの実装
+ */
+
+#include "japanese_typesetting/core/typesetting/grid_layout.h"
+#include "japanese_typesetting/core/typesetting/width_kernels.h"
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define JAPANESE_TYPESETTING_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace japanese_typesetting {
+namespace core {
+namespace typesetting {
+
+namespace {
+
+// 升目に置く全角の文字（itemizeTextが表で全角・正立に分類する範囲）
+// 縦中横になりうる全角の感嘆符・疑問符は前後の文字によるため除く
+// かなと漢字が交互に現れても分岐予測を外さないよう、範囲の判定は分岐なしで行う
+inline bool isGridCharacter(char32_t character) {
+    const uint32_t c = static_cast<uint32_t>(character);
+    return ((c - 0x3000u < 0x100u) | (c - 0x4E00u < 0x5200u) | (c - 0x3400u < 0x1AC0u) | (c - 0xFF01u < 0x60u)) &
+           (c != 0x3040u) & (c != 0xFF01u) & (c != 0xFF1Fu);
+}
+
+// かなと漢字（CJKの記号と句読点・全角形以外）かどうか
+inline bool isKanaOrKanji(char32_t character) {
+    return static_cast<uint32_t>(character) - 0x3041u < 0xFF01u - 0x3041u;
+}
+
+#ifdef JAPANESE_TYPESETTING_X86_SIMD
+
+// 各要素が[low, low + size)の範囲にあるかどうか
+__attribute__((target("avx2")))
+inline __m256i inRangeAvx2(__m256i characters, int32_t low, int32_t size) {
+    __m256i offset = _mm256_sub_epi32(characters, _mm256_set1_epi32(low));
+    return _mm256_and_si256(_mm256_cmpgt_epi32(offset, _mm256_set1_epi32(-1)),
+                            _mm256_cmpgt_epi32(_mm256_set1_epi32(size), offset));
+}
+
+// 先頭から8文字ずつisGridCharacterを判定し、升目に置かない文字を含む8文字の手前で止まる
+__attribute__((target("avx2")))
+size_t scanGridAvx2(const char32_t* text, size_t length, bool& japanese) {
+    __m256i kana = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        __m256i characters = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i));
+        __m256i grid = _mm256_or_si256(
+            _mm256_or_si256(inRangeAvx2(characters, 0x3000, 0x100), inRangeAvx2(characters, 0x3400, 0x1AC0)),
+            _mm256_or_si256(inRangeAvx2(characters, 0x4E00, 0x5200), inRangeAvx2(characters, 0xFF02, 0x5F)));
+        __m256i excluded = _mm256_or_si256(_mm256_cmpeq_epi32(characters, _mm256_set1_epi32(0x3040)),
+                                           _mm256_cmpeq_epi32(characters, _mm256_set1_epi32(0xFF1F)));
+        grid = _mm256_andnot_si256(excluded, grid);
+        if (_mm256_movemask_ps(_mm256_castsi256_ps(grid)) != 0xFF) {
+            break;
+        }
+        kana = _mm256_or_si256(kana, inRangeAvx2(characters, 0x3041, 0xFF01 - 0x3041));
+    }
+    japanese = !_mm256_testz_si256(kana, kana);
+    return i;
+}
+
+#endif // JAPANESE_TYPESETTING_X86_SIMD
+
+// 先頭から升目に置く文字が続く長さを求める（かなか漢字を含む場合はjapaneseをtrueにする）
+size_t scanGridCharacters(const char32_t* text, size_t length, bool& japanese) {
+    size_t i = 0;
+    japanese = false;
+#ifdef JAPANESE_TYPESETTING_X86_SIMD
+    if (getSimdLevel() == SimdLevel::AVX2) {
+        i = scanGridAvx2(text, length, japanese);
+    }
+#endif
+    for (; i < length && isGridCharacter(text[i]); ++i) {
+        japanese |= isKanaOrKanji(text[i]);
+    }
+    return i;
+}
+
+// 全角で正立するランの文字は1字分の升目に置く
+inline bool isGridRun(const TextRun& run) {
+    return run.widthClass == WidthClass::Full && run.orientation == GlyphOrientation::Upright;
+}
+
+// 直前のランとつなげられる場合はつなげる（itemizeTextと同じ条件）
+void appendRun(std::pmr::vector<TextRun>& runs, const TextRun& run) {
+    if (!runs.empty()) {
+        TextRun& last = runs.back();
+        if (last.end() == run.start && last.hasSameLayout(run) && last.orientation != GlyphOrientation::TateChuYoko &&
+            (last.script == run.script || last.script == Script::Common || run.script == Script::Common)) {
+            if (last.script == Script::Common) {
+                last.script = run.script;
+            }
+            last.length += run.length;
+            return;
+        }
+    }
+    runs.push_back(run);
+}
+
+// かな・漢字・全角の記号が続く範囲は1文字ずつ分類せずに1つのランとし、それ以外の範囲だけを分類する
+void itemizeGrid(const char32_t* text, size_t length, bool vertical, const font::FontFace* font,
+                 std::pmr::vector<TextRun>& runs) {
+    std::pmr::vector<TextRun> pieces(runs.get_allocator());
+    size_t i = 0;
+    while (i < length) {
+        size_t end = i;
+        if (isGridCharacter(text[i])) {
+            bool japanese = false;
+            bool hasGlyph = false;
+            if (font) {
+                // グリフの有無が変わる位置でもランを分ける
+                hasGlyph = font->hasGlyph(text[i]);
+                while (end < length && isGridCharacter(text[end]) && font->hasGlyph(text[end]) == hasGlyph) {
+                    japanese |= isKanaOrKanji(text[end]);
+                    ++end;
+                }
+            } else {
+                end += scanGridCharacters(text + i, length - i, japanese);
+            }
+            TextRun run;
+            run.start = static_cast<uint32_t>(i);
+            run.length = static_cast<uint32_t>(end - i);
+            run.script = japanese ? Script::Japanese : Script::Common;
+            run.fallback = !hasGlyph;
+            appendRun(runs, run);
+        } else {
+            while (end < length && !isGridCharacter(text[end])) {
+                ++end;
+            }
+            pieces.clear();
+            itemizeText(text + i, end - i, vertical, font, pieces);
+            for (TextRun piece : pieces) {
+                piece.start += static_cast<uint32_t>(i);
+                appendRun(runs, piece);
+            }
+        }
+        i = end;
+    }
+}
+
+} // namespace
+
+TypesetStatus layoutGridLines(WritingMode mode, const std::pmr::u32string& text, const GlyphAdvanceTable& advances,
+                              const TypesettingRules& rules, LayoutUnit maxUnits, LineLayout& layout,
+                              const CancellationToken* cancellation) {
+    const size_t length = text.length();
+    std::pmr::vector<TextRun>& runs = layout.runs;
+    itemizeGrid(text.data(), length, mode == WritingMode::Vertical, advances.getFont().get(), runs);
+    annotateRuns(runs, layout.annotations);
+
+    // 升目の大きさと1行の字数（以降の行分割は字数の整数演算で行う）
+    const LayoutUnit em = std::max<LayoutUnit>(1, toLayoutUnit(advances.getKey().fontSize));
+    const size_t cellsPerLine = static_cast<size_t>(std::max<LayoutUnit>(1, maxUnits / em));
+    auto ceilCells = [em](LayoutUnit units) { return static_cast<size_t>((units + em - 1) / em); };
+
+    // フォントの送り幅が1字分と異なる全角の文字は、差を送り幅の増減で埋めて升目にそろえる
+    // （推定幅では全角の文字は常に1字分のため、増減が必要になるまで配列を確保しない）
+    std::pmr::vector<LayoutUnit>& deltas = layout.advanceDeltas;
+    deltas.clear();
+    if (advances.getFont()) {
+        deltas.assign(length, 0);
+        for (const auto& run : runs) {
+            if (isGridRun(run)) {
+                for (size_t i = run.start; i < run.end(); ++i) {
+                    deltas[i] = em - advances.getAdvanceUnits(text[i]);
+                }
+            }
+        }
+    }
+
+    // 行数は字数からおおよそ決まるため、先に確保しておく
+    layout.lines.reserve(length / cellsPerLine + 1);
+    size_t lineStart = 0;
+    size_t cursor = 0;
+    while (lineStart < length) {
+        size_t pos = lineStart;
+        size_t cells = 0;
+        bool lineBreak = false;
+        bool full = false;
+        while (pos < length && !lineBreak && !full) {
+            while (runs[cursor].end() <= pos) {
+                ++cursor;
+            }
+            const TextRun& run = runs[cursor];
+            if (isGridRun(run) || run.orientation == GlyphOrientation::TateChuYoko) {
+                if (cells == cellsPerLine) {
+                    full = true;
+                } else if (run.orientation == GlyphOrientation::TateChuYoko) {
+                    // 縦中横は1字分の升目に置く
+                    cells++;
+                    pos = run.end();
+                } else {
+                    // 升目に置く文字は残りの字数だけまとめて進める
+                    size_t count = std::min<size_t>(cellsPerLine - cells, run.end() - pos);
+                    cells += count;
+                    pos += count;
+                }
+                continue;
+            }
+
+            // 半角・横倒しの文字はプロポーショナルに組み、行内で占める幅を升目の整数倍に切り上げる
+            const size_t base = cells;
+            LayoutUnit segment = 0;
+            size_t end = pos;
+            while (end < run.end()) {
+                if (text[end] == U'\n') {
+                    lineBreak = true;
+                    break;
+                }
+                LayoutUnit width = advances.getAdvanceUnits(text[end]);
+                if (base + ceilCells(segment + width) > cellsPerLine && end > lineStart) {
+                    full = true;
+                    break;
+                }
+                segment += width;
+                ++end;
+            }
+            if (end > pos) {
+                cells = base + ceilCells(segment);
+                LayoutUnit padding = static_cast<LayoutUnit>(cells - base) * em - segment;
+                if (padding != 0) {
+                    if (deltas.empty()) {
+                        deltas.assign(length, 0);
+                    }
+                    deltas[end - 1] += padding;
+                }
+            }
+            pos = end;
+        }
+
+        // 禁則は升目に置く文字どうしの境界でのみ行う（プロポーショナルな範囲の途中では行わない）
+        bool hanging = false;
+        if (full && pos > lineStart && isGridCharacter(text[pos]) && isGridCharacter(text[pos - 1])) {
+            if (rules.isLineStartProhibited(text[pos])) {
+                if (rules.isHangingCharacter(text[pos])) {
+                    // 升目の外にぶら下げる
+                    hanging = true;
+                    ++pos;
+                } else if (pos - 1 > lineStart) {
+                    // 行末の1字を次の行に追い出す
+                    --pos;
+                    --cells;
+                }
+            }
+            if (!hanging && pos - 1 > lineStart && isGridCharacter(text[pos - 1]) &&
+                rules.isLineEndProhibited(text[pos - 1])) {
+                --pos;
+                --cells;
+            }
+            // ぶら下げた文字の直後の改行はその行の改行とする
+            lineBreak = hanging && pos < length && text[pos] == U'\n';
+        }
+
+        // ぶら下げた文字は一般の行組みと同じく半分だけ行の幅に含める
+        LineRange line{lineStart, pos - lineStart, static_cast<LayoutUnit>(cells) * em, lineBreak};
+        if (hanging) {
+            line.width += em - em / 2;
+        }
+        layout.lines.push_back(line);
+        if (cancellation) {
+            TypesetStatus status = cancellation->check();
+            if (status != TypesetStatus::Completed) {
+                return status;
+            }
+        }
+
+        lineStart = lineBreak ? pos + 1 : pos;
+        while (cursor > 0 && runs[cursor].start > lineStart) {
+            --cursor;
+        }
+    }
+    return TypesetStatus::Completed;
+}
+
+} // namespace typesetting
+} // namespace core
+} // namespace japanese_typesetting
@@ -0,0 +1,200 @@
+/**
+ * @file itemizer.cpp
+ * @brief 段落を文字種・向き・字幅・フォントが一様なランに分割する処理の実装
+ */
+
+#include "japanese_typesetting/core/typesetting/itemizer.h"
+#include <unicode/uchar.h>
+#include <unicode/uscript.h>
+
+namespace japanese_typesetting {
+namespace core {
+namespace typesetting {
+
+namespace {
+
+bool isAsciiAlphanumeric(char32_t character) {
+    return (character >= U'0' && character <= U'9') || (character >= U'A' && character <= U'Z') ||
+           (character >= U'a' && character <= U'z');
+}
+
+bool isAsciiGraphic(char32_t character) {
+    return character > 0x20 && character < 0x7F;
+}
+
+bool isExclamationOrQuestion(char32_t character) {
+    return character == U'!' || character == U'?' || character == U'！' || character == U'？';
+}
+
+// 位置iから始まる縦中横の文字数（縦中横にしない場合は0）
+size_t matchTateChuYoko(const char32_t* text, size_t length, size_t i) {
+    // 短い半角英数字（「3.14」や長い単語の一部を切り出さないよう、前後の半角記号も見る）
+    if (isAsciiAlphanumeric(text[i])) {
+        if (i > 0 && isAsciiGraphic(text[i - 1])) {
+            return 0;
+        }
+        size_t end = i + 1;
+        while (end < length && isAsciiAlphanumeric(text[end])) {
+            ++end;
+        }
+        if (end - i > kMaxTateChuYokoCharacters || (end < length && isAsciiGraphic(text[end]))) {
+            return 0;
+        }
+        return end - i;
+    }
+
+    // 感嘆符・疑問符の2文字の組み合わせ
+    if (isExclamationOrQuestion(text[i])) {
+        if (i > 0 && isExclamationOrQuestion(text[i - 1])) {
+            return 0;
+        }
+        size_t end = i + 1;
+        while (end < length && isExclamationOrQuestion(text[end])) {
+            ++end;
+        }
+        return end - i == 2 ? 2 : 0;
+    }
+    return 0;
+}
+
+// ICUのプロパティで分類する（表で判定できない文字用）
+CharacterProperties classifyWithIcu(char32_t character, bool vertical) {
+    CharacterProperties properties;
+
+    UErrorCode status = U_ZERO_ERROR;
+    UScriptCode script = uscript_getScript(static_cast<UChar32>(character), &status);
+    if (U_FAILURE(status) || script == USCRIPT_COMMON || script == USCRIPT_INHERITED) {
+        properties.script = Script::Common;
+    } else if (script == USCRIPT_HAN || script == USCRIPT_HIRAGANA || script == USCRIPT_KATAKANA) {
+        properties.script = Script::Japanese;
+    } else if (script == USCRIPT_LATIN) {
+        properties.script = Script::Latin;
+    } else {
+        properties.script = Script::Other;
+    }
+
+    // 東アジアの曖昧な幅の文字は日本語の文脈では全角として扱う
+    int width = u_getIntPropertyValue(static_cast<UChar32>(character), UCHAR_EAST_ASIAN_WIDTH);
+    properties.widthClass = (width == U_EA_WIDE || width == U_EA_FULLWIDTH || width == U_EA_AMBIGUOUS)
+        ? WidthClass::Full : WidthClass::Half;
+
+    // 回転（R）と縦書き用字形がなければ回転（Tr）のうち、Trは縦書き用字形で正立させる
+    properties.orientation = GlyphOrientation::Upright;
+    if (vertical &&
+        u_getIntPropertyValue(static_cast<UChar32>(character), UCHAR_VERTICAL_ORIENTATION) == U_VO_ROTATED) {
+        properties.orientation = GlyphOrientation::Sideways;
+    }
+    return properties;
+}
+
+// 表で判定できる文字を分類する（判定できない場合はfalse）
+inline bool classifyByTable(char32_t character, bool vertical, CharacterProperties& properties) {
+    // ASCII（縦書きではすべて横倒し）
+    if (character < 0x80) {
+        bool letter = (character >= U'A' && character <= U'Z') || (character >= U'a' && character <= U'z');
+        properties.script = letter ? Script::Latin : Script::Common;
+        properties.orientation = vertical ? GlyphOrientation::Sideways : GlyphOrientation::Upright;
+        properties.widthClass = WidthClass::Half;
+        return true;
+    }
+    properties.orientation = GlyphOrientation::Upright;
+    properties.widthClass = WidthClass::Full;
+    // ひらがな・カタカナ（長音記号などの共通文字も含めて日本語とする）、CJK統合漢字と拡張A
+    if ((character >= 0x3041 && character <= 0x30FF) ||
+        (character >= 0x4E00 && character <= 0x9FFF) || (character >= 0x3400 && character <= 0x4DBF)) {
+        properties.script = Script::Japanese;
+        return true;
+    }
+    // CJKの記号と句読点、全角形（全角英数字も縦書きでは正立）
+    if ((character >= 0x3000 && character <= 0x303F) || (character >= 0xFF01 && character <= 0xFF60)) {
+        properties.script = Script::Common;
+        return true;
+    }
+    // 半角カタカナ（縦書きでも正立）
+    if (character >= 0xFF61 && character <= 0xFF9F) {
+        properties.script = Script::Japanese;
+        properties.widthClass = WidthClass::Half;
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+CharacterProperties classifyCharacter(char32_t character, bool vertical) {
+    CharacterProperties properties;
+    if (!classifyByTable(character, vertical, properties)) {
+        properties = classifyWithIcu(character, vertical);
+    }
+    return properties;
+}
+
+void itemizeText(const char32_t* text, size_t length, bool vertical, const font::FontFace* font,
+                 std::pmr::vector<TextRun>& runs) {
+    // 作成中のランはローカルに持ち、属性が変わったときだけ格納する
+    TextRun current;
+    bool open = false;
+    size_t i = 0;
+    while (i < length) {
+        // 縦書きの短い半角英数字と感嘆符・疑問符の組み合わせは縦中横
+        size_t combined = vertical ? matchTateChuYoko(text, length, i) : 0;
+        if (combined > 0) {
+            if (open) {
+                runs.push_back(current);
+                open = false;
+            }
+            TextRun run;
+            run.start = static_cast<uint32_t>(i);
+            run.length = static_cast<uint32_t>(combined);
+            run.script = Script::Common;
+            run.orientation = GlyphOrientation::TateChuYoko;
+            run.widthClass = WidthClass::Half;
+            run.fallback = font == nullptr;
+            for (size_t k = i; k < i + combined && !run.fallback; ++k) {
+                run.fallback = !font->hasGlyph(text[k]);
+            }
+            // 縦中横は1字として扱うため、前後のランとはつなげない
+            runs.push_back(run);
+            i += combined;
+            continue;
+        }
+
+        CharacterProperties properties;
+        if (!classifyByTable(text[i], vertical, properties)) {
+            properties = classifyWithIcu(text[i], vertical);
+        }
+        const bool fallback = font == nullptr || !font->hasGlyph(text[i]);
+
+        // 用字以外の属性が同じで、用字が同じか一方が共通文字の場合は作成中のランを延ばす
+        if (open && current.orientation == properties.orientation && current.widthClass == properties.widthClass &&
+            current.fallback == fallback &&
+            (current.script == properties.script || properties.script == Script::Common ||
+             current.script == Script::Common)) {
+            if (current.script == Script::Common) {
+                current.script = properties.script;
+            }
+            current.length++;
+            ++i;
+            continue;
+        }
+
+        if (open) {
+            runs.push_back(current);
+        }
+        current.start = static_cast<uint32_t>(i);
+        current.length = 1;
+        current.script = properties.script;
+        current.orientation = properties.orientation;
+        current.widthClass = properties.widthClass;
+        current.fallback = fallback;
+        open = true;
+        ++i;
+    }
+    if (open) {
+        runs.push_back(current);
+    }
+}
+
+} // namespace typesetting
+} // namespace core
+} // namespace japanese_typesetting
@@ -0,0 +1,80 @@
+/**
+ * @file layout_arena.cpp
+ * @brief 組版処理の中間データ用アリーナアロケータの実装
+ */
+
+#include "japanese_typesetting/core/typesetting/layout_arena.h"
+#include <algorithm>
+
+namespace japanese_typesetting {
+namespace core {
+namespace typesetting {
+
+// 保持バッファの上限（巨大な段落の後にメモリを抱え込まないようにする）
+static const size_t kMaxRetainedSize = 4 * 1024 * 1024;
+
+LayoutArena::LayoutArena(std::pmr::memory_resource* upstream, size_t initialSize)
+    : m_upstream(upstream ? upstream : std::pmr::get_default_resource())
+    , m_buffer(new std::byte[initialSize])
+    , m_bufferSize(initialSize) {
+    m_resource.emplace(m_buffer.get(), m_bufferSize, m_upstream);
+}
+
+LayoutArena::~LayoutArena() {
+    // バッファより先にリソースを破棄する
+    m_resource.reset();
+}
+
+void LayoutArena::reset() {
+    m_resource.reset();
+
+    // 前回の使用量が保持バッファを超えていた場合は拡張する
+    if (m_stats.bytesAllocated > m_bufferSize && m_bufferSize < kMaxRetainedSize) {
+        size_t newSize = m_bufferSize;
+        while (newSize < m_stats.bytesAllocated && newSize < kMaxRetainedSize) {
+            newSize *= 2;
+        }
+        newSize = std::min(newSize, kMaxRetainedSize);
+        m_buffer.reset(new std::byte[newSize]);
+        m_bufferSize = newSize;
+    }
+
+    m_resource.emplace(m_buffer.get(), m_bufferSize, m_upstream);
+    m_stats = AllocationStats();
+}
+
+void LayoutArena::setUpstream(std::pmr::memory_resource* upstream) {
+    m_upstream = upstream ? upstream : std::pmr::get_default_resource();
+    reset();
+}
+
+std::pmr::memory_resource* LayoutArena::getUpstream() const {
+    return m_upstream;
+}
+
+AllocationStats LayoutArena::getStats() const {
+    return m_stats;
+}
+
+size_t LayoutArena::getRetainedSize() const {
+    return m_bufferSize;
+}
+
+void* LayoutArena::do_allocate(size_t bytes, size_t alignment) {
+    m_stats.bytesAllocated += bytes;
+    m_stats.allocationCount++;
+    return m_resource->allocate(bytes, alignment);
+}
+
+void LayoutArena::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    // 単調増加リソースのため個別解放は行わない（reset()で一括解放）
+    m_resource->deallocate(p, bytes, alignment);
+}
+
+bool LayoutArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+} // namespace typesetting
+} // namespace core
+} // namespace japanese_typesetting
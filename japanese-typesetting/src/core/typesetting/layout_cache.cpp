@@ -0,0 +1,179 @@
+/**
+ * @file layout_cache.cpp
+ * @brief 組版結果のキャッシュの実装
+ */
+
+#include "japanese_typesetting/core/typesetting/layout_cache.h"
+
+namespace japanese_typesetting {
+namespace core {
+namespace typesetting {
+
+namespace {
+
+const uint64_t kFnvOffsetBasis = 14695981039346656037ULL;
+const uint64_t kFnvPrime = 1099511628211ULL;
+
+void mixBytes(uint64_t& hash, const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= kFnvPrime;
+    }
+}
+
+template <typename T>
+void mixValue(uint64_t& hash, const T& value) {
+    mixBytes(hash, &value, sizeof(value));
+}
+
+} // namespace
+
+// LayoutCacheKey の実装
+
+bool LayoutCacheKey::operator==(const LayoutCacheKey& other) const {
+    // ハッシュ値で先に除外し、一致した場合のみ内容を比較する
+    if (textHash != other.textHash || styleHash != other.styleHash || rulesHash != other.rulesHash ||
+        width != other.width || vertical != other.vertical || glyphRuns != other.glyphRuns) {
+        return false;
+    }
+    if (text != other.text || !style::StyleInterner::equalLayoutFields(style, other.style)) {
+        return false;
+    }
+    if (rules == other.rules) {
+        return true;
+    }
+    return rules && other.rules && *rules == *other.rules;
+}
+
+LayoutCacheKey LayoutCacheKey::create(const std::string& text, const style::Style& style,
+                                      std::shared_ptr<const TypesettingRules> rules, double width, bool vertical) {
+    LayoutCacheKey key;
+    key.textHash = LayoutCache::hashText(text);
+    key.text = text;
+    key.styleHash = LayoutCache::hashStyle(style);
+    key.style = style;
+    key.rulesHash = rules ? rules->getFingerprint() : 0;
+    key.rules = std::move(rules);
+    key.width = width;
+    key.vertical = vertical;
+    return key;
+}
+
+LayoutCacheKey LayoutCacheKey::create(const std::string& text, const style::StyleHandle& style,
+                                      std::shared_ptr<const TypesettingRules> rules, double width, bool vertical) {
+    LayoutCacheKey key;
+    key.textHash = LayoutCache::hashText(text);
+    key.text = text;
+    key.styleHash = style.getLayoutHash();
+    key.style = style.get();
+    key.rulesHash = rules ? rules->getFingerprint() : 0;
+    key.rules = std::move(rules);
+    key.width = width;
+    key.vertical = vertical;
+    return key;
+}
+
+size_t LayoutCacheKeyHash::operator()(const LayoutCacheKey& key) const {
+    uint64_t hash = key.textHash;
+    mixValue(hash, key.styleHash);
+    mixValue(hash, key.rulesHash);
+    mixValue(hash, key.width);
+    hash ^= key.vertical ? 1 : 0;
+    hash ^= key.glyphRuns ? 2 : 0;
+    return static_cast<size_t>(hash);
+}
+
+// LayoutCache の実装
+
+LayoutCache& LayoutCache::getInstance() {
+    static LayoutCache instance;
+    return instance;
+}
+
+LayoutCache::LayoutCache(size_t capacity)
+    : m_capacity(capacity) {
+}
+
+LayoutCache::~LayoutCache() {
+    // 特に何もしない
+}
+
+std::shared_ptr<const TextBlock> LayoutCache::find(const LayoutCacheKey& key) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_index.find(key);
+    if (it == m_index.end()) {
+        m_stats.misses++;
+        return nullptr;
+    }
+
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    m_stats.hits++;
+    return it->second->second;
+}
+
+void LayoutCache::store(const LayoutCacheKey& key, const TextBlock& block) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_capacity == 0) {
+        return;
+    }
+
+    std::shared_ptr<const TextBlock> value = std::make_shared<TextBlock>(block);
+    auto it = m_index.find(key);
+    if (it != m_index.end()) {
+        it->second->second = value;
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        return;
+    }
+
+    m_entries.emplace_front(key, value);
+    m_index.emplace(key, m_entries.begin());
+    evictLocked();
+}
+
+void LayoutCache::setCapacity(size_t capacity) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_capacity = capacity;
+    evictLocked();
+}
+
+size_t LayoutCache::getCapacity() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_capacity;
+}
+
+void LayoutCache::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_index.clear();
+    m_entries.clear();
+}
+
+LayoutCacheStats LayoutCache::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    LayoutCacheStats stats = m_stats;
+    stats.entries = m_entries.size();
+    return stats;
+}
+
+uint64_t LayoutCache::hashStyle(const style::Style& style) {
+    // 共有スタイルと同じハッシュ値にする
+    return style::StyleInterner::hashLayoutFields(style);
+}
+
+uint64_t LayoutCache::hashText(const std::string& text) {
+    uint64_t hash = kFnvOffsetBasis;
+    mixBytes(hash, text.data(), text.size());
+    return hash;
+}
+
+void LayoutCache::evictLocked() {
+    while (m_entries.size() > m_capacity) {
+        m_index.erase(m_entries.back().first);
+        m_entries.pop_back();
+        m_stats.evictions++;
+    }
+}
+
+} // namespace typesetting
+} // namespace core
+} // namespace japanese_typesetting
@@ -0,0 +1,400 @@
+/**
+ * @file layout_kernels.cpp
+ * @brief 書字方向と両端揃えかどうかで特殊化された行組みカーネルの実装
+ */
+
+#include "japanese_typesetting/core/typesetting/layout_kernels.h"
+#include "japanese_typesetting/core/font/shaped_run_cache.h"
+#include "japanese_typesetting/core/typesetting/line_adjustment.h"
+#include "japanese_typesetting/core/typesetting/width_kernels.h"
+#include <algorithm>
+
+namespace japanese_typesetting {
+namespace core {
+namespace typesetting {
+
+namespace {
+
+// 中断要求を確認する（トークンがない場合は常に続ける）
+inline TypesetStatus checkCancellation(const CancellationToken* cancellation) {
+    return cancellation ? cancellation->check() : TypesetStatus::Completed;
+}
+
+// 行を確定し、中断要求を確認する
+inline TypesetStatus pushLine(std::pmr::vector<LineRange>& lines, const LineRange& line,
+                              const CancellationToken* cancellation) {
+    lines.push_back(line);
+    return checkCancellation(cancellation);
+}
+
+// 行分割（送り幅は展開済み、noBreakBeforeが1の文字の前では改行しない）
+TypesetStatus breakLines(const std::pmr::u32string& text, const LayoutUnit* widths, const uint8_t* noBreakBefore,
+                         LayoutUnit maxUnits, std::pmr::vector<LineRange>& lines, const CancellationToken* cancellation) {
+    LineRange currentLine{0, 0, 0, false};
+    
+    for (size_t i = 0; i < text.length(); ++i) {
+        // 改行文字の処理（改行文字自体は行に含めない）
+        if (text[i] == U'\n') {
+            currentLine.hasLineBreak = true;
+            TypesetStatus status = pushLine(lines, currentLine, cancellation);
+            if (status != TypesetStatus::Completed) {
+                return status;
+            }
+            currentLine = LineRange{i + 1, 0, 0, false};
+            continue;
+        }
+        
+        // 行の最大幅を超える場合は改行
+        LayoutUnit charWidth = widths[i];
+        if (currentLine.width + charWidth > maxUnits && currentLine.length > 0) {
+            // 分割できない親文字の途中であれば、その先頭まで戻って改行する
+            // （親文字だけで行が埋まる場合はそのまま分割する）
+            size_t breakAt = i;
+            if (noBreakBefore) {
+                while (breakAt > currentLine.start && noBreakBefore[breakAt]) {
+                    --breakAt;
+                }
+                if (breakAt == currentLine.start) {
+                    breakAt = i;
+                }
+            }
+            LayoutUnit carried = 0;
+            for (size_t j = breakAt; j < i; ++j) {
+                carried += widths[j];
+            }
+            
+            LineRange line = currentLine;
+            line.length = breakAt - line.start;
+            line.width -= carried;
+            TypesetStatus status = pushLine(lines, line, cancellation);
+            if (status != TypesetStatus::Completed) {
+                return status;
+            }
+            currentLine = LineRange{breakAt, i - breakAt, carried, false};
+        }
+        
+        currentLine.length++;
+        currentLine.width += charWidth;
+    }
+    
+    // 最後の行を追加
+    if (currentLine.length > 0) {
+        lines.push_back(currentLine);
+    }
+    return TypesetStatus::Completed;
+}
+
+// 禁則処理（隣接行の境界を1文字ずつ動かす）
+void applyProhibitionRules(const std::pmr::u32string& text, std::pmr::vector<LineRange>& lines,
+                           const LayoutUnit* widths, const uint8_t* noBreakBefore, const TypesettingRules& rules) {
+    for (size_t i = 0; i + 1 < lines.size(); ++i) {
+        LineRange& currentLine = lines[i];
+        LineRange& nextLine = lines[i + 1];
+        
+        // 明示的な改行がある場合や、次の行が空の場合はスキップ
+        if (currentLine.hasLineBreak || nextLine.length == 0) {
+            continue;
+        }
+        
+        // 行末禁則文字は次の行の先頭に移動（分割できない親文字は分けない）
+        if (currentLine.length > 0) {
+            size_t last = currentLine.start + currentLine.length - 1;
+            if (rules.isLineEndProhibited(text[last]) && !(noBreakBefore && noBreakBefore[last])) {
+                currentLine.length--;
+                currentLine.width -= widths[last];
+                nextLine.start--;
+                nextLine.length++;
+                nextLine.width += widths[last];
+            }
+        }
+        
+        // 行頭禁則文字は前の行の末尾に移動（縦中横の2文字目など、幅のない後続の文字も一緒に移す）
+        if (nextLine.length > 0) {
+            size_t first = nextLine.start;
+            if (rules.isLineStartProhibited(text[first])) {
+                size_t count = 1;
+                while (count < nextLine.length && widths[first + count] == 0) {
+                    count++;
+                }
+                if (noBreakBefore && count < nextLine.length && noBreakBefore[first + count]) {
+                    continue;
+                }
+                nextLine.start += count;
+                nextLine.length -= count;
+                nextLine.width -= widths[first];
+                currentLine.length += count;
+                currentLine.width += widths[first];
+            }
+        }
+    }
+}
+
+// 行頭・行末に来た親文字のルビが行外に出ないよう、前後のアキと掛かりを行内に移す
+void fitRubiesToLines(std::pmr::vector<LineRange>& lines, const std::pmr::vector<RubySpan>& spans,
+                      std::pmr::vector<RubyPlacement>& placements, LayoutUnit* widths, LayoutUnit* spacing) {
+    auto addSpacing = [&](size_t index, LayoutUnit amount) {
+        widths[index] += amount;
+        spacing[index] += amount;
+    };
+    
+    size_t cursor = 0;
+    for (size_t index = 0; index < lines.size(); ++index) {
+        LineRange& line = lines[index];
+        const size_t lineEnd = line.start + line.length;
+        for (; cursor < spans.size() && spans[cursor].baseStart < lineEnd; ++cursor) {
+            const RubySpan& span = spans[cursor];
+            RubyPlacement& placement = placements[cursor];
+            if (span.baseStart < line.start) {
+                continue;
+            }
+            const size_t last = std::min<size_t>(span.baseEnd(), lineEnd) - 1;
+            
+            // 行頭では親文字を行頭にそろえ、前のアキと掛かりを親文字の後ろに移す
+            // （前のアキは直前の文字、つまり前の行の行末に入っている）
+            if (span.baseStart == line.start && index > 0) {
+                if (placement.leading > 0) {
+                    addSpacing(span.baseStart - 1, -placement.leading);
+                    lines[index - 1].width -= placement.leading;
+                }
+                const LayoutUnit moved = placement.leading + placement.overhangBefore;
+                addSpacing(last, moved);
+                line.width += moved;
+                placement.leading = 0;
+                placement.overhangBefore = 0;
+            }
+            
+            // 行末では次の行の文字に掛けず、その分を親文字の前に空ける
+            if (span.baseEnd() == lineEnd && placement.overhangAfter > 0) {
+                if (span.baseStart > line.start) {
+                    addSpacing(span.baseStart - 1, placement.overhangAfter);
+                    placement.leading += placement.overhangAfter;
+                } else {
+                    addSpacing(last, placement.overhangAfter);
+                }
+                line.width += placement.overhangAfter;
+                placement.overhangAfter = 0;
+            }
+        }
+    }
+}
+
+// シェーピング結果で行の幅を更新（フォントがある場合のみ、行とランが重なる区間ごと）
+// （シェーピングするランごとに中断要求を確認する）
+template <WritingMode Mode>
+TypesetStatus applyShaping(const std::pmr::u32string& text, std::pmr::vector<LineRange>& lines,
+                           const std::pmr::vector<TextRun>& runs, const LayoutUnit* widths, const LayoutUnit* spacing,
+                           const GlyphAdvanceTable& advances, const CancellationToken* cancellation) {
+    const std::shared_ptr<const font::FontFace> face = advances.getFont();
+    if (!face) {
+        return TypesetStatus::Completed;
+    }
+    
+    const double fontSize = advances.getKey().fontSize;
+    TypesetStatus status = TypesetStatus::Completed;
+    size_t cursor = 0;
+    for (auto& line : lines) {
+        if (line.length == 0) {
+            continue;
+        }
+        
+        LayoutUnit total = 0;
+        forEachRunSegment(runs, cursor, line.start, line.start + line.length,
+                          [&](const TextRun& run, size_t start, size_t end) {
+            if (status != TypesetStatus::Completed) {
+                return;
+            }
+            // グリフのあるランは縦書きの正立・横倒しに応じてシェーピングする
+            // （縦中横は字形によらず1字分の幅）
+            if (!run.fallback && run.orientation != GlyphOrientation::TateChuYoko) {
+                status = checkCancellation(cancellation);
+                if (status != TypesetStatus::Completed) {
+                    return;
+                }
+                const bool upright = Mode == WritingMode::Vertical && run.orientation == GlyphOrientation::Upright;
+                std::shared_ptr<const font::ShapedRun> shaped = font::ShapedRunCache::getInstance().shape(
+                    *face, text.data() + start, end - start, fontSize, upright, font::defaultShapingFeatures(upright));
+                if (shaped->missingGlyphs == 0) {
+                    // グリフごとに丸めてから合計し、結果を順序に依存させない
+                    for (double advance : shaped->advances) {
+                        total += toLayoutUnit(advance);
+                    }
+                    // ルビのためのアキは字形によらない
+                    if (spacing) {
+                        for (size_t i = start; i < end; ++i) {
+                            total += spacing[i];
+                        }
+                    }
+                    return;
+                }
+            }
+            
+            // グリフがないランと縦中横はテーブルの幅のままとする
+            for (size_t i = start; i < end; ++i) {
+                total += widths[i];
+            }
+        });
+        if (status != TypesetStatus::Completed) {
+            return status;
+        }
+        line.width = total;
+    }
+    return TypesetStatus::Completed;
+}
+
+// ぶら下げと行の伸縮（どちらも行ごとに独立なので1回の走査で行い、行ごとに中断要求を確認する）
+template <bool Justify>
+TypesetStatus finishLines(const std::pmr::u32string& text, std::pmr::vector<LineRange>& lines, const LayoutUnit* widths,
+                          const TypesettingRules& rules, LayoutUnit maxUnits, LayoutUnit* advanceDeltas,
+                          const CancellationToken* cancellation) {
+    LineAdjuster adjuster(lines.get_allocator().resource());
+    for (size_t index = 0; index < lines.size(); ++index) {
+        LineRange& line = lines[index];
+        if (line.length == 0) {
+            continue;
+        }
+        TypesetStatus status = checkCancellation(cancellation);
+        if (status != TypesetStatus::Completed) {
+            return status;
+        }
+        
+        // 行末のぶら下げ対象文字は半分だけ行外に出し、伸縮の対象から外す
+        size_t last = line.start + line.length - 1;
+        size_t adjustable = line.length;
+        if (rules.isHangingCharacter(text[last])) {
+            line.width -= widths[last] / 2;
+            adjustable--;
+        }
+        
+        // 両端揃えでは段落末と明示的な改行の前の行を除いて最大幅まで広げる
+        bool stretch = false;
+        if constexpr (Justify) {
+            stretch = !line.hasLineBreak && index + 1 < lines.size();
+        }
+        if (line.width > maxUnits || (stretch && line.width < maxUnits)) {
+            line.width = adjuster.adjust(text.data() + line.start, widths + line.start, adjustable, line.width,
+                                         maxUnits, stretch, rules, advanceDeltas + line.start);
+        }
+    }
+    return TypesetStatus::Completed;
+}
+
+} // namespace
+
+template <WritingMode Mode, bool Justify>
+TypesetStatus layoutLineRanges(const std::pmr::u32string& text, const GlyphAdvanceTable& advances,
+                               const TypesettingRules& rules, LayoutUnit maxUnits,
+                               LineLayout& layout, const CancellationToken* cancellation) {
+    std::pmr::vector<LineRange>& lines = layout.lines;
+    
+    // 長い段落でも期限を守れるよう、各段階の間で中断要求を確認する
+    TypesetStatus status = checkCancellation(cancellation);
+    if (status != TypesetStatus::Completed) {
+        return status;
+    }
+    
+    // ランへの分割と送り幅の展開は段落ごとに1回だけ行う
+    itemizeText(text.data(), text.length(), Mode == WritingMode::Vertical, advances.getFont().get(), layout.runs);
+    annotateRuns(layout.runs, layout.annotations);
+    std::pmr::vector<LayoutUnit> widths(text.length(), lines.get_allocator());
+    gatherAdvances(advances, text.data(), text.length(), widths.data());
+    status = checkCancellation(cancellation);
+    if (status != TypesetStatus::Completed) {
+        return status;
+    }
+    if constexpr (Mode == WritingMode::Vertical) {
+        // 縦中横は先頭の文字に1字分の幅を持たせ、残りの文字は幅0とする
+        // （行分割で途中から次の行に送られることがなくなる）
+        const LayoutUnit em = toLayoutUnit(advances.getKey().fontSize);
+        for (const auto& run : layout.runs) {
+            if (run.orientation == GlyphOrientation::TateChuYoko) {
+                widths[run.start] = em;
+                std::fill(widths.begin() + run.start + 1, widths.begin() + run.end(), 0);
+            }
+        }
+    }
+    
+    // ルビの配置を決め、親文字の前後と間に必要なアキを幅に加える
+    const bool hasRubies = !layout.rubies.empty() && layout.ruby.text && layout.ruby.advances;
+    std::pmr::vector<LayoutUnit> spacing(lines.get_allocator());
+    std::pmr::vector<uint8_t> noBreakBefore(lines.get_allocator());
+    std::pmr::vector<RubyPlacement> placements(lines.get_allocator());
+    if (hasRubies) {
+        spacing.assign(text.length(), 0);
+        noBreakBefore.assign(text.length(), 0);
+        placeRubies(text.data(), text.length(), advances, layout.ruby, layout.rubies, placements,
+                    widths.data(), spacing.data(), noBreakBefore.data());
+        status = checkCancellation(cancellation);
+        if (status != TypesetStatus::Completed) {
+            return status;
+        }
+    }
+    
+    status = breakLines(text, widths.data(), hasRubies ? noBreakBefore.data() : nullptr, maxUnits, lines, cancellation);
+    if (status != TypesetStatus::Completed) {
+        return status;
+    }
+    
+    applyProhibitionRules(text, lines, widths.data(), hasRubies ? noBreakBefore.data() : nullptr, rules);
+    if (hasRubies) {
+        fitRubiesToLines(lines, layout.rubies, placements, widths.data(), spacing.data());
+    }
+    status = checkCancellation(cancellation);
+    if (status != TypesetStatus::Completed) {
+        return status;
+    }
+    status = applyShaping<Mode>(text, lines, layout.runs, widths.data(), hasRubies ? spacing.data() : nullptr,
+                                advances, cancellation);
+    if (status != TypesetStatus::Completed) {
+        return status;
+    }
+    
+    // ルビのアキを送り幅の増減の初期値とし、行の伸縮による増減をその上に加える
+    if (hasRubies) {
+        layout.advanceDeltas.assign(spacing.begin(), spacing.end());
+    } else {
+        layout.advanceDeltas.assign(text.length(), 0);
+    }
+    status = finishLines<Justify>(text, lines, widths.data(), rules, maxUnits, layout.advanceDeltas.data(),
+                                  cancellation);
+    if (status != TypesetStatus::Completed) {
+        return status;
+    }
+    
+    // ルビの枠を親文字の先頭の文字からの位置で表す
+    for (size_t k = 0; k < placements.size(); ++k) {
+        layout.rubies[k].rubyOffset = -(placements[k].leading + placements[k].overhangBefore);
+        layout.rubies[k].rubyWidth = placements[k].width;
+    }
+    return TypesetStatus::Completed;
+}
+
+TypesetStatus layoutLineRanges(WritingMode mode, style::TextAlignment alignment,
+                               const std::pmr::u32string& text, const GlyphAdvanceTable& advances,
+                               const TypesettingRules& rules, LayoutUnit maxUnits,
+                               LineLayout& layout, const CancellationToken* cancellation) {
+    // 左・右・中央揃えは行の位置を出力側で決めるため、カーネルが変わるのは両端揃えかどうかだけ
+    const bool justify = alignment == style::TextAlignment::Justify;
+    if (mode == WritingMode::Vertical) {
+        return justify ? layoutLineRanges<WritingMode::Vertical, true>(text, advances, rules, maxUnits, layout, cancellation)
+                       : layoutLineRanges<WritingMode::Vertical, false>(text, advances, rules, maxUnits, layout, cancellation);
+    }
+    return justify ? layoutLineRanges<WritingMode::Horizontal, true>(text, advances, rules, maxUnits, layout, cancellation)
+                   : layoutLineRanges<WritingMode::Horizontal, false>(text, advances, rules, maxUnits, layout, cancellation);
+}
+
+// 書字方向と両端揃えかどうかのすべての組み合わせを実体化する
+#define JAPANESE_TYPESETTING_INSTANTIATE_LAYOUT_KERNEL(mode, justify)                                    \
+    template TypesetStatus layoutLineRanges<WritingMode::mode, justify>(                                  \
+        const std::pmr::u32string&, const GlyphAdvanceTable&, const TypesettingRules&, LayoutUnit,        \
+        LineLayout&, const CancellationToken*);
+
+JAPANESE_TYPESETTING_INSTANTIATE_LAYOUT_KERNEL(Horizontal, false)
+JAPANESE_TYPESETTING_INSTANTIATE_LAYOUT_KERNEL(Horizontal, true)
+JAPANESE_TYPESETTING_INSTANTIATE_LAYOUT_KERNEL(Vertical, false)
+JAPANESE_TYPESETTING_INSTANTIATE_LAYOUT_KERNEL(Vertical, true)
+
+#undef JAPANESE_TYPESETTING_INSTANTIATE_LAYOUT_KERNEL
+
+} // namespace typesetting
+} // namespace core
+} // namespace japanese_typesetting
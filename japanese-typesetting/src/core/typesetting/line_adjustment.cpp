@@ -0,0 +1,185 @@
+/**
+ * @file line_adjustment.cpp
+ * @brief JIS X 4051に基づく行の伸縮（行長の調整）の実装
+ */
+
+#include "japanese_typesetting/core/typesetting/line_adjustment.h"
+#include <algorithm>
+#include <limits>
+
+namespace japanese_typesetting {
+namespace core {
+namespace typesetting {
+
+namespace {
+
+// 上限のない調整箇所（文字間）
+const LayoutUnit kUnlimited = std::numeric_limits<LayoutUnit>::max();
+
+// 文字間を広げてよいかどうか（括弧の内側や句読点・中点の前は広げない）
+bool isStretchableGap(char32_t before, char32_t after, const TypesettingRules& rules) {
+    if (rules.isInseparable(before) && rules.isInseparable(after)) {
+        return false;
+    }
+    PunctuationClass beforeClass = classifyPunctuation(before);
+    PunctuationClass afterClass = classifyPunctuation(after);
+    if (beforeClass == PunctuationClass::Opening) {
+        return false;
+    }
+    return afterClass == PunctuationClass::None || afterClass == PunctuationClass::Opening;
+}
+
+} // namespace
+
+PunctuationClass classifyPunctuation(char32_t character) {
+    switch (character) {
+    case U'「': case U'『': case U'（': case U'〔': case U'［': case U'｛':
+    case U'〈': case U'《': case U'【': case U'〘': case U'〖': case U'〝':
+    case U'‘': case U'“':
+        return PunctuationClass::Opening;
+    case U'」': case U'』': case U'）': case U'〕': case U'］': case U'｝':
+    case U'〉': case U'》': case U'】': case U'〙': case U'〗': case U'〟':
+    case U'’': case U'”':
+        return PunctuationClass::Closing;
+    case U'、': case U'，':
+        return PunctuationClass::Comma;
+    case U'。': case U'．':
+        return PunctuationClass::FullStop;
+    case U'・': case U'：': case U'；':
+        return PunctuationClass::MiddleDot;
+    default:
+        return PunctuationClass::None;
+    }
+}
+
+LineAdjuster::LineAdjuster(std::pmr::memory_resource* resource)
+    : m_positions(resource)
+    , m_limits(resource)
+    , m_assigned(resource) {
+}
+
+LineAdjuster::~LineAdjuster() {
+    // 特に何もしない
+}
+
+void LineAdjuster::addOpportunity(size_t position, LayoutUnit limit) {
+    if (limit <= 0) {
+        return;
+    }
+    m_positions.push_back(static_cast<uint32_t>(position));
+    m_limits.push_back(limit);
+    m_assigned.push_back(0);
+}
+
+LayoutUnit LineAdjuster::distribute(LayoutUnit amount, int direction, LayoutUnit* deltas) {
+    // 上限に達していない調整箇所へ均等に配り、端数は先頭から1単位ずつ配る
+    LayoutUnit remaining = amount;
+    const size_t count = m_positions.size();
+    while (remaining > 0) {
+        size_t open = 0;
+        for (size_t i = 0; i < count; ++i) {
+            open += m_assigned[i] < m_limits[i] ? 1 : 0;
+        }
+        if (open == 0) {
+            break;
+        }
+
+        LayoutUnit share = remaining / static_cast<LayoutUnit>(open);
+        if (share == 0) {
+            for (size_t i = 0; i < count && remaining > 0; ++i) {
+                if (m_assigned[i] < m_limits[i]) {
+                    m_assigned[i]++;
+                    remaining--;
+                }
+            }
+            break;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            LayoutUnit given = std::min(share, m_limits[i] - m_assigned[i]);
+            m_assigned[i] += given;
+            remaining -= given;
+        }
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        deltas[m_positions[i]] += direction * m_assigned[i];
+    }
+    m_positions.clear();
+    m_limits.clear();
+    m_assigned.clear();
+    return amount - remaining;
+}
+
+LayoutUnit LineAdjuster::adjust(const char32_t* text, const LayoutUnit* widths, size_t length, LayoutUnit width,
+                                LayoutUnit target, bool stretch, const TypesettingRules& rules, LayoutUnit* deltas) {
+    if (length == 0) {
+        return width;
+    }
+
+    if (width > target) {
+        // 詰める：まず約物のアキ（句点は詰めない）
+        LayoutUnit excess = width - target;
+        for (size_t i = 0; i < length; ++i) {
+            switch (classifyPunctuation(text[i])) {
+            case PunctuationClass::Opening:
+                // 前側のアキは直前の文字の後ろを詰めて取る
+                if (i > 0) {
+                    addOpportunity(i - 1, widths[i] / 2);
+                }
+                break;
+            case PunctuationClass::Closing:
+            case PunctuationClass::Comma:
+                addOpportunity(i, widths[i] / 2);
+                break;
+            case PunctuationClass::MiddleDot:
+                if (i > 0) {
+                    addOpportunity(i - 1, widths[i] / 4);
+                }
+                addOpportunity(i, widths[i] / 4);
+                break;
+            default:
+                break;
+            }
+        }
+        excess -= distribute(excess, -1, deltas);
+
+        // 次に欧文間のスペース（幅の半分まで）
+        if (excess > 0) {
+            for (size_t i = 0; i < length; ++i) {
+                if (text[i] == U' ') {
+                    addOpportunity(i, widths[i] / 2);
+                }
+            }
+            excess -= distribute(excess, -1, deltas);
+        }
+        return target + excess;
+    }
+
+    if (width < target && stretch) {
+        // 広げる：まず欧文間のスペース（幅の分まで）
+        LayoutUnit shortage = target - width;
+        for (size_t i = 0; i + 1 < length; ++i) {
+            if (text[i] == U' ') {
+                addOpportunity(i, widths[i]);
+            }
+        }
+        shortage -= distribute(shortage, 1, deltas);
+
+        // 次に文字間（上限なし、縦中横の内側など幅のない文字の前は広げない）
+        if (shortage > 0) {
+            for (size_t i = 0; i + 1 < length; ++i) {
+                if (widths[i + 1] != 0 && isStretchableGap(text[i], text[i + 1], rules)) {
+                    addOpportunity(i, kUnlimited);
+                }
+            }
+            shortage -= distribute(shortage, 1, deltas);
+        }
+        return target - shortage;
+    }
+
+    return width;
+}
+
+} // namespace typesetting
+} // namespace core
+} // namespace japanese_typesetting
@@ -4,6 +4,7 @@
  */
 
 #include "japanese_typesetting/core/typesetting/line_break.h"
+#include "japanese_typesetting/core/typesetting/width_kernels.h"
 #include <algorithm>
 #include <limits>
 #include <cmath>
@@ -12,6 +13,13 @@ namespace japanese_typesetting {
 namespace core {
 namespace typesetting {
 
+namespace {
+
+// 最大幅を超える行のペナルティ（分割可能な位置が収まらない場合に限り使う）
+const double kOverfullPenalty = 1.0e6;
+
+} // namespace
+
 LineBreaker::LineBreaker(const TypesettingRules& rules, const unicode::UnicodeHandler& unicodeHandler)
     : m_rules(rules)
     , m_unicodeHandler(unicodeHandler) {
@@ -27,8 +35,11 @@ std::vector<std::u32string> LineBreaker::breakLines(const std::u32string& text,
     // 分割可能な位置を検出
     std::vector<BreakPoint> breakPoints = findBreakPoints(text);
     
+    // 文字送り幅テーブルを取得（組版エンジンと共有される）
+    std::shared_ptr<const GlyphAdvanceTable> advances = GlyphAdvanceCache::getInstance().getTable(style, vertical);
+    
     // 最適な分割位置を計算
-    std::vector<size_t> optimalBreaks = calculateOptimalBreaks(text, breakPoints, style, maxWidth, vertical);
+    std::vector<size_t> optimalBreaks = calculateOptimalBreaks(text, breakPoints, *advances, maxWidth);
     
     // 分割位置に基づいて行を生成
     size_t startPos = 0;
@@ -55,50 +66,9 @@ std::vector<BreakPoint> LineBreaker::findBreakPoints(const std::u32string& text)
     startPoint.mandatory = false;
     breakPoints.push_back(startPoint);
     
-    for (size_t i = 0; i < text.length(); ++i) {
-        char32_t ch = text[i];
-        
-        // 改行文字は強制的な分割点
-        if (ch == U'\n') {
-            BreakPoint bp;
-            bp.position = i + 1; // 改行文字の次の位置
-            bp.penalty = 0.0;    // 最低ペナルティ
-            bp.mandatory = true;
-            breakPoints.push_back(bp);
-            continue;
-        }
-        
-        // 空白文字は分割可能
-        if (ch == U' ' || ch == U'\t') {
-            BreakPoint bp;
-            bp.position = i + 1; // 空白文字の次の位置
-            bp.penalty = 50.0;   // 中程度のペナルティ
-            bp.mandatory = false;
-            breakPoints.push_back(bp);
-            continue;
-        }
-        
-        // 日本語の文字間は基本的に分割可能
-        if (i > 0 && m_unicodeHandler.isJapaneseCharacter(text[i-1]) && m_unicodeHandler.isJapaneseCharacter(ch)) {
-            // 行頭禁則文字の場合は分割不可
-            if (m_rules.isLineStartProhibited(ch)) {
-                continue;
-            }
-            
-            // 行末禁則文字の場合は分割不可
-            if (m_rules.isLineEndProhibited(text[i-1])) {
-                continue;
-            }
-            
-            // 分離禁止文字の場合は分割不可
-            if (m_rules.isInseparable(ch) || m_rules.isInseparable(text[i-1])) {
-                continue;
-            }
-            
-            BreakPoint bp;
-            bp.position = i;
-            bp.penalty = 100.0;  // 日本語の文字間は空白よりも高いペナルティ
-            bp.mandatory = false;
+    for (size_t position = 1; position <= text.length(); ++position) {
+        BreakPoint bp;
+        if (findBreakAt(text, position, bp)) {
             breakPoints.push_back(bp);
         }
     }
@@ -113,7 +83,119 @@ std::vector<BreakPoint> LineBreaker::findBreakPoints(const std::u32string& text)
     return breakPoints;
 }
 
-std::vector<size_t> LineBreaker::calculateOptimalBreaks(const std::u32string& text, const std::vector<BreakPoint>& breakPoints, const style::Style& style, double maxWidth, bool vertical) {
+bool LineBreaker::findBreakAt(const std::u32string& text, size_t position, BreakPoint& breakPoint) const {
+    char32_t before = text[position - 1];
+    breakPoint.position = position;
+    breakPoint.mandatory = false;
+    
+    // 改行文字の次の位置は強制的な分割点
+    if (before == U'\n') {
+        breakPoint.penalty = 0.0;    // 最低ペナルティ
+        breakPoint.mandatory = true;
+        return true;
+    }
+    
+    // 空白文字の次の位置は分割可能
+    if (before == U' ' || before == U'\t') {
+        breakPoint.penalty = 50.0;   // 中程度のペナルティ
+        return true;
+    }
+    
+    // 日本語の文字間は基本的に分割可能
+    if (position == text.length()) {
+        return false;
+    }
+    char32_t after = text[position];
+    if (!m_unicodeHandler.isJapaneseCharacter(before) || !m_unicodeHandler.isJapaneseCharacter(after)) {
+        return false;
+    }
+    
+    // 行頭禁則文字・行末禁則文字・分離禁止文字の間は分割不可
+    if (m_rules.isLineStartProhibited(after) || m_rules.isLineEndProhibited(before) ||
+        m_rules.isInseparable(after) || m_rules.isInseparable(before)) {
+        return false;
+    }
+    
+    breakPoint.penalty = 100.0;  // 日本語の文字間は空白よりも高いペナルティ
+    return true;
+}
+
+std::vector<size_t> LineBreaker::breakPositions(const std::u32string& text, const AdvanceWidthIndex& widths, double maxWidth) {
+    return breakRange(text, widths, 0, text.length(), maxWidth);
+}
+
+std::vector<size_t> LineBreaker::breakPositions(const std::u32string& text, const AdvanceWidthIndex& widths, double maxWidth,
+                                                const std::vector<size_t>& previousBreaks, size_t editPosition,
+                                                size_t removedLength, size_t insertedLength) {
+    // 編集した範囲を含む段落（改行文字で区切られた範囲）を求める
+    size_t start = std::min(editPosition, text.length());
+    while (start > 0 && text[start - 1] != U'\n') {
+        --start;
+    }
+    size_t end = std::min(editPosition + insertedLength, text.length());
+    while (end < text.length() && text[end] != U'\n') {
+        ++end;
+    }
+    if (end < text.length()) {
+        ++end;
+    }
+    
+    // 改行文字の後では必ず分かれるため、段落より前と後の分割位置は編集の影響を受けない
+    std::vector<size_t> breaks(previousBreaks.begin(), std::lower_bound(previousBreaks.begin(), previousBreaks.end(), start));
+    if (start > 0 && start < text.length()) {
+        breaks.push_back(start);
+    }
+    std::vector<size_t> paragraphBreaks = breakRange(text, widths, start, end, maxWidth);
+    breaks.insert(breaks.end(), paragraphBreaks.begin(), paragraphBreaks.end());
+    if (end < text.length()) {
+        breaks.push_back(end);
+    }
+    
+    size_t previousEnd = end - insertedLength + removedLength;
+    for (auto previous = std::upper_bound(previousBreaks.begin(), previousBreaks.end(), previousEnd);
+         previous != previousBreaks.end(); ++previous) {
+        breaks.push_back(*previous - removedLength + insertedLength);
+    }
+    return breaks;
+}
+
+std::vector<size_t> LineBreaker::breakRange(const std::u32string& text, const AdvanceWidthIndex& widths,
+                                            size_t start, size_t end, double maxWidth) const {
+    // 範囲の先頭と末尾を分割点とし、間の分割可能な位置までの幅は索引から引く
+    std::vector<BreakPoint> breakPoints;
+    std::vector<int64_t> breakPrefix;
+    BreakPoint bp;
+    bp.position = start;
+    bp.penalty = 1000.0;
+    bp.mandatory = false;
+    breakPoints.push_back(bp);
+    breakPrefix.push_back(widths.prefix(start));
+    for (size_t position = start + 1; position < end; ++position) {
+        if (findBreakAt(text, position, bp)) {
+            breakPoints.push_back(bp);
+            breakPrefix.push_back(widths.prefix(position));
+        }
+    }
+    bp.position = end;
+    bp.penalty = 0.0;
+    bp.mandatory = true;
+    breakPoints.push_back(bp);
+    breakPrefix.push_back(widths.prefix(end));
+    return calculateOptimalBreaks(breakPoints, breakPrefix, maxWidth);
+}
+
+std::vector<size_t> LineBreaker::calculateOptimalBreaks(const std::u32string& text, const std::vector<BreakPoint>& breakPoints, const GlyphAdvanceTable& advances, double maxWidth) const {
+    // 送り幅の累積和（LayoutUnit）を求めておき、分割可能な位置での値を取り出す
+    std::vector<int64_t> prefix(text.length() + 1);
+    prefixAdvances(advances, text.data(), text.length(), prefix.data());
+    std::vector<int64_t> breakPrefix(breakPoints.size());
+    for (size_t i = 0; i < breakPoints.size(); ++i) {
+        breakPrefix[i] = prefix[breakPoints[i].position];
+    }
+    return calculateOptimalBreaks(breakPoints, breakPrefix, maxWidth);
+}
+
+std::vector<size_t> LineBreaker::calculateOptimalBreaks(const std::vector<BreakPoint>& breakPoints, const std::vector<int64_t>& breakPrefix, double maxWidth) const {
     // 動的計画法による最適な分割位置の計算
     std::vector<size_t> result;
     
@@ -129,32 +211,27 @@ std::vector<size_t> LineBreaker::calculateOptimalBreaks(const std::u32string& te
     // 初期値の設定
     minPenalty[0] = 0.0;
     
+    // 区間の幅は分割可能な位置までの累積幅の差で得る
+    const LayoutUnit maxUnits = toLayoutUnit(maxWidth);
+    
     // 各分割点について最適な前の分割点を計算
     for (size_t j = 1; j < breakPoints.size(); ++j) {
-        size_t endPos = breakPoints[j].position;
-        
-        for (size_t i = 0; i < j; ++i) {
-            size_t startPos = breakPoints[i].position;
-            
-            // この区間のテキストを取得
-            std::u32string segment = text.substr(startPos, endPos - startPos);
-            
+        // 区間の幅は前の分割点を遡るほど広がるため、後ろから見て最大幅を超えたところで打ち切る
+        for (size_t i = j; i-- > 0;) {
             // 区間の幅を計算
-            double width = 0.0;
-            for (char32_t ch : segment) {
-                width += calculateCharacterWidth(ch, style, vertical);
-            }
-            
-            // 最大幅を超える場合はスキップ（強制分割点を除く）
-            if (width > maxWidth && !breakPoints[j].mandatory) {
-                continue;
-            }
+            int64_t width = breakPrefix[j] - breakPrefix[i];
             
             // 行の余白に基づくペナルティ
             double linePenalty = 0.0;
-            if (width < maxWidth) {
+            if (width > maxUnits) {
+                // 最大幅を超える行は、直前の分割点からでも収まらない場合に限り大きなペナルティで許す
+                if (i + 1 < j) {
+                    break;
+                }
+                linePenalty = kOverfullPenalty;
+            } else if (width < maxUnits) {
                 // 行が短すぎる場合のペナルティ
-                double ratio = width / maxWidth;
+                double ratio = static_cast<double>(width) / maxUnits;
                 linePenalty = 100.0 * (1.0 - ratio) * (1.0 - ratio);
             }
             
@@ -164,11 +241,22 @@ std::vector<size_t> LineBreaker::calculateOptimalBreaks(const std::u32string& te
             // 総合ペナルティ
             double totalPenalty = minPenalty[i] + linePenalty + breakPenalty;
             
-            // より良い分割が見つかった場合は更新
-            if (totalPenalty < minPenalty[j]) {
+            // より良い分割が見つかった場合は更新（同じ値の場合は前の分割点を優先する）
+            if (totalPenalty <= minPenalty[j]) {
                 minPenalty[j] = totalPenalty;
                 prev[j] = i;
             }
+            
+            // 強制分割点より前から行を始めることはできない
+            if (breakPoints[i].mandatory || width > maxUnits) {
+                break;
+            }
+        }
+        
+        // 強制分割点はどの分割も通るため、以降はここからのペナルティで比べる
+        // （改行文字で区切った段落ごとに計算しても、全体を計算した場合と同じ結果になる）
+        if (breakPoints[j].mandatory) {
+            minPenalty[j] = 0.0;
         }
     }
     
@@ -189,20 +277,8 @@ std::vector<size_t> LineBreaker::calculateOptimalBreaks(const std::u32string& te
 }
 
 double LineBreaker::calculateCharacterWidth(char32_t character, const style::Style& style, bool vertical) {
-    // 簡易的な実装：フォントサイズに基づいて幅を計算
-    // 実際の実装では、フォントメトリクスを使用して正確な幅を計算する
-    
-    double baseWidth = style.getFontSize();
-    
-    // 全角文字と半角文字で幅を調整
-    if (m_unicodeHandler.isFullWidthCharacter(character)) {
-        return baseWidth;
-    } else if (m_unicodeHandler.isHalfWidthCharacter(character)) {
-        return baseWidth * 0.5;
-    }
-    
-    // デフォルトは全角として扱う
-    return baseWidth;
+    // 共有の送り幅キャッシュから取得する
+    return GlyphAdvanceCache::getInstance().getTable(style, vertical)->getAdvance(character);
 }
 
 } // namespace typesetting
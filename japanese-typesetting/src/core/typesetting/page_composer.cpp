@@ -0,0 +1,107 @@
+/**
+ * @file page_composer.cpp
+ * @brief 組版済みの行をページに割り付けるページ構成器の実装
+ */
+
+#include "japanese_typesetting/core/typesetting/page_composer.h"
+
+namespace japanese_typesetting {
+namespace core {
+namespace typesetting {
+
+PageComposer::PageComposer(const PageFrame& frame, PageCallback callback)
+    : m_frame(frame)
+    , m_callback(std::move(callback))
+    , m_blockIndex(0)
+    , m_pendingSpacing(0)
+    , m_extent(0)
+    , m_pageCount(0)
+    , m_stopped(false) {
+}
+
+PageComposer::~PageComposer() {
+    // 特に何もしない
+}
+
+bool PageComposer::addBlock(const TextBlock& block) {
+    if (m_stopped) {
+        return false;
+    }
+
+    for (const auto& line : block.lines) {
+        if (!addLine(line)) {
+            return false;
+        }
+    }
+
+    // 次のブロックの前に余白を入れる（ページ先頭では入れない）
+    m_pendingSpacing = toLayoutUnit(m_frame.blockSpacing);
+    m_blockIndex++;
+    return true;
+}
+
+bool PageComposer::finish() {
+    if (m_stopped) {
+        return false;
+    }
+    if (m_page.lines.empty()) {
+        return true;
+    }
+    return emitPage();
+}
+
+size_t PageComposer::getPageCount() const {
+    return m_pageCount;
+}
+
+bool PageComposer::isStopped() const {
+    return m_stopped;
+}
+
+const PageFrame& PageComposer::getFrame() const {
+    return m_frame;
+}
+
+bool PageComposer::addLine(const TextLine& line) {
+    // 行の位置はLayoutUnitで積み上げ、誤差を蓄積させない
+    LayoutUnit spacing = m_page.lines.empty() ? 0 : m_pendingSpacing;
+    LayoutUnit height = toLayoutUnit(line.height);
+
+    // 行数または行送り方向の大きさが版面を超える場合は改ページ
+    bool exceedsLines = m_frame.maxLines > 0 && m_page.lines.size() >= m_frame.maxLines;
+    bool exceedsExtent = m_frame.blockExtent > 0.0 &&
+                         m_extent + spacing + height > toLayoutUnit(m_frame.blockExtent);
+    if (!m_page.lines.empty() && (exceedsLines || exceedsExtent)) {
+        if (!emitPage()) {
+            return false;
+        }
+        spacing = 0;
+    }
+
+    PlacedLine placed;
+    placed.line = line;
+    placed.offset = fromLayoutUnit(m_extent + spacing);
+    placed.blockIndex = m_blockIndex;
+    m_page.lines.push_back(std::move(placed));
+    m_extent += spacing + height;
+    m_page.extent = fromLayoutUnit(m_extent);
+    m_pendingSpacing = 0;
+    return true;
+}
+
+bool PageComposer::emitPage() {
+    m_page.index = m_pageCount++;
+    if (m_callback && !m_callback(m_page)) {
+        m_stopped = true;
+    }
+
+    // 次のページを始める（行の領域は再利用する）
+    m_page.lines.clear();
+    m_page.extent = 0.0;
+    m_extent = 0;
+    return !m_stopped;
+}
+
+} // namespace typesetting
+} // namespace core
+} // namespace japanese_typesetting
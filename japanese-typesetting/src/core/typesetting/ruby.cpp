@@ -5,11 +5,304 @@
 
 #include "japanese_typesetting/core/typesetting/ruby.h"
 #include <algorithm>
+#include <string_view>
 
 namespace japanese_typesetting {
 namespace core {
 namespace typesetting {
 
+namespace {
+
+const size_t kNoPosition = static_cast<size_t>(-1);
+
+bool isRubyMarkup(char32_t character) {
+    return character == U'｜' || character == U'《' || character == U'》' || character == U'［';
+}
+
+/**
+ * @struct NoteKind
+ * @brief 青空文庫形式の注記の名前と、それが表す圏点・傍線
+ */
+struct NoteKind {
+    const char32_t* name;     ///< 注記の名前（「に」の後ろ）
+    EmphasisMark emphasis;    ///< 圏点
+    Sideline sideline;        ///< 傍線
+};
+
+constexpr NoteKind kNoteKinds[] = {
+    {U"傍点", EmphasisMark::FilledSesame, Sideline::None},
+    {U"白ゴマ傍点", EmphasisMark::OpenSesame, Sideline::None},
+    {U"丸傍点", EmphasisMark::FilledCircle, Sideline::None},
+    {U"白丸傍点", EmphasisMark::OpenCircle, Sideline::None},
+    {U"傍線", EmphasisMark::None, Sideline::Solid},
+    {U"二重傍線", EmphasisMark::None, Sideline::Double},
+};
+
+// 「［＃「対象」に種類］」の中身（「［＃」と「］」を除く）を解釈する
+bool parseNote(const char32_t* note, size_t length, size_t& targetLength, AnnotationSpan& span) {
+    if (length < 4 || note[0] != U'「') {
+        return false;
+    }
+    // 対象に「」を含む場合に備え、最後の「」に」で区切る
+    size_t close = length - 2;
+    while (close > 1 && !(note[close] == U'」' && note[close + 1] == U'に')) {
+        --close;
+    }
+    if (close <= 1) {
+        return false;
+    }
+    const std::u32string_view kind(note + close + 2, length - close - 2);
+    for (const NoteKind& candidate : kNoteKinds) {
+        if (kind == candidate.name) {
+            targetLength = close - 1;
+            span.emphasis = candidate.emphasis;
+            span.sideline = candidate.sideline;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @enum BaseClass
+ * @brief 「｜」のない注釈で親文字をさかのぼる字種
+ */
+enum class BaseClass {
+    None,       ///< 親文字にならない文字
+    Kanji,      ///< 漢字（々・〆・〇・ヶを含む）
+    Katakana,   ///< カタカナ
+    Hiragana,   ///< ひらがな
+    Latin       ///< 英数字（全角を含む）
+};
+
+BaseClass classifyBase(char32_t c) {
+    if ((c >= 0x4E00 && c <= 0x9FFF) || (c >= 0x3400 && c <= 0x4DBF) || (c >= 0xF900 && c <= 0xFAFF) ||
+        (c >= 0x20000 && c <= 0x2FFFF) || c == U'々' || c == U'〆' || c == U'〇' || c == U'ヶ') {
+        return BaseClass::Kanji;
+    }
+    if ((c >= 0x30A1 && c <= 0x30FA) || c == U'ー') {
+        return BaseClass::Katakana;
+    }
+    if (c >= 0x3041 && c <= 0x3096) {
+        return BaseClass::Hiragana;
+    }
+    if ((c >= U'0' && c <= U'9') || (c >= U'A' && c <= U'Z') || (c >= U'a' && c <= U'z') ||
+        (c >= U'０' && c <= U'９') || (c >= U'Ａ' && c <= U'Ｚ') || (c >= U'ａ' && c <= U'ｚ')) {
+        return BaseClass::Latin;
+    }
+    return BaseClass::None;
+}
+
+// 「｜」のない注釈の親文字の開始位置（limitより前にはさかのぼらない、親文字がない場合はend）
+size_t findImplicitBase(const std::pmr::u32string& clean, size_t limit, size_t end) {
+    if (end <= limit) {
+        return end;
+    }
+    BaseClass baseClass = classifyBase(clean[end - 1]);
+    if (baseClass == BaseClass::None) {
+        return end;
+    }
+    size_t start = end - 1;
+    while (start > limit && classifyBase(clean[start - 1]) == baseClass) {
+        --start;
+    }
+    return start;
+}
+
+// ルビを掛けてよい文字（かな）
+bool isKana(char32_t c) {
+    return c >= 0x3041 && c <= 0x30FF && c != U'・';
+}
+
+LayoutUnit sumAdvances(const GlyphAdvanceTable& advances, const char32_t* text, size_t length) {
+    LayoutUnit total = 0;
+    for (size_t i = 0; i < length; ++i) {
+        total += advances.getAdvanceUnits(text[i]);
+    }
+    return total;
+}
+
+} // namespace
+
+bool scanRubyMarkup(const char32_t* text, size_t length, std::pmr::u32string& clean, std::pmr::u32string& rubyText,
+                    std::pmr::vector<RubySpan>& spans, std::pmr::vector<RubySourceRange>* sources,
+                    std::pmr::vector<AnnotationSpan>* annotations) {
+    // 記号を含まないテキスト（大半の段落）は読むだけで戻る
+    if (std::none_of(text, text + length, isRubyMarkup)) {
+        return false;
+    }
+
+    clean.clear();
+    rubyText.clear();
+    spans.clear();
+    if (sources) {
+        sources->clear();
+    }
+    if (annotations) {
+        annotations->clear();
+    }
+    clean.reserve(length);
+
+    size_t bar = kNoPosition;         // 保留中の「｜」の本文内の位置
+    size_t barSource = kNoPosition;   // 保留中の「｜」の入力内の位置
+    size_t open = kNoPosition;        // 読み取り中のルビの「《」の入力内の位置
+    size_t rubyStart = 0;             // 読み取り中のルビのルビ文字列内の開始位置
+    size_t protectedEnd = 0;          // 直前の親文字の終了位置（親文字はここより前にさかのぼらない）
+    size_t emphasis = kNoPosition;    // 読み取り中の「《《」の本文内の位置（閉じるまで本文に残しておく）
+
+    // 読み取り中のルビを注釈にせず、本文に戻す
+    auto restoreRuby = [&](bool closed) {
+        clean.push_back(U'《');
+        clean.append(rubyText, rubyStart, std::u32string::npos);
+        if (closed) {
+            clean.push_back(U'》');
+        }
+        rubyText.resize(rubyStart);
+        open = kNoPosition;
+        bar = kNoPosition;
+    };
+
+    // 閉じた「《《」を本文から取り除き、それより後ろの位置を詰める
+    auto closeEmphasis = [&]() {
+        const size_t start = emphasis;
+        clean.erase(start, 2);
+        for (auto it = spans.rbegin(); it != spans.rend() && it->baseEnd() > start; ++it) {
+            if (it->baseStart >= start) {
+                it->baseStart -= 2;
+            } else {
+                it->baseLength -= 2;
+            }
+        }
+        if (annotations) {
+            for (auto it = annotations->rbegin(); it != annotations->rend() && it->start >= start; ++it) {
+                it->start -= 2;
+            }
+        }
+        if (bar != kNoPosition && bar > start) {
+            bar -= 2;
+        }
+        protectedEnd = protectedEnd > start + 2 ? protectedEnd - 2 : std::min(protectedEnd, start);
+        if (annotations) {
+            AnnotationSpan span;
+            span.start = static_cast<uint32_t>(start);
+            span.length = static_cast<uint32_t>(clean.size() - start);
+            span.emphasis = EmphasisMark::FilledSesame;
+            annotations->push_back(span);
+        }
+        emphasis = kNoPosition;
+    };
+
+    for (size_t i = 0; i < length; ++i) {
+        char32_t c = text[i];
+
+        // ルビの読み取り中
+        if (open != kNoPosition) {
+            if (c == U'》') {
+                size_t baseEnd = clean.size();
+                size_t baseStart = bar != kNoPosition ? bar + 1 : findImplicitBase(clean, protectedEnd, baseEnd);
+                if (baseStart == baseEnd || rubyText.size() == rubyStart) {
+                    restoreRuby(true);
+                    continue;
+                }
+
+                RubySourceRange source{baseStart, i + 1};
+                if (bar != kNoPosition) {
+                    // 「｜」を取り除く（親文字だけが1文字分ずれる）
+                    clean.erase(bar, 1);
+                    baseStart--;
+                    baseEnd--;
+                    source.start = barSource;
+                } else {
+                    source.start = open - (baseEnd - baseStart);
+                }
+
+                RubySpan span;
+                span.baseStart = static_cast<uint32_t>(baseStart);
+                span.baseLength = static_cast<uint32_t>(baseEnd - baseStart);
+                span.rubyStart = static_cast<uint32_t>(rubyStart);
+                span.rubyLength = static_cast<uint32_t>(rubyText.size() - rubyStart);
+                spans.push_back(span);
+                if (sources) {
+                    sources->push_back(source);
+                }
+                protectedEnd = baseEnd;
+                open = kNoPosition;
+                bar = kNoPosition;
+                continue;
+            }
+            if (c != U'《' && c != U'\n') {
+                rubyText.push_back(c);
+                continue;
+            }
+            // 閉じられないまま次の「《」や改行に達した場合は本文に戻し、この文字は本文として扱う
+            restoreRuby(false);
+        }
+
+        // 圏点の「《《」と「》》」（空の場合や閉じられない場合は本文に残す）
+        const bool doubled = i + 1 < length && text[i + 1] == c;
+        if (c == U'《' && doubled && emphasis == kNoPosition) {
+            emphasis = clean.size();
+            clean.append(2, U'《');
+            ++i;
+            continue;
+        }
+        if (c == U'》' && doubled && emphasis != kNoPosition && clean.size() > emphasis + 2) {
+            closeEmphasis();
+            ++i;
+            continue;
+        }
+
+        // 青空文庫形式の注記は閉じる「］」まで先読みし、直前の本文と対象が一致すれば取り除く
+        // （先読みは次の「［」か改行で打ち切るため、各文字を読むのは高々2度）
+        if (c == U'［' && i + 1 < length && text[i + 1] == U'＃') {
+            size_t close = i + 2;
+            while (close < length && text[close] != U'］' && text[close] != U'［' && text[close] != U'\n') {
+                ++close;
+            }
+            size_t targetLength = 0;
+            AnnotationSpan span;
+            if (close < length && text[close] == U'］' &&
+                parseNote(text + i + 2, close - i - 2, targetLength, span) &&
+                targetLength > 0 && targetLength <= clean.size() &&
+                clean.compare(clean.size() - targetLength, targetLength, text + i + 3, targetLength) == 0) {
+                span.start = static_cast<uint32_t>(clean.size() - targetLength);
+                span.length = static_cast<uint32_t>(targetLength);
+                if (annotations) {
+                    annotations->push_back(span);
+                }
+                i = close;
+                continue;
+            }
+        }
+
+        if (c == U'《') {
+            open = i;
+            rubyStart = rubyText.size();
+            continue;
+        }
+        if (c == U'｜') {
+            // 前の「｜」は注釈にならなかったため、そのまま本文に残す
+            bar = clean.size();
+            barSource = i;
+        } else if (c == U'\n') {
+            // 親文字と圏点は改行をまたがない
+            bar = kNoPosition;
+            emphasis = kNoPosition;
+        }
+        clean.push_back(c);
+    }
+    if (open != kNoPosition) {
+        restoreRuby(false);
+    }
+
+    // 注記は出現順に記録されるため、開始位置の順に並べ直す
+    if (annotations) {
+        std::stable_sort(annotations->begin(), annotations->end(),
+                         [](const AnnotationSpan& a, const AnnotationSpan& b) { return a.start < b.start; });
+    }
+    return true;
+}
+
 RubyProcessor::RubyProcessor() {
     // 特に初期化処理はない
 }
@@ -21,85 +314,252 @@ RubyProcessor::~RubyProcessor() {
 std::vector<RubyText> RubyProcessor::parseRuby(const std::u32string& text) {
     std::vector<RubyText> result;
     
-    size_t pos = 0;
-    while (pos < text.length()) {
-        // ルビ開始タグを検索
-        size_t rubyStartPos = findRubyStartTag(text, pos);
-        if (rubyStartPos == static_cast<size_t>(-1)) {
-            break; // ルビタグが見つからない場合は終了
-        }
-        
-        // ルビテキストタグを検索
-        size_t rubyTextTagPos = findRubyTextTag(text, rubyStartPos + 1);
-        if (rubyTextTagPos == static_cast<size_t>(-1)) {
-            pos = rubyStartPos + 1;
-            continue; // ルビテキストタグが見つからない場合は次の検索へ
-        }
-        
-        // ルビ終了タグを検索
-        size_t rubyEndPos = findRubyEndTag(text, rubyTextTagPos + 1);
-        if (rubyEndPos == static_cast<size_t>(-1)) {
-            pos = rubyTextTagPos + 1;
-            continue; // ルビ終了タグが見つからない場合は次の検索へ
-        }
-        
-        // ベーステキストとルビテキストを抽出
-        std::u32string baseText = text.substr(rubyStartPos + 1, rubyTextTagPos - rubyStartPos - 1);
-        std::u32string rubyText = text.substr(rubyTextTagPos + 1, rubyEndPos - rubyTextTagPos - 1);
-        
-        // ルビ情報を追加
+    std::pmr::u32string clean;
+    std::pmr::u32string rubyText;
+    std::pmr::vector<RubySpan> spans;
+    std::pmr::vector<RubySourceRange> sources;
+    if (!scanRubyMarkup(text.data(), text.length(), clean, rubyText, spans, &sources)) {
+        return result;
+    }
+    
+    result.reserve(spans.size());
+    for (size_t i = 0; i < spans.size(); ++i) {
         RubyText ruby;
-        ruby.base = baseText;
-        ruby.ruby = rubyText;
-        ruby.startPos = rubyStartPos;
-        ruby.endPos = rubyEndPos + 1;
-        
-        result.push_back(ruby);
-        
-        // 次の検索位置を更新
-        pos = rubyEndPos + 1;
+        ruby.base.assign(clean.data() + spans[i].baseStart, spans[i].baseLength);
+        ruby.ruby.assign(rubyText.data() + spans[i].rubyStart, spans[i].rubyLength);
+        ruby.startPos = sources[i].start;
+        ruby.endPos = sources[i].end;
+        result.push_back(std::move(ruby));
     }
     
     return result;
 }
 
-void RubyProcessor::calculateRubyLayout(RubyText& rubyText, const style::Style& baseStyle, const style::Style& rubyStyle, bool vertical) {
-    // ルビの配置計算の実装
-    // 実際の実装では、ベーステキストとルビテキストの幅や高さを計算し、
-    // 適切な配置方法（モノルビ、グループルビなど）を決定する
-    
-    // この簡易実装では特に何もしない
-    // 将来的には、ルビの配置情報を計算して返す
+RubyLayout RubyProcessor::calculateRubyLayout(const RubyText& rubyText, const style::Style& baseStyle,
+                                              const style::Style& rubyStyle, bool vertical) {
+    std::shared_ptr<const GlyphAdvanceTable> baseAdvances = GlyphAdvanceCache::getInstance().getTable(baseStyle, vertical);
+    std::shared_ptr<const GlyphAdvanceTable> rubyAdvances = GlyphAdvanceCache::getInstance().getTable(rubyStyle, vertical);
+    return RubyLayoutCache::getInstance().getLayout(rubyText.base.data(), rubyText.base.length(),
+                                                    rubyText.ruby.data(), rubyText.ruby.length(),
+                                                    *baseAdvances, *rubyAdvances, baseStyle.getRubyAlignment());
 }
 
-size_t RubyProcessor::findRubyStartTag(const std::u32string& text, size_t startPos) {
-    // ルビ開始タグ「｜」または「《」の検索
-    for (size_t i = startPos; i < text.length(); ++i) {
-        if (text[i] == U'｜' || text[i] == U'《') {
-            return i;
+RubyLayout computeRubyLayout(const char32_t* base, size_t baseLength, const char32_t* ruby, size_t rubyLength,
+                             const GlyphAdvanceTable& baseAdvances, const GlyphAdvanceTable& rubyAdvances,
+                             style::RubyAlignment alignment) {
+    RubyLayout layout;
+    layout.baseWidth = sumAdvances(baseAdvances, base, baseLength);
+    layout.rubyWidth = sumAdvances(rubyAdvances, ruby, rubyLength);
+    layout.maxOverhang = toLayoutUnit(rubyAdvances.getKey().fontSize);
+    
+    // 親文字が1字の場合はモノルビとグループルビの区別がない
+    if (baseLength <= 1) {
+        layout.alignment = style::RubyAlignment::Mono;
+        return layout;
+    }
+    if (alignment == style::RubyAlignment::Group || rubyLength % baseLength != 0) {
+        return layout;
+    }
+    if (alignment == style::RubyAlignment::Mono) {
+        layout.alignment = style::RubyAlignment::Mono;
+        return layout;
+    }
+    
+    // 熟語ルビは各字のルビがその字の幅に収まる場合だけ1字ごとに配置する
+    const size_t share = rubyLength / baseLength;
+    for (size_t i = 0; i < baseLength; ++i) {
+        if (sumAdvances(rubyAdvances, ruby + i * share, share) > baseAdvances.getAdvanceUnits(base[i])) {
+            return layout;
         }
     }
-    return static_cast<size_t>(-1);
+    layout.alignment = style::RubyAlignment::Mono;
+    return layout;
+}
+
+// RubyLayoutCache の実装
+
+bool RubyLayoutCache::Key::operator==(const Key& other) const {
+    return baseLength == other.baseLength &&
+           rubyFontSize == other.rubyFontSize &&
+           alignment == other.alignment &&
+           baseFont == other.baseFont &&
+           text == other.text;
+}
+
+size_t RubyLayoutCache::KeyHash::operator()(const Key& key) const {
+    uint64_t hash = 14695981039346656037ULL;
+    auto mix = [&hash](const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+    };
+
+    mix(key.text.data(), key.text.size() * sizeof(char32_t));
+    mix(&key.baseLength, sizeof(key.baseLength));
+    hash ^= GlyphAdvanceKeyHash()(key.baseFont);
+    mix(&key.rubyFontSize, sizeof(key.rubyFontSize));
+    uint32_t alignment = static_cast<uint32_t>(key.alignment);
+    mix(&alignment, sizeof(alignment));
+    return static_cast<size_t>(hash);
 }
 
-size_t RubyProcessor::findRubyTextTag(const std::u32string& text, size_t startPos) {
-    // ルビテキストタグ「《」の検索
-    for (size_t i = startPos; i < text.length(); ++i) {
-        if (text[i] == U'《') {
-            return i;
+RubyLayoutCache& RubyLayoutCache::getInstance() {
+    static RubyLayoutCache instance;
+    return instance;
+}
+
+RubyLayoutCache::RubyLayoutCache(size_t capacity)
+    : m_capacity(capacity > 0 ? capacity : 1)
+    , m_hits(0)
+    , m_misses(0) {
+}
+
+RubyLayoutCache::~RubyLayoutCache() {
+    // 特に何もしない
+}
+
+RubyLayout RubyLayoutCache::getLayout(const char32_t* base, size_t baseLength, const char32_t* ruby, size_t rubyLength,
+                                      const GlyphAdvanceTable& baseAdvances, const GlyphAdvanceTable& rubyAdvances,
+                                      style::RubyAlignment alignment) {
+    Key key;
+    key.text.reserve(baseLength + rubyLength);
+    key.text.append(base, baseLength);
+    key.text.append(ruby, rubyLength);
+    key.baseLength = static_cast<uint32_t>(baseLength);
+    key.baseFont = baseAdvances.getKey();
+    key.rubyFontSize = rubyAdvances.getKey().fontSize;
+    key.alignment = alignment;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_index.find(key);
+        if (it != m_index.end()) {
+            m_entries.splice(m_entries.begin(), m_entries, it->second);
+            m_hits++;
+            return it->second->second;
         }
+        m_misses++;
     }
-    return static_cast<size_t>(-1);
+
+    // 計算はロックの外で行う（同じキーを複数スレッドが計算しても結果は同じ）
+    RubyLayout layout = computeRubyLayout(base, baseLength, ruby, rubyLength, baseAdvances, rubyAdvances, alignment);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_index.find(key) == m_index.end()) {
+        m_entries.emplace_front(key, layout);
+        m_index.emplace(std::move(key), m_entries.begin());
+        while (m_entries.size() > m_capacity) {
+            m_index.erase(m_entries.back().first);
+            m_entries.pop_back();
+        }
+    }
+    return layout;
+}
+
+void RubyLayoutCache::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_index.clear();
+    m_entries.clear();
+}
+
+RubyLayoutCacheStats RubyLayoutCache::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    RubyLayoutCacheStats stats;
+    stats.hits = m_hits;
+    stats.misses = m_misses;
+    stats.entries = m_entries.size();
+    return stats;
 }
 
-size_t RubyProcessor::findRubyEndTag(const std::u32string& text, size_t startPos) {
-    // ルビ終了タグ「》」の検索
-    for (size_t i = startPos; i < text.length(); ++i) {
-        if (text[i] == U'》') {
-            return i;
+void placeRubies(const char32_t* text, size_t length, const GlyphAdvanceTable& advances,
+                 const RubyAnnotations& annotations, std::pmr::vector<RubySpan>& spans,
+                 std::pmr::vector<RubyPlacement>& placements, LayoutUnit* widths, LayoutUnit* spacing,
+                 uint8_t* noBreakBefore) {
+    RubyLayoutCache& cache = RubyLayoutCache::getInstance();
+    auto getLayout = [&](const RubySpan& span) {
+        return cache.getLayout(text + span.baseStart, span.baseLength, annotations.text + span.rubyStart,
+                               span.rubyLength, advances, *annotations.advances, annotations.alignment);
+    };
+    
+    // 配置方法を決め、モノルビは親文字1字ごとの注釈に分ける
+    std::pmr::vector<RubySpan> resolved(spans.get_allocator());
+    std::pmr::vector<RubyLayout> layouts(spans.get_allocator());
+    resolved.reserve(spans.size());
+    layouts.reserve(spans.size());
+    for (const RubySpan& span : spans) {
+        RubyLayout layout = getLayout(span);
+        if (layout.alignment != style::RubyAlignment::Mono || span.baseLength <= 1) {
+            resolved.push_back(span);
+            layouts.push_back(layout);
+            continue;
+        }
+        const uint32_t share = span.rubyLength / span.baseLength;
+        for (uint32_t i = 0; i < span.baseLength; ++i) {
+            RubySpan part;
+            part.baseStart = span.baseStart + i;
+            part.baseLength = 1;
+            part.rubyStart = span.rubyStart + i * share;
+            part.rubyLength = share;
+            resolved.push_back(part);
+            layouts.push_back(getLayout(part));
+        }
+    }
+    spans.swap(resolved);
+    
+    auto addSpacing = [&](size_t index, LayoutUnit amount) {
+        widths[index] += amount;
+        spacing[index] += amount;
+    };
+    
+    placements.assign(spans.size(), RubyPlacement());
+    for (size_t k = 0; k < spans.size(); ++k) {
+        const RubySpan& span = spans[k];
+        const RubyLayout& layout = layouts[k];
+        RubyPlacement& placement = placements[k];
+        const size_t start = span.baseStart;
+        const size_t end = span.baseEnd();
+        
+        // グループルビは親文字の途中で改行しない
+        for (size_t i = start + 1; i < end; ++i) {
+            noBreakBefore[i] = 1;
+        }
+        placement.width = std::max(layout.rubyWidth, layout.baseWidth);
+        const LayoutUnit excess = layout.getExcess();
+        if (excess == 0) {
+            continue;
+        }
+        
+        // はみ出す分は、前後がほかの親文字でないかなであればルビ1字分まで掛ける
+        const LayoutUnit half = excess / 2;
+        if (start > 0 && isKana(text[start - 1]) && (k == 0 || spans[k - 1].baseEnd() < start)) {
+            placement.overhangBefore = std::min(half, layout.maxOverhang);
+        }
+        if (end < length && isKana(text[end]) && (k + 1 == spans.size() || spans[k + 1].baseStart > end)) {
+            placement.overhangAfter = std::min(excess - half, layout.maxOverhang);
+        }
+        
+        // 残りは親文字の前後と間に1:2:1で空ける
+        const LayoutUnit before = half - placement.overhangBefore;
+        const LayoutUnit after = excess - half - placement.overhangAfter;
+        const LayoutUnit count = static_cast<LayoutUnit>(end - start);
+        const LayoutUnit lead = before / count;
+        const LayoutUnit trail = after / count;
+        if (count > 1) {
+            const LayoutUnit inner = before + after - lead - trail;
+            for (size_t i = start; i + 1 < end; ++i) {
+                addSpacing(i, inner / (count - 1) + (i + 2 == end ? inner % (count - 1) : 0));
+            }
+        }
+        addSpacing(end - 1, trail);
+        if (start > 0 && text[start - 1] != U'\n') {
+            addSpacing(start - 1, lead);
+            placement.leading = lead;
+        } else {
+            addSpacing(end - 1, lead);
         }
     }
-    return static_cast<size_t>(-1);
 }
 
 } // namespace typesetting
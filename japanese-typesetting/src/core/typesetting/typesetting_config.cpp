@@ -0,0 +1,24 @@
+/**
+ * @file typesetting_config.cpp
+ * @brief 組版エンジンの不変な設定の実装
+ */
+
+#include "japanese_typesetting/core/typesetting/typesetting_config.h"
+#include "japanese_typesetting/core/typesetting/layout_cache.h"
+
+namespace japanese_typesetting {
+namespace core {
+namespace typesetting {
+
+TypesettingConfig::TypesettingConfig()
+    : memoryResource(nullptr)
+    , layoutCache(&LayoutCache::getInstance())
+    , diskLayoutCache(nullptr)
+    , glyphRuns(false) {
+    // デフォルトの組版ルールを設定
+    rules.setDefaultJisX4051Rules();
+}
+
+} // namespace typesetting
+} // namespace core
+} // namespace japanese_typesetting
@@ -4,6 +4,12 @@
  */
 
 #include "japanese_typesetting/core/typesetting/typesetting_engine.h"
+#include "japanese_typesetting/core/typesetting/block_stream.h"
+#include "japanese_typesetting/core/typesetting/disk_layout_cache.h"
+#include "japanese_typesetting/core/typesetting/grid_layout.h"
+#include "japanese_typesetting/core/typesetting/layout_cache.h"
+#include "japanese_typesetting/core/typesetting/page_composer.h"
+#include "japanese_typesetting/core/typesetting/width_kernels.h"
 #include <algorithm>
 #include <cmath>
 
@@ -11,276 +17,398 @@ namespace japanese_typesetting {
 namespace core {
 namespace typesetting {
 
-TypesettingEngine::TypesettingEngine() {
-    // デフォルトの組版ルールを設定
-    m_rules.setDefaultJisX4051Rules();
+/**
+ * @struct TypesettingEngine::Scratch
+ * @brief 1回の組版呼び出しが専有する作業領域
+ */
+struct TypesettingEngine::Scratch {
+    LayoutArena arena;   ///< 中間データ用アリーナ
+};
+
+// TypesettingEngine::ScratchLease の実装
+
+TypesettingEngine::ScratchLease::ScratchLease(const TypesettingEngine& engine, const TypesettingConfig& config)
+    : m_engine(engine) {
+    {
+        std::lock_guard<std::mutex> lock(engine.m_mutex);
+        if (!engine.m_scratchPool.empty()) {
+            m_scratch = std::move(engine.m_scratchPool.back());
+            engine.m_scratchPool.pop_back();
+        }
+    }
+    if (!m_scratch) {
+        m_scratch = std::make_unique<Scratch>();
+    }
+
+    // 設定の上流メモリリソースに合わせる
+    std::pmr::memory_resource* upstream = config.memoryResource ? config.memoryResource : std::pmr::get_default_resource();
+    if (m_scratch->arena.getUpstream() != upstream) {
+        m_scratch->arena.setUpstream(upstream);
+    }
+}
+
+TypesettingEngine::ScratchLease::~ScratchLease() {
+    std::lock_guard<std::mutex> lock(m_engine.m_mutex);
+    m_engine.m_scratchPool.push_back(std::move(m_scratch));
+}
+
+// TypesettingEngine の実装
+
+TypesettingEngine::TypesettingEngine()
+    : TypesettingEngine(TypesettingConfig()) {
+}
+
+TypesettingEngine::TypesettingEngine(const TypesettingConfig& config)
+    : m_config(std::make_shared<const TypesettingConfig>(config)) {
 }
 
 TypesettingEngine::~TypesettingEngine() {
     // 特に何もしない
 }
 
+void TypesettingEngine::setConfig(const TypesettingConfig& config) {
+    std::atomic_store(&m_config, std::make_shared<const TypesettingConfig>(config));
+}
+
+std::shared_ptr<const TypesettingConfig> TypesettingEngine::getConfig() const {
+    return loadConfig();
+}
+
 void TypesettingEngine::setTypesettingRules(const TypesettingRules& rules) {
-    m_rules = rules;
+    updateConfig([&rules](TypesettingConfig& config) {
+        config.rules = rules;
+    });
 }
 
-const TypesettingRules& TypesettingEngine::getTypesettingRules() const {
-    return m_rules;
+TypesettingRules TypesettingEngine::getTypesettingRules() const {
+    return loadConfig()->rules;
 }
 
 void TypesettingEngine::setUnicodeHandler(const unicode::UnicodeHandler& handler) {
-    m_unicodeHandler = handler;
+    updateConfig([&handler](TypesettingConfig& config) {
+        config.unicodeHandler = handler;
+    });
 }
 
-const unicode::UnicodeHandler& TypesettingEngine::getUnicodeHandler() const {
-    return m_unicodeHandler;
+unicode::UnicodeHandler TypesettingEngine::getUnicodeHandler() const {
+    return loadConfig()->unicodeHandler;
 }
 
-TextBlock TypesettingEngine::typeset(const std::string& text, const style::Style& style, double width, bool vertical) {
-    // UTF-8からUTF-32に変換
-    std::u32string utf32Text = m_unicodeHandler.utf8ToUtf32(text);
-    
-    // 行分割を行う
-    std::vector<TextLine> lines = breakLines(utf32Text, style, width, vertical);
-    
-    // 禁則処理を適用
-    applyProhibitionRules(lines, style, vertical);
-    
-    // 文字詰め処理を適用
-    applyJustification(lines, style, width, vertical);
-    
-    // ぶら下げ処理を適用
-    applyHanging(lines, style, vertical);
-    
-    // テキストブロックを作成
-    TextBlock block;
-    block.lines = lines;
-    
-    // ブロックの幅と高さを計算
-    block.width = width;
-    block.height = 0.0;
-    for (const auto& line : lines) {
-        block.height += line.height;
-    }
-    
-    return block;
+void TypesettingEngine::setMemoryResource(std::pmr::memory_resource* resource) {
+    updateConfig([resource](TypesettingConfig& config) {
+        config.memoryResource = resource;
+    });
 }
 
-std::vector<TextBlock> TypesettingEngine::typesetDocument(const document::Document& document, const style::Style& style, double width) {
-    std::vector<TextBlock> blocks;
-    
-    // 各セクションを組版
-    for (size_t i = 0; i < document.getSectionCount(); ++i) {
-        document::Section* section = document.getSection(i);
-        if (section) {
-            // セクションのタイトルを組版
-            if (!section->getTitle().empty()) {
-                style::Style titleStyle = style;
-                titleStyle.setBold(true);
-                titleStyle.setFontSize(style.getFontSize() * 1.2); // タイトルは少し大きく
-                
-                TextBlock titleBlock = typeset(section->getTitle(), titleStyle, width, document.isVertical());
-                blocks.push_back(titleBlock);
-            }
-            
-            // セクションの内容を組版
-            TextBlock contentBlock = typeset(section->getContent(), style, width, document.isVertical());
-            blocks.push_back(contentBlock);
-            
-            // 子セクションを再帰的に組版（将来的な拡張）
-        }
-    }
-    
-    return blocks;
+std::pmr::memory_resource* TypesettingEngine::getMemoryResource() const {
+    std::pmr::memory_resource* resource = loadConfig()->memoryResource;
+    return resource ? resource : std::pmr::get_default_resource();
 }
 
-std::vector<TextLine> TypesettingEngine::breakLines(const std::u32string& text, const style::Style& style, double maxWidth, bool vertical) {
-    std::vector<TextLine> lines;
-    
-    // 現在の行
-    TextLine currentLine;
-    currentLine.text.clear();
-    currentLine.width = 0.0;
-    currentLine.height = style.getFontSize() * style.getLineHeight();
-    currentLine.baseline = style.getFontSize() * 0.8; // 仮のベースライン位置
-    currentLine.hasLineBreak = false;
-    
-    // 文字ごとに処理
-    for (size_t i = 0; i < text.length(); ++i) {
-        char32_t ch = text[i];
-        
-        // 改行文字の処理
-        if (ch == U'\n') {
-            currentLine.hasLineBreak = true;
-            lines.push_back(currentLine);
-            
-            // 新しい行を開始
-            currentLine.text.clear();
-            currentLine.width = 0.0;
-            currentLine.hasLineBreak = false;
-            continue;
-        }
-        
-        // 文字の幅を計算
-        double charWidth = calculateCharacterWidth(ch, style, vertical);
-        
-        // 行の最大幅を超える場合は改行
-        if (currentLine.width + charWidth > maxWidth && !currentLine.text.empty()) {
-            lines.push_back(currentLine);
-            
-            // 新しい行を開始
-            currentLine.text.clear();
-            currentLine.width = 0.0;
-            currentLine.hasLineBreak = false;
+void TypesettingEngine::setLayoutCache(LayoutCache* cache) {
+    updateConfig([cache](TypesettingConfig& config) {
+        config.layoutCache = cache;
+    });
+}
+
+LayoutCache* TypesettingEngine::getLayoutCache() const {
+    return loadConfig()->layoutCache;
+}
+
+void TypesettingEngine::setGlyphRunOutput(bool enabled) {
+    updateConfig([enabled](TypesettingConfig& config) {
+        config.glyphRuns = enabled;
+    });
+}
+
+bool TypesettingEngine::isGlyphRunOutputEnabled() const {
+    return loadConfig()->glyphRuns;
+}
+
+void TypesettingEngine::setDiskLayoutCache(DiskLayoutCache* cache) {
+    updateConfig([cache](TypesettingConfig& config) {
+        config.diskLayoutCache = cache;
+    });
+}
+
+DiskLayoutCache* TypesettingEngine::getDiskLayoutCache() const {
+    return loadConfig()->diskLayoutCache;
+}
+
+std::shared_ptr<const TypesettingConfig> TypesettingEngine::loadConfig() const {
+    return std::atomic_load(&m_config);
+}
+
+void TypesettingEngine::updateConfig(const std::function<void(TypesettingConfig& config)>& update) {
+    // 実行中の組版が参照している設定は変更せず、複製を変更して置き換える
+    auto config = std::make_shared<TypesettingConfig>(*loadConfig());
+    update(*config);
+    std::atomic_store(&m_config, std::shared_ptr<const TypesettingConfig>(std::move(config)));
+}
+
+TextBlock TypesettingEngine::typeset(const std::string& text, const style::Style& style, double width, bool vertical,
+                                     const CancellationToken* cancellation, AllocationStats* allocationStats) const {
+    return typesetText(text, style, nullptr, width, vertical, cancellation, allocationStats);
+}
+
+TextBlock TypesettingEngine::typeset(const std::string& text, const style::StyleHandle& style, double width, bool vertical,
+                                     const CancellationToken* cancellation, AllocationStats* allocationStats) const {
+    return typesetText(text, style.get(), &style, width, vertical, cancellation, allocationStats);
+}
+
+TextBlock TypesettingEngine::typesetText(const std::string& text, const style::Style& style, const style::StyleHandle* handle,
+                                         double width, bool vertical, const CancellationToken* cancellation,
+                                         AllocationStats* allocationStats) const {
+    // キャッシュにヒットした場合は確保しない
+    if (allocationStats) {
+        *allocationStats = AllocationStats();
+    }
+
+    // 呼び出しの間は同じ設定を使い続ける
+    std::shared_ptr<const TypesettingConfig> config = loadConfig();
+    LayoutCache* layoutCache = config->layoutCache;
+    // グリフ列はディスク上のキャッシュの形式に含まれないため、ディスク上のキャッシュは使わない
+    DiskLayoutCache* diskLayoutCache = config->glyphRuns ? nullptr : config->diskLayoutCache;
+
+    // 同じ入力の組版結果があれば再利用する
+    LayoutCacheKey cacheKey;
+    if (layoutCache || diskLayoutCache) {
+        // ルールは設定と寿命を共有し、キーごとに複製しない
+        std::shared_ptr<const TypesettingRules> rules(config, &config->rules);
+        cacheKey = handle ? LayoutCacheKey::create(text, *handle, rules, width, vertical)
+                          : LayoutCacheKey::create(text, style, std::move(rules), width, vertical);
+        cacheKey.glyphRuns = config->glyphRuns;
+    }
+    if (layoutCache) {
+        std::shared_ptr<const TextBlock> cached = layoutCache->find(cacheKey);
+        if (cached) {
+            return *cached;
         }
-        
-        // 文字を追加
-        currentLine.text.push_back(ch);
-        currentLine.width += charWidth;
     }
-    
-    // 最後の行を追加
-    if (!currentLine.text.empty()) {
-        lines.push_back(currentLine);
+    if (diskLayoutCache) {
+        TextBlock stored;
+        if (diskLayoutCache->load(cacheKey, stored)) {
+            if (layoutCache) {
+                layoutCache->store(cacheKey, stored);
+            }
+            return stored;
+        }
     }
-    
-    return lines;
-}
 
-void TypesettingEngine::applyProhibitionRules(std::vector<TextLine>& lines, const style::Style& style, bool vertical) {
-    // 行が2行未満の場合は処理不要
-    if (lines.size() < 2) {
-        return;
-    }
-    
-    for (size_t i = 0; i < lines.size() - 1; ++i) {
-        TextLine& currentLine = lines[i];
-        TextLine& nextLine = lines[i + 1];
+    // 中間データはすべて作業領域のアリーナから確保し、呼び出しごとに一括解放する
+    ScratchLease scratch(*this, *config);
+    LayoutArena& arena = scratch->arena;
+    arena.reset();
+
+    TextBlock block;
+    {
+        // UTF-8からUTF-32に変換
+        std::pmr::u32string utf32Text(&arena);
+        config->unicodeHandler.utf8ToUtf32(text, utf32Text);
         
-        // 明示的な改行がある場合はスキップ
-        if (currentLine.hasLineBreak) {
-            continue;
+        // ルビ・圏点・傍線のマークアップを取り除いた本文を組版し、注釈は別表に持つ
+        LineLayout layout(&arena);
+        std::pmr::u32string cleanText(&arena);
+        std::pmr::u32string rubyText(&arena);
+        const std::pmr::u32string& layoutText =
+            scanRubyMarkup(utf32Text.data(), utf32Text.length(), cleanText, rubyText, layout.rubies, nullptr,
+                           &layout.annotations) ? cleanText : utf32Text;
+
+        // 文字送り幅テーブルを取得（エンジン・スレッド間で共有される）
+        std::shared_ptr<const GlyphAdvanceTable> advances = GlyphAdvanceCache::getInstance().getTable(style, vertical);
+        std::shared_ptr<const GlyphAdvanceTable> rubyAdvances;
+        if (!layout.rubies.empty()) {
+            // ルビのスタイルは本文のスタイルからの派生として共有し、段落ごとに複製しない
+            // （共有されていないスタイルは本文の送り幅テーブルのキーからサイズだけ変える）
+            if (handle) {
+                style::StyleDerivation ruby;
+                ruby.fontSizeScale = kRubyFontSizeScale;
+                style::StyleHandle rubyStyle = style::StyleInterner::getInstance().derive(*handle, ruby);
+                rubyAdvances = GlyphAdvanceCache::getInstance().getTable(*rubyStyle, vertical);
+            } else {
+                GlyphAdvanceKey rubyKey = advances->getKey();
+                rubyKey.fontSize = style.getFontSize() * kRubyFontSizeScale;
+                rubyAdvances = GlyphAdvanceCache::getInstance().getTable(rubyKey);
+            }
+            layout.ruby.text = rubyText.data();
+            layout.ruby.advances = rubyAdvances.get();
+            layout.ruby.alignment = style.getRubyAlignment();
         }
-        
-        // 次の行が空の場合はスキップ
-        if (nextLine.text.empty()) {
-            continue;
+
+        // 行分割・禁則・ルビ・行揃えなどを書字方向と行揃えに特殊化されたカーネルで行う
+        // （字詰めでは升目の字数で分割するカーネルを使う。ルビのある段落は一般のカーネルで組む）
+        TypesetStatus status = style.isGridLayout() && layout.rubies.empty()
+            ? layoutGridLines(toWritingMode(vertical), layoutText, *advances, config->rules, toLayoutUnit(width),
+                              layout, cancellation)
+            : layoutLineRanges(toWritingMode(vertical), style.getTextAlignment(), layoutText, *advances,
+                               config->rules, toLayoutUnit(width), layout, cancellation);
+        if (status != TypesetStatus::Completed) {
+            // 中断された場合は残りの処理を行わず、キャッシュにも保存しない
+            if (allocationStats) {
+                *allocationStats = arena.getStats();
+            }
+            block.width = width;
+            block.height = 0.0;
+            block.status = status;
+            return block;
         }
-        
-        // 行末禁則処理
-        if (!currentLine.text.empty()) {
-            char32_t lastChar = currentLine.text.back();
+
+        // テキストブロックを作成（行の文字列はここで初めて確保する）
+        double lineHeight = fromLayoutUnit(toLayoutUnit(style.getFontSize() * style.getLineHeight()));
+        double baseline = fromLayoutUnit(toLayoutUnit(style.getFontSize() * 0.8)); // 仮のベースライン位置
+        const LayoutUnit leading = toLayoutUnit(lineHeight) - toLayoutUnit(style.getFontSize());
+
+        size_t runCursor = 0;
+        size_t rubyCursor = 0;
+        block.lines.reserve(layout.lines.size());
+        for (const auto& range : layout.lines) {
+            TextLine line;
+            line.text.assign(layoutText.data() + range.start, range.length);
+            line.width = fromLayoutUnit(range.width);
+            line.height = lineHeight;
+            line.baseline = baseline;
+            line.hasLineBreak = range.hasLineBreak;
             
-            // 行末禁則文字の場合
-            if (m_rules.isLineEndProhibited(lastChar)) {
-                // 次の行の先頭に移動
-                currentLine.text.pop_back();
-                currentLine.width -= calculateCharacterWidth(lastChar, style, vertical);
-                
-                nextLine.text.insert(0, 1, lastChar);
-                nextLine.width += calculateCharacterWidth(lastChar, style, vertical);
+            // 伸縮した行のみ文字ごとの増減を持たせる
+            const LayoutUnit* deltas = layout.advanceDeltas.data() + range.start;
+            if (!layout.advanceDeltas.empty() &&
+                std::any_of(deltas, deltas + range.length, [](LayoutUnit delta) { return delta != 0; })) {
+                line.advanceDeltas.reserve(range.length);
+                for (size_t i = 0; i < range.length; ++i) {
+                    line.advanceDeltas.push_back(fromLayoutUnit(deltas[i]));
+                }
+            }
+            
+            // 段落のランを行で切り分け、行の先頭からの位置に直す
+            forEachRunSegment(layout.runs, runCursor, range.start, range.start + range.length,
+                              [&](const TextRun& run, size_t start, size_t end) {
+                TextRun lineRun = run;
+                lineRun.start = static_cast<uint32_t>(start - range.start);
+                lineRun.length = static_cast<uint32_t>(end - start);
+                line.runs.push_back(lineRun);
+            });
+            
+            // 親文字が行内で始まる注釈を行に持たせる（親文字だけで行が埋まり分割した場合は行末で切る）
+            const size_t lineEnd = range.start + range.length;
+            for (; rubyCursor < layout.rubies.size() && layout.rubies[rubyCursor].baseStart < lineEnd; ++rubyCursor) {
+                const RubySpan& span = layout.rubies[rubyCursor];
+                if (span.baseStart < range.start) {
+                    continue;
+                }
+                RubySpan lineSpan = span;
+                lineSpan.baseStart = static_cast<uint32_t>(span.baseStart - range.start);
+                lineSpan.baseLength = static_cast<uint32_t>(std::min<size_t>(span.baseEnd(), lineEnd) - span.baseStart);
+                lineSpan.rubyStart = static_cast<uint32_t>(line.rubyText.size());
+                line.rubyText.append(rubyText.data() + span.rubyStart, span.rubyLength);
+                line.rubies.push_back(lineSpan);
+            }
+            
+            // ルビ・圏点・傍線の配置をまとめて求め、行間に収まらない分だけ行を高くする
+            const bool annotated = std::any_of(line.runs.begin(), line.runs.end(), [](const TextRun& run) {
+                return run.emphasis != EmphasisMark::None || run.sideline != Sideline::None;
+            });
+            if (annotated || !line.rubies.empty()) {
+                AnnotationExtents extents = placeLineAnnotations(line.text, line.advanceDeltas, line.runs, line.rubies,
+                                                                 *advances, line.annotations);
+                line.annotationOver = extents.over;
+                line.annotationUnder = extents.under;
+                LayoutUnit over = toLayoutUnit(extents.over);
+                LayoutUnit extra = over + toLayoutUnit(extents.under) - leading;
+                if (extra > 0) {
+                    line.height = fromLayoutUnit(toLayoutUnit(lineHeight) + extra);
+                    line.baseline = fromLayoutUnit(toLayoutUnit(baseline) + std::min(extra, over));
+                }
             }
-        }
-        
-        // 行頭禁則処理
-        if (!nextLine.text.empty()) {
-            char32_t firstChar = nextLine.text.front();
             
-            // 行頭禁則文字の場合
-            if (m_rules.isLineStartProhibited(firstChar)) {
-                // 前の行の末尾に移動
-                nextLine.text.erase(0, 1);
-                nextLine.width -= calculateCharacterWidth(firstChar, style, vertical);
-                
-                currentLine.text.push_back(firstChar);
-                currentLine.width += calculateCharacterWidth(firstChar, style, vertical);
+            // 出力側がそのまま描画できるグリフ列を作る
+            if (config->glyphRuns) {
+                line.glyphRuns = buildGlyphRuns(line.text, line.advanceDeltas, line.runs, *advances, vertical);
             }
+            block.lines.push_back(std::move(line));
         }
     }
-}
+    if (allocationStats) {
+        *allocationStats = arena.getStats();
+    }
 
-void TypesettingEngine::applyJustification(std::vector<TextLine>& lines, const style::Style& style, double maxWidth, bool vertical) {
-    // 両端揃えの場合のみ処理
-    if (style.getTextAlignment() != style::TextAlignment::Justify) {
-        return;
+    // ブロックの幅と高さを計算（行の高さはLayoutUnitで割り切れるため合計は厳密）
+    block.width = width;
+    int64_t height = 0;
+    for (const auto& line : block.lines) {
+        height += toLayoutUnit(line.height);
     }
-    
-    for (auto& line : lines) {
-        // 明示的な改行がある場合や、行が最大幅に近い場合はスキップ
-        if (line.hasLineBreak || line.width >= maxWidth * 0.95) {
-            continue;
-        }
-        
-        // 行内の文字数
-        size_t charCount = line.text.length();
-        if (charCount <= 1) {
-            continue;
-        }
-        
-        // 追加する文字間隔を計算
-        double additionalSpacing = (maxWidth - line.width) / (charCount - 1);
-        
-        // 文字間隔を調整した新しい幅を設定
-        line.width = maxWidth;
-        
-        // 実際の描画時に文字間隔を適用する（この実装では単純に幅を調整するのみ）
+    block.height = fromLayoutUnit(height);
+
+    if (layoutCache) {
+        layoutCache->store(cacheKey, block);
+    }
+    if (diskLayoutCache) {
+        diskLayoutCache->store(cacheKey, block);
     }
+
+    return block;
 }
 
-void TypesettingEngine::applyHanging(std::vector<TextLine>& lines, const style::Style& style, bool vertical) {
-    for (auto& line : lines) {
-        // 行が空の場合はスキップ
-        if (line.text.empty()) {
-            continue;
-        }
-        
-        // 行末の文字がぶら下げ対象かチェック
-        char32_t lastChar = line.text.back();
-        if (m_rules.isHangingCharacter(lastChar)) {
-            // ぶら下げ対象の場合、行の幅を調整（実際の描画時に位置を調整）
-            double charWidth = calculateCharacterWidth(lastChar, style, vertical);
-            line.width -= charWidth * 0.5; // 半分だけぶら下げる
-        }
+std::vector<TextBlock> TypesettingEngine::typesetDocument(const document::Document& document, const style::Style& style, double width,
+                                                          const CancellationToken* cancellation, TypesetStatus* status) const {
+    std::vector<TextBlock> blocks;
+    DocumentBlockStream stream(*this, document, style, width, cancellation);
+    TypesetStatus result = typesetSections(stream, [&blocks](TextBlock&& block) {
+        blocks.push_back(std::move(block));
+        return true;
+    });
+    if (status) {
+        *status = result;
     }
+    return blocks;
 }
 
-double TypesettingEngine::calculateCharacterWidth(char32_t character, const style::Style& style, bool vertical) {
-    // 簡易的な実装：フォントサイズに基づいて幅を計算
-    // 実際の実装では、フォントメトリクスを使用して正確な幅を計算する
-    
-    double baseWidth = style.getFontSize();
-    
-    // 全角文字と半角文字で幅を調整
-    if (m_unicodeHandler.isFullWidthCharacter(character)) {
-        return baseWidth;
-    } else if (m_unicodeHandler.isHalfWidthCharacter(character)) {
-        return baseWidth * 0.5;
+std::vector<TextBlock> TypesettingEngine::typesetDocument(const document::Document& document, const style::CompiledStyleSheet& styleSheet,
+                                                          double width, const CancellationToken* cancellation,
+                                                          TypesetStatus* status) const {
+    std::vector<TextBlock> blocks;
+    DocumentBlockStream stream(*this, document, styleSheet, width, cancellation);
+    TypesetStatus result = typesetSections(stream, [&blocks](TextBlock&& block) {
+        blocks.push_back(std::move(block));
+        return true;
+    });
+    if (status) {
+        *status = result;
     }
-    
-    // デフォルトは全角として扱う
-    return baseWidth;
+    return blocks;
 }
 
-double TypesettingEngine::calculateCharacterHeight(char32_t character, const style::Style& style, bool vertical) {
-    // 簡易的な実装：フォントサイズに基づいて高さを計算
-    // 実際の実装では、フォントメトリクスを使用して正確な高さを計算する
+size_t TypesettingEngine::composeDocument(const document::Document& document, const style::Style& style,
+                                          const PageFrame& frame, const std::function<bool(Page& page)>& callback,
+                                          const CancellationToken* cancellation, TypesetStatus* status) const {
+    PageComposer composer(frame, callback);
     
-    return style.getFontSize();
-}
-
-double TypesettingEngine::calculateTextWidth(const std::u32string& text, const style::Style& style, bool vertical) {
-    double width = 0.0;
+    // ブロックが組版されるたびにページへ流し込み、埋まったページから渡していく
+    DocumentBlockStream stream(*this, document, style, frame.lineLength, cancellation);
+    TypesetStatus result = typesetSections(stream, [&composer](TextBlock&& block) {
+        return composer.addBlock(block);
+    });
     
-    for (char32_t ch : text) {
-        width += calculateCharacterWidth(ch, style, vertical);
+    // 中断された場合、組版途中のページは渡さない
+    if (result == TypesetStatus::Completed) {
+        composer.finish();
     }
-    
-    // 文字間隔を考慮
-    if (text.length() > 1) {
-        width += style.getCharacterSpacing() * style.getFontSize() * (text.length() - 1);
+    if (status) {
+        *status = result;
     }
     
-    return width;
+    return composer.getPageCount();
+}
+
+TypesetStatus TypesettingEngine::typesetSections(DocumentBlockStream& stream,
+                                                 const std::function<bool(TextBlock&& block)>& sink) {
+    TextBlock block;
+    while (stream.next(block)) {
+        if (!sink(std::move(block))) {
+            break;
+        }
+    }
+    return stream.getStatus();
 }
 
 } // namespace typesetting
@@ -23,10 +23,11 @@ TypesettingRules::~TypesettingRules() {
 
 void TypesettingRules::addLineStartProhibitedCharacter(char32_t character) {
     m_lineStartProhibitedChars.insert(character);
+    addToRuleFilter(character);
 }
 
 bool TypesettingRules::isLineStartProhibited(char32_t character) const {
-    return m_lineStartProhibitedChars.find(character) != m_lineStartProhibitedChars.end();
+    return mayHaveRule(character) && m_lineStartProhibitedChars.find(character) != m_lineStartProhibitedChars.end();
 }
 
 const std::set<char32_t>& TypesettingRules::getLineStartProhibitedCharacters() const {
@@ -35,10 +36,11 @@ const std::set<char32_t>& TypesettingRules::getLineStartProhibitedCharacters() c
 
 void TypesettingRules::addLineEndProhibitedCharacter(char32_t character) {
     m_lineEndProhibitedChars.insert(character);
+    addToRuleFilter(character);
 }
 
 bool TypesettingRules::isLineEndProhibited(char32_t character) const {
-    return m_lineEndProhibitedChars.find(character) != m_lineEndProhibitedChars.end();
+    return mayHaveRule(character) && m_lineEndProhibitedChars.find(character) != m_lineEndProhibitedChars.end();
 }
 
 const std::set<char32_t>& TypesettingRules::getLineEndProhibitedCharacters() const {
@@ -47,10 +49,11 @@ const std::set<char32_t>& TypesettingRules::getLineEndProhibitedCharacters() con
 
 void TypesettingRules::addInseparableCharacter(char32_t character) {
     m_inseparableChars.insert(character);
+    addToRuleFilter(character);
 }
 
 bool TypesettingRules::isInseparable(char32_t character) const {
-    return m_inseparableChars.find(character) != m_inseparableChars.end();
+    return mayHaveRule(character) && m_inseparableChars.find(character) != m_inseparableChars.end();
 }
 
 const std::set<char32_t>& TypesettingRules::getInseparableCharacters() const {
@@ -59,16 +62,54 @@ const std::set<char32_t>& TypesettingRules::getInseparableCharacters() const {
 
 void TypesettingRules::addHangingCharacter(char32_t character) {
     m_hangingChars.insert(character);
+    addToRuleFilter(character);
 }
 
 bool TypesettingRules::isHangingCharacter(char32_t character) const {
-    return m_hangingChars.find(character) != m_hangingChars.end();
+    return mayHaveRule(character) && m_hangingChars.find(character) != m_hangingChars.end();
 }
 
 const std::set<char32_t>& TypesettingRules::getHangingCharacters() const {
     return m_hangingChars;
 }
 
+void TypesettingRules::addToRuleFilter(char32_t character) {
+    uint32_t bit = static_cast<uint32_t>(character) & 1023;
+    m_ruleFilter[bit >> 6] |= uint64_t(1) << (bit & 63);
+}
+
+uint64_t TypesettingRules::getFingerprint() const {
+    // FNV-1a でセットの内容を順に混ぜる（セットの区切りも含める）
+    uint64_t hash = 14695981039346656037ULL;
+    auto mix = [&hash](uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            hash ^= (value >> (i * 8)) & 0xFF;
+            hash *= 1099511628211ULL;
+        }
+    };
+
+    for (const auto* characters : {&m_lineStartProhibitedChars, &m_lineEndProhibitedChars,
+                                   &m_inseparableChars, &m_hangingChars}) {
+        mix(static_cast<uint32_t>(characters->size()));
+        for (char32_t ch : *characters) {
+            mix(static_cast<uint32_t>(ch));
+        }
+    }
+    return hash;
+}
+
+bool TypesettingRules::operator==(const TypesettingRules& other) const {
+    // フィルタはセットから決まるため比較しない
+    return m_lineStartProhibitedChars == other.m_lineStartProhibitedChars &&
+           m_lineEndProhibitedChars == other.m_lineEndProhibitedChars &&
+           m_inseparableChars == other.m_inseparableChars &&
+           m_hangingChars == other.m_hangingChars;
+}
+
+bool TypesettingRules::operator!=(const TypesettingRules& other) const {
+    return !(*this == other);
+}
+
 void TypesettingRules::setDefaultJisX4051Rules() {
     // 行頭禁則文字（JIS X 4051準拠）
     // 句読点
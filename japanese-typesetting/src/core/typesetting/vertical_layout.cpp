@@ -4,46 +4,226 @@
  */
 
 #include "japanese_typesetting/core/typesetting/vertical_layout.h"
-#include <map>
+#include "japanese_typesetting/core/typesetting/itemizer.h"
+#include "japanese_typesetting/core/typesetting/width_kernels.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define JAPANESE_TYPESETTING_X86_SIMD 1
+#include <immintrin.h>
+#endif
 
 namespace japanese_typesetting {
 namespace core {
 namespace typesetting {
 
-// 横書き文字から縦書き文字への変換マップ
-static const std::map<char32_t, char32_t> horizontalToVerticalMap = {
-    {U'(', U'︵'}, // 左括弧
-    {U')', U'︶'}, // 右括弧
-    {U'[', U'﹇'}, // 左角括弧
-    {U']', U'﹈'}, // 右角括弧
-    {U'{', U'︷'}, // 左波括弧
-    {U'}', U'︸'}, // 右波括弧
-    {U'<', U'︿'}, // 左山括弧
-    {U'>', U'﹀'}, // 右山括弧
-    {U'«', U'︽'}, // 左二重山括弧
-    {U'»', U'︾'}, // 右二重山括弧
-    {U'—', U'︱'}, // ダッシュ
-    {U'－', U'｜'}, // ハイフン
-    {U'…', U'︙'}, // 三点リーダー
+namespace {
+
+/**
+ * @struct FormMapping
+ * @brief 字形の置き換え（変換元の昇順に並べて二分探索する）
+ */
+struct FormMapping {
+    char32_t from;  ///< 変換元
+    char32_t to;    ///< 変換先
 };
 
-// 縦書き文字から横書き文字への変換マップ
-static const std::map<char32_t, char32_t> verticalToHorizontalMap = {
-    {U'︵', U'('}, // 左括弧
-    {U'︶', U')'}, // 右括弧
-    {U'﹇', U'['}, // 左角括弧
-    {U'﹈', U']'}, // 右角括弧
-    {U'︷', U'{'}, // 左波括弧
-    {U'︸', U'}'}, // 右波括弧
-    {U'︿', U'<'}, // 左山括弧
-    {U'﹀', U'>'}, // 右山括弧
-    {U'︽', U'«'}, // 左二重山括弧
-    {U'︾', U'»'}, // 右二重山括弧
-    {U'︱', U'—'}, // ダッシュ
-    {U'｜', U'－'}, // ハイフン
-    {U'︙', U'…'}, // 三点リーダー
+// 横書き文字から縦書き文字への変換表
+constexpr FormMapping kHorizontalToVertical[] = {
+    {U'(', U'︵'},      // 左括弧
+    {U')', U'︶'},      // 右括弧
+    {U'<', U'︿'},      // 左山括弧
+    {U'>', U'﹀'},      // 右山括弧
+    {U'[', U'﹇'},      // 左角括弧
+    {U']', U'﹈'},      // 右角括弧
+    {U'{', U'︷'},      // 左波括弧
+    {U'}', U'︸'},      // 右波括弧
+    {U'«', U'︽'},      // 左二重山括弧
+    {U'»', U'︾'},      // 右二重山括弧
+    {U'—', U'︱'},      // ダッシュ
+    {U'…', U'︙'},      // 三点リーダー
+    {U'－', U'｜'},     // ハイフン
+};
+
+// 縦書き文字から横書き文字への変換表
+constexpr FormMapping kVerticalToHorizontal[] = {
+    {U'︙', U'…'},      // 三点リーダー
+    {U'︱', U'—'},      // ダッシュ
+    {U'︵', U'('},      // 左括弧
+    {U'︶', U')'},      // 右括弧
+    {U'︷', U'{'},      // 左波括弧
+    {U'︸', U'}'},      // 右波括弧
+    {U'︽', U'«'},      // 左二重山括弧
+    {U'︾', U'»'},      // 右二重山括弧
+    {U'︿', U'<'},      // 左山括弧
+    {U'﹀', U'>'},      // 右山括弧
+    {U'﹇', U'['},      // 左角括弧
+    {U'﹈', U']'},      // 右角括弧
+    {U'｜', U'－'},     // ハイフン
+};
+
+template <size_t N>
+constexpr bool isSorted(const FormMapping (&table)[N]) {
+    for (size_t i = 1; i < N; ++i) {
+        if (!(table[i - 1].from < table[i].from)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <size_t N>
+constexpr char32_t lookupForm(const FormMapping (&table)[N], char32_t character) {
+    size_t low = 0;
+    size_t high = N;
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        if (table[middle].from < character) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low < N && table[low].from == character ? table[low].to : character;
+}
+
+template <size_t N, size_t M>
+constexpr bool isRoundTrip(const FormMapping (&forward)[N], const FormMapping (&backward)[M]) {
+    if (N != M) {
+        return false;
+    }
+    for (size_t i = 0; i < N; ++i) {
+        if (lookupForm(backward, forward[i].to) != forward[i].from) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(isSorted(kHorizontalToVertical) && isSorted(kVerticalToHorizontal),
+              "変換表は変換元の昇順に並べること");
+static_assert(isRoundTrip(kHorizontalToVertical, kVerticalToHorizontal),
+              "縦書きと横書きの変換表は互いに逆変換であること");
+
+/**
+ * @struct CandidateRange
+ * @brief 変換表に含まれうる文字の範囲（ベクトル命令での事前判定用）
+ *
+ * 範囲内か単独の文字に一致する文字だけを表で引く。かな・漢字はどちらにも含まれない。
+ */
+struct CandidateRange {
+    char32_t first;   ///< 範囲の先頭
+    char32_t last;    ///< 範囲の末尾
+    char32_t single;  ///< 範囲外の単独の文字
 };
 
+constexpr CandidateRange kHorizontalCandidates = {U'(', U'…', U'－'};
+constexpr CandidateRange kVerticalCandidates = {U'︙', U'﹈', U'｜'};
+
+template <size_t N>
+constexpr bool coversTable(const CandidateRange& range, const FormMapping (&table)[N]) {
+    for (size_t i = 0; i < N; ++i) {
+        if ((table[i].from < range.first || table[i].from > range.last) && table[i].from != range.single) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(coversTable(kHorizontalCandidates, kHorizontalToVertical) &&
+              coversTable(kVerticalCandidates, kVerticalToHorizontal),
+              "事前判定の範囲は変換表のすべての文字を含むこと");
+
+inline bool isCandidate(char32_t character, const CandidateRange& range) {
+    return (character >= range.first && character <= range.last) || character == range.single;
+}
+
+size_t findCandidateScalar(const char32_t* text, size_t length, const CandidateRange& range) {
+    for (size_t i = 0; i < length; ++i) {
+        if (isCandidate(text[i], range)) {
+            return i;
+        }
+    }
+    return length;
+}
+
+#ifdef JAPANESE_TYPESETTING_X86_SIMD
+
+// 符号付き比較を使う（Unicodeの範囲の文字は正の値になる）
+__attribute__((target("avx2")))
+size_t findCandidateAvx2(const char32_t* text, size_t length, const CandidateRange& range) {
+    const __m256i below = _mm256_set1_epi32(static_cast<int32_t>(range.first) - 1);
+    const __m256i above = _mm256_set1_epi32(static_cast<int32_t>(range.last) + 1);
+    const __m256i single = _mm256_set1_epi32(static_cast<int32_t>(range.single));
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i));
+        __m256i inRange = _mm256_and_si256(_mm256_cmpgt_epi32(x, below), _mm256_cmpgt_epi32(above, x));
+        __m256i hit = _mm256_or_si256(inRange, _mm256_cmpeq_epi32(x, single));
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(hit));
+        if (mask != 0) {
+            return i + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+        }
+    }
+    return i + findCandidateScalar(text + i, length - i, range);
+}
+
+__attribute__((target("sse2")))
+size_t findCandidateSse2(const char32_t* text, size_t length, const CandidateRange& range) {
+    const __m128i below = _mm_set1_epi32(static_cast<int32_t>(range.first) - 1);
+    const __m128i above = _mm_set1_epi32(static_cast<int32_t>(range.last) + 1);
+    const __m128i single = _mm_set1_epi32(static_cast<int32_t>(range.single));
+    size_t i = 0;
+    for (; i + 4 <= length; i += 4) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+        __m128i inRange = _mm_and_si128(_mm_cmpgt_epi32(x, below), _mm_cmplt_epi32(x, above));
+        __m128i hit = _mm_or_si128(inRange, _mm_cmpeq_epi32(x, single));
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(hit));
+        if (mask != 0) {
+            return i + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+        }
+    }
+    return i + findCandidateScalar(text + i, length - i, range);
+}
+
+#endif // JAPANESE_TYPESETTING_X86_SIMD
+
+// 変換表に含まれうる最初の文字の位置（ない場合はlength）
+size_t findCandidate(const char32_t* text, size_t length, const CandidateRange& range) {
+#ifdef JAPANESE_TYPESETTING_X86_SIMD
+    switch (getSimdLevel()) {
+    case SimdLevel::AVX2:
+        return findCandidateAvx2(text, length, range);
+    case SimdLevel::SSE2:
+        return findCandidateSse2(text, length, range);
+    default:
+        break;
+    }
+#endif
+    return findCandidateScalar(text, length, range);
+}
+
+// 候補の文字だけを表で引いて置き換える
+template <size_t N>
+size_t convertInPlace(char32_t* text, size_t length, const CandidateRange& range, const FormMapping (&table)[N]) {
+    size_t converted = 0;
+    size_t i = findCandidate(text, length, range);
+    while (i < length) {
+        char32_t mapped = lookupForm(table, text[i]);
+        if (mapped != text[i]) {
+            text[i] = mapped;
+            converted++;
+        }
+        ++i;
+        // 候補が続く間は1文字ずつ、途切れたら再びまとめて読み飛ばす
+        if (i < length && !isCandidate(text[i], range)) {
+            i += findCandidate(text + i, length - i, range);
+        }
+    }
+    return converted;
+}
+
+} // namespace
+
 VerticalLayoutProcessor::VerticalLayoutProcessor(const unicode::UnicodeHandler& unicodeHandler)
     : m_unicodeHandler(unicodeHandler) {
 }
@@ -53,70 +233,50 @@ VerticalLayoutProcessor::~VerticalLayoutProcessor() {
 }
 
 char32_t VerticalLayoutProcessor::convertToVertical(char32_t character) const {
-    // 横書き文字から縦書き文字への変換
-    auto it = horizontalToVerticalMap.find(character);
-    if (it != horizontalToVerticalMap.end()) {
-        return it->second;
-    }
-    
-    return character; // 変換がない場合は元の文字を返す
+    // 変換がない場合は元の文字を返す
+    return lookupForm(kHorizontalToVertical, character);
 }
 
 char32_t VerticalLayoutProcessor::convertToHorizontal(char32_t character) const {
-    // 縦書き文字から横書き文字への変換
-    auto it = verticalToHorizontalMap.find(character);
-    if (it != verticalToHorizontalMap.end()) {
-        return it->second;
-    }
-    
-    return character; // 変換がない場合は元の文字を返す
+    // 変換がない場合は元の文字を返す
+    return lookupForm(kVerticalToHorizontal, character);
 }
 
 std::u32string VerticalLayoutProcessor::convertToVertical(const std::u32string& text) const {
-    std::u32string result;
-    result.reserve(text.length());
-    
-    for (char32_t ch : text) {
-        result.push_back(convertToVertical(ch));
-    }
-    
+    std::u32string result(text);
+    convertToVerticalInPlace(result);
     return result;
 }
 
 std::u32string VerticalLayoutProcessor::convertToHorizontal(const std::u32string& text) const {
-    std::u32string result;
-    result.reserve(text.length());
-    
-    for (char32_t ch : text) {
-        result.push_back(convertToHorizontal(ch));
-    }
-    
+    std::u32string result(text);
+    convertToHorizontalInPlace(result);
     return result;
 }
 
+size_t VerticalLayoutProcessor::convertToVerticalInPlace(char32_t* text, size_t length) const {
+    return convertInPlace(text, length, kHorizontalCandidates, kHorizontalToVertical);
+}
+
+size_t VerticalLayoutProcessor::convertToHorizontalInPlace(char32_t* text, size_t length) const {
+    return convertInPlace(text, length, kVerticalCandidates, kVerticalToHorizontal);
+}
+
+size_t VerticalLayoutProcessor::convertToVerticalInPlace(std::u32string& text) const {
+    return convertToVerticalInPlace(&text[0], text.length());
+}
+
+size_t VerticalLayoutProcessor::convertToHorizontalInPlace(std::u32string& text) const {
+    return convertToHorizontalInPlace(&text[0], text.length());
+}
+
 int VerticalLayoutProcessor::getCharacterRotation(char32_t character, bool vertical) const {
     if (!vertical) {
         return 0; // 横書きの場合は回転なし
     }
     
-    // 縦書きでの文字の回転角度を決定
-    // アルファベット、数字は90度回転
-    if ((character >= U'a' && character <= U'z') ||
-        (character >= U'A' && character <= U'Z') ||
-        (character >= U'0' && character <= U'9')) {
-        return 90;
-    }
-    
-    // 一部の記号も90度回転
-    if (character == U'/' || character == U'\\' || 
-        character == U'|' || character == U'-' || 
-        character == U'_' || character == U'=' || 
-        character == U'+' || character == U'*') {
-        return 90;
-    }
-    
-    // その他の文字は回転なし
-    return 0;
+    // 組版時のランへの分割と同じ分類を使う
+    return classifyCharacter(character, vertical).orientation == GlyphOrientation::Sideways ? 90 : 0;
 }
 
 } // namespace typesetting
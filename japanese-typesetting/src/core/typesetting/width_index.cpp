@@ -0,0 +1,241 @@
+/**
+ * @file width_index.cpp
+ * @brief 編集に追従する段落の送り幅の索引の実装
+ */
+
+#include "japanese_typesetting/core/typesetting/width_index.h"
+#include "japanese_typesetting/core/typesetting/width_kernels.h"
+#include <algorithm>
+
+namespace japanese_typesetting {
+namespace core {
+namespace typesetting {
+
+AdvanceWidthIndex::AdvanceWidthIndex()
+    : m_root(kNull)
+    , m_seed(0x9E3779B9u) {
+}
+
+AdvanceWidthIndex::~AdvanceWidthIndex() {
+    // 特に何もしない
+}
+
+void AdvanceWidthIndex::assign(const GlyphAdvanceTable& advances, const char32_t* text, size_t length) {
+    clear();
+    std::vector<LayoutUnit> widths(length);
+    gatherAdvances(advances, text, length, widths.data());
+    m_nodes.reserve(length);
+    m_root = build(widths.data(), length);
+}
+
+void AdvanceWidthIndex::insert(size_t position, const GlyphAdvanceTable& advances, const char32_t* text, size_t length) {
+    if (length == 0) {
+        return;
+    }
+    std::vector<LayoutUnit> widths(length);
+    gatherAdvances(advances, text, length, widths.data());
+    uint32_t inserted = build(widths.data(), length);
+
+    uint32_t left = kNull;
+    uint32_t right = kNull;
+    split(m_root, std::min(position, size()), left, right);
+    m_root = merge(merge(left, inserted), right);
+}
+
+void AdvanceWidthIndex::erase(size_t position, size_t length) {
+    if (position >= size() || length == 0) {
+        return;
+    }
+    uint32_t left = kNull;
+    uint32_t middle = kNull;
+    uint32_t right = kNull;
+    split(m_root, position, left, middle);
+    split(middle, length, middle, right);
+    release(middle);
+    m_root = merge(left, right);
+}
+
+void AdvanceWidthIndex::clear() {
+    m_nodes.clear();
+    m_free.clear();
+    m_root = kNull;
+}
+
+size_t AdvanceWidthIndex::size() const {
+    return count(m_root);
+}
+
+LayoutUnit AdvanceWidthIndex::advanceAt(size_t position) const {
+    uint32_t node = m_root;
+    while (node != kNull) {
+        const Node& current = m_nodes[node];
+        size_t leftCount = count(current.left);
+        if (position < leftCount) {
+            node = current.left;
+        } else if (position == leftCount) {
+            return current.advance;
+        } else {
+            position -= leftCount + 1;
+            node = current.right;
+        }
+    }
+    return 0;
+}
+
+int64_t AdvanceWidthIndex::prefix(size_t position) const {
+    int64_t total = 0;
+    uint32_t node = m_root;
+    while (node != kNull && position > 0) {
+        const Node& current = m_nodes[node];
+        size_t leftCount = count(current.left);
+        if (position <= leftCount) {
+            node = current.left;
+        } else {
+            // 左の部分木とこの文字は範囲に含まれる
+            total += sum(current.left) + current.advance;
+            position -= leftCount + 1;
+            node = current.right;
+        }
+    }
+    return total;
+}
+
+int64_t AdvanceWidthIndex::width(size_t start, size_t end) const {
+    return end > start ? prefix(end) - prefix(start) : 0;
+}
+
+size_t AdvanceWidthIndex::findPosition(int64_t width) const {
+    size_t position = 0;
+    uint32_t node = m_root;
+    while (node != kNull) {
+        const Node& current = m_nodes[node];
+        int64_t leftSum = sum(current.left);
+        if (leftSum > width) {
+            node = current.left;
+            continue;
+        }
+        width -= leftSum;
+        position += count(current.left);
+        if (current.advance > width) {
+            break;
+        }
+        width -= current.advance;
+        position++;
+        node = current.right;
+    }
+    return position;
+}
+
+uint32_t AdvanceWidthIndex::allocate(LayoutUnit advance) {
+    // 優先度はxorshiftで決める（同じ編集の列からは常に同じ木ができる）
+    m_seed ^= m_seed << 13;
+    m_seed ^= m_seed >> 17;
+    m_seed ^= m_seed << 5;
+    Node node{kNull, kNull, m_seed, 1, advance, advance};
+
+    if (!m_free.empty()) {
+        uint32_t index = m_free.back();
+        m_free.pop_back();
+        m_nodes[index] = node;
+        return index;
+    }
+    m_nodes.push_back(node);
+    return static_cast<uint32_t>(m_nodes.size() - 1);
+}
+
+uint32_t AdvanceWidthIndex::build(const LayoutUnit* widths, size_t length) {
+    // 並び順に節点を追加しながら、右端の経路をスタックに持って木を組む（O(n)）
+    // スタックから外した節点は部分木が確定しているため、そのときに集計する
+    m_stack.clear();
+    for (size_t i = 0; i < length; ++i) {
+        uint32_t node = allocate(widths[i]);
+        uint32_t last = kNull;
+        while (!m_stack.empty() && m_nodes[m_stack.back()].priority < m_nodes[node].priority) {
+            last = m_stack.back();
+            m_stack.pop_back();
+            update(last);
+        }
+        m_nodes[node].left = last;
+        if (!m_stack.empty()) {
+            m_nodes[m_stack.back()].right = node;
+        }
+        m_stack.push_back(node);
+    }
+
+    uint32_t root = kNull;
+    while (!m_stack.empty()) {
+        root = m_stack.back();
+        m_stack.pop_back();
+        update(root);
+    }
+    return root;
+}
+
+void AdvanceWidthIndex::update(uint32_t node) {
+    Node& current = m_nodes[node];
+    current.count = count(current.left) + count(current.right) + 1;
+    current.sum = sum(current.left) + sum(current.right) + current.advance;
+}
+
+void AdvanceWidthIndex::split(uint32_t node, size_t position, uint32_t& left, uint32_t& right) {
+    if (node == kNull) {
+        left = kNull;
+        right = kNull;
+        return;
+    }
+    uint32_t leftCount = count(m_nodes[node].left);
+    if (position <= leftCount) {
+        uint32_t child = kNull;
+        split(m_nodes[node].left, position, left, child);
+        m_nodes[node].left = child;
+        right = node;
+    } else {
+        uint32_t child = kNull;
+        split(m_nodes[node].right, position - leftCount - 1, child, right);
+        m_nodes[node].right = child;
+        left = node;
+    }
+    update(node);
+}
+
+uint32_t AdvanceWidthIndex::merge(uint32_t left, uint32_t right) {
+    if (left == kNull) {
+        return right;
+    }
+    if (right == kNull) {
+        return left;
+    }
+    if (m_nodes[left].priority > m_nodes[right].priority) {
+        uint32_t child = merge(m_nodes[left].right, right);
+        m_nodes[left].right = child;
+        update(left);
+        return left;
+    }
+    uint32_t child = merge(left, m_nodes[right].left);
+    m_nodes[right].left = child;
+    update(right);
+    return right;
+}
+
+void AdvanceWidthIndex::release(uint32_t node) {
+    if (node == kNull) {
+        return;
+    }
+    m_stack.clear();
+    m_stack.push_back(node);
+    while (!m_stack.empty()) {
+        uint32_t current = m_stack.back();
+        m_stack.pop_back();
+        if (m_nodes[current].left != kNull) {
+            m_stack.push_back(m_nodes[current].left);
+        }
+        if (m_nodes[current].right != kNull) {
+            m_stack.push_back(m_nodes[current].right);
+        }
+        m_free.push_back(current);
+    }
+}
+
+} // namespace typesetting
+} // namespace core
+} // namespace japanese_typesetting
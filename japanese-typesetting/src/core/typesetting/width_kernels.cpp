@@ -0,0 +1,302 @@
+/**
+ * @file width_kernels.cpp
+ * @brief 送り幅の合計・累積和を求めるベクトル化されたカーネルの実装
+ */
+
+#include "japanese_typesetting/core/typesetting/width_kernels.h"
+#include <algorithm>
+#include <atomic>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define JAPANESE_TYPESETTING_X86_SIMD 1
+#define JAPANESE_TYPESETTING_TARGET(isa) __attribute__((target(isa)))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+// MSVCはコンパイラの設定によらず組み込み関数を使えるため、関数ごとの指定は不要
+#define JAPANESE_TYPESETTING_X86_SIMD 1
+#define JAPANESE_TYPESETTING_TARGET(isa)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace japanese_typesetting {
+namespace core {
+namespace typesetting {
+
+namespace {
+
+// 1度に処理する文字数（スタック上の一時領域の大きさ）
+const size_t kChunkSize = 256;
+
+std::atomic<int> g_simdLevel(-1);
+
+// 1文字ずつ送り幅を引く
+void gatherScalar(const GlyphAdvanceTable& advances, const char32_t* text, size_t length, LayoutUnit* widths) {
+    for (size_t i = 0; i < length; ++i) {
+        widths[i] = advances.getAdvanceUnits(text[i]);
+    }
+}
+
+#ifdef JAPANESE_TYPESETTING_X86_SIMD
+
+// 密な配列の範囲（GlyphAdvanceTable::denseIndexと同じ）
+//   U+0000-U+00FF → 0x0000-、U+3000-U+9FFF → 0x0100-、U+FF00-U+FFEF → 0x7100-
+JAPANESE_TYPESETTING_TARGET("avx2")
+void gatherAvx2(const GlyphAdvanceTable& advances, const LayoutUnit* dense,
+                const char32_t* text, size_t length, LayoutUnit* widths) {
+    const __m256i lo1 = _mm256_set1_epi32(0x3000);
+    const __m256i lo2 = _mm256_set1_epi32(0xFF00);
+    const __m256i size0 = _mm256_set1_epi32(0x100);
+    const __m256i size1 = _mm256_set1_epi32(0xA000 - 0x3000);
+    const __m256i size2 = _mm256_set1_epi32(0xFFF0 - 0xFF00);
+    const __m256i base1 = _mm256_set1_epi32(0x100);
+    const __m256i base2 = _mm256_set1_epi32(0x7100);
+    const __m256i minusOne = _mm256_set1_epi32(-1);
+
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        __m256i ch = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i));
+
+        // 範囲ごとに添字を求め、範囲外は-1とする
+        __m256i d1 = _mm256_sub_epi32(ch, lo1);
+        __m256i d2 = _mm256_sub_epi32(ch, lo2);
+        __m256i in0 = _mm256_and_si256(_mm256_cmpgt_epi32(ch, minusOne), _mm256_cmpgt_epi32(size0, ch));
+        __m256i in1 = _mm256_and_si256(_mm256_cmpgt_epi32(d1, minusOne), _mm256_cmpgt_epi32(size1, d1));
+        __m256i in2 = _mm256_and_si256(_mm256_cmpgt_epi32(d2, minusOne), _mm256_cmpgt_epi32(size2, d2));
+        __m256i index = _mm256_and_si256(in0, ch);
+        index = _mm256_or_si256(index, _mm256_and_si256(in1, _mm256_add_epi32(d1, base1)));
+        index = _mm256_or_si256(index, _mm256_and_si256(in2, _mm256_add_epi32(d2, base2)));
+        __m256i inDense = _mm256_or_si256(in0, _mm256_or_si256(in1, in2));
+
+        // 密な範囲の文字はまとめて収集する
+        __m256i values = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), dense, index, inDense, 4);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(widths + i), values);
+
+        // 範囲外の文字のみ1文字ずつ引く
+        int denseMask = _mm256_movemask_ps(_mm256_castsi256_ps(inDense));
+        if (denseMask != 0xFF) {
+            for (int lane = 0; lane < 8; ++lane) {
+                if (!(denseMask & (1 << lane))) {
+                    widths[i + lane] = advances.getAdvanceUnits(text[i + lane]);
+                }
+            }
+        }
+    }
+    gatherScalar(advances, text + i, length - i, widths + i);
+}
+
+// SSE2には収集命令がないため、添字の計算のみをベクトル化する
+JAPANESE_TYPESETTING_TARGET("sse2")
+void gatherSse2(const GlyphAdvanceTable& advances, const LayoutUnit* dense,
+                const char32_t* text, size_t length, LayoutUnit* widths) {
+    const __m128i lo1 = _mm_set1_epi32(0x3000);
+    const __m128i lo2 = _mm_set1_epi32(0xFF00);
+    const __m128i size0 = _mm_set1_epi32(0x100);
+    const __m128i size1 = _mm_set1_epi32(0xA000 - 0x3000);
+    const __m128i size2 = _mm_set1_epi32(0xFFF0 - 0xFF00);
+    const __m128i base1 = _mm_set1_epi32(0x100);
+    const __m128i base2 = _mm_set1_epi32(0x7100);
+    const __m128i minusOne = _mm_set1_epi32(-1);
+
+    alignas(16) int32_t indices[4];
+    size_t i = 0;
+    for (; i + 4 <= length; i += 4) {
+        __m128i ch = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+        __m128i d1 = _mm_sub_epi32(ch, lo1);
+        __m128i d2 = _mm_sub_epi32(ch, lo2);
+        __m128i in0 = _mm_and_si128(_mm_cmpgt_epi32(ch, minusOne), _mm_cmpgt_epi32(size0, ch));
+        __m128i in1 = _mm_and_si128(_mm_cmpgt_epi32(d1, minusOne), _mm_cmpgt_epi32(size1, d1));
+        __m128i in2 = _mm_and_si128(_mm_cmpgt_epi32(d2, minusOne), _mm_cmpgt_epi32(size2, d2));
+        __m128i inDense = _mm_or_si128(in0, _mm_or_si128(in1, in2));
+        __m128i index = _mm_and_si128(in0, ch);
+        index = _mm_or_si128(index, _mm_and_si128(in1, _mm_add_epi32(d1, base1)));
+        index = _mm_or_si128(index, _mm_and_si128(in2, _mm_add_epi32(d2, base2)));
+        // 範囲外の添字は-1とする
+        index = _mm_or_si128(index, _mm_andnot_si128(inDense, minusOne));
+        _mm_store_si128(reinterpret_cast<__m128i*>(indices), index);
+
+        for (int lane = 0; lane < 4; ++lane) {
+            widths[i + lane] = indices[lane] >= 0 ? dense[indices[lane]]
+                                                  : advances.getAdvanceUnits(text[i + lane]);
+        }
+    }
+    gatherScalar(advances, text + i, length - i, widths + i);
+}
+
+#endif // JAPANESE_TYPESETTING_X86_SIMD
+
+// 送り幅を1チャンク分展開する
+void gatherChunk(const GlyphAdvanceTable& advances, const char32_t* text, size_t length, LayoutUnit* widths) {
+    const LayoutUnit* dense = advances.getDenseAdvances();
+    if (!dense) {
+        // 事前計算前のテーブルは未計算の値を含むため、1文字ずつ引く
+        gatherScalar(advances, text, length, widths);
+        return;
+    }
+
+    switch (getSimdLevel()) {
+#ifdef JAPANESE_TYPESETTING_X86_SIMD
+    case SimdLevel::AVX2:
+        gatherAvx2(advances, dense, text, length, widths);
+        return;
+    case SimdLevel::SSE2:
+        gatherSse2(advances, dense, text, length, widths);
+        return;
+#endif
+    default:
+        gatherScalar(advances, text, length, widths);
+        return;
+    }
+}
+
+#ifdef JAPANESE_TYPESETTING_X86_SIMD
+
+JAPANESE_TYPESETTING_TARGET("avx2")
+int64_t sumAvx2(const LayoutUnit* widths, size_t length) {
+    // 64ビットに広げて加算する（桁あふれしない）
+    __m256i total = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        __m256i values = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(widths + i));
+        total = _mm256_add_epi64(total, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(values)));
+        total = _mm256_add_epi64(total, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(values, 1)));
+    }
+    alignas(32) int64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), total);
+    int64_t sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    for (; i < length; ++i) {
+        sum += widths[i];
+    }
+    return sum;
+}
+
+// チャンク内の累積和を64ビットで求める（2要素ずつシフトと加算で走査する）
+// 送り幅はLayoutUnitの上限で飽和するため、32ビットのまま足すと桁あふれする
+JAPANESE_TYPESETTING_TARGET("sse2")
+void scanSse2(const LayoutUnit* widths, size_t length, int64_t base, int64_t* prefix) {
+    __m128i carry = _mm_set1_epi64x(base);
+    size_t i = 0;
+    for (; i + 4 <= length; i += 4) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(widths + i));
+        __m128i sign = _mm_srai_epi32(x, 31);
+        __m128i lo = _mm_unpacklo_epi32(x, sign);
+        __m128i hi = _mm_unpackhi_epi32(x, sign);
+        lo = _mm_add_epi64(_mm_add_epi64(lo, _mm_slli_si128(lo, 8)), carry);
+        carry = _mm_shuffle_epi32(lo, _MM_SHUFFLE(3, 2, 3, 2));
+        hi = _mm_add_epi64(_mm_add_epi64(hi, _mm_slli_si128(hi, 8)), carry);
+        carry = _mm_shuffle_epi32(hi, _MM_SHUFFLE(3, 2, 3, 2));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(prefix + i), lo);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(prefix + i + 2), hi);
+    }
+    int64_t running = i > 0 ? prefix[i - 1] : base;
+    for (; i < length; ++i) {
+        running += widths[i];
+        prefix[i] = running;
+    }
+}
+
+#endif // JAPANESE_TYPESETTING_X86_SIMD
+
+int64_t sumWidths(const LayoutUnit* widths, size_t length) {
+#ifdef JAPANESE_TYPESETTING_X86_SIMD
+    if (getSimdLevel() == SimdLevel::AVX2) {
+        return sumAvx2(widths, length);
+    }
+#endif
+    // 送り幅は非負なので、チャンク内の合計は32ビットに収まらない場合でも64ビットで足す
+    int64_t sum = 0;
+    for (size_t i = 0; i < length; ++i) {
+        sum += widths[i];
+    }
+    return sum;
+}
+
+} // namespace
+
+SimdLevel getSupportedSimdLevel() {
+#if defined(JAPANESE_TYPESETTING_X86_SIMD) && defined(_MSC_VER)
+    // AVX2はCPUの対応に加え、OSがYMMレジスタを保存する（XCR0のビット1・2）ことを確かめる
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    bool sse2 = (info[3] & (1 << 26)) != 0;
+    bool osAvx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+    if (osAvx && maxLeaf >= 7) {
+        __cpuidex(info, 7, 0);
+        if (info[1] & (1 << 5)) {
+            return SimdLevel::AVX2;
+        }
+    }
+    if (sse2) {
+        return SimdLevel::SSE2;
+    }
+#elif defined(JAPANESE_TYPESETTING_X86_SIMD)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return SimdLevel::AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return SimdLevel::SSE2;
+    }
+#endif
+    return SimdLevel::Scalar;
+}
+
+SimdLevel getSimdLevel() {
+    int level = g_simdLevel.load(std::memory_order_relaxed);
+    if (level < 0) {
+        level = static_cast<int>(getSupportedSimdLevel());
+        g_simdLevel.store(level, std::memory_order_relaxed);
+    }
+    return static_cast<SimdLevel>(level);
+}
+
+void setSimdLevel(SimdLevel level) {
+    SimdLevel supported = getSupportedSimdLevel();
+    if (static_cast<int>(level) > static_cast<int>(supported)) {
+        level = supported;
+    }
+    g_simdLevel.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+void gatherAdvances(const GlyphAdvanceTable& advances, const char32_t* text, size_t length, LayoutUnit* widths) {
+    gatherChunk(advances, text, length, widths);
+}
+
+int64_t sumAdvances(const GlyphAdvanceTable& advances, const char32_t* text, size_t length) {
+    // 一時領域をスタックに置き、チャンクごとに展開して足す
+    LayoutUnit widths[kChunkSize];
+    int64_t sum = 0;
+    for (size_t offset = 0; offset < length; offset += kChunkSize) {
+        size_t count = std::min(kChunkSize, length - offset);
+        gatherChunk(advances, text + offset, count, widths);
+        sum += sumWidths(widths, count);
+    }
+    return sum;
+}
+
+void prefixAdvances(const GlyphAdvanceTable& advances, const char32_t* text, size_t length, int64_t* prefix) {
+    LayoutUnit widths[kChunkSize];
+    prefix[0] = 0;
+    for (size_t offset = 0; offset < length; offset += kChunkSize) {
+        size_t count = std::min(kChunkSize, length - offset);
+        gatherChunk(advances, text + offset, count, widths);
+
+        int64_t base = prefix[offset];
+#ifdef JAPANESE_TYPESETTING_X86_SIMD
+        if (getSimdLevel() != SimdLevel::Scalar) {
+            scanSse2(widths, count, base, prefix + offset + 1);
+            continue;
+        }
+#endif
+        for (size_t i = 0; i < count; ++i) {
+            base += widths[i];
+            prefix[offset + i + 1] = base;
+        }
+    }
+}
+
+} // namespace typesetting
+} // namespace core
+} // namespace japanese_typesetting
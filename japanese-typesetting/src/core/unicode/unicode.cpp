@@ -8,6 +8,7 @@
 #include <unicode/normlzr.h>
 #include <unicode/uchar.h>
 #include <unicode/utf.h>
+#include <unicode/utf8.h>
 #include <algorithm> // std::find用に追加
 
 namespace japanese_typesetting {
@@ -70,6 +71,28 @@ std::u32string UnicodeHandler::utf8ToUtf32(const std::string& utf8String) const
     return result;
 }
 
+void UnicodeHandler::utf8ToUtf32(const std::string& utf8String, std::pmr::u32string& result) const {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(utf8String.data());
+    int32_t length = static_cast<int32_t>(utf8String.length());
+
+    // 継続バイト以外を数えて必要な長さを求め、再確保を避ける
+    size_t codePointCount = 0;
+    for (int32_t i = 0; i < length; ++i) {
+        if ((bytes[i] & 0xC0) != 0x80) {
+            ++codePointCount;
+        }
+    }
+    result.clear();
+    result.reserve(codePointCount);
+
+    for (int32_t i = 0; i < length; ) {
+        UChar32 c;
+        U8_NEXT(bytes, i, length, c);
+        // 不正なバイト列は置換文字にする（UnicodeString::fromUTF8と同じ扱い）
+        result.push_back(c < 0 ? U'\uFFFD' : static_cast<char32_t>(c));
+    }
+}
+
 std::string UnicodeHandler::utf32ToUtf8(const std::u32string& utf32String) const {
     icu::UnicodeString ustr;
     for (char32_t ch : utf32String) {
@@ -7,7 +7,7 @@
 #include <string>
 #include "japanese_typesetting/core/document/document.h"
 #include "japanese_typesetting/core/style/style.h"
-#include "japanese_typesetting/core/typesetting/typesetting.h"
+#include "japanese_typesetting/core/typesetting/typesetting_engine.h"
 #include "japanese_typesetting/core/unicode/unicode.h"
 
 int main(int argc, char* argv[]) {
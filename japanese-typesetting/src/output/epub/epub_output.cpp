@@ -4,12 +4,15 @@
  */
 
 #include "japanese_typesetting/output/epub_output.h"
+#include "japanese_typesetting/output/html_writer.h"
+#include "japanese_typesetting/core/typesetting/block_stream.h"
 #include <fstream>
 #include <sstream>
 #include <cstdio>
 #include <cstdlib>
 #include <filesystem>
 #include <stdexcept>
+#include <algorithm>
 #include <ctime>
 #include <iomanip>
 #include <zip.h>
@@ -177,53 +180,59 @@ std::map<std::string, std::string> EpubOutputEngine::generateHtmlContent(
     
     std::map<std::string, std::string> contentFiles;
     
-    // 文書の組版
+    // 文書をブロックごとに組版し、一定数のブロックごとにチャプターとして書き出す
+    // （保持するのは書き出し前のチャプターのブロックのみ）
     double contentWidth = 800.0; // 仮の幅
-    std::vector<core::typesetting::TextBlock> blocks = m_typesettingEngine.typesetDocument(document, style, contentWidth);
+    core::typesetting::DocumentBlockStream stream(m_typesettingEngine, document, style, contentWidth);
     
-    // チャプターごとにHTMLファイルを生成
     int chapterCount = 1;
     std::vector<core::typesetting::TextBlock> chapterBlocks;
+    auto writeChapter = [&]() {
+        // HTMLの生成
+        std::ostringstream html;
+        
+        html << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+             << "<!DOCTYPE html>\n"
+             << "<html xmlns=\"http://www.w3.org/1999/xhtml\" xmlns:epub=\"http://www.idpf.org/2007/ops\" xml:lang=\"ja\">\n"
+             << "<head>\n"
+             << "  <meta charset=\"UTF-8\" />\n"
+             << "  <title>" << options.title << " - Chapter " << chapterCount << "</title>\n"
+             << "  <link rel=\"stylesheet\" type=\"text/css\" href=\"css/style.css\" />\n"
+             << "</head>\n"
+             << "<body class=\"" << (options.vertical ? "vertical" : "horizontal") << "\">\n";
+        
+        // チャプタータイトル
+        html << "  <h1>Chapter " << chapterCount << "</h1>\n";
+        
+        // 文書内容の変換
+        html << blocksToHtml(chapterBlocks);
+        
+        html << "</body>\n"
+             << "</html>\n";
+        
+        // ファイル名の生成
+        std::ostringstream fileName;
+        fileName << "chapter" << std::setw(3) << std::setfill('0') << chapterCount << ".xhtml";
+        
+        // コンテンツファイルに追加
+        contentFiles[fileName.str()] = html.str();
+        
+        // チャプターカウントの更新
+        chapterCount++;
+        chapterBlocks.clear();
+    };
     
-    for (const auto& block : blocks) {
+    for (const auto& block : stream) {
         chapterBlocks.push_back(block);
         
         // 一定数のブロックごとにチャプターを区切る（実際には文書構造に基づいて区切る）
-        if (chapterBlocks.size() >= 10 || &block == &blocks.back()) {
-            // HTMLの生成
-            std::ostringstream html;
-            
-            html << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
-                 << "<!DOCTYPE html>\n"
-                 << "<html xmlns=\"http://www.w3.org/1999/xhtml\" xmlns:epub=\"http://www.idpf.org/2007/ops\" xml:lang=\"ja\">\n"
-                 << "<head>\n"
-                 << "  <meta charset=\"UTF-8\" />\n"
-                 << "  <title>" << options.title << " - Chapter " << chapterCount << "</title>\n"
-                 << "  <link rel=\"stylesheet\" type=\"text/css\" href=\"css/style.css\" />\n"
-                 << "</head>\n"
-                 << "<body class=\"" << (options.vertical ? "vertical" : "horizontal") << "\">\n";
-            
-            // チャプタータイトル
-            html << "  <h1>Chapter " << chapterCount << "</h1>\n";
-            
-            // 文書内容の変換
-            html << blocksToHtml(chapterBlocks, options);
-            
-            html << "</body>\n"
-                 << "</html>\n";
-            
-            // ファイル名の生成
-            std::ostringstream fileName;
-            fileName << "chapter" << std::setw(3) << std::setfill('0') << chapterCount << ".xhtml";
-            
-            // コンテンツファイルに追加
-            contentFiles[fileName.str()] = html.str();
-            
-            // チャプターカウントの更新
-            chapterCount++;
-            chapterBlocks.clear();
+        if (chapterBlocks.size() >= 10) {
+            writeChapter();
         }
     }
+    if (!chapterBlocks.empty()) {
+        writeChapter();
+    }
     
     // 表紙ページの生成
     std::ostringstream coverHtml;
@@ -341,6 +350,9 @@ std::string EpubOutputEngine::generateCss(
         << "  text-indent: 1em;\n"
         << "}\n\n";
     
+    // 縦中横・圏点・傍線
+    writeAnnotationCss(css);
+    
     // 表紙スタイル
     css << ".cover {\n"
         << "  text-align: center;\n"
@@ -584,38 +596,14 @@ void EpubOutputEngine::removeTempDir(const std::string& dirPath) {
 }
 
 std::string EpubOutputEngine::blocksToHtml(
-    const std::vector<core::typesetting::TextBlock>& blocks,
-    const EpubOutputOptions& options) {
+    const std::vector<core::typesetting::TextBlock>& blocks) {
     
     std::ostringstream html;
     core::unicode::UnicodeHandler unicodeHandler;
     
     // 各ブロックをHTML要素に変換
     for (const auto& block : blocks) {
-        html << "  <div class=\"block\">\n";
-        
-        for (const auto& line : block.lines) {
-            html << "    <p>";
-            
-            // UTF-32からUTF-8に変換
-            std::string utf8Text = unicodeHandler.utf32ToUtf8(line.text);
-            
-            // 特殊文字のエスケープ
-            for (char c : utf8Text) {
-                switch (c) {
-                    case '<': html << "&lt;"; break;
-                    case '>': html << "&gt;"; break;
-                    case '&': html << "&amp;"; break;
-                    case '"': html << "&quot;"; break;
-                    case '\'': html << "&#39;"; break;
-                    default: html << c;
-                }
-            }
-            
-            html << "</p>\n";
-        }
-        
-        html << "  </div>\n";
+        writeBlockHtml(html, block, unicodeHandler, "  ");
     }
     
     return html.str();
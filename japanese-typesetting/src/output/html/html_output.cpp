@@ -4,12 +4,14 @@
  */
 
 #include "japanese_typesetting/output/html_output.h"
+#include "japanese_typesetting/output/html_writer.h"
+#include "japanese_typesetting/core/font/font_registry.h"
+#include "japanese_typesetting/core/typesetting/block_stream.h"
 #include <fstream>
 #include <sstream>
 #include <filesystem>
 #include <stdexcept>
 #include <algorithm>
-#include <cctype>
 #include <ctime>
 #include <iomanip>
 #include <iostream>
@@ -142,10 +144,6 @@ std::string HtmlOutputEngine::generateHtml(
     const core::style::Style& style,
     const HtmlOutputOptions& options) {
     
-    // 文書の組版
-    double contentWidth = 800.0; // 仮の幅
-    std::vector<core::typesetting::TextBlock> blocks = m_typesettingEngine.typesetDocument(document, style, contentWidth);
-    
     // HTMLの生成
     std::ostringstream html;
     
@@ -216,10 +214,15 @@ std::string HtmlOutputEngine::generateHtml(
         html << generateToc(document, options);
     }
     
-    // 文書内容の変換
-    html << "<div class=\"content\">\n"
-         << blocksToHtml(blocks, options)
-         << "</div>\n";
+    // 文書内容の変換（ブロックを1つずつ組版して書き出す）
+    double contentWidth = 800.0; // 仮の幅
+    html << "<div class=\"content\">\n";
+    core::typesetting::DocumentBlockStream stream(m_typesettingEngine, document, style, contentWidth);
+    core::unicode::UnicodeHandler unicodeHandler;
+    for (const auto& block : stream) {
+        writeBlockHtml(html, block, unicodeHandler);
+    }
+    html << "</div>\n";
     
     html << "</body>\n"
          << "</html>\n";
@@ -367,20 +370,8 @@ std::string HtmlOutputEngine::generateCss(
         << "  letter-spacing: " << style.getCharacterSpacing() << "em;\n"
         << "}\n\n";
     
-    // 縦中横
-    css << "/* 縦中横 */\n"
-        << ".tcy {\n"
-        << "  text-combine-upright: all;\n"
-        << "  -webkit-text-combine: horizontal;\n"
-        << "  -ms-text-combine-horizontal: all;\n"
-        << "}\n\n";
-    
-    // 圏点
-    css << "/* 圏点 */\n"
-        << ".emphasis {\n"
-        << "  text-emphasis: filled circle;\n"
-        << "  -webkit-text-emphasis: filled circle;\n"
-        << "}\n\n";
+    // 縦中横・圏点・傍線
+    writeAnnotationCss(css);
     
     // 禁則処理
     css << "/* 禁則処理 */\n"
@@ -417,76 +408,27 @@ std::string HtmlOutputEngine::generateToc(
 }
 
 std::string HtmlOutputEngine::blocksToHtml(
-    const std::vector<core::typesetting::TextBlock>& blocks,
-    const HtmlOutputOptions& options) {
+    const std::vector<core::typesetting::TextBlock>& blocks) {
     
     std::ostringstream html;
     core::unicode::UnicodeHandler unicodeHandler;
     
     // 各ブロックをHTML要素に変換
     for (const auto& block : blocks) {
-        html << "<div class=\"block\">\n";
-        
-        for (const auto& line : block.lines) {
-            html << "  <p>";
-            
-            // UTF-32からUTF-8に変換
-            std::string utf8Text = unicodeHandler.utf32ToUtf8(line.text);
-            
-            // 特殊文字のエスケープと変換
-            for (size_t i = 0; i < utf8Text.length(); i++) {
-                char c = utf8Text[i];
-                
-                // 特殊文字のエスケープ
-                switch (c) {
-                    case '<': html << "&lt;"; break;
-                    case '>': html << "&gt;"; break;
-                    case '&': html << "&amp;"; break;
-                    case '"': html << "&quot;"; break;
-                    case '\'': html << "&#39;"; break;
-                    default:
-                        // 数字の縦中横変換（縦書きモードの場合）
-                        if (options.vertical && std::isdigit(c)) {
-                            // 連続する数字を検出
-                            size_t start = i;
-                            while (i < utf8Text.length() && std::isdigit(utf8Text[i])) {
-                                i++;
-                            }
-                            i--; // ループで再度インクリメントされるため
-                            
-                            // 縦中横として出力
-                            html << "<span class=\"tcy\">" << utf8Text.substr(start, i - start + 1) << "</span>";
-                        } else {
-                            html << c;
-                        }
-                }
-            }
-            
-            html << "</p>\n";
-        }
-        
-        html << "</div>\n";
+        writeBlockHtml(html, block, unicodeHandler);
     }
     
     return html.str();
 }
 
 std::string HtmlOutputEngine::encodeFont(const std::string& fontPath) {
-    // フォントファイルをBase64エンコード
-    std::ifstream file(fontPath, std::ios::binary);
-    if (!file.is_open()) {
+    // フォントファイルは登録簿でメモリマップしたものを共有する
+    std::shared_ptr<const core::font::MappedFile> file = core::font::FontRegistry::getInstance().getFile(fontPath);
+    if (!file) {
         throw std::runtime_error("フォントファイルを開けませんでした: " + fontPath);
     }
-    
-    // ファイルサイズの取得
-    file.seekg(0, std::ios::end);
-    size_t fileSize = file.tellg();
-    file.seekg(0, std::ios::beg);
-    
-    // ファイル内容の読み込み
-    std::vector<char> buffer(fileSize);
-    file.read(buffer.data(), fileSize);
-    file.close();
+    const unsigned char* buffer = file->data();
+    size_t fileSize = file->size();
     
     // Base64エンコード
     static const std::string base64Chars = 
@@ -541,78 +483,84 @@ std::map<std::string, std::string> HtmlOutputEngine::generateMultiFileHtml(
     
     std::map<std::string, std::string> htmlFiles;
     
-    // 文書の組版
+    // 文書をブロックごとに組版し、一定数のブロックごとにチャプターとして書き出す
+    // （保持するのは書き出し前のチャプターのブロックのみ）
     double contentWidth = 800.0; // 仮の幅
-    std::vector<core::typesetting::TextBlock> blocks = m_typesettingEngine.typesetDocument(document, style, contentWidth);
+    core::typesetting::DocumentBlockStream stream(m_typesettingEngine, document, style, contentWidth);
     
-    // チャプターごとにHTMLファイルを生成
     int chapterCount = 1;
     std::vector<core::typesetting::TextBlock> chapterBlocks;
+    auto writeChapter = [&]() {
+        // HTMLの生成
+        std::ostringstream html;
+        
+        html << "<!DOCTYPE html>\n"
+             << "<html lang=\"" << options.language << "\">\n"
+             << "<head>\n"
+             << "  <meta charset=\"UTF-8\">\n"
+             << "  <meta name=\"viewport\" content=\"width=device-width, initial-scale=1.0\">\n"
+             << "  <title>" << options.title << " - 第" << chapterCount << "章</title>\n";
+        
+        // メタ情報
+        html << "  <meta name=\"author\" content=\"" << options.author << "\">\n"
+             << "  <meta name=\"description\" content=\"" << options.description << "\">\n";
+        
+        // CSSの埋め込みまたは参照
+        if (options.embedCss) {
+            html << "  <style>\n"
+                 << generateCss(style, options)
+                 << "  </style>\n";
+        } else {
+            html << "  <link rel=\"stylesheet\" href=\"css/style.css\">\n";
+        }
+        
+        html << "</head>\n"
+             << "<body class=\"" << (options.vertical ? "vertical" : "horizontal") << "\">\n";
+        
+        // ナビゲーション
+        html << "<div class=\"navigation\">\n";
+        if (chapterCount > 1) {
+            html << "  <a href=\"chapter" << (chapterCount - 1) << ".html\">前の章</a> | ";
+        }
+        html << "  <a href=\"index.html\">目次</a>";
+        if (chapterCount < 5) { // 仮のチャプター数
+            html << " | <a href=\"chapter" << (chapterCount + 1) << ".html\">次の章</a>";
+        }
+        html << "\n</div>\n";
+        
+        // チャプタータイトル
+        html << "<h1 id=\"chapter" << chapterCount << "\">第" << chapterCount << "章</h1>\n";
+        
+        // 文書内容の変換
+        html << "<div class=\"content\">\n"
+             << blocksToHtml(chapterBlocks)
+             << "</div>\n";
+        
+        html << "</body>\n"
+             << "</html>\n";
+        
+        // ファイル名の生成
+        std::string fileName = "chapter" + std::to_string(chapterCount) + ".html";
+        
+        // コンテンツファイルに追加
+        htmlFiles[fileName] = html.str();
+        
+        // チャプターカウントの更新
+        chapterCount++;
+        chapterBlocks.clear();
+    };
     
-    for (const auto& block : blocks) {
+    for (const auto& block : stream) {
         chapterBlocks.push_back(block);
         
         // 一定数のブロックごとにチャプターを区切る（実際には文書構造に基づいて区切る）
-        if (chapterBlocks.size() >= 10 || &block == &blocks.back()) {
-            // HTMLの生成
-            std::ostringstream html;
-            
-            html << "<!DOCTYPE html>\n"
-                 << "<html lang=\"" << options.language << "\">\n"
-                 << "<head>\n"
-                 << "  <meta charset=\"UTF-8\">\n"
-                 << "  <meta name=\"viewport\" content=\"width=device-width, initial-scale=1.0\">\n"
-                 << "  <title>" << options.title << " - 第" << chapterCount << "章</title>\n";
-            
-            // メタ情報
-            html << "  <meta name=\"author\" content=\"" << options.author << "\">\n"
-                 << "  <meta name=\"description\" content=\"" << options.description << "\">\n";
-            
-            // CSSの埋め込みまたは参照
-            if (options.embedCss) {
-                html << "  <style>\n"
-                     << generateCss(style, options)
-                     << "  </style>\n";
-            } else {
-                html << "  <link rel=\"stylesheet\" href=\"css/style.css\">\n";
-            }
-            
-            html << "</head>\n"
-                 << "<body class=\"" << (options.vertical ? "vertical" : "horizontal") << "\">\n";
-            
-            // ナビゲーション
-            html << "<div class=\"navigation\">\n";
-            if (chapterCount > 1) {
-                html << "  <a href=\"chapter" << (chapterCount - 1) << ".html\">前の章</a> | ";
-            }
-            html << "  <a href=\"index.html\">目次</a>";
-            if (chapterCount < 5) { // 仮のチャプター数
-                html << " | <a href=\"chapter" << (chapterCount + 1) << ".html\">次の章</a>";
-            }
-            html << "\n</div>\n";
-            
-            // チャプタータイトル
-            html << "<h1 id=\"chapter" << chapterCount << "\">第" << chapterCount << "章</h1>\n";
-            
-            // 文書内容の変換
-            html << "<div class=\"content\">\n"
-                 << blocksToHtml(chapterBlocks, options)
-                 << "</div>\n";
-            
-            html << "</body>\n"
-                 << "</html>\n";
-            
-            // ファイル名の生成
-            std::string fileName = "chapter" + std::to_string(chapterCount) + ".html";
-            
-            // コンテンツファイルに追加
-            htmlFiles[fileName] = html.str();
-            
-            // チャプターカウントの更新
-            chapterCount++;
-            chapterBlocks.clear();
+        if (chapterBlocks.size() >= 10) {
+            writeChapter();
         }
     }
+    if (!chapterBlocks.empty()) {
+        writeChapter();
+    }
     
     // インデックスページの生成
     std::ostringstream indexHtml;
@@ -0,0 +1,142 @@
+/**
+ * @file html_writer.cpp
+ * @brief HTMLを経由する出力エンジンで共有する組版結果の書き出しの実装
+ */
+
+#include "japanese_typesetting/output/html_writer.h"
+#include <algorithm>
+
+namespace japanese_typesetting {
+namespace output {
+
+void writeLineHtml(std::ostream& html,
+                   const core::typesetting::TextLine& line,
+                   const core::unicode::UnicodeHandler& unicodeHandler) {
+
+    // 縦中横とルビの判定は組版時に済んでいるため、行の属性に従って囲むだけでよい
+    auto writeEscaped = [&](const std::u32string& text, size_t start, size_t end) {
+        if (start >= end) {
+            return;
+        }
+        std::string utf8Text = unicodeHandler.utf32ToUtf8(text.substr(start, end - start));
+        for (char c : utf8Text) {
+            switch (c) {
+                case '<': html << "&lt;"; break;
+                case '>': html << "&gt;"; break;
+                case '&': html << "&amp;"; break;
+                case '"': html << "&quot;"; break;
+                case '\'': html << "&#39;"; break;
+                default: html << c;
+            }
+        }
+    };
+
+    // 圏点の種類ごとのクラス名
+    auto emphasisClass = [](core::typesetting::EmphasisMark mark) {
+        switch (mark) {
+            case core::typesetting::EmphasisMark::OpenSesame: return "emphasis open-sesame";
+            case core::typesetting::EmphasisMark::FilledCircle: return "emphasis circle";
+            case core::typesetting::EmphasisMark::OpenCircle: return "emphasis open-circle";
+            default: return "emphasis sesame";
+        }
+    };
+
+    // 範囲内の縦中横・圏点・傍線のランをspan要素で囲んで書き出す
+    auto writeRange = [&](size_t start, size_t end) {
+        size_t position = start;
+        for (const auto& run : line.runs) {
+            const bool tcy = run.orientation == core::typesetting::GlyphOrientation::TateChuYoko;
+            const bool emphasis = run.emphasis != core::typesetting::EmphasisMark::None;
+            const bool sideline = run.sideline != core::typesetting::Sideline::None;
+            if ((!tcy && !emphasis && !sideline) || run.end() <= position || run.start >= end) {
+                continue;
+            }
+            size_t runStart = std::max<size_t>(run.start, position);
+            size_t runEnd = std::min<size_t>(run.end(), end);
+            writeEscaped(line.text, position, runStart);
+            if (sideline) {
+                html << (run.sideline == core::typesetting::Sideline::Double ? "<span class=\"sideline double\">"
+                                                                              : "<span class=\"sideline\">");
+            }
+            if (emphasis) {
+                html << "<span class=\"" << emphasisClass(run.emphasis) << "\">";
+            }
+            if (tcy) {
+                html << "<span class=\"tcy\">";
+            }
+            writeEscaped(line.text, runStart, runEnd);
+            for (int i = tcy + emphasis + sideline; i > 0; --i) {
+                html << "</span>";
+            }
+            position = runEnd;
+        }
+        writeEscaped(line.text, position, end);
+    };
+
+    size_t position = 0;
+    for (const auto& ruby : line.rubies) {
+        if (ruby.baseStart < position || ruby.baseEnd() > line.text.size() || ruby.rubyEnd() > line.rubyText.size()) {
+            continue;
+        }
+        writeRange(position, ruby.baseStart);
+        html << "<ruby>";
+        writeRange(ruby.baseStart, ruby.baseEnd());
+        html << "<rt>";
+        writeEscaped(line.rubyText, ruby.rubyStart, ruby.rubyEnd());
+        html << "</rt></ruby>";
+        position = ruby.baseEnd();
+    }
+    writeRange(position, line.text.size());
+}
+
+void writeBlockHtml(std::ostream& html,
+                    const core::typesetting::TextBlock& block,
+                    const core::unicode::UnicodeHandler& unicodeHandler,
+                    const std::string& indent) {
+
+    html << indent << "<div class=\"block\">\n";
+
+    for (const auto& line : block.lines) {
+        html << indent << "  <p>";
+
+        writeLineHtml(html, line, unicodeHandler);
+
+        html << "</p>\n";
+    }
+
+    html << indent << "</div>\n";
+}
+
+void writeAnnotationCss(std::ostream& css) {
+    // 縦中横
+    css << "/* 縦中横 */\n"
+        << ".tcy {\n"
+        << "  text-combine-upright: all;\n"
+        << "  -webkit-text-combine: horizontal;\n"
+        << "  -epub-text-combine: horizontal;\n"
+        << "  -ms-text-combine-horizontal: all;\n"
+        << "}\n\n";
+
+    // 圏点・傍線（圏点は右側・上側、傍線は左側・下側）
+    css << "/* 圏点 */\n"
+        << ".emphasis {\n"
+        << "  text-emphasis-position: over right;\n"
+        << "  -webkit-text-emphasis-position: over right;\n"
+        << "  -epub-text-emphasis-position: over right;\n"
+        << "}\n\n"
+        << ".emphasis.sesame { text-emphasis-style: filled sesame; -webkit-text-emphasis-style: filled sesame; }\n"
+        << ".emphasis.open-sesame { text-emphasis-style: open sesame; -webkit-text-emphasis-style: open sesame; }\n"
+        << ".emphasis.circle { text-emphasis-style: filled circle; -webkit-text-emphasis-style: filled circle; }\n"
+        << ".emphasis.open-circle { text-emphasis-style: open circle; -webkit-text-emphasis-style: open circle; }\n\n"
+        << "/* 傍線 */\n"
+        << ".sideline {\n"
+        << "  text-decoration: underline;\n"
+        << "  text-underline-position: left;\n"
+        << "}\n\n"
+        << ".sideline.double {\n"
+        << "  text-decoration-style: double;\n"
+        << "}\n\n";
+}
+
+} // namespace output
+} // namespace japanese_typesetting
@@ -4,12 +4,15 @@
  */
 
 #include "japanese_typesetting/output/pdf_output.h"
+#include "japanese_typesetting/output/html_writer.h"
+#include "japanese_typesetting/core/typesetting/block_stream.h"
 #include <fstream>
 #include <sstream>
 #include <cstdio>
 #include <cstdlib>
 #include <filesystem>
 #include <stdexcept>
+#include <algorithm>
 #include <Python.h>
 #include <iostream>
 
@@ -31,11 +34,7 @@ bool PdfOutputEngine::outputPdf(
     const PdfOutputOptions& options) {
     
     try {
-        // 文書の組版
-        double contentWidth = options.pageWidth - options.marginLeft - options.marginRight;
-        std::vector<core::typesetting::TextBlock> blocks = m_typesettingEngine.typesetDocument(document, style, contentWidth);
-        
-        // HTMLとCSSの生成
+        // HTMLとCSSの生成（組版はHTMLの生成中に行う）
         std::string htmlContent = generateHtml(document, style, options);
         std::string cssContent = generateCss(style, options);
         
@@ -137,10 +136,6 @@ std::string PdfOutputEngine::generateHtml(
     const core::style::Style& style,
     const PdfOutputOptions& options) {
     
-    // 文書の組版
-    double contentWidth = options.pageWidth - options.marginLeft - options.marginRight;
-    std::vector<core::typesetting::TextBlock> blocks = m_typesettingEngine.typesetDocument(document, style, contentWidth);
-    
     // HTMLの生成
     std::ostringstream html;
     
@@ -153,8 +148,13 @@ std::string PdfOutputEngine::generateHtml(
          << "</head>\n"
          << "<body class=\"" << (options.vertical ? "vertical" : "horizontal") << "\">\n";
     
-    // 文書内容の変換
-    html << blocksToHtml(blocks, options);
+    // 文書内容の変換（ブロックを1つずつ組版して書き出す）
+    double contentWidth = options.pageWidth - options.marginLeft - options.marginRight;
+    core::typesetting::DocumentBlockStream stream(m_typesettingEngine, document, style, contentWidth);
+    core::unicode::UnicodeHandler unicodeHandler;
+    for (const auto& block : stream) {
+        writeBlockHtml(html, block, unicodeHandler);
+    }
     
     html << "</body>\n"
          << "</html>\n";
@@ -223,42 +223,21 @@ std::string PdfOutputEngine::generateCss(
         << "  letter-spacing: " << style.getCharacterSpacing() << "em;\n"
         << "}\n\n";
     
+    // 縦中横・圏点・傍線
+    writeAnnotationCss(css);
+    
     return css.str();
 }
 
 std::string PdfOutputEngine::blocksToHtml(
-    const std::vector<core::typesetting::TextBlock>& blocks,
-    const PdfOutputOptions& options) {
+    const std::vector<core::typesetting::TextBlock>& blocks) {
     
     std::ostringstream html;
     core::unicode::UnicodeHandler unicodeHandler;
     
     // 各ブロックをHTML要素に変換
     for (const auto& block : blocks) {
-        html << "<div class=\"block\">\n";
-        
-        for (const auto& line : block.lines) {
-            html << "  <p>";
-            
-            // UTF-32からUTF-8に変換
-            std::string utf8Text = unicodeHandler.utf32ToUtf8(line.text);
-            
-            // 特殊文字のエスケープ
-            for (char c : utf8Text) {
-                switch (c) {
-                    case '<': html << "&lt;"; break;
-                    case '>': html << "&gt;"; break;
-                    case '&': html << "&amp;"; break;
-                    case '"': html << "&quot;"; break;
-                    case '\'': html << "&#39;"; break;
-                    default: html << c;
-                }
-            }
-            
-            html << "</p>\n";
-        }
-        
-        html << "</div>\n";
+        writeBlockHtml(html, block, unicodeHandler);
     }
     
     return html.str();
@@ -1,12 +1,165 @@
 /**
  * @file typesetting_engine_test.cpp
- * @brief 組版エンジン統合テスト用の空実装ファイル
+ * @brief 組版エンジンの統合テスト
  */
 
 #include <gtest/gtest.h>
+#include "japanese_typesetting/core/document/document.h"
+#include "japanese_typesetting/core/typesetting/block_stream.h"
+#include "japanese_typesetting/core/typesetting/page_composer.h"
+#include "japanese_typesetting/core/typesetting/typesetting_engine.h"
+#include <string>
+#include <vector>
+
+using namespace japanese_typesetting;
+
+namespace {
+
+// 同じ本文の節を指定数だけ持つ文書を作る
+void fillDocument(core::document::Document& document, size_t sectionCount, const std::string& content) {
+    for (size_t i = 0; i < sectionCount; ++i) {
+        core::document::Section* section = new core::document::Section("第" + std::to_string(i + 1) + "章");
+        section->setContent(content);
+        document.addSection(section);
+    }
+}
+
+} // namespace
 
 // 基本的な統合テストケース
 TEST(TypesettingEngineTest, BasicIntegrationTest) {
   // 将来的に実装予定
   EXPECT_TRUE(true);
 }
+
+// 文書を組版しながらページが順に渡されることの検証
+TEST(TypesettingEngineTest, ComposeDocumentStreamsPages) {
+    core::document::Document document;
+    fillDocument(document, 3, u8"あいうえおかきくけこさしすせそ");
+
+    core::style::Style style;
+    style.setFontSize(10.0);
+    style.setLineHeight(1.5);
+    core::typesetting::TypesettingEngine engine;
+
+    core::typesetting::PageFrame frame;
+    frame.lineLength = 50.0;   // 1行5文字
+    frame.maxLines = 4;
+
+    std::vector<core::typesetting::Page> pages;
+    size_t pageCount = engine.composeDocument(document, style, frame, [&pages](core::typesetting::Page& page) {
+        pages.push_back(page);
+        return true;
+    });
+
+    // 節ごとにタイトル1行と本文3行で、計12行が3ページに割り付けられる
+    EXPECT_EQ(pageCount, 3u);
+    ASSERT_EQ(pages.size(), 3u);
+    for (const auto& page : pages) {
+        EXPECT_EQ(page.lines.size(), 4u);
+    }
+    EXPECT_EQ(pages[0].lines[1].line.text, U"あいうえお");
+    EXPECT_DOUBLE_EQ(pages[0].lines[1].offset, 18.0); // タイトル行（12pt × 1.5）の次
+
+    // 1ページ目で中止すると残りの節は組版されない
+    size_t calls = 0;
+    pageCount = engine.composeDocument(document, style, frame, [&calls](core::typesetting::Page&) {
+        ++calls;
+        return false;
+    });
+    EXPECT_EQ(calls, 1u);
+    EXPECT_EQ(pageCount, 1u);
+}
+
+// ストリームがtypesetDocumentと同じブロックを順に返すことの検証
+TEST(TypesettingEngineTest, BlockStreamMatchesTypesetDocument) {
+    core::document::Document document;
+    fillDocument(document, 4, u8"あいうえおかきくけこ");
+    core::document::Section* untitled = new core::document::Section();
+    untitled->setContent(u8"さしすせそ");
+    document.addSection(untitled);
+
+    core::style::Style style;
+    core::typesetting::TypesettingEngine engine;
+    std::vector<core::typesetting::TextBlock> expected = engine.typesetDocument(document, style, 50.0);
+
+    core::typesetting::DocumentBlockStream stream(engine, document, style, 50.0);
+    size_t index = 0;
+    for (const auto& block : stream) {
+        ASSERT_LT(index, expected.size());
+        ASSERT_EQ(block.lines.size(), expected[index].lines.size());
+        for (size_t i = 0; i < block.lines.size(); ++i) {
+            EXPECT_EQ(block.lines[i].text, expected[index].lines[i].text);
+        }
+        ++index;
+    }
+    // 4節のタイトルと本文、タイトルのない節の本文
+    EXPECT_EQ(index, 9u);
+    EXPECT_EQ(index, expected.size());
+    EXPECT_EQ(stream.getBlockCount(), expected.size());
+
+    // 読み終えたストリームは空を返す
+    core::typesetting::TextBlock block;
+    EXPECT_FALSE(stream.next(block));
+}
+
+// 文書の組版途中で中断すると、それまでのブロックとページのみが返されることの検証
+TEST(TypesettingEngineTest, CancellationStopsDocument) {
+    core::document::Document document;
+    fillDocument(document, 3, u8"あいうえおかきくけこさしすせそ");
+
+    core::style::Style style;
+    style.setFontSize(10.0);
+    core::typesetting::TypesettingEngine engine;
+    engine.setLayoutCache(nullptr);
+
+    // 開始前に中断されていれば何も組版しない
+    core::typesetting::CancellationToken token;
+    token.cancel();
+    core::typesetting::TypesetStatus status = core::typesetting::TypesetStatus::Completed;
+    std::vector<core::typesetting::TextBlock> blocks = engine.typesetDocument(document, style, 50.0, &token, &status);
+    EXPECT_TRUE(blocks.empty());
+    EXPECT_EQ(status, core::typesetting::TypesetStatus::Cancelled);
+
+    // 1ページ目を受け取った時点で中断すると、組版途中のページは渡されない
+    token.reset();
+    core::typesetting::PageFrame frame;
+    frame.lineLength = 50.0;   // 1行5文字
+    frame.maxLines = 4;
+    size_t calls = 0;
+    size_t pageCount = engine.composeDocument(document, style, frame, [&](core::typesetting::Page&) {
+        ++calls;
+        token.cancel();
+        return true;
+    }, &token, &status);
+    EXPECT_EQ(calls, 1u);
+    EXPECT_EQ(pageCount, 1u);
+    EXPECT_EQ(status, core::typesetting::TypesetStatus::Cancelled);
+
+    // トークンを渡さなければ最後まで組版される
+    blocks = engine.typesetDocument(document, style, 50.0, nullptr, &status);
+    EXPECT_EQ(blocks.size(), 6u);
+    EXPECT_EQ(status, core::typesetting::TypesetStatus::Completed);
+}
+
+// スタイルシートの本文・見出しスタイルで文書が組版されることの検証
+TEST(TypesettingEngineTest, TypesetDocumentWithStyleSheet) {
+    core::document::Document document;
+    fillDocument(document, 2, u8"あいうえおかきくけこ");
+
+    core::style::StyleSheet sheet;
+    sheet.setValue("body", "FontSize", "10");
+    sheet.setValue("body", "LineHeight", "1.5");
+    sheet.setValue("heading", "FontSizeScale", "2");
+    std::shared_ptr<const core::style::CompiledStyleSheet> compiled = sheet.compile(core::style::Style());
+    ASSERT_NE(compiled, nullptr);
+
+    core::typesetting::TypesettingEngine engine;
+    std::vector<core::typesetting::TextBlock> blocks = engine.typesetDocument(document, *compiled, 50.0);
+    ASSERT_EQ(blocks.size(), 4u);
+    // 見出しは20pt（×1.5）、本文は10pt（×1.5）で1行5文字
+    ASSERT_FALSE(blocks[0].lines.empty());
+    EXPECT_DOUBLE_EQ(blocks[0].lines[0].height, 30.0);
+    ASSERT_EQ(blocks[1].lines.size(), 2u);
+    EXPECT_DOUBLE_EQ(blocks[1].lines[0].height, 15.0);
+}
@@ -134,6 +134,29 @@ TEST(CommandLineInterfaceTest, CustomOptions) {
     EXPECT_EQ(options.extraOptions["flag-option"], "true");
 }
 
+// 数値でない・有限でない数値の引数を受け付けないことのテスト
+TEST(CommandLineInterfaceTest, RejectsNonFiniteNumbers) {
+    CommandLineInterface cli;
+    
+    const char* argv[] = {
+        "japanese-typesetting",
+        "input.txt",
+        "--page-width", "inf",
+        "--page-height", "nan",
+        "--margin-left", "12mm",
+        "--margin-right", "15.5"
+    };
+    int argc = sizeof(argv) / sizeof(argv[0]);
+    
+    CommandLineOptions options = cli.parseCommandLine(argc, const_cast<char**>(argv));
+    
+    // 無効な値は既定値のまま残る
+    EXPECT_DOUBLE_EQ(options.pageWidth, 210.0);
+    EXPECT_DOUBLE_EQ(options.pageHeight, 297.0);
+    EXPECT_DOUBLE_EQ(options.marginLeft, 20.0);
+    EXPECT_DOUBLE_EQ(options.marginRight, 15.5);
+}
+
 } // namespace test
 } // namespace cli
 } // namespace japanese_typesetting
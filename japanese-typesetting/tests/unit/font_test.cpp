@@ -0,0 +1,250 @@
+/**
+ * @file font_test.cpp
+ * @brief フォントとシェーピングのテスト
+ */
+
+#include <gtest/gtest.h>
+#include "japanese_typesetting/core/font/font.h"
+#include "japanese_typesetting/core/font/font_registry.h"
+#include "japanese_typesetting/core/font/shaped_run_cache.h"
+#include "japanese_typesetting/core/typesetting/glyph_advance_cache.h"
+#include "japanese_typesetting/core/typesetting/typesetting_engine.h"
+#include <filesystem>
+#include <string>
+
+using japanese_typesetting::core::font::FontFace;
+using japanese_typesetting::core::font::FontLocation;
+using japanese_typesetting::core::font::ShapedRun;
+using japanese_typesetting::core::font::ShapedRunCache;
+
+namespace {
+
+const char* kTestFontPath = "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf";
+
+bool hasTestFont() {
+    return std::filesystem::exists(kTestFontPath);
+}
+
+} // namespace
+
+// フォントを開いて送り幅が得られることの検証
+TEST(FontTest, OpensFontAndReadsAdvances) {
+    if (!hasTestFont()) {
+        GTEST_SKIP() << "テスト用フォントがありません";
+    }
+
+    std::shared_ptr<FontFace> font = FontFace::open(kTestFontPath);
+    ASSERT_NE(font, nullptr);
+    EXPECT_EQ(font->getFamilyName(), "DejaVu Sans");
+    EXPECT_GT(font->getUnitsPerEm(), 0);
+    EXPECT_TRUE(font->hasGlyph(U'A'));
+
+    double advance = font->getAdvance(U'A', 10.0, false);
+    EXPECT_GT(advance, 0.0);
+    EXPECT_LT(advance, 10.0);
+    EXPECT_LT(font->getAdvance(U'\U0010FFFD', 10.0, false), 0.0);
+}
+
+// 存在しないフォントファイルではnullptrが返ることの検証
+TEST(FontTest, OpenFailsForMissingFile) {
+    EXPECT_EQ(FontFace::open("/nonexistent/font.ttf"), nullptr);
+}
+
+// ファミリー名からフォントファイルが見つかることの検証
+TEST(FontTest, FindsFontFileByFamily) {
+    if (!hasTestFont()) {
+        GTEST_SKIP() << "テスト用フォントがありません";
+    }
+
+    FontLocation location = FontFace::findFontFile("dejavu sans");
+    EXPECT_FALSE(location.filePath.empty());
+
+    // パスを直接指定した場合はそのまま使われる
+    EXPECT_EQ(FontFace::findFontFile(kTestFontPath).filePath, kTestFontPath);
+    EXPECT_TRUE(FontFace::findFontFile("No Such Family").filePath.empty());
+}
+
+// シェーピング結果の送り幅が各グリフの合計になることの検証
+TEST(FontTest, ShapesRun) {
+    if (!hasTestFont()) {
+        GTEST_SKIP() << "テスト用フォントがありません";
+    }
+
+    std::shared_ptr<FontFace> font = FontFace::open(kTestFontPath);
+    ASSERT_NE(font, nullptr);
+
+    std::u32string text = U"Hello";
+    ShapedRun run = font->shape(text.data(), text.size(), 12.0, false,
+                                japanese_typesetting::core::font::defaultShapingFeatures(false));
+    ASSERT_EQ(run.glyphIds.size(), text.size());
+    EXPECT_EQ(run.missingGlyphs, 0u);
+
+    double sum = 0.0;
+    for (double advance : run.advances) {
+        sum += advance;
+    }
+    EXPECT_DOUBLE_EQ(run.totalAdvance, sum);
+    EXPECT_GT(run.totalAdvance, 0.0);
+}
+
+// 同じランの2回目のシェーピングがキャッシュから返ることの検証
+TEST(FontTest, ShapedRunCacheHitsRepeatedRuns) {
+    if (!hasTestFont()) {
+        GTEST_SKIP() << "テスト用フォントがありません";
+    }
+
+    std::shared_ptr<FontFace> font = FontFace::open(kTestFontPath);
+    ASSERT_NE(font, nullptr);
+
+    ShapedRunCache cache(2);
+    std::u32string text = U"abc";
+    auto first = cache.shape(*font, text.data(), text.size(), 10.0, false, 0);
+    auto second = cache.shape(*font, text.data(), text.size(), 10.0, false, 0);
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(cache.getStats().hits, 1u);
+    EXPECT_EQ(cache.getStats().misses, 1u);
+
+    // 上限を超えると古いエントリから破棄される
+    cache.shape(*font, text.data(), text.size(), 11.0, false, 0);
+    cache.shape(*font, text.data(), text.size(), 12.0, false, 0);
+    EXPECT_EQ(cache.getStats().entries, 2u);
+    EXPECT_NE(cache.shape(*font, text.data(), text.size(), 10.0, false, 0), first);
+}
+
+// フォントが見つかる場合に組版でその送り幅が使われることの検証
+TEST(FontTest, EngineUsesFontMetrics) {
+    if (!hasTestFont()) {
+        GTEST_SKIP() << "テスト用フォントがありません";
+    }
+
+    japanese_typesetting::core::typesetting::TypesettingEngine engine;
+    japanese_typesetting::core::style::Style style;
+    style.setFontFamily(kTestFontPath);
+    style.setFontSize(10.0);
+    style.setTextAlignment(japanese_typesetting::core::style::TextAlignment::Left);
+
+    auto block = engine.typeset("iiii", style, 1000.0, false);
+    ASSERT_EQ(block.lines.size(), 1u);
+    // 推定値（半角0.5em）ではなく実際の字幅になる
+    EXPECT_GT(block.lines[0].width, 0.0);
+    EXPECT_LT(block.lines[0].width, 20.0);
+}
+
+// 同じフォントファイルが1度だけマップされ共有されることの検証
+TEST(FontTest, RegistrySharesFacesAndFiles) {
+    if (!hasTestFont()) {
+        GTEST_SKIP() << "テスト用フォントがありません";
+    }
+
+    japanese_typesetting::core::font::FontRegistry registry;
+    FontLocation location;
+    location.filePath = kTestFontPath;
+
+    auto first = registry.getFace(location);
+    auto second = registry.getFace(location);
+    ASSERT_NE(first, nullptr);
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(registry.getFile(kTestFontPath), first->getFile());
+
+    auto stats = registry.getStats();
+    EXPECT_EQ(stats.fileCount, 1u);
+    EXPECT_EQ(stats.faceCount, 1u);
+    EXPECT_EQ(stats.misses, 1u);
+    EXPECT_EQ(stats.memoryUsage, first->getFile()->size());
+}
+
+// 上限を超えると登録簿から外れるが、取得済みのフェイスは使い続けられることの検証
+TEST(FontTest, RegistryEvictsUnderMemoryLimit) {
+    if (!hasTestFont()) {
+        GTEST_SKIP() << "テスト用フォントがありません";
+    }
+
+    japanese_typesetting::core::font::FontRegistry registry;
+    FontLocation location;
+    location.filePath = kTestFontPath;
+    auto face = registry.getFace(location);
+    ASSERT_NE(face, nullptr);
+
+    registry.setMemoryLimit(0);
+    auto stats = registry.getStats();
+    EXPECT_EQ(stats.fileCount, 0u);
+    EXPECT_EQ(stats.faceCount, 0u);
+    EXPECT_EQ(stats.evictions, 1u);
+    EXPECT_GT(face->getAdvance(U'A', 10.0, false), 0.0);
+}
+
+// 上限で外したファイルが使われている間に取得し直しても、2度マップされないことの検証
+TEST(FontTest, RegistryDoesNotMapFileTwice) {
+    if (!hasTestFont()) {
+        GTEST_SKIP() << "テスト用フォントがありません";
+    }
+
+    japanese_typesetting::core::font::FontRegistry registry;
+    FontLocation location;
+    location.filePath = kTestFontPath;
+    auto face = registry.getFace(location);
+    ASSERT_NE(face, nullptr);
+
+    // 小さな上限でファイルを外しても、フェイスが使われている間はマップされたまま
+    registry.setMemoryLimit(1);
+    auto stats = registry.getStats();
+    EXPECT_EQ(stats.evictions, 1u);
+    EXPECT_EQ(stats.releasedMemoryUsage, face->getFile()->size());
+
+    // 参照が残っているファイルとフェイスはそのまま登録し直される
+    registry.setMemoryLimit(256 * 1024 * 1024);
+    auto again = registry.getFace(location);
+    EXPECT_EQ(again, face);
+    EXPECT_EQ(registry.getFile(kTestFontPath), face->getFile());
+    stats = registry.getStats();
+    EXPECT_EQ(stats.misses, 1u);
+    EXPECT_EQ(stats.releasedMemoryUsage, 0u);
+}
+
+// 送り幅テーブルがフォントを保持せず、登録簿が外した後は取得し直すことの検証
+TEST(FontTest, AdvanceTableDoesNotPinFont) {
+    if (!hasTestFont()) {
+        GTEST_SKIP() << "テスト用フォントがありません";
+    }
+
+    using japanese_typesetting::core::font::FontRegistry;
+    japanese_typesetting::core::typesetting::GlyphAdvanceCache cache;
+    japanese_typesetting::core::style::Style style;
+    style.setFontFamily(kTestFontPath);
+    style.setFontSize(10.0);
+    auto table = cache.getTable(style, false);
+    std::weak_ptr<const FontFace> face = table->getFont();
+    ASSERT_FALSE(face.expired());
+    const double advance = table->getAdvance(U'A');
+
+    // テーブルが残っていても、登録簿が外せばフォントは破棄される
+    FontRegistry& registry = FontRegistry::getInstance();
+    const size_t limit = registry.getMemoryLimit();
+    registry.setMemoryLimit(0);
+    EXPECT_TRUE(face.expired());
+    registry.setMemoryLimit(limit);
+
+    ASSERT_NE(table->getFont(), nullptr);
+    EXPECT_DOUBLE_EQ(table->getAdvance(U'A'), advance);
+    EXPECT_DOUBLE_EQ(table->getAdvance(U'Å'), cache.getTable(style, false)->getAdvance(U'Å'));
+}
+
+// 送り幅テーブルの数が上限を超えると、最も長く取得されていないものから外れることの検証
+TEST(FontTest, AdvanceCacheBoundsTableCount) {
+    japanese_typesetting::core::typesetting::GlyphAdvanceCache cache(2);
+    japanese_typesetting::core::style::Style style;
+    style.setFontSize(10.0);
+    auto first = cache.getTable(style, false);
+    style.setFontSize(11.0);
+    cache.getTable(style, false);
+    style.setFontSize(10.0);
+    EXPECT_EQ(cache.getTable(style, false), first);
+
+    // 11ptのテーブルが外れ、10ptのテーブルは残る
+    style.setFontSize(12.0);
+    cache.getTable(style, false);
+    EXPECT_EQ(cache.getTableCount(), 2u);
+    style.setFontSize(10.0);
+    EXPECT_EQ(cache.getTable(style, false), first);
+    EXPECT_DOUBLE_EQ(first->getAdvance(U'あ'), 10.0);
+}
@@ -5,10 +5,21 @@
 
 #include <gtest/gtest.h>
 #include "japanese_typesetting/core/style/style.h"
+#include "japanese_typesetting/core/style/style_interner.h"
+#include "japanese_typesetting/core/style/stylesheet.h"
+#include <filesystem>
+#include <fstream>
 
 using japanese_typesetting::core::style::Style;
 using japanese_typesetting::core::style::TextAlignment;
 using japanese_typesetting::core::style::LineBreakMode;
+using japanese_typesetting::core::style::CompiledStyleSheet;
+using japanese_typesetting::core::style::StyleDerivation;
+using japanese_typesetting::core::style::StyleId;
+using japanese_typesetting::core::style::StyleKind;
+using japanese_typesetting::core::style::StyleSheet;
+using japanese_typesetting::core::style::StyleHandle;
+using japanese_typesetting::core::style::StyleInterner;
 
 
 // Setter/Getters の検証
@@ -57,3 +68,165 @@ TEST(StyleTest, SettersAndGetters) {
     style.setProperty("custom-key", "custom-value");
     EXPECT_EQ(style.getProperty("custom-key"), "custom-value");
 }
+
+// 内容の等しいスタイルが同じハンドルになることの検証
+TEST(StyleTest, InternerSharesEqualStyles) {
+    StyleInterner interner;
+    Style a;
+    a.setFontSize(12.0);
+    Style b;
+    b.setFontSize(12.0);
+
+    StyleHandle first = interner.intern(a);
+    StyleHandle second = interner.intern(b);
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(interner.size(), 1u);
+    EXPECT_DOUBLE_EQ(first->getFontSize(), 12.0);
+    EXPECT_EQ(first.getLayoutHash(), StyleInterner::hashLayoutFields(a));
+
+    // 組版に影響しない項目の違いでも別のスタイルとして扱う
+    b.setProperty("note", "x");
+    StyleHandle third = interner.intern(b);
+    EXPECT_NE(first, third);
+    EXPECT_EQ(first.getLayoutHash(), third.getLayoutHash());
+    EXPECT_EQ(interner.size(), 2u);
+}
+
+// 派生スタイルがキャッシュされることの検証
+TEST(StyleTest, InternerCachesDerivedStyles) {
+    StyleInterner interner;
+    Style base;
+    base.setFontSize(10.0);
+    StyleHandle handle = interner.intern(base);
+
+    StyleDerivation title;
+    title.bold = true;
+    title.fontSizeScale = 1.2;
+    StyleHandle derived = interner.derive(handle, title);
+    EXPECT_TRUE(derived->isBold());
+    EXPECT_DOUBLE_EQ(derived->getFontSize(), 12.0);
+    EXPECT_FALSE(handle->isBold());
+    EXPECT_NE(derived.getLayoutHash(), handle.getLayoutHash());
+
+    size_t count = interner.size();
+    EXPECT_EQ(interner.derive(handle, title), derived);
+    EXPECT_EQ(interner.size(), count);
+
+    // 直接登録した同じ内容のスタイルとも共有される
+    Style manual = base;
+    manual.setBold(true);
+    manual.setFontSize(12.0);
+    EXPECT_EQ(interner.intern(manual), derived);
+}
+
+// 上限に達すると登録済みのスタイルを破棄し、取得済みのハンドルは有効なままであることの検証
+TEST(StyleTest, InternerIsBounded) {
+    StyleInterner interner(2);
+    Style style;
+    style.setFontSize(10.0);
+    StyleHandle first = interner.intern(style);
+    style.setFontSize(11.0);
+    interner.intern(style);
+    EXPECT_EQ(interner.size(), 2u);
+
+    style.setFontSize(12.0);
+    interner.intern(style);
+    EXPECT_EQ(interner.size(), 1u);
+    EXPECT_DOUBLE_EQ(first->getFontSize(), 10.0);
+
+    // 別のインターナーのスタイルからの派生も番号が重ならず取り違えない
+    StyleInterner other;
+    StyleDerivation larger;
+    larger.fontSizeScale = 2.0;
+    EXPECT_DOUBLE_EQ(other.derive(first, larger)->getFontSize(), 20.0);
+    EXPECT_DOUBLE_EQ(other.derive(other.intern(style), larger)->getFontSize(), 24.0);
+}
+
+// スタイルシートの継承が番号付きの表に解決されることの検証
+TEST(StyleTest, StyleSheetResolvesInheritance) {
+    namespace style = japanese_typesetting::core::style;
+
+    StyleSheet sheet;
+    sheet.setValue("body", "FontSize", "10");
+    sheet.define("caption", "heading");
+    sheet.setValue("caption", "Italic", "true");
+    sheet.setValue("caption", "FontSizeScale", "0.5");
+
+    Style base;
+    StyleInterner interner;
+    std::shared_ptr<const CompiledStyleSheet> compiled = sheet.compile(base, interner);
+    ASSERT_NE(compiled, nullptr);
+    EXPECT_EQ(compiled->size(), 5u);
+
+    // 組み込みのスタイルは固定の番号を持つ
+    EXPECT_EQ(compiled->findId("body"), style::kBodyStyle);
+    EXPECT_EQ(compiled->findId("heading"), style::kHeadingStyle);
+    EXPECT_EQ(compiled->findId("ruby"), style::kRubyStyle);
+    EXPECT_EQ(compiled->findId("emphasis"), style::kEmphasisStyle);
+    EXPECT_EQ(compiled->findId("missing"), style::kInvalidStyleId);
+
+    EXPECT_DOUBLE_EQ(compiled->getStyle(style::kBodyStyle).getFontSize(), 10.0);
+    EXPECT_TRUE(compiled->getStyle(style::kHeadingStyle).isBold());
+    EXPECT_DOUBLE_EQ(compiled->getStyle(style::kHeadingStyle).getFontSize(), 12.0);
+    EXPECT_DOUBLE_EQ(compiled->getStyle(style::kRubyStyle).getFontSize(), 5.0);
+    EXPECT_EQ(compiled->getEntry(style::kRubyStyle).kind, StyleKind::Character);
+
+    // 継承元の設定を引き継ぎ、倍率は継承元のサイズに掛かる
+    StyleId caption = compiled->findId("caption");
+    ASSERT_NE(caption, style::kInvalidStyleId);
+    EXPECT_EQ(compiled->getEntry(caption).parent, style::kHeadingStyle);
+    EXPECT_TRUE(compiled->getStyle(caption).isBold());
+    EXPECT_TRUE(compiled->getStyle(caption).isItalic());
+    EXPECT_DOUBLE_EQ(compiled->getStyle(caption).getFontSize(), 6.0);
+
+    // 解決済みのスタイルはインターナーで共有される
+    EXPECT_EQ(compiled->getHandle(style::kBodyStyle), interner.intern(compiled->getStyle(style::kBodyStyle)));
+}
+
+// 継承元の誤りでコンパイルが失敗することの検証
+TEST(StyleTest, StyleSheetRejectsBrokenInheritance) {
+    StyleInterner interner;
+
+    StyleSheet unknown;
+    unknown.define("note", "missing");
+    EXPECT_EQ(unknown.compile(Style(), interner), nullptr);
+
+    StyleSheet circular;
+    circular.define("a", "b");
+    circular.define("b", "a");
+    EXPECT_EQ(circular.compile(Style(), interner), nullptr);
+}
+
+// スタイルシートをファイルから読み込めることの検証
+TEST(StyleTest, StyleSheetLoadsFromFile) {
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "japanese_typesetting_stylesheet_test.txt";
+    {
+        std::ofstream file(path);
+        file << "# 見出しを大きくする\n";
+        file << "[heading : body]\n";
+        file << "FontSizeScale: 1.5\n";
+        file << "\n";
+        file << "[warichu : body]\n";
+        file << "Kind: Character\n";
+        file << "FontSize: 5\n";
+    }
+
+    StyleSheet sheet;
+    ASSERT_TRUE(sheet.loadFromFile(path.string()));
+    std::filesystem::remove(path);
+
+    Style base;
+    base.setFontSize(10.0);
+    StyleInterner interner;
+    std::shared_ptr<const CompiledStyleSheet> compiled = sheet.compile(base, interner);
+    ASSERT_NE(compiled, nullptr);
+
+    StyleId heading = compiled->findId("heading");
+    EXPECT_DOUBLE_EQ(compiled->getStyle(heading).getFontSize(), 15.0);
+    EXPECT_TRUE(compiled->getStyle(heading).isBold());
+
+    StyleId warichu = compiled->findId("warichu");
+    ASSERT_NE(warichu, japanese_typesetting::core::style::kInvalidStyleId);
+    EXPECT_EQ(compiled->getEntry(warichu).kind, StyleKind::Character);
+    EXPECT_DOUBLE_EQ(compiled->getStyle(warichu).getFontSize(), 5.0);
+}
@@ -1,12 +1,1414 @@
 /**
  * @file typesetting_test.cpp
- * @brief テスト用の空実装ファイル
+ * @brief 組版エンジンのテスト
  */
 
 #include <gtest/gtest.h>
+#include "japanese_typesetting/core/typesetting/disk_layout_cache.h"
+#include "japanese_typesetting/core/typesetting/layout_cache.h"
+#include "japanese_typesetting/core/typesetting/line_break.h"
+#include "japanese_typesetting/core/typesetting/page_composer.h"
+#include "japanese_typesetting/core/typesetting/typesetting_engine.h"
+#include "japanese_typesetting/core/typesetting/vertical_layout.h"
+#include "japanese_typesetting/core/typesetting/width_kernels.h"
+#include "japanese_typesetting/core/typesetting/width_index.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using japanese_typesetting::core::style::Style;
+using japanese_typesetting::core::typesetting::AllocationStats;
+using japanese_typesetting::core::typesetting::LayoutArena;
+using japanese_typesetting::core::typesetting::LayoutCache;
+using japanese_typesetting::core::typesetting::LayoutCacheKey;
+using japanese_typesetting::core::typesetting::TextBlock;
+using japanese_typesetting::core::typesetting::TypesettingEngine;
+using japanese_typesetting::core::typesetting::TypesettingRules;
+
+namespace {
+
+// 上流への確保回数を数えるテスト用メモリリソース
+class CountingResource : public std::pmr::memory_resource {
+public:
+    size_t allocationCount = 0;
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        ++allocationCount;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+} // namespace
 
 // 基本的なテストケース
 TEST(TypesettingTest, BasicTest) {
   // 将来的に実装予定
   EXPECT_TRUE(true);
 }
+
+// 最大幅で行が分割されることの検証
+TEST(TypesettingTest, BreaksLinesAtMaxWidth) {
+    TypesettingEngine engine;
+    Style style;
+    style.setFontSize(10.0);
+    style.setTextAlignment(japanese_typesetting::core::style::TextAlignment::Left);
+
+    TextBlock block = engine.typeset(u8"あいうえおかきくけこ", style, 50.0, true);
+    ASSERT_EQ(block.lines.size(), 2u);
+    EXPECT_EQ(block.lines[0].text, U"あいうえお");
+    EXPECT_EQ(block.lines[1].text, U"かきくけこ");
+    EXPECT_DOUBLE_EQ(block.lines[0].width, 50.0);
+}
+
+// 行頭禁則文字が前の行に追い込まれることの検証
+TEST(TypesettingTest, AppliesLineStartProhibition) {
+    TypesettingEngine engine;
+    Style style;
+    style.setFontSize(10.0);
+    style.setTextAlignment(japanese_typesetting::core::style::TextAlignment::Left);
+
+    TextBlock block = engine.typeset(u8"あいうえお。かきく", style, 50.0, true);
+    ASSERT_EQ(block.lines.size(), 2u);
+    EXPECT_EQ(block.lines[0].text, U"あいうえお。");
+    EXPECT_EQ(block.lines[1].text, U"かきく");
+}
+
+// 明示的な改行が保持されることの検証
+TEST(TypesettingTest, KeepsExplicitLineBreaks) {
+    TypesettingEngine engine;
+    Style style;
+
+    TextBlock block = engine.typeset(u8"あい\n\nう", style, 100.0, true);
+    ASSERT_EQ(block.lines.size(), 3u);
+    EXPECT_EQ(block.lines[0].text, U"あい");
+    EXPECT_TRUE(block.lines[0].hasLineBreak);
+    EXPECT_TRUE(block.lines[1].text.empty());
+    EXPECT_EQ(block.lines[2].text, U"う");
+    EXPECT_FALSE(block.lines[2].hasLineBreak);
+}
+
+// 中間データの確保統計が呼び出しごとに報告されることの検証
+TEST(TypesettingTest, ReportsAllocationStatsPerCall) {
+    TypesettingEngine engine;
+    engine.setLayoutCache(nullptr); // 2回目も実際に組版させる
+    Style style;
+
+    AllocationStats first;
+    engine.typeset(u8"あいうえおかきくけこ", style, 30.0, true, nullptr, &first);
+    EXPECT_GT(first.allocationCount, 0u);
+    EXPECT_GT(first.bytesAllocated, 0u);
+
+    // 同じ入力なら同じ量だけ確保される（前回分は持ち越さない）
+    AllocationStats second;
+    engine.typeset(u8"あいうえおかきくけこ", style, 30.0, true, nullptr, &second);
+    EXPECT_EQ(second.allocationCount, first.allocationCount);
+    EXPECT_EQ(second.bytesAllocated, first.bytesAllocated);
+}
+
+// 保持バッファに収まる組版では上流のメモリリソースを使わないことの検証
+TEST(TypesettingTest, ArenaReusesRetainedBuffer) {
+    CountingResource upstream;
+    TypesettingEngine engine;
+    engine.setLayoutCache(nullptr); // 2回目も実際に組版させる
+    engine.setMemoryResource(&upstream);
+    EXPECT_EQ(engine.getMemoryResource(), &upstream);
+
+    Style style;
+    std::string text;
+    for (int i = 0; i < 4000; ++i) {
+        text += u8"あ";
+    }
+
+    // 初回は保持バッファを超えるため上流から確保される
+    engine.typeset(text, style, 100.0, true);
+    EXPECT_GT(upstream.allocationCount, 0u);
+
+    // 2回目以降は拡張された保持バッファに収まる
+    size_t before = upstream.allocationCount;
+    engine.typeset(text, style, 100.0, true);
+    EXPECT_EQ(upstream.allocationCount, before);
+}
+
+// アリーナのリセットで統計が初期化されることの検証
+TEST(TypesettingTest, ArenaResetClearsStats) {
+    LayoutArena arena;
+    void* p = arena.allocate(128, alignof(std::max_align_t));
+    EXPECT_NE(p, nullptr);
+    EXPECT_EQ(arena.getStats().allocationCount, 1u);
+    EXPECT_EQ(arena.getStats().bytesAllocated, 128u);
+
+    arena.reset();
+    EXPECT_EQ(arena.getStats().allocationCount, 0u);
+    EXPECT_EQ(arena.getStats().bytesAllocated, 0u);
+}
+
+// 送り幅テーブルが全角・半角の幅を返し、同じキーで共有されることの検証
+TEST(TypesettingTest, GlyphAdvanceTableIsSharedPerFace) {
+    using japanese_typesetting::core::typesetting::GlyphAdvanceCache;
+    using japanese_typesetting::core::typesetting::GlyphAdvanceTable;
+
+    GlyphAdvanceCache cache;
+    Style style;
+    style.setFontSize(12.0);
+
+    std::shared_ptr<const GlyphAdvanceTable> table = cache.getTable(style, true);
+    // 取得した時点で密な配列が事前計算されている（ベクトル化したカーネルの経路を使う）
+    EXPECT_NE(table->getDenseAdvances(), nullptr);
+    EXPECT_DOUBLE_EQ(table->getAdvance(U'漢'), 12.0);
+    EXPECT_DOUBLE_EQ(table->getAdvance(U'a'), 6.0);
+    EXPECT_EQ(cache.getTable(style, true), table);
+    EXPECT_NE(cache.getTable(style, false), table);
+
+    // 太字は別のフェイスとして扱う
+    Style boldStyle = style;
+    boldStyle.setBold(true);
+    EXPECT_NE(cache.getTable(boldStyle, true), table);
+    EXPECT_EQ(cache.getTableCount(), 3u);
+}
+
+// 頻出範囲外の文字がハッシュマップに格納されることの検証
+TEST(TypesettingTest, GlyphAdvanceTableStoresRareCharactersSparsely) {
+    using japanese_typesetting::core::typesetting::GlyphAdvanceCache;
+    using japanese_typesetting::core::typesetting::GlyphAdvanceTable;
+
+    GlyphAdvanceCache cache;
+    Style style;
+    std::shared_ptr<const GlyphAdvanceTable> table = cache.preload(style, true);
+    EXPECT_TRUE(table->isPreloaded());
+    EXPECT_EQ(table->getSparseEntryCount(), 0u);
+
+    EXPECT_TRUE(GlyphAdvanceTable::isDenseCharacter(U'あ'));
+    EXPECT_FALSE(GlyphAdvanceTable::isDenseCharacter(U'\U00020B9F'));
+    table->getAdvance(U'\U00020B9F');
+    table->getAdvance(U'\U00020B9F');
+    EXPECT_EQ(table->getSparseEntryCount(), 1u);
+}
+
+// 複数スレッドから同じテーブルを参照しても同じ値が得られることの検証
+TEST(TypesettingTest, GlyphAdvanceTableIsThreadSafe) {
+    using japanese_typesetting::core::typesetting::GlyphAdvanceCache;
+    using japanese_typesetting::core::typesetting::GlyphAdvanceTable;
+
+    GlyphAdvanceCache cache;
+    Style style;
+    std::shared_ptr<const GlyphAdvanceTable> table = cache.getTable(style, false);
+
+    std::vector<std::thread> threads;
+    std::vector<double> sums(4, 0.0);
+    for (size_t t = 0; t < sums.size(); ++t) {
+        threads.emplace_back([&table, &sums, t]() {
+            for (char32_t ch = 0x3040; ch < 0x3100; ++ch) {
+                sums[t] += table->getAdvance(ch);
+            }
+            sums[t] += table->getAdvance(U'\U0001F600');
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (double sum : sums) {
+        EXPECT_DOUBLE_EQ(sum, sums[0]);
+    }
+}
+
+// 同じ入力の2回目の組版がキャッシュから返ることの検証
+TEST(TypesettingTest, LayoutCacheReusesResults) {
+    LayoutCache cache;
+    TypesettingEngine engine;
+    engine.setLayoutCache(&cache);
+    Style style;
+
+    TextBlock first = engine.typeset(u8"あいうえおかきくけこ", style, 30.0, true);
+    AllocationStats stats;
+    stats.allocationCount = 1;
+    TextBlock second = engine.typeset(u8"あいうえおかきくけこ", style, 30.0, true, nullptr, &stats);
+    EXPECT_EQ(cache.getStats().misses, 1u);
+    EXPECT_EQ(cache.getStats().hits, 1u);
+    EXPECT_EQ(stats.allocationCount, 0u);
+    ASSERT_EQ(second.lines.size(), first.lines.size());
+    for (size_t i = 0; i < first.lines.size(); ++i) {
+        EXPECT_EQ(second.lines[i].text, first.lines[i].text);
+        EXPECT_DOUBLE_EQ(second.lines[i].width, first.lines[i].width);
+    }
+
+    // 幅・書字方向・スタイルが異なれば別のエントリとなる
+    engine.typeset(u8"あいうえおかきくけこ", style, 40.0, true);
+    engine.typeset(u8"あいうえおかきくけこ", style, 30.0, false);
+    Style larger = style;
+    larger.setFontSize(style.getFontSize() * 2.0);
+    engine.typeset(u8"あいうえおかきくけこ", larger, 30.0, true);
+    EXPECT_EQ(cache.getStats().misses, 4u);
+    EXPECT_EQ(cache.getStats().entries, 4u);
+}
+
+// 組版ルールが異なれば別のキーとなることの検証
+TEST(TypesettingTest, LayoutCacheKeyIncludesRules) {
+    Style style;
+    TypesettingRules rules;
+    LayoutCacheKey before = LayoutCacheKey::create(u8"あいう", style, std::make_shared<const TypesettingRules>(rules), 100.0, true);
+    rules.addLineStartProhibitedCharacter(U'う');
+    LayoutCacheKey after = LayoutCacheKey::create(u8"あいう", style, std::make_shared<const TypesettingRules>(rules), 100.0, true);
+    EXPECT_FALSE(before == after);
+
+    // ハッシュ値が衝突しても内容が異なれば別のキーとなる
+    after.rulesHash = before.rulesHash;
+    EXPECT_FALSE(before == after);
+}
+
+// ハッシュ値が衝突したキーで別の入力の組版結果を返さないことの検証
+TEST(TypesettingTest, LayoutCacheComparesKeysByValue) {
+    LayoutCache cache(16);
+    Style style;
+    auto rules = std::make_shared<const TypesettingRules>();
+    LayoutCacheKey stored = LayoutCacheKey::create(u8"あいう", style, rules, 100.0, true);
+    TextBlock block;
+    block.width = 100.0;
+    cache.store(stored, block);
+
+    LayoutCacheKey otherText = LayoutCacheKey::create(u8"かきく", style, rules, 100.0, true);
+    otherText.textHash = stored.textHash;
+    EXPECT_EQ(cache.find(otherText), nullptr);
+
+    Style larger;
+    larger.setFontSize(20.0);
+    LayoutCacheKey otherStyle = LayoutCacheKey::create(u8"あいう", larger, rules, 100.0, true);
+    otherStyle.styleHash = stored.styleHash;
+    EXPECT_EQ(cache.find(otherStyle), nullptr);
+
+    // ルールは別のインスタンスでも内容が同じなら一致する
+    LayoutCacheKey sameInput = LayoutCacheKey::create(u8"あいう", style, std::make_shared<const TypesettingRules>(), 100.0, true);
+    EXPECT_NE(cache.find(sameInput), nullptr);
+}
+
+// 上限を超えると古いエントリから破棄されることの検証
+TEST(TypesettingTest, LayoutCacheEvictsLeastRecentlyUsed) {
+    LayoutCache cache(2);
+    TypesettingEngine engine;
+    engine.setLayoutCache(&cache);
+    Style style;
+
+    engine.typeset(u8"あ", style, 100.0, true);
+    engine.typeset(u8"い", style, 100.0, true);
+    engine.typeset(u8"あ", style, 100.0, true); // 「あ」を最新にする
+    engine.typeset(u8"う", style, 100.0, true); // 「い」が破棄される
+    EXPECT_EQ(cache.getStats().evictions, 1u);
+    EXPECT_EQ(cache.getStats().entries, 2u);
+
+    auto rules = std::make_shared<const TypesettingRules>(engine.getTypesettingRules());
+    EXPECT_NE(cache.find(LayoutCacheKey::create(u8"あ", style, rules, 100.0, true)), nullptr);
+    EXPECT_EQ(cache.find(LayoutCacheKey::create(u8"い", style, rules, 100.0, true)), nullptr);
+}
+
+// ディスクキャッシュに保存した組版結果が別のエンジンから再利用されることの検証
+TEST(TypesettingTest, DiskLayoutCacheReusesResultsAcrossEngines) {
+    using japanese_typesetting::core::typesetting::DiskLayoutCache;
+
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "jt_disk_layout_cache_test";
+    std::filesystem::remove_all(directory);
+
+    Style style;
+    TextBlock first;
+    {
+        DiskLayoutCache disk(directory.string());
+        TypesettingEngine engine;
+        engine.setLayoutCache(nullptr);
+        engine.setDiskLayoutCache(&disk);
+        first = engine.typeset(u8"あいうえお。\nかきくけこ", style, 30.0, true);
+        EXPECT_EQ(disk.getStats().writes, 1u);
+        EXPECT_EQ(disk.getStats().hits, 0u);
+    }
+
+    // 一時ファイルが残っていないこと
+    size_t fileCount = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        EXPECT_EQ(entry.path().extension(), ".layout");
+        ++fileCount;
+    }
+    EXPECT_EQ(fileCount, 1u);
+
+    // 新しいプロセスに相当する別のキャッシュ・エンジンで読み込む
+    DiskLayoutCache disk(directory.string());
+    TypesettingEngine engine;
+    engine.setLayoutCache(nullptr);
+    engine.setDiskLayoutCache(&disk);
+    TextBlock second = engine.typeset(u8"あいうえお。\nかきくけこ", style, 30.0, true);
+    EXPECT_EQ(disk.getStats().hits, 1u);
+    ASSERT_EQ(second.lines.size(), first.lines.size());
+    for (size_t i = 0; i < first.lines.size(); ++i) {
+        EXPECT_EQ(second.lines[i].text, first.lines[i].text);
+        EXPECT_DOUBLE_EQ(second.lines[i].width, first.lines[i].width);
+        EXPECT_EQ(second.lines[i].hasLineBreak, first.lines[i].hasLineBreak);
+    }
+    EXPECT_DOUBLE_EQ(second.height, first.height);
+
+    // 内容が変われば再利用されない
+    engine.typeset(u8"あいうえお。\nかきくけ", style, 30.0, true);
+    EXPECT_EQ(disk.getStats().hits, 1u);
+    EXPECT_EQ(disk.getStats().writes, 1u);
+
+    std::filesystem::remove_all(directory);
+}
+
+// 壊れたキャッシュファイルは無視されることの検証
+TEST(TypesettingTest, DiskLayoutCacheIgnoresCorruptEntries) {
+    using japanese_typesetting::core::typesetting::DiskLayoutCache;
+
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "jt_disk_layout_cache_corrupt_test";
+    std::filesystem::remove_all(directory);
+
+    Style style;
+    DiskLayoutCache disk(directory.string());
+    LayoutCacheKey key = LayoutCacheKey::create(u8"あいう", style, std::make_shared<const TypesettingRules>(), 100.0, true);
+    TextBlock block;
+    block.width = 100.0;
+    block.height = 10.0;
+    ASSERT_TRUE(disk.store(key, block));
+
+    // ファイルの末尾を切り詰める
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        std::filesystem::resize_file(entry.path(), 8);
+    }
+
+    TextBlock loaded;
+    EXPECT_FALSE(disk.load(key, loaded));
+    EXPECT_EQ(disk.getStats().misses, 1u);
+
+    std::filesystem::remove_all(directory);
+}
+
+// フォントファイルやテキストが変わると以前の組版結果を使わないことの検証
+TEST(TypesettingTest, DiskLayoutCacheKeysOnFontAndText) {
+    using japanese_typesetting::core::typesetting::DiskLayoutCache;
+
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "jt_disk_layout_cache_font_test";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+
+    // ファミリー名にファイルのパスを指定すると、そのファイルがフォントとして解決される
+    std::filesystem::path fontPath = directory / "font.ttf";
+    {
+        std::ofstream font(fontPath, std::ios::binary);
+        font << "first";
+    }
+    Style style;
+    style.setFontFamily(fontPath.string());
+    auto rules = std::make_shared<const TypesettingRules>();
+
+    DiskLayoutCache disk((directory / "cache").string());
+    LayoutCacheKey key = LayoutCacheKey::create(u8"あいう", style, rules, 100.0, true);
+    TextBlock block;
+    block.width = 100.0;
+    ASSERT_TRUE(disk.store(key, block));
+
+    TextBlock loaded;
+    EXPECT_TRUE(disk.load(key, loaded));
+
+    // ハッシュ値が同じでもテキストが異なれば読み込まない
+    LayoutCacheKey otherText = LayoutCacheKey::create(u8"かきく", style, rules, 100.0, true);
+    otherText.textHash = key.textHash;
+    EXPECT_FALSE(disk.load(otherText, loaded));
+
+    // フォントファイルが置き換えられると読み込まない
+    {
+        std::ofstream font(fontPath, std::ios::binary | std::ios::trunc);
+        font << "replaced";
+    }
+    EXPECT_FALSE(disk.load(key, loaded));
+
+    std::filesystem::remove_all(directory);
+}
+
+namespace {
+
+// 指定した行数・行送りのテキストブロックを作る
+TextBlock makeBlock(size_t lineCount, double lineHeight) {
+    TextBlock block;
+    for (size_t i = 0; i < lineCount; ++i) {
+        japanese_typesetting::core::typesetting::TextLine line;
+        line.text = U"あ";
+        line.width = 10.0;
+        line.height = lineHeight;
+        line.baseline = 8.0;
+        line.hasLineBreak = false;
+        block.lines.push_back(line);
+    }
+    block.width = 100.0;
+    block.height = lineCount * lineHeight;
+    return block;
+}
+
+} // namespace
+
+// 最大行数でページが区切られ、埋まるたびに渡されることの検証
+TEST(TypesettingTest, PageComposerSplitsByLineCount) {
+    using japanese_typesetting::core::typesetting::Page;
+    using japanese_typesetting::core::typesetting::PageComposer;
+    using japanese_typesetting::core::typesetting::PageFrame;
+
+    PageFrame frame;
+    frame.lineLength = 100.0;
+    frame.maxLines = 4;
+
+    std::vector<size_t> lineCounts;
+    PageComposer composer(frame, [&lineCounts](Page& page) {
+        EXPECT_EQ(page.index, lineCounts.size());
+        lineCounts.push_back(page.lines.size());
+        return true;
+    });
+
+    // 1ページ目はブロックを追加した時点で完成している
+    composer.addBlock(makeBlock(5, 15.0));
+    EXPECT_EQ(lineCounts.size(), 1u);
+
+    composer.addBlock(makeBlock(4, 15.0));
+    composer.finish();
+    ASSERT_EQ(lineCounts.size(), 3u);
+    EXPECT_EQ(lineCounts[0], 4u);
+    EXPECT_EQ(lineCounts[1], 4u);
+    EXPECT_EQ(lineCounts[2], 1u);
+    EXPECT_EQ(composer.getPageCount(), 3u);
+}
+
+// 行送り方向の大きさとブロック間の余白でページが区切られることの検証
+TEST(TypesettingTest, PageComposerSplitsByExtent) {
+    using japanese_typesetting::core::typesetting::Page;
+    using japanese_typesetting::core::typesetting::PageComposer;
+    using japanese_typesetting::core::typesetting::PageFrame;
+
+    PageFrame frame;
+    frame.lineLength = 100.0;
+    frame.blockExtent = 50.0;
+    frame.blockSpacing = 5.0;
+
+    std::vector<Page> pages;
+    PageComposer composer(frame, [&pages](Page& page) {
+        pages.push_back(page);
+        return true;
+    });
+    composer.addBlock(makeBlock(2, 15.0));
+    composer.addBlock(makeBlock(2, 15.0));
+    composer.finish();
+
+    // 15 + 15 + 余白5 + 15 = 50 で1ページ目に収まり、残り1行が次のページになる
+    ASSERT_EQ(pages.size(), 2u);
+    ASSERT_EQ(pages[0].lines.size(), 3u);
+    EXPECT_DOUBLE_EQ(pages[0].lines[2].offset, 35.0);
+    EXPECT_EQ(pages[0].lines[2].blockIndex, 1u);
+    EXPECT_DOUBLE_EQ(pages[0].extent, 50.0);
+    ASSERT_EQ(pages[1].lines.size(), 1u);
+    EXPECT_DOUBLE_EQ(pages[1].lines[0].offset, 0.0);
+}
+
+// コールバックがfalseを返すと構成が中止されることの検証
+TEST(TypesettingTest, PageComposerStopsWhenCallbackDeclines) {
+    using japanese_typesetting::core::typesetting::Page;
+    using japanese_typesetting::core::typesetting::PageComposer;
+    using japanese_typesetting::core::typesetting::PageFrame;
+
+    PageFrame frame;
+    frame.maxLines = 1;
+
+    size_t calls = 0;
+    PageComposer composer(frame, [&calls](Page&) {
+        ++calls;
+        return false;
+    });
+    EXPECT_FALSE(composer.addBlock(makeBlock(3, 10.0)));
+    EXPECT_TRUE(composer.isStopped());
+    EXPECT_FALSE(composer.finish());
+    EXPECT_EQ(calls, 1u);
+}
+
+// 中断されたtypesetが行を返さず、結果がキャッシュされないことの検証
+TEST(TypesettingTest, CancelledTypesetIsNotCached) {
+    using japanese_typesetting::core::typesetting::CancellationToken;
+    using japanese_typesetting::core::typesetting::TypesetStatus;
+
+    LayoutCache cache(16);
+    TypesettingEngine engine;
+    engine.setLayoutCache(&cache);
+    Style style;
+    std::string text = u8"日本語の組版エンジンで中断を確認する。";
+
+    CancellationToken token;
+    token.cancel();
+    TextBlock cancelled = engine.typeset(text, style, 50.0, true, &token);
+    EXPECT_EQ(cancelled.status, TypesetStatus::Cancelled);
+    EXPECT_TRUE(cancelled.lines.empty());
+    EXPECT_EQ(cache.getStats().entries, 0u);
+
+    // 中断を取り消すと最後まで組版される
+    token.reset();
+    TextBlock completed = engine.typeset(text, style, 50.0, true, &token);
+    EXPECT_EQ(completed.status, TypesetStatus::Completed);
+    EXPECT_FALSE(completed.lines.empty());
+    EXPECT_EQ(cache.getStats().entries, 1u);
+}
+
+// 期限を過ぎたトークンで組版が打ち切られることの検証
+TEST(TypesettingTest, ExpiredDeadlineStopsTypeset) {
+    using japanese_typesetting::core::typesetting::CancellationToken;
+    using japanese_typesetting::core::typesetting::TypesetStatus;
+
+    TypesettingEngine engine;
+    engine.setLayoutCache(nullptr);
+    Style style;
+
+    CancellationToken token;
+    EXPECT_EQ(token.check(), TypesetStatus::Completed);
+    token.setDeadline(CancellationToken::Clock::now() - std::chrono::seconds(1));
+    EXPECT_EQ(token.check(), TypesetStatus::DeadlineExceeded);
+
+    TextBlock block = engine.typeset(u8"あいうえおかきくけこ", style, 50.0, true, &token);
+    EXPECT_EQ(block.status, TypesetStatus::DeadlineExceeded);
+    EXPECT_TRUE(block.lines.empty());
+
+    // 行組みカーネルは行分割の前の段階（ランへの分割など）からトークンを確認する
+    namespace ts = japanese_typesetting::core::typesetting;
+    ts::TypesettingRules rules;
+    rules.setDefaultJisX4051Rules();
+    auto table = ts::GlyphAdvanceCache::getInstance().getTable(style, true);
+    std::pmr::u32string text(U"あいうえおかきくけこ");
+    ts::LineLayout layout;
+    EXPECT_EQ(ts::layoutLineRanges(ts::WritingMode::Vertical, japanese_typesetting::core::style::TextAlignment::Left,
+                                   text, *table, rules, ts::toLayoutUnit(50.0), layout, &token),
+              TypesetStatus::DeadlineExceeded);
+    EXPECT_TRUE(layout.runs.empty());
+    EXPECT_TRUE(layout.lines.empty());
+
+    // 十分に先の期限では打ち切られない
+    token.setTimeout(std::chrono::hours(1));
+    block = engine.typeset(u8"あいうえおかきくけこ", style, 50.0, true, &token);
+    EXPECT_EQ(block.status, TypesetStatus::Completed);
+    EXPECT_FALSE(block.lines.empty());
+}
+
+// 1つのエンジンを複数のスレッドから同時に使えることの検証
+TEST(TypesettingTest, SharedEngineTypesetsConcurrently) {
+    TypesettingEngine mutableEngine;
+    mutableEngine.setLayoutCache(nullptr); // すべてのスレッドで実際に組版させる
+    const TypesettingEngine& engine = mutableEngine;
+    Style style;
+
+    std::vector<std::string> texts = {
+        u8"あいうえおかきくけこ、さしすせそ。",
+        u8"「たちつてと」なにぬねの\nはひふへほ",
+        u8"まみむめもやゆよらりるれろわをん",
+    };
+    std::vector<TextBlock> expected;
+    for (const auto& text : texts) {
+        expected.push_back(engine.typeset(text, style, 40.0, true));
+    }
+
+    const size_t threadCount = 4;
+    std::vector<size_t> mismatches(threadCount, 0);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < threadCount; ++t) {
+        threads.emplace_back([&, t]() {
+            for (int round = 0; round < 50; ++round) {
+                size_t index = (t + round) % texts.size();
+                TextBlock block = engine.typeset(texts[index], style, 40.0, true);
+                if (block.lines.size() != expected[index].lines.size()) {
+                    mismatches[t]++;
+                    continue;
+                }
+                for (size_t i = 0; i < block.lines.size(); ++i) {
+                    if (block.lines[i].text != expected[index].lines[i].text) {
+                        mismatches[t]++;
+                    }
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (size_t count : mismatches) {
+        EXPECT_EQ(count, 0u);
+    }
+}
+
+// 設定の置き換えが以前に取得した設定に影響しないことの検証
+TEST(TypesettingTest, ConfigIsReplacedNotMutated) {
+    using japanese_typesetting::core::typesetting::TypesettingConfig;
+
+    TypesettingConfig config;
+    config.layoutCache = nullptr;
+    TypesettingEngine engine(config);
+    EXPECT_EQ(engine.getLayoutCache(), nullptr);
+
+    std::shared_ptr<const TypesettingConfig> before = engine.getConfig();
+    LayoutCache cache;
+    engine.setLayoutCache(&cache);
+    EXPECT_EQ(engine.getLayoutCache(), &cache);
+    EXPECT_EQ(before->layoutCache, nullptr);
+    EXPECT_NE(engine.getConfig(), before);
+}
+
+// 送り幅と行幅がLayoutUnitで厳密に計算されることの検証
+TEST(TypesettingTest, WidthsUseExactLayoutUnits) {
+    using japanese_typesetting::core::typesetting::GlyphAdvanceCache;
+    using japanese_typesetting::core::typesetting::LayoutUnit;
+    using japanese_typesetting::core::typesetting::fromLayoutUnit;
+    using japanese_typesetting::core::typesetting::kLayoutUnitsPerPoint;
+    using japanese_typesetting::core::typesetting::toLayoutUnit;
+
+    EXPECT_EQ(toLayoutUnit(1.0), kLayoutUnitsPerPoint);
+    EXPECT_EQ(toLayoutUnit(0.01), 1);
+    EXPECT_DOUBLE_EQ(fromLayoutUnit(toLayoutUnit(10.5)), 10.5);
+
+    // 表せない長さは折り返さずに範囲の端へ、非数は0にする
+    EXPECT_EQ(toLayoutUnit(1e9), std::numeric_limits<LayoutUnit>::max());
+    EXPECT_EQ(toLayoutUnit(-1e9), std::numeric_limits<LayoutUnit>::min());
+    EXPECT_EQ(toLayoutUnit(std::numeric_limits<double>::infinity()), std::numeric_limits<LayoutUnit>::max());
+    EXPECT_EQ(toLayoutUnit(std::numeric_limits<double>::quiet_NaN()), 0);
+
+    // 1/64ポイントで割り切れないサイズでも送り幅は丸めた値となる
+    Style style;
+    style.setFontSize(10.3);
+    style.setTextAlignment(japanese_typesetting::core::style::TextAlignment::Left);
+    auto table = GlyphAdvanceCache::getInstance().getTable(style, true);
+    LayoutUnit units = table->getAdvanceUnits(U'あ');
+    EXPECT_EQ(units, toLayoutUnit(table->getAdvance(U'あ')));
+    EXPECT_DOUBLE_EQ(table->getAdvance(U'あ') * kLayoutUnitsPerPoint, static_cast<double>(units));
+
+    // 行幅は文字の送り幅の整数和と一致する
+    TypesettingEngine engine;
+    engine.setLayoutCache(nullptr);
+    TextBlock block = engine.typeset(u8"あいうえおかきくけこさしすせそ", style, 60.0, true);
+    ASSERT_FALSE(block.lines.empty());
+    for (const auto& line : block.lines) {
+        int64_t sum = 0;
+        for (char32_t ch : line.text) {
+            sum += table->getAdvanceUnits(ch);
+        }
+        EXPECT_EQ(line.width, fromLayoutUnit(sum));
+        EXPECT_LE(sum, toLayoutUnit(60.0));
+    }
+}
+
+// ベクトル化した送り幅カーネルが命令セットによらず同じ結果を返すことの検証
+TEST(TypesettingTest, WidthKernelsMatchScalarLookup) {
+    using japanese_typesetting::core::typesetting::GlyphAdvanceCache;
+    using japanese_typesetting::core::typesetting::LayoutUnit;
+    using japanese_typesetting::core::typesetting::SimdLevel;
+    namespace ts = japanese_typesetting::core::typesetting;
+
+    Style style;
+    style.setFontSize(9.7);
+    auto table = GlyphAdvanceCache::getInstance().preload(style, false);
+    ASSERT_NE(table->getDenseAdvances(), nullptr);
+
+    // 密な範囲の境界と範囲外（私用領域・絵文字など）を混ぜる
+    std::u32string text;
+    const char32_t samples[] = {
+        U'A', 0xFF, 0x100, 0x2FFF, 0x3000, 0x3042, 0x9FFF, 0xA000, 0xE000,
+        0xFEFF, 0xFF00, 0xFF21, 0xFFEF, 0xFFF0, 0x1F600, 0x20B9F, U'\n', U' '
+    };
+    for (int round = 0; round < 37; ++round) {
+        for (char32_t ch : samples) {
+            text.push_back(ch);
+        }
+        text.push_back(static_cast<char32_t>(0x4E00 + round));
+    }
+
+    std::vector<LayoutUnit> expected(text.size());
+    std::vector<int64_t> expectedPrefix(text.size() + 1, 0);
+    for (size_t i = 0; i < text.size(); ++i) {
+        expected[i] = table->getAdvanceUnits(text[i]);
+        expectedPrefix[i + 1] = expectedPrefix[i] + expected[i];
+    }
+
+    // LayoutUnitの上限で飽和する送り幅
+    Style huge;
+    huge.setFontSize(1.0e9);
+    auto hugeTable = GlyphAdvanceCache::getInstance().preload(huge, false);
+    const std::u32string hugeText(U"あいうえおかきくけ");
+    ASSERT_EQ(hugeTable->getAdvanceUnits(U'あ'), std::numeric_limits<LayoutUnit>::max());
+
+    SimdLevel original = ts::getSimdLevel();
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2}) {
+        ts::setSimdLevel(level);
+        // 飽和した送り幅を足しても累積和は桁あふれしない
+        std::vector<int64_t> hugePrefix(hugeText.size() + 1);
+        ts::prefixAdvances(*hugeTable, hugeText.data(), hugeText.size(), hugePrefix.data());
+        EXPECT_EQ(hugePrefix.back(), int64_t(std::numeric_limits<LayoutUnit>::max()) * int64_t(hugeText.size()));
+        EXPECT_EQ(ts::sumAdvances(*hugeTable, hugeText.data(), hugeText.size()), hugePrefix.back());
+
+        // 端数を含む長さでも一致する
+        for (size_t length : {text.size(), text.size() - 3, size_t(7), size_t(0)}) {
+            std::vector<LayoutUnit> widths(length);
+            ts::gatherAdvances(*table, text.data(), length, widths.data());
+            for (size_t i = 0; i < length; ++i) {
+                EXPECT_EQ(widths[i], expected[i]) << "level " << static_cast<int>(level) << " index " << i;
+            }
+            EXPECT_EQ(ts::sumAdvances(*table, text.data(), length), expectedPrefix[length]);
+
+            std::vector<int64_t> prefix(length + 1);
+            ts::prefixAdvances(*table, text.data(), length, prefix.data());
+            for (size_t i = 0; i <= length; ++i) {
+                EXPECT_EQ(prefix[i], expectedPrefix[i]);
+            }
+        }
+    }
+    ts::setSimdLevel(original);
+}
+
+// 書字方向と行揃えごとの行組みカーネルが行揃えのみで結果を変えることの検証
+TEST(TypesettingTest, LayoutKernelsSpecializeAlignment) {
+    using japanese_typesetting::core::style::TextAlignment;
+    using japanese_typesetting::core::typesetting::GlyphAdvanceCache;
+    using japanese_typesetting::core::typesetting::LineLayout;
+    using japanese_typesetting::core::typesetting::TypesetStatus;
+    using japanese_typesetting::core::typesetting::TypesettingRules;
+    using japanese_typesetting::core::typesetting::WritingMode;
+    namespace ts = japanese_typesetting::core::typesetting;
+
+    Style style;
+    style.setFontSize(10.0);
+    TypesettingRules rules;
+    rules.setDefaultJisX4051Rules();
+    std::pmr::u32string text(U"あいうえおかきく");
+    const auto maxUnits = ts::toLayoutUnit(45.0);   // 1行4文字（40pt）
+
+    for (WritingMode mode : {WritingMode::Horizontal, WritingMode::Vertical}) {
+        auto table = GlyphAdvanceCache::getInstance().getTable(style, mode == WritingMode::Vertical);
+
+        LineLayout left;
+        ASSERT_EQ(ts::layoutLineRanges(mode, TextAlignment::Left, text, *table, rules, maxUnits, left, nullptr),
+                  TypesetStatus::Completed);
+        ASSERT_EQ(left.lines.size(), 2u);
+        EXPECT_EQ(left.lines[0].length, 4u);
+        EXPECT_EQ(left.lines[0].width, ts::toLayoutUnit(40.0));
+
+        // 両端揃えでは95%未満の行が最大幅まで広がる
+        LineLayout justified;
+        ASSERT_EQ(ts::layoutLineRanges(mode, TextAlignment::Justify, text, *table, rules, maxUnits, justified, nullptr),
+                  TypesetStatus::Completed);
+        ASSERT_EQ(justified.lines.size(), 2u);
+        EXPECT_EQ(justified.lines[0].width, maxUnits);
+        EXPECT_EQ(justified.lines[0].length, left.lines[0].length);
+    }
+
+    // 直接特殊化を呼んでも同じ結果になる
+    auto table = GlyphAdvanceCache::getInstance().getTable(style, false);
+    LineLayout centered;
+    ts::layoutLineRanges<WritingMode::Horizontal, false>(text, *table, rules, maxUnits, centered, nullptr);
+    ASSERT_EQ(centered.lines.size(), 2u);
+    EXPECT_EQ(centered.lines[1].width, ts::toLayoutUnit(40.0));
+}
+
+// 両端揃えで行の不足分が文字間に配られ、文字ごとの増減として記録されることの検証
+TEST(TypesettingTest, JustificationRecordsAdvanceDeltas) {
+    Style style;
+    style.setFontSize(10.0);
+    TypesettingEngine engine;
+    engine.setLayoutCache(nullptr);
+
+    // 1行4文字（40pt）に対して最大幅45pt
+    TextBlock block = engine.typeset(u8"あいうえおかきく", style, 45.0);
+    ASSERT_EQ(block.lines.size(), 2u);
+    EXPECT_DOUBLE_EQ(block.lines[0].width, 45.0);
+    ASSERT_EQ(block.lines[0].advanceDeltas.size(), 4u);
+    double total = 0.0;
+    for (double delta : block.lines[0].advanceDeltas) {
+        EXPECT_GE(delta, 0.0);
+        total += delta;
+    }
+    EXPECT_DOUBLE_EQ(total, 5.0);
+    EXPECT_DOUBLE_EQ(block.lines[0].advanceDeltas[3], 0.0); // 行末の文字の後ろは広げない
+
+    // 段落末の行は広げない
+    EXPECT_DOUBLE_EQ(block.lines[1].width, 40.0);
+    EXPECT_TRUE(block.lines[1].advanceDeltas.empty());
+}
+
+// 追い込みではみ出した行が約物のアキを詰めて収まることの検証
+TEST(TypesettingTest, ShrinksPunctuationAkiFirst) {
+    Style style;
+    style.setFontSize(10.0);
+    style.setTextAlignment(japanese_typesetting::core::style::TextAlignment::Left);
+    TypesettingEngine engine;
+    engine.setLayoutCache(nullptr);
+
+    // 行頭禁則の「」」が前の行に追い込まれ、5文字（50pt）になる
+    TextBlock block = engine.typeset(u8"「あ」い」う", style, 40.0);
+    ASSERT_EQ(block.lines.size(), 2u);
+    EXPECT_EQ(block.lines[0].text, U"「あ」い」");
+    EXPECT_DOUBLE_EQ(block.lines[0].width, 40.0);
+
+    // 行末の「」」は半分ぶら下げ、残りは行中の終わり括弧のアキを詰めて取る
+    // （行頭の始め括弧のアキは詰めない）
+    ASSERT_EQ(block.lines[0].advanceDeltas.size(), 5u);
+    EXPECT_DOUBLE_EQ(block.lines[0].advanceDeltas[0], 0.0);
+    EXPECT_DOUBLE_EQ(block.lines[0].advanceDeltas[2], -5.0);
+    EXPECT_DOUBLE_EQ(block.lines[0].advanceDeltas[4], 0.0);
+
+    // 左揃えでは足りない行を広げない
+    EXPECT_TRUE(block.lines[1].advanceDeltas.empty());
+}
+
+// グリフ列の出力を有効にすると、行の幅と一致する位置付け済みのグリフが得られることの検証
+TEST(TypesettingTest, EmitsPositionedGlyphRuns) {
+    Style style;
+    style.setFontSize(10.0);
+    LayoutCache cache(16);
+    TypesettingEngine engine;
+    engine.setLayoutCache(&cache);
+
+    // 既定では出力しない
+    TextBlock block = engine.typeset(u8"あいうえおかきく", style, 45.0, false);
+    ASSERT_EQ(block.lines.size(), 2u);
+    EXPECT_TRUE(block.lines[0].glyphRuns.empty());
+
+    // 有効にするとキャッシュ済みの結果ではなくグリフ列を含む結果が返る
+    engine.setGlyphRunOutput(true);
+    block = engine.typeset(u8"あいうえおかきく", style, 45.0, false);
+    ASSERT_EQ(block.lines.size(), 2u);
+    for (const auto& line : block.lines) {
+        ASSERT_EQ(line.glyphRuns.size(), 1u);
+        const auto& run = line.glyphRuns[0];
+        ASSERT_EQ(run.size(), line.text.size());
+
+        // フォントが見つからない場合は推定幅で、フォントの位置を持たない
+        EXPECT_TRUE(run.fontLocation.filePath.empty());
+        EXPECT_EQ(run.getFont(), nullptr);
+        EXPECT_EQ(run.clusters.size(), run.size());
+        EXPECT_EQ(run.rotated.size(), run.size());
+
+        // 伸縮の増減を含む送り幅の合計は行の幅に一致する
+        double total = 0.0;
+        for (size_t i = 0; i < run.size(); ++i) {
+            total += run.xAdvances[i];
+            EXPECT_DOUBLE_EQ(run.yAdvances[i], 0.0);
+            EXPECT_EQ(run.rotated[i], 0);
+        }
+        EXPECT_DOUBLE_EQ(total, line.width);
+    }
+
+    // 縦書きでは送り幅は下方向に進み、欧字は横倒しの別のランになる
+    block = engine.typeset(u8"あABC", style, 100.0, true);
+    ASSERT_EQ(block.lines.size(), 1u);
+    ASSERT_EQ(block.lines[0].glyphRuns.size(), 2u);
+    const auto& upright = block.lines[0].glyphRuns[0];
+    ASSERT_EQ(upright.size(), 1u);
+    EXPECT_DOUBLE_EQ(upright.xAdvances[0], 0.0);
+    EXPECT_DOUBLE_EQ(upright.yAdvances[0], 10.0);
+    EXPECT_EQ(upright.rotated[0], 0);
+    const auto& sideways = block.lines[0].glyphRuns[1];
+    ASSERT_EQ(sideways.size(), 3u);
+    EXPECT_EQ(sideways.clusters[0], 1u);
+    EXPECT_EQ(sideways.rotated[0], 1);
+    EXPECT_EQ(sideways.rotated[2], 1);
+}
+
+// 段落が用字・向き・字幅・フォントの一様なランに1回の走査で分割されることの検証
+TEST(TypesettingTest, ItemizesTextRuns) {
+    using japanese_typesetting::core::typesetting::GlyphOrientation;
+    using japanese_typesetting::core::typesetting::Script;
+    using japanese_typesetting::core::typesetting::TextRun;
+    using japanese_typesetting::core::typesetting::WidthClass;
+    namespace ts = japanese_typesetting::core::typesetting;
+
+    // 横書きでは漢字・かな・句読点が1つのランになり、欧字は別のランになる
+    std::u32string text = U"漢字と、かなABC";
+    std::pmr::vector<TextRun> runs;
+    ts::itemizeText(text.data(), text.size(), false, nullptr, runs);
+    ASSERT_EQ(runs.size(), 2u);
+    EXPECT_EQ(runs[0].length, 6u);
+    EXPECT_EQ(runs[0].script, Script::Japanese);
+    EXPECT_EQ(runs[0].widthClass, WidthClass::Full);
+    EXPECT_EQ(runs[1].start, 6u);
+    EXPECT_EQ(runs[1].script, Script::Latin);
+    EXPECT_EQ(runs[1].widthClass, WidthClass::Half);
+    EXPECT_EQ(runs[1].orientation, GlyphOrientation::Upright);
+    EXPECT_TRUE(runs[0].fallback); // フォントがない場合は推定幅
+
+    // 縦書きでは欧字は横倒し、2桁までの数字は縦中横、3桁以上は横倒し
+    text = U"第12回とABC、123";
+    runs.clear();
+    ts::itemizeText(text.data(), text.size(), true, nullptr, runs);
+    ASSERT_EQ(runs.size(), 6u);
+    EXPECT_EQ(runs[0].length, 1u);
+    EXPECT_EQ(runs[1].orientation, GlyphOrientation::TateChuYoko);
+    EXPECT_EQ(runs[1].length, 2u);
+    EXPECT_EQ(runs[2].length, 2u);               // 「回と」
+    EXPECT_EQ(runs[3].orientation, GlyphOrientation::Sideways);
+    EXPECT_EQ(runs[3].length, 3u);
+    EXPECT_EQ(runs[4].length, 1u);               // 「、」
+    EXPECT_EQ(runs[5].orientation, GlyphOrientation::Sideways);
+    EXPECT_EQ(runs[5].length, 3u);
+
+    // 組版結果の各行は行内のランを持つ
+    Style style;
+    style.setFontSize(10.0);
+    TypesettingEngine engine;
+    engine.setLayoutCache(nullptr);
+    TextBlock block = engine.typeset(u8"あいうABCえお", style, 40.0, false);
+    ASSERT_EQ(block.lines.size(), 2u);
+    ASSERT_EQ(block.lines[0].runs.size(), 2u);
+    EXPECT_EQ(block.lines[0].runs[1].start, 3u);
+    EXPECT_EQ(block.lines[0].runs[1].length, 2u);
+    ASSERT_EQ(block.lines[1].runs.size(), 2u);
+    EXPECT_EQ(block.lines[1].runs[0].start, 0u);
+    EXPECT_EQ(block.lines[1].runs[0].length, 1u);
+}
+
+// 縦中横が組版時に判定され、1字分の幅として行分割・グリフ列・出力に使われることの検証
+TEST(TypesettingTest, TateChuYokoTakesOneEm) {
+    using japanese_typesetting::core::typesetting::GlyphOrientation;
+    using japanese_typesetting::core::typesetting::TextRun;
+    namespace ts = japanese_typesetting::core::typesetting;
+
+    // 短い英数字と感嘆符・疑問符の組み合わせは縦中横、小数の一部や3文字以上は対象外
+    std::u32string text = U"A4判で!?と3.14とabc";
+    std::pmr::vector<TextRun> runs;
+    ts::itemizeText(text.data(), text.size(), true, nullptr, runs);
+    std::vector<std::u32string> combined;
+    for (const auto& run : runs) {
+        if (run.orientation == GlyphOrientation::TateChuYoko) {
+            combined.push_back(text.substr(run.start, run.length));
+        }
+    }
+    ASSERT_EQ(combined.size(), 2u);
+    EXPECT_EQ(combined[0], U"A4");
+    EXPECT_EQ(combined[1], U"!?");
+
+    Style style;
+    style.setFontSize(10.0);
+    style.setTextAlignment(japanese_typesetting::core::style::TextAlignment::Left);
+    TypesettingEngine engine;
+    engine.setLayoutCache(nullptr);
+    engine.setGlyphRunOutput(true);
+
+    // 縦中横は1字分（10pt）として数え、途中で行が分かれない
+    TextBlock block = engine.typeset(u8"第12回", style, 100.0, true);
+    ASSERT_EQ(block.lines.size(), 1u);
+    EXPECT_DOUBLE_EQ(block.lines[0].width, 30.0);
+    block = engine.typeset(u8"あい12う", style, 25.0, true);
+    ASSERT_EQ(block.lines.size(), 2u);
+    EXPECT_EQ(block.lines[1].text, U"12う");
+
+    // 行頭禁則の「!?」は2文字とも前の行に追い込まれる
+    block = engine.typeset(u8"あい!?う", style, 20.0, true);
+    ASSERT_EQ(block.lines.size(), 2u);
+    EXPECT_EQ(block.lines[0].text, U"あい!?");
+
+    // グリフは1字分の枠の中央に横に並び、最後のグリフで1字分進む
+    block = engine.typeset(u8"第12回", style, 100.0, true);
+    ASSERT_EQ(block.lines[0].glyphRuns.size(), 3u);
+    const auto& run = block.lines[0].glyphRuns[1];
+    ASSERT_EQ(run.size(), 2u);
+    EXPECT_DOUBLE_EQ(run.xOffsets[0], -5.0);
+    EXPECT_DOUBLE_EQ(run.xOffsets[1], 0.0);
+    EXPECT_DOUBLE_EQ(run.yAdvances[0], 0.0);
+    EXPECT_DOUBLE_EQ(run.yAdvances[1], 10.0);
+    EXPECT_EQ(run.rotated[0], 0);
+
+    // 横書きでは縦中横にしない
+    block = engine.typeset(u8"第12回", style, 100.0, false);
+    EXPECT_DOUBLE_EQ(block.lines[0].width, 30.0);
+    for (const auto& lineRun : block.lines[0].runs) {
+        EXPECT_NE(lineRun.orientation, GlyphOrientation::TateChuYoko);
+    }
+}
+
+// 縦書き用字形への置き換えが、命令セットによらず同じ結果になり、置き換えのない文字列を変更しないことの検証
+TEST(TypesettingTest, ConvertsVerticalFormsInPlace) {
+    using japanese_typesetting::core::typesetting::SimdLevel;
+    using japanese_typesetting::core::typesetting::VerticalLayoutProcessor;
+    namespace ts = japanese_typesetting::core::typesetting;
+
+    japanese_typesetting::core::unicode::UnicodeHandler unicodeHandler;
+    VerticalLayoutProcessor processor(unicodeHandler);
+    EXPECT_EQ(processor.convertToVertical(U'('), U'︵');
+    EXPECT_EQ(processor.convertToVertical(U'あ'), U'あ');
+    EXPECT_EQ(processor.convertToHorizontal(U'︙'), U'…');
+
+    SimdLevel original = ts::getSimdLevel();
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2}) {
+        ts::setSimdLevel(level);
+
+        // かな・漢字だけの文字列は変更しない
+        std::u32string plain = U"吾輩は猫である。名前はまだ無い。";
+        EXPECT_EQ(processor.convertToVerticalInPlace(plain), 0u);
+        EXPECT_EQ(plain, U"吾輩は猫である。名前はまだ無い。");
+
+        // ベクトル幅をまたぐ位置の文字も置き換える
+        std::u32string text = U"あいうえおかきく(けこ)さしすせそ[たち]…abc－";
+        std::u32string expected = U"あいうえおかきく︵けこ︶さしすせそ﹇たち﹈︙abc｜";
+        EXPECT_EQ(processor.convertToVertical(text), expected);
+        EXPECT_EQ(processor.convertToVerticalInPlace(text), 6u);
+        EXPECT_EQ(text, expected);
+
+        // 横書きに戻すと元に戻る
+        EXPECT_EQ(processor.convertToHorizontalInPlace(text), 6u);
+        EXPECT_EQ(text, U"あいうえおかきく(けこ)さしすせそ[たち]…abc－");
+    }
+    ts::setSimdLevel(original);
+}
+
+// ルビのマークアップが1回の走査で取り除かれ、注釈が親文字とルビの範囲として記録されることの検証
+TEST(TypesettingTest, ScansRubyMarkupIntoSpans) {
+    using japanese_typesetting::core::typesetting::RubyProcessor;
+    using japanese_typesetting::core::typesetting::RubySpan;
+    namespace ts = japanese_typesetting::core::typesetting;
+
+    std::pmr::u32string clean;
+    std::pmr::u32string rubyText;
+    std::pmr::vector<RubySpan> spans;
+
+    // 記号を含まない場合は何もしない
+    std::u32string plain = U"吾輩は猫である。";
+    EXPECT_FALSE(ts::scanRubyMarkup(plain.data(), plain.size(), clean, rubyText, spans));
+
+    // 「｜」のない親文字は直前の同じ字種の並び、「｜」があればそこから
+    std::u32string text = U"日本語《にほんご》の｜東京タワー《とうきょうたわー》とカタカナ《るび》";
+    ASSERT_TRUE(ts::scanRubyMarkup(text.data(), text.size(), clean, rubyText, spans));
+    EXPECT_EQ(std::u32string(clean), U"日本語の東京タワーとカタカナ");
+    ASSERT_EQ(spans.size(), 3u);
+    EXPECT_EQ(spans[0].baseStart, 0u);
+    EXPECT_EQ(spans[0].baseLength, 3u);
+    EXPECT_EQ(std::u32string(rubyText.substr(spans[0].rubyStart, spans[0].rubyLength)), U"にほんご");
+    EXPECT_EQ(std::u32string(clean.substr(spans[1].baseStart, spans[1].baseLength)), U"東京タワー");
+    EXPECT_EQ(std::u32string(clean.substr(spans[2].baseStart, spans[2].baseLength)), U"カタカナ");
+    EXPECT_EQ(std::u32string(rubyText.substr(spans[2].rubyStart, spans[2].rubyLength)), U"るび");
+
+    // 閉じられない「《」や注釈にならない「｜」は本文に残る
+    text = U"｜あ《い\n｜｜う《》え》";
+    ASSERT_TRUE(ts::scanRubyMarkup(text.data(), text.size(), clean, rubyText, spans));
+    EXPECT_EQ(std::u32string(clean), text);
+    EXPECT_TRUE(spans.empty());
+
+    // 対応しない記号が大量に続いても1回の走査で終わる
+    std::u32string noisy;
+    for (int i = 0; i < 20000; ++i) {
+        noisy += U"｜《あ";
+    }
+    ASSERT_TRUE(ts::scanRubyMarkup(noisy.data(), noisy.size(), clean, rubyText, spans));
+    EXPECT_EQ(clean.size(), noisy.size());
+    EXPECT_TRUE(spans.empty());
+
+    // RubyProcessorは入力内の位置を返す
+    RubyProcessor processor;
+    auto rubies = processor.parseRuby(U"これは｜漢字《かんじ》です");
+    ASSERT_EQ(rubies.size(), 1u);
+    EXPECT_EQ(rubies[0].base, U"漢字");
+    EXPECT_EQ(rubies[0].ruby, U"かんじ");
+    EXPECT_EQ(rubies[0].startPos, 3u);
+    EXPECT_EQ(rubies[0].endPos, 11u);
+
+    // 組版結果の行は親文字だけを含み、注釈は行ごとの別表に入る
+    Style style;
+    style.setFontSize(10.0);
+    TypesettingEngine engine;
+    engine.setLayoutCache(nullptr);
+    TextBlock block = engine.typeset(u8"漢字《かんじ》です", style, 100.0, false);
+    ASSERT_EQ(block.lines.size(), 1u);
+    EXPECT_EQ(block.lines[0].text, U"漢字です");
+    EXPECT_DOUBLE_EQ(block.lines[0].width, 40.0);
+    ASSERT_EQ(block.lines[0].rubies.size(), 1u);
+    EXPECT_EQ(block.lines[0].rubies[0].baseLength, 2u);
+    EXPECT_EQ(block.lines[0].rubyText, U"かんじ");
+}
+
+// モノ・グループ・熟語ルビの配置、かなへの掛かり、親文字の途中で改行しないことの検証
+TEST(TypesettingTest, LaysOutRubyDuringLineBreaking) {
+    namespace ts = japanese_typesetting::core::typesetting;
+    using japanese_typesetting::core::style::RubyAlignment;
+    using japanese_typesetting::core::style::TextAlignment;
+
+    Style style;
+    style.setFontSize(10.0);
+    style.setTextAlignment(TextAlignment::Left);
+    TypesettingEngine engine;
+    engine.setLayoutCache(nullptr);
+
+    // 熟語ルビ：各字のルビが親文字に収まればモノルビとして1字ごとに分ける
+    TextBlock block = engine.typeset(u8"山川《やまかわ》", style, 100.0, false);
+    ASSERT_EQ(block.lines.size(), 1u);
+    ASSERT_EQ(block.lines[0].rubies.size(), 2u);
+    EXPECT_EQ(block.lines[0].rubies[1].baseStart, 1u);
+    EXPECT_EQ(block.lines[0].rubies[1].rubyLength, 2u);
+
+    // 収まらない場合はグループルビ
+    block = engine.typeset(u8"東京《とうきょう》", style, 100.0, false);
+    ASSERT_EQ(block.lines[0].rubies.size(), 1u);
+    EXPECT_EQ(block.lines[0].rubies[0].baseLength, 2u);
+
+    // ルビが長い場合、前後のかなにはルビ1字分まで掛け、かな以外の隣では親文字の前後を空ける
+    block = engine.typeset(u8"の漢《かんじ》の", style, 100.0, false);
+    EXPECT_DOUBLE_EQ(block.lines[0].width, 30.0);
+    ASSERT_EQ(block.lines[0].rubies.size(), 1u);
+    EXPECT_EQ(block.lines[0].rubies[0].rubyOffset, ts::toLayoutUnit(-2.5));
+    EXPECT_EQ(block.lines[0].rubies[0].rubyWidth, ts::toLayoutUnit(15.0));
+    block = engine.typeset(u8"川｜漢《かんじ》川", style, 100.0, false);
+    EXPECT_DOUBLE_EQ(block.lines[0].width, 35.0);
+    ASSERT_EQ(block.lines[0].advanceDeltas.size(), 3u);
+    EXPECT_DOUBLE_EQ(block.lines[0].advanceDeltas[0], 2.5);
+    EXPECT_DOUBLE_EQ(block.lines[0].advanceDeltas[1], 2.5);
+
+    // グループルビの親文字は途中で改行せず、まとめて次の行に送る
+    style.setRubyAlignment(RubyAlignment::Group);
+    block = engine.typeset(u8"あいう山川《やまかわ》", style, 40.0, false);
+    ASSERT_EQ(block.lines.size(), 2u);
+    EXPECT_EQ(block.lines[0].text, U"あいう");
+    EXPECT_EQ(block.lines[1].text, U"山川");
+    ASSERT_EQ(block.lines[1].rubies.size(), 1u);
+    EXPECT_EQ(block.lines[1].rubies[0].baseLength, 2u);
+
+    // モノルビは親文字の間で改行できる
+    style.setRubyAlignment(RubyAlignment::Mono);
+    block = engine.typeset(u8"あいう山川《やまかわ》", style, 40.0, false);
+    ASSERT_EQ(block.lines.size(), 2u);
+    EXPECT_EQ(block.lines[0].text, U"あいう山");
+    EXPECT_EQ(block.lines[1].rubyText, U"かわ");
+
+    // 同じ親文字とルビの組の配置はキャッシュから取り出す
+    engine.typeset(u8"の漢《かんじ》の", style, 100.0, false);
+    ts::RubyLayoutCacheStats before = ts::RubyLayoutCache::getInstance().getStats();
+    engine.typeset(u8"の漢《かんじ》の", style, 100.0, false);
+    ts::RubyLayoutCacheStats after = ts::RubyLayoutCache::getInstance().getStats();
+    EXPECT_GT(after.hits, before.hits);
+    EXPECT_EQ(after.misses, before.misses);
+
+    // 共有されたスタイルではルビのスタイルを派生のキャッシュから引き、同じ結果になる
+    using japanese_typesetting::core::style::StyleInterner;
+    auto handle = StyleInterner::getInstance().intern(style);
+    TextBlock shared = engine.typeset(u8"の漢《かんじ》の", handle, 100.0, false);
+    size_t interned = StyleInterner::getInstance().size();
+    engine.typeset(u8"の漢《かんじ》の", handle, 100.0, false);
+    EXPECT_EQ(StyleInterner::getInstance().size(), interned);
+    EXPECT_EQ(shared.lines[0].rubies[0].rubyWidth, ts::toLayoutUnit(15.0));
+}
+
+TEST(TypesettingTest, LaysOutEmphasisMarksAndSidelines) {
+    namespace ts = japanese_typesetting::core::typesetting;
+    using japanese_typesetting::core::style::TextAlignment;
+
+    Style style;
+    style.setFontSize(10.0);
+    style.setLineHeight(1.5);
+    style.setTextAlignment(TextAlignment::Left);
+    TypesettingEngine engine;
+    engine.setLayoutCache(nullptr);
+
+    // 《《》》で囲んだ文字は圏点のランになり、約物には圏点を付けない
+    TextBlock block = engine.typeset(u8"これは《《重、要》》です", style, 200.0, false);
+    ASSERT_EQ(block.lines.size(), 1u);
+    const auto& line = block.lines[0];
+    EXPECT_EQ(line.text, U"これは重、要です");
+    auto emphasized = std::find_if(line.runs.begin(), line.runs.end(),
+                                   [](const ts::TextRun& run) { return run.emphasis != ts::EmphasisMark::None; });
+    ASSERT_NE(emphasized, line.runs.end());
+    EXPECT_EQ(emphasized->start, 3u);
+    EXPECT_EQ(emphasized->emphasis, ts::EmphasisMark::FilledSesame);
+    ASSERT_EQ(line.annotations.size(), 2u);
+    EXPECT_EQ(line.annotations[0].start, 3u);
+    EXPECT_DOUBLE_EQ(line.annotations[0].inlineStart, 30.0);
+    EXPECT_EQ(line.annotations[1].start, 5u);
+    EXPECT_DOUBLE_EQ(line.annotationOver, 5.0);
+    EXPECT_DOUBLE_EQ(line.height, 15.0);
+
+    // 青空文庫形式の注記は前の文字列に掛かり、注記自体は本文から取り除く
+    block = engine.typeset(u8"彼は走った［＃「走った」に二重傍線］", style, 200.0, false);
+    EXPECT_EQ(block.lines[0].text, U"彼は走った");
+    ASSERT_EQ(block.lines[0].annotations.size(), 1u);
+    EXPECT_EQ(block.lines[0].annotations[0].sideline, ts::Sideline::Double);
+    EXPECT_EQ(block.lines[0].annotations[0].start, 2u);
+    EXPECT_EQ(block.lines[0].annotations[0].length, 3u);
+    EXPECT_DOUBLE_EQ(block.lines[0].annotations[0].inlineEnd, 50.0);
+    EXPECT_DOUBLE_EQ(block.lines[0].annotationUnder, 2.5);
+
+    // 対象の文字列が直前にない注記はそのまま残す
+    block = engine.typeset(u8"あ［＃「い」に傍点］", style, 200.0, false);
+    EXPECT_EQ(block.lines[0].text, U"あ［＃「い」に傍点］");
+    EXPECT_TRUE(block.lines[0].annotations.empty());
+
+    // ルビだけなら行間に収まり、ルビのある文字に圏点を付けると外側に置いて行を高くする
+    block = engine.typeset(u8"｜漢《かんじ》", style, 200.0, false);
+    EXPECT_DOUBLE_EQ(block.lines[0].height, 15.0);
+    block = engine.typeset(u8"｜漢《かんじ》［＃「漢」に白丸傍点］", style, 200.0, false);
+    ASSERT_EQ(block.lines[0].annotations.size(), 1u);
+    EXPECT_EQ(block.lines[0].annotations[0].emphasis, ts::EmphasisMark::OpenCircle);
+    EXPECT_DOUBLE_EQ(block.lines[0].annotations[0].blockOffset, 5.0);
+    EXPECT_DOUBLE_EQ(block.lines[0].annotationOver, 10.0);
+    EXPECT_DOUBLE_EQ(block.lines[0].height, 20.0);
+    EXPECT_DOUBLE_EQ(block.lines[0].baseline, 13.0);
+}
+
+TEST(TypesettingTest, LaysOutCharactersOnGrid) {
+    Style style;
+    style.setFontSize(10.0);
+    style.setGridLayout(true);
+    TypesettingEngine engine;
+    engine.setLayoutCache(nullptr);
+
+    // 1行の字数は最大幅を1字分で割って切り捨てたもの（行の伸縮は行わない）
+    TextBlock block = engine.typeset(u8"あいうえおかきくけこ", style, 45.0, false);
+    ASSERT_EQ(block.lines.size(), 3u);
+    EXPECT_EQ(block.lines[0].text, U"あいうえ");
+    EXPECT_DOUBLE_EQ(block.lines[0].width, 40.0);
+    EXPECT_TRUE(block.lines[0].advanceDeltas.empty());
+    EXPECT_DOUBLE_EQ(block.lines[2].width, 20.0);
+
+    // 句点は升目の外にぶら下げ、長音記号は前の字を追い出し、始め括弧は次の行に送る
+    block = engine.typeset(u8"あいうえ。かき", style, 40.0, false);
+    ASSERT_EQ(block.lines.size(), 2u);
+    EXPECT_EQ(block.lines[0].text, U"あいうえ。");
+    EXPECT_DOUBLE_EQ(block.lines[0].width, 45.0);
+    block = engine.typeset(u8"あいうえーか", style, 40.0, false);
+    EXPECT_EQ(block.lines[0].text, U"あいう");
+    EXPECT_EQ(block.lines[1].text, U"えーか");
+    block = engine.typeset(u8"あいう「えお」", style, 40.0, false);
+    EXPECT_EQ(block.lines[0].text, U"あいう");
+    EXPECT_EQ(block.lines[1].text, U"「えお」");
+
+    // 半角の範囲はプロポーショナルに組み、升目の整数倍に切り上げた余りを末尾に空ける
+    block = engine.typeset(u8"あabcい\nう", style, 40.0, false);
+    ASSERT_EQ(block.lines.size(), 2u);
+    EXPECT_EQ(block.lines[0].text, U"あabcい");
+    EXPECT_TRUE(block.lines[0].hasLineBreak);
+    EXPECT_DOUBLE_EQ(block.lines[0].width, 40.0);
+    ASSERT_EQ(block.lines[0].advanceDeltas.size(), 5u);
+    EXPECT_DOUBLE_EQ(block.lines[0].advanceDeltas[3], 5.0);
+
+    // 縦中横は1字分の升目に置く
+    block = engine.typeset(u8"あ12いう", style, 30.0, true);
+    ASSERT_EQ(block.lines.size(), 2u);
+    EXPECT_EQ(block.lines[0].text, U"あ12い");
+    EXPECT_DOUBLE_EQ(block.lines[0].width, 30.0);
+
+    // 字詰めかどうかは組版結果のキャッシュで区別する
+    using japanese_typesetting::core::style::StyleInterner;
+    Style proportional = style;
+    proportional.setGridLayout(false);
+    EXPECT_NE(StyleInterner::hashLayoutFields(proportional), StyleInterner::hashLayoutFields(style));
+}
+
+// 送り幅の索引が挿入・削除の後も累積和の配列と一致し、行分割に使えることの検証
+TEST(TypesettingTest, WidthIndexFollowsEdits) {
+    using japanese_typesetting::core::typesetting::AdvanceWidthIndex;
+    using japanese_typesetting::core::typesetting::GlyphAdvanceCache;
+    using japanese_typesetting::core::typesetting::LineBreaker;
+    using japanese_typesetting::core::typesetting::TypesettingRules;
+    namespace ts = japanese_typesetting::core::typesetting;
+
+    Style style;
+    style.setFontSize(10.0);
+    auto table = GlyphAdvanceCache::getInstance().preload(style, false);
+
+    std::u32string text(U"吾輩は猫である。名前はまだ無い。");
+    AdvanceWidthIndex index;
+    index.assign(*table, text.data(), text.size());
+
+    auto expectMatches = [&]() {
+        ASSERT_EQ(index.size(), text.size());
+        std::vector<int64_t> prefix(text.size() + 1);
+        ts::prefixAdvances(*table, text.data(), text.size(), prefix.data());
+        for (size_t i = 0; i <= text.size(); ++i) {
+            EXPECT_EQ(index.prefix(i), prefix[i]) << "position " << i;
+            if (i < text.size()) {
+                EXPECT_EQ(index.advanceAt(i), table->getAdvanceUnits(text[i]));
+            }
+        }
+        EXPECT_EQ(index.width(2, 7), prefix[7] - prefix[2]);
+        // 幅から位置を引くと、その幅に収まる最大の文字数になる
+        for (size_t i = 0; i <= text.size(); ++i) {
+            size_t position = index.findPosition(prefix[i]);
+            EXPECT_LE(index.prefix(position), prefix[i]);
+            EXPECT_TRUE(position == text.size() || index.prefix(position + 1) > prefix[i]);
+        }
+    };
+    expectMatches();
+
+    // 索引を使った行分割は、編集した段落だけを分割し直しても全体を分割し直した結果と一致し、
+    // 累積和を使う行分割（breakLines）の各行の終了位置とも一致する
+    TypesettingRules rules;
+    rules.setDefaultJisX4051Rules();
+    japanese_typesetting::core::unicode::UnicodeHandler unicodeHandler;
+    LineBreaker breaker(rules, unicodeHandler);
+    auto lineEnds = [&](const std::u32string& source) {
+        std::vector<size_t> ends;
+        size_t end = 0;
+        for (const auto& line : breaker.breakLines(source, style, 60.0, false)) {
+            end += line.size();
+            if (end < source.size()) {
+                ends.push_back(end);
+            }
+        }
+        return ends;
+    };
+    std::vector<size_t> breaks = breaker.breakPositions(text, index, 60.0);
+    EXPECT_EQ(breaks, lineEnds(text));
+
+    // 入力中の編集を模して、先頭・途中・末尾への挿入と削除を繰り返す
+    const std::u32string insertion(U"Japanで\n");
+    uint32_t seed = 12345;
+    for (int round = 0; round < 40; ++round) {
+        seed = seed * 1103515245u + 12345u;
+        size_t position = (seed >> 8) % (text.size() + 1);
+        size_t removed = 0;
+        size_t inserted = 0;
+        if (round % 3 == 2 && !text.empty()) {
+            size_t length = 1 + (seed >> 20) % 3;
+            index.erase(position, length);
+            if (position < text.size()) {
+                removed = std::min(length, text.size() - position);
+                text.erase(position, length);
+            }
+        } else {
+            inserted = 1 + (seed >> 16) % insertion.size();
+            index.insert(position, *table, insertion.data(), inserted);
+            text.insert(position, insertion, 0, inserted);
+        }
+        expectMatches();
+        breaks = breaker.breakPositions(text, index, 60.0, breaks, position, removed, inserted);
+        EXPECT_EQ(breaks, breaker.breakPositions(text, index, 60.0)) << "round " << round;
+        EXPECT_EQ(breaks, lineEnds(text)) << "round " << round;
+    }
+
+    // 改行文字の後では必ず分かれ、改行文字をまたぐ行は作らない
+    std::u32string paragraph(U"あいうえおかきくけこ\nさし");
+    AdvanceWidthIndex paragraphIndex;
+    paragraphIndex.assign(*table, paragraph.data(), paragraph.size());
+    std::vector<size_t> paragraphBreaks = breaker.breakPositions(paragraph, paragraphIndex, 60.0);
+    EXPECT_EQ(paragraphBreaks, lineEnds(paragraph));
+    ASSERT_FALSE(paragraphBreaks.empty());
+    EXPECT_EQ(paragraphBreaks.back(), 11u);
+
+    // 最後の行が最大幅を超える場合も、収まるように分割する（1語が最大幅を超える行だけがはみ出す）
+    std::u32string words(U"ab cd efgh ijklmnop qr st uvwxyz ab cdefg hij");
+    AdvanceWidthIndex wordsIndex;
+    wordsIndex.assign(*table, words.data(), words.size());
+    std::vector<size_t> wordBreaks = breaker.breakPositions(words, wordsIndex, 60.0);
+    EXPECT_EQ(wordBreaks, lineEnds(words));
+    ASSERT_FALSE(wordBreaks.empty());
+    size_t lineStart = 0;
+    for (size_t i = 0; i <= wordBreaks.size(); ++i) {
+        size_t lineEnd = i < wordBreaks.size() ? wordBreaks[i] : words.size();
+        std::u32string line = words.substr(lineStart, lineEnd - lineStart);
+        if (line.find(U' ') < line.size() - 1) {
+            EXPECT_LE(wordsIndex.width(lineStart, lineEnd), japanese_typesetting::core::typesetting::toLayoutUnit(60.0))
+                << "line " << i;
+        }
+        lineStart = lineEnd;
+    }
+
+    index.clear();
+    EXPECT_EQ(index.size(), 0u);
+    EXPECT_EQ(index.prefix(3), 0);
+}